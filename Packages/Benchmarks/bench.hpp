@@ -0,0 +1,128 @@
+/*
+  bench.hpp
+
+  Shared harness for the benchmarks: argument handling, the report
+  header, and tracking whether the implementations being compared
+  gave the same results.
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_BENCH_HPP)
+#define LOOS_BENCH_HPP
+
+#include <loos.hpp>
+
+
+namespace bench {
+
+
+  //! Exits with the usage message unless at least \a nargs arguments were given
+  inline void checkUsage(const int argc, const uint nargs, const std::string& usage) {
+    if (argc < static_cast<int>(nargs) + 1) {
+      std::cerr << "Usage- " << usage << std::endl;
+      exit(-1);
+    }
+  }
+
+
+  //! Optional unsigned argument \a i, or \a def if it wasn't given
+  inline uint argument(const int argc, char *argv[], const int i, const uint def) {
+    return((argc > i) ? strtoul(argv[i], 0, 10) : def);
+  }
+
+  //! Optional string argument \a i, or \a def if it wasn't given
+  inline std::string argument(const int argc, char *argv[], const int i, const std::string& def) {
+    return((argc > i) ? std::string(argv[i]) : def);
+  }
+
+  //! Number of repeats from argument \a i (at least one)
+  inline uint repeats(const int argc, char *argv[], const int i, const uint def) {
+    uint n = argument(argc, argv, i, def);
+    return(n == 0 ? 1 : n);
+  }
+
+
+  //! Number of threads to report for a requested count (0 = all cores)
+  inline uint threadCount(const uint n) {
+    return(n ? n : boost::thread::hardware_concurrency());
+  }
+
+
+  //! True if the coordinates are exactly the same
+  inline bool identical(const std::vector<loos::GCoord>& a, const std::vector<loos::GCoord>& b) {
+    if (a.size() != b.size())
+      return(false);
+    for (uint i=0; i<a.size(); ++i)
+      for (uint j=0; j<3; ++j)
+        if (a[i][j] != b[i][j])
+          return(false);
+    return(true);
+  }
+
+
+  //! Writes the report header and keeps track of mismatches
+  /**
+   * The report starts with the invocation header.  Further comment
+   * lines (a summary and the column headings) are written with
+   * comment().  Each timing line appends check(), which flags it if
+   * the results did not match the reference, and finish() exits with
+   * an error if any did.
+   */
+  class Report {
+  public:
+    Report(int argc, char *argv[]) : _mismatch(false) {
+      std::cout << "# " << loos::invocationHeader(argc, argv) << std::endl;
+    }
+
+    //! Starts a comment line in the report
+    std::ostream& comment() { return(std::cout << "# "); }
+
+    //! Returns the note to append to a timing line
+    std::string check(const bool matched) {
+      if (matched)
+        return("");
+      _mismatch = true;
+      return("\t[MISMATCH]");
+    }
+
+    bool mismatched() const { return(_mismatch); }
+
+    //! Exits with \a error if anything did not match
+    void finish(const std::string& error) const {
+      if (_mismatch) {
+        std::cerr << "Error- " << error << std::endl;
+        exit(-1);
+      }
+    }
+
+  private:
+    bool _mismatch;
+  };
+
+
+}
+
+
+#endif
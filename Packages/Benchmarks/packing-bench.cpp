@@ -0,0 +1,112 @@
+/*
+  packing-bench.cpp
+
+  Times reading a trajectory and computing the centroid of a selection
+  with the model's coordinates held in each Atom versus packed into a
+  contiguous CoordinateStore (see AtomicGroup::packCoords()), and
+  verifies that both give the same results.  It also checks that
+  packing a subset selected from a packed model takes the atoms out of
+  the model's store rather than leaving the model with stale packed
+  coordinates.
+
+  usage:
+    packing-bench model trajectory [selection [repeats]]
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <loos.hpp>
+#include "bench.hpp"
+
+using namespace std;
+using namespace loos;
+
+
+// Reads every frame into model, returning the elapsed time and the
+// centroids of model and subset for each frame
+double timeCentroids(const AtomicGroup& model, const AtomicGroup& subset, pTraj& traj,
+                     vector<GCoord>& model_centroids, vector<GCoord>& subset_centroids) {
+  AtomicGroup group(model);
+  model_centroids.clear();
+  subset_centroids.clear();
+
+  Timer<WallTimer> timer;
+  timer.start();
+  traj->rewind();
+  while (traj->readFrame()) {
+    traj->updateGroupCoords(group);
+    model_centroids.push_back(group.centroid());
+    subset_centroids.push_back(subset.centroid());
+  }
+  timer.stop();
+
+  return(timer.elapsed());
+}
+
+
+int main(int argc, char *argv[]) {
+  bench::checkUsage(argc, 2, "packing-bench model trajectory [selection [repeats]]");
+
+  bench::Report report(argc, argv);
+  string selection = bench::argument(argc, argv, 3, string("name == 'CA'"));
+  uint repeats = bench::repeats(argc, argv, 4, 1);
+
+  AtomicGroup model = createSystem(argv[1]);
+  pTraj traj = createTrajectory(argv[2], model);
+  AtomicGroup subset = selectAtoms(model, selection);
+
+  vector<GCoord> ref_model, ref_subset;
+  double ref_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    ref_time += timeCentroids(model, subset, traj, ref_model, ref_subset);
+  ref_time /= repeats;
+
+  model.packCoords();
+  vector<GCoord> packed_model, packed_subset;
+  double packed_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    packed_time += timeCentroids(model, subset, traj, packed_model, packed_subset);
+  packed_time /= repeats;
+  bool packed_match = bench::identical(ref_model, packed_model) && bench::identical(ref_subset, packed_subset);
+
+  // Packing the subset moves its atoms into a new store, so the model
+  // must no longer use its old one...
+  subset.packCoords();
+  vector<GCoord> sub_model, sub_subset;
+  double sub_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    sub_time += timeCentroids(model, subset, traj, sub_model, sub_subset);
+  sub_time /= repeats;
+  bool sub_match = !model.isPacked() && subset.isPacked()
+    && bench::identical(ref_model, sub_model) && bench::identical(ref_subset, sub_subset);
+
+  report.comment() << model.size() << " atoms, " << subset.size() << " selected, "
+                   << ref_model.size() << " frames, " << repeats << " repeats\n";
+  report.comment() << "Method\tTime (s)\tFrames/s\n";
+  cout << "Unpacked\t" << ref_time << "\t" << ref_model.size() / ref_time << endl;
+  cout << "Packed\t" << packed_time << "\t" << packed_model.size() / packed_time << report.check(packed_match) << endl;
+  cout << "Subset packed\t" << sub_time << "\t" << sub_model.size() / sub_time << report.check(sub_match) << endl;
+
+  report.finish("packed coordinates do not match the unpacked ones");
+}
@@ -0,0 +1,187 @@
+/*
+  pdb-bench.cpp
+
+  Times reading the ATOM records of a PDB with the original
+  stringstream-based field parsing versus the in-place parser used by
+  the PDB class (serially and with multiple threads), and verifies
+  that all give the same atoms.
+
+  usage:
+    pdb-bench pdb [threads [repeats]]
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <loos.hpp>
+#include <boost/filesystem.hpp>
+#include "bench.hpp"
+
+using namespace std;
+using namespace loos;
+
+
+// The ATOM record parsing from PDB before it was changed to parse in
+// place, using parseStringAs() for each field
+pAtom parseReference(const string& s) {
+  pAtom pa(new Atom);
+
+  pa->recordName(parseStringAs<string>(s, 0, 6));
+  pa->id(parseStringAsHybrid36(s, 6, 5));
+  pa->name(parseStringAs<string>(s, 12, 4));
+  pa->altLoc(parseStringAs<string>(s, 16, 1));
+  pa->resname(parseStringAs<string>(s, 17, 4));
+  pa->chainId(parseStringAs<string>(s, 21, 1));
+  pa->resid(parseStringAsHybrid36(s, 22, 4));
+
+  string t = parseStringAs<string>(s, 26, 1);
+  char c = t[0];
+  if (c != ' ' && isdigit(c)) {
+    pa->resid(parseStringAs<int>(s, 22, 5));
+    t = " ";
+  }
+  pa->iCode(t);
+
+  GCoord x;
+  x[0] = parseStringAs<float>(s, 30, 8);
+  x[1] = parseStringAs<float>(s, 38, 8);
+  x[2] = parseStringAs<float>(s, 46, 8);
+  pa->coords(x);
+
+  if (s.size() > 54) {
+    pa->occupancy(parseStringAs<float>(s, 54, 6));
+    if (s.size() > 60) {
+      pa->bfactor(parseStringAs<float>(s, 60, 6));
+      if (s.size() > 72) {
+        pa->segid(parseStringAs<string>(s, 72, 4));
+        if (s.size() > 76)
+          pa->PDBelement(parseStringAs<string>(s, 76, 2));
+      }
+    }
+  }
+
+  return(pa);
+}
+
+
+double timeReference(const string& fname, AtomicGroup& model) {
+  Timer<WallTimer> timer;
+  timer.start();
+
+  ifstream ifs(fname.c_str());
+  if (!ifs)
+    throw(FileOpenError(fname));
+
+  AtomicGroup g;
+  string line;
+  while (getline(ifs, line)) {
+    if (line.compare(0, 4, "ATOM") == 0 || line.compare(0, 6, "HETATM") == 0)
+      g.append(parseReference(line));
+    else if (line.compare(0, 3, "END") == 0)
+      break;
+  }
+  timer.stop();
+
+  model = g;
+  return(timer.elapsed());
+}
+
+
+double timePDB(const string& fname, const uint nthreads, AtomicGroup& model) {
+  PDB::parseThreads(nthreads);
+
+  Timer<WallTimer> timer;
+  timer.start();
+  PDB pdb(fname);
+  timer.stop();
+
+  model = pdb;
+  return(timer.elapsed());
+}
+
+
+bool identical(const AtomicGroup& a, const AtomicGroup& b) {
+  if (a.size() != b.size())
+    return(false);
+
+  for (uint i=0; i<a.size(); ++i) {
+    const Atom& x = *(a[i]);
+    const Atom& y = *(b[i]);
+    if (x.recordName() != y.recordName() || x.id() != y.id() || x.name() != y.name()
+        || x.altLoc() != y.altLoc() || x.resname() != y.resname() || x.chainId() != y.chainId()
+        || x.resid() != y.resid() || x.iCode() != y.iCode() || x.segid() != y.segid()
+        || x.PDBelement() != y.PDBelement() || x.occupancy() != y.occupancy()
+        || x.bfactor() != y.bfactor())
+      return(false);
+    for (uint j=0; j<3; ++j)
+      if (x.coords()[j] != y.coords()[j])
+        return(false);
+  }
+
+  return(true);
+}
+
+
+
+int main(int argc, char *argv[]) {
+  bench::checkUsage(argc, 1, "pdb-bench pdb [threads [repeats]]");
+
+  bench::Report report(argc, argv);
+  string fname(argv[1]);
+  uint nthreads = bench::argument(argc, argv, 2, 0u);
+  uint repeats = bench::repeats(argc, argv, 3, 1);
+
+  AtomicGroup reference;
+  double ref_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    ref_time += timeReference(fname, reference);
+  ref_time /= repeats;
+
+  double mbytes = static_cast<double>(boost::filesystem::file_size(fname)) / megabytes;
+
+  report.comment() << reference.size() << " atoms, " << mbytes << " MB, " << repeats << " repeats\n";
+  report.comment() << "Method\tThreads\tTime (s)\tMB/s\n";
+  cout << "parseStringAs\t1\t" << ref_time << "\t" << mbytes / ref_time << endl;
+
+  uint threads[2] = { 1, nthreads };
+  for (uint k=0; k<2; ++k) {
+    if (k > 0 && nthreads == 1)
+      break;
+
+    AtomicGroup model;
+    double pdb_time = 0.0;
+    for (uint r=0; r<repeats; ++r)
+      pdb_time += timePDB(fname, threads[k], model);
+    pdb_time /= repeats;
+
+    // Large PDBs are renumbered, so compare the atoms without that...
+    if (reference.size() >= 100000)
+      for (uint i=0; i<model.size(); ++i)
+        model[i]->id(reference[i]->id());
+
+    cout << "PDB\t" << bench::threadCount(threads[k]) << "\t"
+         << pdb_time << "\t" << mbytes / pdb_time << report.check(identical(reference, model)) << endl;
+  }
+
+  report.finish("in-place parsing does not match the stringstream parsing");
+}
@@ -0,0 +1,111 @@
+/*
+  selection-bench.cpp
+
+  Times atom selection using the Kernel's stack machine versus the
+  compiled predicate tree, and verifies that both give the same atoms.
+
+  usage:
+    selection-bench model [repeats [selection ...]]
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <loos.hpp>
+#include "bench.hpp"
+
+using namespace std;
+using namespace loos;
+
+
+const char* default_selections[] = {
+  "all",
+  "name == 'CA'",
+  "resid >= 10 && resid <= 100",
+  "name =~ '^C' && !hydrogen",
+  "backbone",
+  "segid == 'PROT' || resname =~ 'LYS|ARG'",
+  "(name -> 'C(\\d+)') > 2 && !(resname == 'SOL' || resname == 'WAT')",
+  "!hydrogen && (resname != 'ALA' || name == 'CB')",
+  0
+};
+
+
+// Returns the time per repeat, storing the selected group
+double timeSelection(const AtomicGroup& model, const string& selection, const bool compile, const uint repeats, AtomicGroup& result) {
+  Parser parser(selection);
+  KernelSelector sel(parser.kernel(), compile);
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint i=0; i<repeats; ++i)
+    result = model.select(sel);
+  timer.stop();
+
+  return(timer.elapsed() / repeats);
+}
+
+
+
+int main(int argc, char *argv[]) {
+  bench::checkUsage(argc, 1, "selection-bench model [repeats [selection ...]]");
+
+  bench::Report report(argc, argv);
+  AtomicGroup model = createSystem(argv[1]);
+  uint repeats = bench::repeats(argc, argv, 2, 10);
+
+  vector<string> selections;
+  if (argc > 3)
+    for (int i=3; i<argc; ++i)
+      selections.push_back(argv[i]);
+  else
+    for (uint i=0; default_selections[i] != 0; ++i)
+      selections.push_back(default_selections[i]);
+
+  report.comment() << model.size() << " atoms, " << repeats << " repeats\n";
+  report.comment() << "Kernel (s)\tCompiled (s)\tSpeedup\tAtoms\tSelection\n";
+
+  for (vector<string>::const_iterator i = selections.begin(); i != selections.end(); ++i) {
+    AtomicGroup by_kernel, by_tree;
+    double kernel_time, tree_time;
+
+    try {
+      kernel_time = timeSelection(model, *i, false, repeats, by_kernel);
+      tree_time = timeSelection(model, *i, true, repeats, by_tree);
+    }
+    catch (exception& e) {
+      cout << "-\t-\t-\t-\t" << *i << " [" << e.what() << "]\n";
+      continue;
+    }
+
+    Parser parser(*i);
+    KernelSelector sel(parser.kernel());
+    string note = sel.isCompiled() ? "" : "\t[not compiled]";
+
+    cout << kernel_time << "\t" << tree_time << "\t"
+         << (tree_time > 0.0 ? kernel_time / tree_time : 0.0) << "\t"
+         << by_kernel.size() << "\t" << *i << note << report.check(by_kernel == by_tree) << endl;
+  }
+
+  report.finish("compiled selections do not match the Kernel");
+}
@@ -0,0 +1,216 @@
+/*
+  superposition-bench.cpp
+
+  Times the SVD and QCP superposition kernels for all pairs of frames
+  in a trajectory and verifies that they agree.  Also times computing
+  the RMSD of every frame to one reference, one frame at a time versus
+  in blocks with ReferenceSuperposition.
+
+  usage:
+    superposition-bench model trajectory [selection [repeats [threads]]]
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <loos.hpp>
+#include "bench.hpp"
+
+using namespace std;
+using namespace loos;
+
+typedef vector<alignment::vecDouble>    vMatrix;
+
+
+// Largest allowed difference in RMSD (in Angstroms) between methods.
+// QCP typically agrees with SVD to ~1e-12, but loses precision for
+// (nearly) collinear selections where the largest eigenvalue of its
+// key matrix is degenerate.
+const double rmsd_tolerance = 1e-3;
+
+
+// RMSD between V and U after rotating U by M
+double superimposedRMSD(const GMatrix& M, const alignment::vecDouble& U, const alignment::vecDouble& V) {
+  alignment::vecDouble R(U);
+  alignment::applyTransform(M, R);
+  double d = 0.0;
+  for (uint i=0; i<R.size(); ++i)
+    d += (R[i] - V[i]) * (R[i] - V[i]);
+  return(sqrt(d / (R.size() / 3)));
+}
+
+
+// Times centeredRMSD() for all pairs, storing the RMSDs in rmsds
+double timeRMSD(const alignment::SuperpositionMethod method, const vMatrix& frames, const uint repeats, vector<double>& rmsds) {
+  alignment::superpositionMethod(method);
+  uint n = frames.size();
+  uint natoms = frames[0].size() / 3;
+  rmsds.resize(n * (n - 1) / 2);
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint k=0; k<repeats; ++k) {
+    uint l = 0;
+    for (uint j=1; j<n; ++j)
+      for (uint i=0; i<j; ++i)
+        rmsds[l++] = alignment::centeredRMSD(frames[i].data(), frames[j].data(), natoms);
+  }
+  timer.stop();
+
+  return(timer.elapsed());
+}
+
+
+// Times kabsch() for all pairs, storing the superimposed RMSDs
+double timeRotation(const alignment::SuperpositionMethod method, const vMatrix& frames, const uint repeats, vector<double>& rmsds) {
+  alignment::superpositionMethod(method);
+  uint n = frames.size();
+  vector<GMatrix> rots(n * (n - 1) / 2);
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint k=0; k<repeats; ++k) {
+    uint l = 0;
+    for (uint j=1; j<n; ++j)
+      for (uint i=0; i<j; ++i)
+        rots[l++] = alignment::kabsch(frames[i], frames[j]);
+  }
+  timer.stop();
+
+  rmsds.resize(rots.size());
+  uint l = 0;
+  for (uint j=1; j<n; ++j)
+    for (uint i=0; i<j; ++i, ++l)
+      rmsds[l] = superimposedRMSD(rots[l], frames[i], frames[j]);
+
+  return(timer.elapsed());
+}
+
+
+// Times the RMSD of each frame to the first one with alignedRMSD(),
+// which recenters both structures for every frame
+double timeOneToManySerial(const vMatrix& frames, const uint repeats, vector<double>& rmsds) {
+  uint n = frames.size();
+  rmsds.resize(n);
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint k=0; k<repeats; ++k)
+    for (uint i=0; i<n; ++i)
+      rmsds[i] = alignment::alignedRMSD(frames[i], frames[0]);
+  timer.stop();
+
+  return(timer.elapsed());
+}
+
+
+// Same as above, but with all frames handled in one block
+double timeOneToManyBlock(const vMatrix& frames, const uint repeats, const uint nthreads, vector<double>& rmsds) {
+  uint n = frames.size();
+  rmsds.resize(n);
+
+  alignment::vecDouble packed;
+  for (uint i=0; i<n; ++i)
+    packed.insert(packed.end(), frames[i].begin(), frames[i].end());
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint k=0; k<repeats; ++k) {
+    alignment::ReferenceSuperposition reference(frames[0]);
+    reference.rmsds(&packed[0], n, &rmsds[0], nthreads);
+  }
+  timer.stop();
+
+  return(timer.elapsed());
+}
+
+
+double maxDifference(const vector<double>& a, const vector<double>& b) {
+  double d = 0.0;
+  for (uint i=0; i<a.size(); ++i)
+    d = max(d, fabs(a[i] - b[i]));
+  return(d);
+}
+
+
+
+int main(int argc, char *argv[]) {
+  bench::checkUsage(argc, 2, "superposition-bench model trajectory [selection [repeats [threads]]]");
+
+  bench::Report report(argc, argv);
+  AtomicGroup model = createSystem(argv[1]);
+  pTraj traj = createTrajectory(argv[2], model);
+  string selection = bench::argument(argc, argv, 3, string("name == 'CA'"));
+  uint repeats = bench::repeats(argc, argv, 4, 1);
+  uint nthreads = bench::argument(argc, argv, 5, 1u);
+
+  AtomicGroup subset = selectAtoms(model, selection);
+  vMatrix frames;
+  while (traj->readFrame()) {
+    traj->updateGroupCoords(subset);
+    subset.centerAtOrigin();
+    frames.push_back(subset.coordsAsVector());
+  }
+  if (frames.size() < 2) {
+    cerr << "Error- need at least two frames\n";
+    exit(-1);
+  }
+
+  uint npairs = frames.size() * (frames.size() - 1) / 2;
+  report.comment() << subset.size() << " atoms, " << frames.size() << " frames, " << npairs << " pairs, " << repeats << " repeats\n";
+  report.comment() << "Kernel\tMethod\tTime (s)\tPairs/s\tMax diff\n";
+
+  vector<double> svd_rmsds, qcp_rmsds;
+  double svd_time = timeRMSD(alignment::SVD, frames, repeats, svd_rmsds);
+  double qcp_time = timeRMSD(alignment::QCP, frames, repeats, qcp_rmsds);
+  double rmsd_diff = maxDifference(svd_rmsds, qcp_rmsds);
+  cout << "centeredRMSD\tSVD\t" << svd_time << "\t" << npairs * repeats / svd_time << "\t-\n";
+  cout << "centeredRMSD\tQCP\t" << qcp_time << "\t" << npairs * repeats / qcp_time << "\t" << rmsd_diff << report.check(rmsd_diff <= rmsd_tolerance) << endl;
+
+  // Rotations are compared by the RMSD they give, since the rotation
+  // is not well defined for nearly identical structures
+  vector<double> svd_super, qcp_super;
+  svd_time = timeRotation(alignment::SVD, frames, repeats, svd_super);
+  qcp_time = timeRotation(alignment::QCP, frames, repeats, qcp_super);
+  double super_diff = max(maxDifference(svd_super, qcp_super), maxDifference(svd_super, svd_rmsds));
+  cout << "kabsch\tSVD\t" << svd_time << "\t" << npairs * repeats / svd_time << "\t-\n";
+  cout << "kabsch\tQCP\t" << qcp_time << "\t" << npairs * repeats / qcp_time << "\t" << super_diff << report.check(super_diff <= rmsd_tolerance) << endl;
+
+  // The RMSD of the reference to itself is the square root of a
+  // difference that is ideally zero, so it is much less precise and is
+  // skipped in the comparison
+  alignment::SuperpositionMethod methods[2] = { alignment::SVD, alignment::QCP };
+  for (uint k=0; k<2; ++k) {
+    alignment::superpositionMethod(methods[k]);
+    string name = (methods[k] == alignment::SVD) ? "SVD" : "QCP";
+    vector<double> serial, block;
+    double serial_time = timeOneToManySerial(frames, repeats, serial);
+    double block_time = timeOneToManyBlock(frames, repeats, nthreads, block);
+    serial[0] = block[0] = 0.0;
+    double diff = maxDifference(serial, block);
+    cout << "alignedRMSD\t" << name << "\t" << serial_time << "\t" << frames.size() * repeats / serial_time << "\t-\n";
+    cout << "ReferenceSuperposition\t" << name << "\t" << block_time << "\t" << frames.size() * repeats / block_time << "\t" << diff << report.check(diff <= rmsd_tolerance) << endl;
+  }
+
+  report.finish("QCP superposition does not match SVD superposition");
+}
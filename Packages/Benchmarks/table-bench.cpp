@@ -0,0 +1,152 @@
+/*
+  table-bench.cpp
+
+  Times reading a text table of numbers with the original
+  LineReader/stringstream-based readTable() versus TableReader (as
+  rows, into contiguous storage, and with a single column selected),
+  and verifies that all give the same values.
+
+  usage:
+    table-bench file [column [repeats]]
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <loos.hpp>
+#include <boost/filesystem.hpp>
+#include "bench.hpp"
+
+using namespace std;
+using namespace loos;
+
+
+typedef vector< vector<double> >    Table;
+
+
+double timeReference(const string& fname, Table& table) {
+  Timer<WallTimer> timer;
+  timer.start();
+  ifstream ifs(fname.c_str());
+  LineReader lr(ifs, fname);
+  table = readTable<double>(lr);
+  timer.stop();
+  return(timer.elapsed());
+}
+
+
+double timeRows(const string& fname, Table& table) {
+  Timer<WallTimer> timer;
+  timer.start();
+  table = readTable<double>(fname);
+  timer.stop();
+  return(timer.elapsed());
+}
+
+
+double timeContiguous(const string& fname, vector<double>& data, uint& ncols) {
+  Timer<WallTimer> timer;
+  timer.start();
+  ifstream ifs(fname.c_str());
+  TableReader tr(ifs, fname);
+  data.clear();
+  tr.readRows(data, ncols);
+  timer.stop();
+  return(timer.elapsed());
+}
+
+
+double timeColumn(const string& fname, const uint col, vector<double>& data) {
+  Timer<WallTimer> timer;
+  timer.start();
+  ifstream ifs(fname.c_str());
+  TableReader tr(ifs, fname);
+  tr.selectColumns(vector<uint>(1, col));
+  uint ncols;
+  data.clear();
+  tr.readRows(data, ncols);
+  timer.stop();
+  return(timer.elapsed());
+}
+
+
+
+int main(int argc, char *argv[]) {
+  bench::checkUsage(argc, 1, "table-bench file [column [repeats]]");
+
+  bench::Report report(argc, argv);
+  string fname(argv[1]);
+  uint col = bench::argument(argc, argv, 2, 0u);
+  uint repeats = bench::repeats(argc, argv, 3, 1);
+
+  Table reference;
+  double ref_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    ref_time += timeReference(fname, reference);
+  ref_time /= repeats;
+
+  Table rows;
+  double row_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    row_time += timeRows(fname, rows);
+  row_time /= repeats;
+
+  vector<double> data;
+  uint ncols = 0;
+  double contig_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    contig_time += timeContiguous(fname, data, ncols);
+  contig_time /= repeats;
+
+  vector<double> column;
+  double col_time = 0.0;
+  for (uint k=0; k<repeats; ++k)
+    col_time += timeColumn(fname, col, column);
+  col_time /= repeats;
+
+  // The original readTable() stops at the first empty row, so only
+  // compare up to there...
+  bool rows_match = (rows.size() >= reference.size());
+  bool contig_match = (data.size() >= reference.size() * ncols);
+  bool col_match = (column.size() >= reference.size());
+  for (uint i=0; i<reference.size() && (rows_match || contig_match || col_match); ++i) {
+    if (rows_match && rows[i] != reference[i])
+      rows_match = false;
+    if (contig_match && (reference[i].size() != ncols
+                         || !equal(reference[i].begin(), reference[i].end(), data.begin() + i * ncols)))
+      contig_match = false;
+    if (col_match && (col >= reference[i].size() || column[i] != reference[i][col]))
+      col_match = false;
+  }
+
+  double mbytes = static_cast<double>(boost::filesystem::file_size(fname)) / megabytes;
+
+  report.comment() << reference.size() << " rows, " << mbytes << " MB, " << repeats << " repeats\n";
+  report.comment() << "Method\tTime (s)\tMB/s\n";
+  cout << "LineReader\t" << ref_time << "\t" << mbytes / ref_time << endl;
+  cout << "TableReader\t" << row_time << "\t" << mbytes / row_time << report.check(rows_match) << endl;
+  cout << "Contiguous\t" << contig_time << "\t" << mbytes / contig_time << report.check(contig_match) << endl;
+  cout << "Column " << col << "\t" << col_time << "\t" << mbytes / col_time << report.check(col_match) << endl;
+
+  report.finish("TableReader does not match the stringstream parsing");
+}
@@ -0,0 +1,116 @@
+/*
+  xtc-bench.cpp
+
+  Times XTC decompression frame-by-frame versus the batch API (with
+  one and with multiple threads), and verifies that all give the same
+  coordinates.
+
+  usage:
+    xtc-bench xtc [threads [batch]]
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <loos.hpp>
+#include "bench.hpp"
+
+using namespace std;
+using namespace loos;
+
+
+// Reads every frame with readFrame(), returning the elapsed time
+double timeSerial(XTC& xtc, vector<GCoord>& coords, vector<GCoord>& boxes) {
+  uint n = xtc.nframes();
+  uint natoms = xtc.natoms();
+  coords.resize(static_cast<size_t>(n) * natoms);
+  boxes.resize(n);
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint i=0; i<n; ++i) {
+    if (!xtc.readFrame(i)) {
+      cerr << "Error- unable to read frame " << i << endl;
+      exit(-1);
+    }
+    vector<GCoord> frame = xtc.coords();
+    copy(frame.begin(), frame.end(), coords.begin() + static_cast<size_t>(i) * natoms);
+    boxes[i] = xtc.periodicBox();
+  }
+  timer.stop();
+
+  return(timer.elapsed());
+}
+
+
+// Reads every frame with readFrames() in blocks of batch frames
+double timeBatch(XTC& xtc, const uint nthreads, const uint batch, vector<GCoord>& coords, vector<GCoord>& boxes) {
+  uint n = xtc.nframes();
+  uint natoms = xtc.natoms();
+  coords.resize(static_cast<size_t>(n) * natoms);
+  boxes.resize(n);
+
+  vector<GCoord> block_coords, block_boxes;
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint i=0; i<n; i += batch) {
+    uint m = min(batch, n - i);
+    xtc.readFrames(i, m, block_coords, block_boxes, nthreads);
+    copy(block_coords.begin(), block_coords.end(), coords.begin() + static_cast<size_t>(i) * natoms);
+    copy(block_boxes.begin(), block_boxes.end(), boxes.begin() + i);
+  }
+  timer.stop();
+
+  return(timer.elapsed());
+}
+
+
+int main(int argc, char *argv[]) {
+  bench::checkUsage(argc, 1, "xtc-bench xtc [threads [batch]]");
+
+  bench::Report report(argc, argv);
+  XTC xtc(argv[1]);
+  uint nthreads = bench::argument(argc, argv, 2, 0u);
+  uint batch = bench::repeats(argc, argv, 3, 64);
+
+  report.comment() << xtc.natoms() << " atoms, " << xtc.nframes() << " frames, batch of " << batch << endl;
+  report.comment() << "Method\tThreads\tTime (s)\tFrames/s\n";
+
+  vector<GCoord> serial_coords, serial_boxes;
+  double serial_time = timeSerial(xtc, serial_coords, serial_boxes);
+  cout << "readFrame\t1\t" << serial_time << "\t" << xtc.nframes() / serial_time << endl;
+
+  uint threads[2] = { 1, nthreads };
+  for (uint k=0; k<2; ++k) {
+    if (k > 0 && nthreads == 1)
+      break;
+
+    vector<GCoord> batch_coords, batch_boxes;
+    double batch_time = timeBatch(xtc, threads[k], batch, batch_coords, batch_boxes);
+    bool matched = bench::identical(serial_coords, batch_coords) && bench::identical(serial_boxes, batch_boxes);
+    cout << "readFrames\t" << bench::threadCount(threads[k]) << "\t"
+         << batch_time << "\t" << xtc.nframes() / batch_time << report.check(matched) << endl;
+  }
+
+  report.finish("batch decoding does not match frame-by-frame decoding");
+}
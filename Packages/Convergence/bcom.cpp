@@ -63,7 +63,7 @@ bool local_average;
 bool use_zscore;
 uint ntries;
 vector<uint> blocksizes;
-uint seed;
+uint nthreads;
 string gold_standard_trajectory_name;
 
 string fullHelpMessage() {
@@ -147,7 +147,8 @@ public:
       ("zscore,Z", po::value<bool>(&use_zscore)->default_value(false), "Use Z-score rather than covariance overlap")
       ("ntries,N", po::value<uint>(&ntries)->default_value(20), "Number of tries for Z-score")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
   }
 
@@ -161,12 +162,13 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s'")
+    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s', threads=%d")
       % blocks_spec
       % use_zscore
       % ntries
       % local_average
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % nthreads;
     return(oss.str());
   }
 
@@ -191,27 +193,31 @@ struct Datum {
 
 
 
+// The groups are copied so that blocks running in different threads
+// never share atoms.
 vGroup subgroup(const vGroup& A, const uint a, const uint b) {
   vGroup B;
 
   for (uint i=a; i<b; ++i)
-    B.push_back(A[i]);
+    B.push_back(A[i].copy());
 
   return(B);
 }
 
 
-// Breaks the ensemble up into blocks and computes the PCA for each
-// block and the statistics for the covariance overlaps...
+// Computes the covariance overlap (or z-score) for the i'th block.
+// When using the z-score, each block shuffles using its own random
+// stream, so the results do not depend on the number of threads.
 
 template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy) {
-
-
-  TimeSeries<double> coverlaps;
-
-  for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-    vGroup subset = subgroup(ensemble, i, i+blocksize);
+struct Block {
+  Block(const RealMatrix& Ua_, const RealMatrix& sa_, const vGroup& ensemble_, const uint blocksize_,
+        const ExtractPolicy& policy_, const uint seed_, const ulong first_stream_)
+    : Ua(Ua_), sa(sa_), ensemble(ensemble_), blocksize(blocksize_), policy(policy_),
+      seed(seed_), first_stream(first_stream_) { }
+
+  double operator()(const uint i) {
+    vGroup subset = subgroup(ensemble, i * blocksize, (i+1) * blocksize);
     boost::tuple<RealMatrix, RealMatrix> pca_result = pca(subset, policy);
     RealMatrix s = boost::get<0>(pca_result);
     RealMatrix U = boost::get<1>(pca_result);
@@ -223,14 +229,38 @@ Datum blocker(const RealMatrix& Ua, const RealMatrix sa, vGroup& ensemble, const
 
     double val;
     if (use_zscore) {
-      boost::tuple<double, double, double> result = zCovarianceOverlap(sa, Ua, s, U, ntries);
+      base_generator_type rng = randomStream(seed, first_stream + i);
+      boost::tuple<double, double, double> result = zCovarianceOverlap(sa, Ua, s, U, ntries, rng);
       val = boost::get<0>(result);
     } else
       val = covarianceOverlap(sa, Ua, s, U);
 
-    coverlaps.push_back(val);
+    return(val);
   }
 
+  const RealMatrix& Ua;
+  const RealMatrix& sa;
+  const vGroup& ensemble;
+  uint blocksize;
+  ExtractPolicy policy;
+  uint seed;
+  ulong first_stream;
+};
+
+
+// Breaks the ensemble up into blocks and computes the PCA for each
+// block and the statistics for the covariance overlaps...
+
+template<class ExtractPolicy>
+Datum blocker(const RealMatrix& Ua, const RealMatrix sa, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy,
+              const uint seed, const ulong first_stream) {
+
+  // Same blocks as stepping i by blocksize while i < ensemble.size() - blocksize
+  uint nblocks = (ensemble.size() - 1) / blocksize;
+
+  Block<ExtractPolicy> block(Ua, sa, ensemble, blocksize, policy, seed, first_stream);
+  TimeSeries<double> coverlaps(runReplicates(block, nblocks, nthreads));
+
   return( Datum(coverlaps.average(), coverlaps.variance(), coverlaps.size()) );
 }
 
@@ -330,8 +360,10 @@ int main(int argc, char *argv[]) {
   slayer.attach(&watcher);
   slayer.start();
 
+  // The j'th block of the i'th block size gets random stream (i << 32) | j
   for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i) {
-    Datum result = blocker(UA, Us, ensemble, *i, policy);
+    ulong first_stream = static_cast<ulong>(i - blocksizes.begin()) << 32;
+    Datum result = blocker(UA, Us, ensemble, *i, policy, copts->seed, first_stream);
     cout << *i << "\t" << result.avg_coverlap << "\t" << result.var_coverlap << "\t" << result.nblocks << endl;
     slayer.update();
   }
@@ -35,6 +35,7 @@
 
 
 #include <loos.hpp>
+#include <boost/thread/thread.hpp>
 
 /*
  * = Developer's Note =
@@ -56,7 +57,9 @@ namespace Convergence {
     std::vector<float> avg(model.size() * 3);
     uint k = 0;
     for (uint i=0; i<model.size(); ++i) {
-      loos::GCoord c = model[i]->coords();
+      // Read through a const ref so concurrent calls sharing the model don't write to it
+      const loos::Atom& atom = *(model[i]);
+      loos::GCoord c = atom.coords();
       avg[k++] = c.x();
       avg[k++] = c.y();
       avg[k++] = c.z();
@@ -173,9 +176,9 @@ namespace Convergence {
 
    
     lwork = static_cast<f77int>(dummy);
-    float *work = new float[lwork+1];
+    std::vector<float> work(lwork+1);
 
-    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), work, &lwork, &info);
+    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), &work[0], &lwork, &info);
     if (info != 0)
       throw(loos::NumericalError("ssyev failed in loos::pca()", info));
   
@@ -219,9 +222,9 @@ namespace Convergence {
 
    
     lwork = static_cast<f77int>(dummy);
-    float *work = new float[lwork+1];
+    std::vector<float> work(lwork+1);
 
-    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), work, &lwork, &info);
+    ssyev_(&jobz, &uplo, &n, C.get(), &lda, W.get(), &work[0], &lwork, &info);
     if (info != 0)
       throw(loos::NumericalError("ssyev failed in loos::pca()", info));
   
@@ -247,6 +250,67 @@ namespace Convergence {
   }
 
 
+
+  /*
+   * Runs independent replicates (bootstrap trials, blocks, etc) in
+   * parallel.  The functor is called as f(i) for each replicate i and
+   * returns a double.  Replicates are interleaved across the threads,
+   * and each thread uses its own copy of the functor.  The results
+   * are returned in replicate order, so as long as f(i) depends only
+   * on i (e.g. random numbers come from loos::randomStream() rather
+   * than the rng_singleton()), the output does not depend on the
+   * number of threads.
+   */
+
+  template<class Functor>
+  struct ReplicateWorker {
+    ReplicateWorker(const Functor& f, std::vector<double>* r, const uint s, const uint st, std::string* e)
+      : func(f), results(r), first(s), stride(st), error(e) { }
+
+    void operator()() {
+      try {
+        for (uint i=first; i<results->size(); i += stride)
+          (*results)[i] = func(i);
+      }
+      catch (std::exception& e) {
+        *error = e.what();
+      }
+    }
+
+    Functor func;
+    std::vector<double>* results;
+    uint first, stride;
+    std::string* error;
+  };
+
+
+  // nthreads of 0 means use all available cores
+  template<class Functor>
+  std::vector<double> runReplicates(const Functor& f, const uint n, const uint nthreads) {
+    std::vector<double> results(n);
+    if (n == 0)
+      return(results);
+
+    uint nt = nthreads ? nthreads : boost::thread::hardware_concurrency();
+    if (nt == 0)
+      nt = 1;
+    nt = std::min(nt, n);
+
+    std::vector<std::string> errors(nt);
+    boost::thread_group threads;
+    for (uint t=1; t<nt; ++t)
+      threads.create_thread(ReplicateWorker<Functor>(f, &results, t, nt, &(errors[t])));
+    ReplicateWorker<Functor>(f, &results, 0, nt, &(errors[0]))();
+    threads.join_all();
+
+    for (uint t=0; t<nt; ++t)
+      if (!errors[t].empty())
+        throw(loos::LOOSError(errors[t]));
+
+    return(results);
+  }
+
+
 }
 
 #endif
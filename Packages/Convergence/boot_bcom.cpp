@@ -57,6 +57,7 @@ uint nsteps = 25;
 vector<uint> blocksizes;
 bool local_average;
 uint nreps;
+uint nthreads;
 string gold_standard_trajectory_name;
 
 
@@ -155,7 +156,8 @@ public:
       ("steps", po::value<uint>(&nsteps)->default_value(25), "Max number of blocks for auto-ranging")
       ("reps", po::value<uint>(&nreps)->default_value(20), "Number of replicates for bootstrap")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
 
   }
@@ -169,11 +171,12 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s'")
+    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s', threads=%d")
       % blocks_spec
       % local_average
       % nreps
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % nthreads;
     return(oss.str());
   }
 
@@ -195,10 +198,10 @@ struct Datum {
 
 
 // Randomly pick frames
-vector<uint> pickFrames(const uint nframes, const uint blocksize) {
+vector<uint> pickFrames(const uint nframes, const uint blocksize, base_generator_type& generator) {
   
   boost::uniform_int<uint> imap(0,nframes-1);
-  boost::variate_generator< base_generator_type&, boost::uniform_int<uint> > rng(rng_singleton(), imap);
+  boost::variate_generator< base_generator_type&, boost::uniform_int<uint> > rng(generator, imap);
   vector<uint> picks;
 
   for (uint i=0; i<blocksize; ++i)
@@ -216,29 +219,34 @@ void dumpPicks(const vector<uint>& picks) {
 
 
 // Extract a subgroup of the vector<AtomicGroup> given the indices in picks...
+// The groups are copied so that replicates running in different
+// threads never share atoms.
 vGroup subgroup(const vGroup& A, const vector<uint>& picks) {
   vGroup B;
   
   for (vector<uint>::const_iterator ci = picks.begin(); ci != picks.end(); ++ci)
-    B.push_back(A[*ci]);
+    B.push_back(A[*ci].copy());
 
   return(B);
 }
 
 
 
-// Breaks the ensemble up into blocks and computes the PCA for each
-// block and the statistics for the covariance overlaps...
+// Computes the covariance overlap for one bootstrap replicate.  Each
+// replicate draws its frames from its own random stream, so the
+// results are the same regardless of how the replicates are spread
+// across threads.
 
 template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const vGroup& ensemble, const uint blocksize, uint repeats, ExtractPolicy& policy) {
-
-
-  
-  TimeSeries<double> coverlaps;
-
-  for (uint i=0; i<repeats; ++i) {
-    vector<uint> picks = pickFrames(ensemble.size(), blocksize);
+struct Replicate {
+  Replicate(const RealMatrix& Ua_, const RealMatrix& sa_, const vGroup& ensemble_, const uint blocksize_,
+            const ExtractPolicy& policy_, const uint seed_, const ulong first_stream_)
+    : Ua(Ua_), sa(sa_), ensemble(ensemble_), blocksize(blocksize_), policy(policy_),
+      seed(seed_), first_stream(first_stream_) { }
+
+  double operator()(const uint i) {
+    base_generator_type rng = randomStream(seed, first_stream + i);
+    vector<uint> picks = pickFrames(ensemble.size(), blocksize, rng);
     
     if (debug) {
       cerr << "***Block " << blocksize << ", replica " << i << ", picks " << picks.size() << endl;
@@ -254,9 +262,29 @@ Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const vGroup& ensemble,
       for (uint j=0; j<s.rows(); ++j)
         s[j] /= blocksize;
 
-    coverlaps.push_back(covarianceOverlap(sa, Ua, s, U));
+    return(covarianceOverlap(sa, Ua, s, U));
   }
 
+  const RealMatrix& Ua;
+  const RealMatrix& sa;
+  const vGroup& ensemble;
+  uint blocksize;
+  ExtractPolicy policy;
+  uint seed;
+  ulong first_stream;
+};
+
+
+// Breaks the ensemble up into blocks and computes the PCA for each
+// block and the statistics for the covariance overlaps...
+
+template<class ExtractPolicy>
+Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const vGroup& ensemble, const uint blocksize, uint repeats, ExtractPolicy& policy,
+              const uint seed, const ulong first_stream) {
+
+  Replicate<ExtractPolicy> replicate(Ua, sa, ensemble, blocksize, policy, seed, first_stream);
+  TimeSeries<double> coverlaps(runReplicates(replicate, repeats, nthreads));
+
   return( Datum(coverlaps.average(), coverlaps.variance(), coverlaps.size()) );
 
 }
@@ -356,8 +384,10 @@ int main(int argc, char *argv[]) {
   slayer.start();
 
 
+  // Replicate j of the i'th block size uses random stream i*nreps+j
   for (vector<uint>::iterator i = blocksizes.begin(); i != blocksizes.end(); ++i) {
-    Datum result = blocker(UA, Us, ensemble, *i, nreps, policy);
+    ulong first_stream = static_cast<ulong>(i - blocksizes.begin()) * nreps;
+    Datum result = blocker(UA, Us, ensemble, *i, nreps, policy, copts->seed, first_stream);
     cout << *i << "\t" << result.avg_coverlap << "\t" << result.var_coverlap << "\t" << result.nblocks << endl;
     slayer.update();
   }
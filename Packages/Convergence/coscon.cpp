@@ -152,6 +152,7 @@ bool local_average;
 vector<uint> blocksizes;
 string model_name, traj_name, selection;
 uint principal_component;
+uint nthreads;
 
 
 // @cond TOOLS_INTERAL
@@ -162,7 +163,8 @@ public:
     o.add_options()
       ("pc", po::value<uint>(&principal_component)->default_value(0), "Which principal component to use")
       ("blocks", po::value<string>(&blocks_spec), "Block sizes (MATLAB style range)")
-      ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global");
+      ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
   }
 
@@ -180,10 +182,11 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', local=%d, pc=%d")
+    oss << boost::format("blocks='%s', local=%d, pc=%d, threads=%d")
       % blocks_spec
       % local_average
-      % principal_component;
+      % principal_component
+      % nthreads;
     return(oss.str());
   }
 
@@ -197,16 +200,37 @@ public:
 
 
 
+// The groups are copied so that blocks running in different threads
+// never share atoms.
 vGroup subgroup(const vGroup& A, const uint a, const uint b) {
   vGroup B;
 
   for (uint i=a; i<b; ++i)
-    B.push_back(A[i]);
+    B.push_back(A[i].copy());
 
   return(B);
 }
 
 
+// Computes the cosine content for the i'th block
+template<class ExtractPolicy>
+struct Block {
+  Block(const uint pc_, const vGroup& ensemble_, const uint blocksize_, const ExtractPolicy& policy_)
+    : pc(pc_), ensemble(ensemble_), blocksize(blocksize_), policy(policy_) { }
+
+  double operator()(const uint i) {
+    vGroup subset = subgroup(ensemble, i * blocksize, (i+1) * blocksize);
+    RealMatrix V = rsv(subset, policy);
+
+    return(cosineContent(V, pc));
+  }
+
+  uint pc;
+  const vGroup& ensemble;
+  uint blocksize;
+  ExtractPolicy policy;
+};
+
 
 // Breaks the ensemble up into blocks and computes the RSV for each
 // block and the statistics for the cosine content...
@@ -214,16 +238,11 @@ vGroup subgroup(const vGroup& A, const uint a, const uint b) {
 template<class ExtractPolicy>
 Datum blocker(const uint pc, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy) {
 
+  // Same blocks as stepping i by blocksize while i < ensemble.size() - blocksize
+  uint nblocks = (ensemble.size() - 1) / blocksize;
 
-  TimeSeries<double> cosines;
-
-  for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-    vGroup subset = subgroup(ensemble, i, i+blocksize);
-    RealMatrix V = rsv(subset, policy);
-
-    double val = cosineContent(V, pc);
-    cosines.push_back(val);
-  }
+  Block<ExtractPolicy> block(pc, ensemble, blocksize, policy);
+  TimeSeries<double> cosines(runReplicates(block, nblocks, nthreads));
 
   return( Datum(cosines.average(), cosines.variance(), cosines.size()) );
 }
@@ -53,6 +53,10 @@ vecUint assignStructures(AtomicGroup& model, pTraj& traj, const vecUint& frames,
   vecUint assignments(frames.size(), 0);
   uint j = 0;
 
+  vector<alignment::ReferenceSuperposition> references;
+  for (vecGroup::const_iterator i = refs.begin(); i != refs.end(); ++i)
+    references.push_back(alignment::ReferenceSuperposition(*i));
+
   for (vecUint::const_iterator frame = frames.begin(); frame != frames.end(); ++frame) {
     traj->readFrame(*frame);
     traj->updateGroupCoords(model);
@@ -61,8 +65,7 @@ vecUint assignStructures(AtomicGroup& model, pTraj& traj, const vecUint& frames,
     uint mini = refs.size() + 1;
     
     for (uint i = 0; i < refs.size(); ++i) {
-      model.alignOnto(refs[i]);
-      double d = model.rmsd(refs[i]);
+      double d = references[i].rmsd(model);
       if (d < mind) {
         mind = d;
         mini = i;
@@ -134,6 +137,7 @@ boost::tuple<vecGroup, vecUint> pickFiducials(AtomicGroup& model, pTraj& traj, c
 
     fiducials.push_back(fiducial);
     refs.push_back(pick);
+    alignment::ReferenceSuperposition reference(fiducial);
     
     // Now find the distance from every unassigned frame to this new fiducial (aligning
     // them first), and then sort by distance...
@@ -143,9 +147,7 @@ boost::tuple<vecGroup, vecUint> pickFiducials(AtomicGroup& model, pTraj& traj, c
         continue;
       traj->readFrame(frames[i]);
       traj->updateGroupCoords(model);
-      model.centerAtOrigin();
-      model.alignOnto(fiducial);
-      distances[i] = model.rmsd(fiducial);
+      distances[i] = reference.rmsd(model);
     }
 
     vecUint indices = sortedIndex(distances);
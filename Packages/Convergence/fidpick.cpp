@@ -144,6 +144,7 @@ int main(int argc, char *argv[]) {
 
     fiducials.push_back(fiducial);
     assignments[pick] = myid;
+    alignment::ReferenceSuperposition reference(fiducial);
     
     uint cluster_size = 0;
     for (uint i = 0; i<assignments.size(); ++i) {
@@ -151,9 +152,7 @@ int main(int argc, char *argv[]) {
         continue;
       traj->readFrame(frames[i]);
       traj->updateGroupCoords(model);
-      subset.centerAtOrigin();
-      subset.alignOnto(fiducial);
-      double d = subset.rmsd(fiducial);
+      double d = reference.rmsd(subset);
       if (d < cutoff) {
         assignments[i] = myid;
         ++cluster_size;
@@ -27,11 +27,15 @@ using namespace std;
 using namespace loos;
 
 
+// Number of waters correlated at a time
+const uint batch_size = 1024;
+
+
 int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
   if (argc == 1) {
-    cerr << "Usage- " << argv[0] << " water_matrix [max-t] >output.asc\n";
+    cerr << "Usage- " << argv[0] << " water_matrix [max-t [threads]] >output.asc\n";
     exit(-1);
   }
 
@@ -40,6 +44,9 @@ int main(int argc, char *argv[]) {
   uint max_t = 0;
   if (k != argc)
     max_t = strtoul(argv[k++], 0, 10);
+  uint nthreads = 1;
+  if (k != argc)
+    nthreads = strtoul(argv[k++], 0, 10);
   
   Math::Matrix<int> M;
   cerr << "Reading matrix...\n";
@@ -52,7 +59,12 @@ int main(int argc, char *argv[]) {
 
   cerr << boost::format("Water matrix is %d x %d\n") % m % n;
   cerr << "Processing- ";
-  vector< TimeSeries<double> > waters;
+
+  // The correlations are computed a batch of waters at a time and
+  // only the sums needed for the statistics are kept
+  vector<double> sum(max_t, 0.0), sum2(max_t, 0.0);
+  uint nwaters = 0;
+  vector< vector<double> > batch;
   for (uint j=0; j<m; ++j) {
     if (j % 250 == 0)
       cerr << '.';
@@ -64,20 +76,26 @@ int main(int argc, char *argv[]) {
       if (tmp[i])
 	flag = true;
     }
-    if (flag) {
-      TimeSeries<double> wtmp(tmp);
-      waters.push_back(wtmp.correl(max_t));
+    if (flag)
+      batch.push_back(tmp);
+
+    if (batch.size() == batch_size || (j == m-1 && !batch.empty())) {
+      vector< vector<double> > corr = autocorrelations(batch, max_t, true, nthreads);
+      for (uint i=0; i<corr.size(); ++i)
+        for (uint t=0; t<max_t; ++t) {
+          sum[t] += corr[i][t];
+          sum2[t] += corr[i][t] * corr[i][t];
+        }
+      nwaters += corr.size();
+      batch.clear();
     }
   }
 
-  uint nwaters = waters.size();
   cerr << boost::format(" done\nFound %d unique waters inside\n") % nwaters;
   cout << "# " << hdr << endl;
   for (uint j=0; j<max_t; ++j) {
-    vector<double> tmp(nwaters, 0);
-    for (uint i=0; i<nwaters; ++i)
-      tmp[i] = waters[i][j];
-    dTimeSeries dtmp(tmp);
-    cout << j << '\t' << dtmp.average() << '\t' << dtmp.stdev() << '\t' << dtmp.sterr() << endl;
+    double avg = sum[j] / nwaters;
+    double dev = sqrt(sum2[j] / nwaters - avg * avg);
+    cout << j << '\t' << avg << '\t' << dev << '\t' << dev / sqrt(nwaters) << endl;
   }
 }
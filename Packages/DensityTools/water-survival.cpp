@@ -9,11 +9,47 @@ typedef Math::Matrix<int>   WaterClassMatrix;
 
 
 
+// Number of waters correlated at a time
+const uint batch_size = 1024;
+
+
+// Survival for each tau of the batch of waters is accumulated into
+// sum, sum2 and count.  The number of times a water is inside at both
+// t and t+tau (t < n-tau-1) is the autocorrelation of its occupancy,
+// less the t = n-tau-1 term.
+
+void accumulateSurvival(const vector< vector<double> >& batch, const uint max_t, const uint nthreads,
+                        vector<double>& sum, vector<double>& sum2, vector<uint>& count) {
+  vector< vector<double> > corr = autocorrelations(batch, max_t, false, nthreads);
+
+  for (uint j=0; j<batch.size(); ++j) {
+    const vector<double>& x = batch[j];
+    uint n = x.size();
+
+    vector<uint> before(n+1, 0);
+    for (uint t=0; t<n; ++t)
+      before[t+1] = before[t] + static_cast<uint>(x[t]);
+
+    for (uint tau=0; tau<max_t; ++tau) {
+      uint pairs = before[n-tau-1];
+      if (!pairs)
+        continue;
+
+      double both = floor(corr[j][tau] * (n - tau) + 0.5) - x[n-tau-1] * x[n-1];
+      double survival = both / pairs;
+      sum[tau] += survival;
+      sum2[tau] += survival * survival;
+      ++count[tau];
+    }
+  }
+}
+
+
 int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
   if (argc == 1) {
-    cerr << "Usage- " << argv[0] << " water_matrix [max-t] >output.asc\n";
+    cerr << "Usage- " << argv[0] << " water_matrix [max-t [threads]] >output.asc\n";
     exit(-1);
   }
 
@@ -22,6 +58,9 @@ int main(int argc, char *argv[]) {
   uint max_t = 0;
   if (k != argc)
     max_t = strtoul(argv[k++], 0, 10);
+  uint nthreads = 1;
+  if (k != argc)
+    nthreads = strtoul(argv[k++], 0, 10);
   
   Math::Matrix<int> M;
   cerr << "Reading matrix...\n";
@@ -31,6 +70,10 @@ int main(int argc, char *argv[]) {
 
   if (max_t == 0)
     max_t = n/10;
+  if (max_t > n) {
+    cerr << "Error- max-t cannot be larger than the number of frames\n";
+    exit(-1);
+  }
 
   cerr << boost::format("Water matrix is %d x %d\n") % m % n;
 
@@ -38,35 +81,36 @@ int main(int argc, char *argv[]) {
   cout << "# tau\tavg\tstdev\tsterr\n";
   
   cerr << "Processing- ";
-  
 
-  for (uint tau=0; tau<max_t; ++tau) {
-    vector<double> survivals;
-    if (tau % 100 == 0)
+  vector<double> sum(max_t, 0.0), sum2(max_t, 0.0);
+  vector<uint> count(max_t, 0);
+  vector< vector<double> > batch;
+  for (uint j=0; j<m; ++j) {
+    if (j % 250 == 0)
       cerr << '.';
-    
-    for (uint j=0; j<m; ++j) {
-      uint inside = 0;
-      uint pairs = 0;
-      
-      for (uint t=0; t<n-tau-1; ++t)
-	if (M(j, t))
-	{
-	  ++pairs;
-	  if (M(j, t+tau))
-	    ++inside;
-	}
-      if (pairs)
-	survivals.push_back(static_cast<double>(inside) / (pairs));
+
+    vector<double> occupied(n, 0.0);
+    bool flag = false;
+    for (uint t=0; t<n; ++t)
+      if (M(j, t)) {
+        occupied[t] = 1.0;
+        flag = true;
+      }
+    if (flag)
+      batch.push_back(occupied);
+
+    if (batch.size() == batch_size || (j == m-1 && !batch.empty())) {
+      accumulateSurvival(batch, max_t, nthreads, sum, sum2, count);
+      batch.clear();
     }
-    dTimeSeries ts(survivals);
-    cout << tau << '\t' << ts.average() << '\t' << ts.stdev() << '\t' << ts.sterr() << endl;
+  }
+
+  for (uint tau=0; tau<max_t; ++tau) {
+    double avg = sum[tau] / count[tau];
+    double dev = sqrt(sum2[tau] / count[tau] - avg * avg);
+    cout << tau << '\t' << avg << '\t' << dev << '\t' << dev / sqrt(count[tau]) << endl;
   }
   
   cerr << " Done\n";
 
 }
-
-
-
-  
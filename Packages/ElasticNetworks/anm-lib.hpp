@@ -38,6 +38,11 @@ namespace ENM {
 
     void solve() {
 
+      if (sparse_modes_ != 0) {
+        solveSparse();
+        return;
+      }
+
       if (verbosity_ > 2)
         std::cerr << "Building hessian...\n";
       buildHessian();
@@ -69,6 +74,8 @@ namespace ENM {
     //! Return the inverted hessian matrix
     loos::DoubleMatrix inverseHessian() {
 
+      if (sparse_modes_ != 0)
+        throw(std::logic_error("ANM::inverseHessian() requires all modes and cannot be used with a sparse hessian"));
       if (rsv_.rows() == 0)
         throw(std::logic_error("ANM::inverseHessian() called before ANM::solve()"));
 
@@ -85,6 +92,44 @@ namespace ENM {
 
 
   private:
+
+    // The rigid-body modes are known, so only the lowest non-zero
+    // modes are computed.  These are prefixed by the rigid-body modes
+    // so the layout matches the dense solution (the first 6 modes
+    // are the zero modes).
+    void solveSparse() {
+      if (verbosity_ > 2)
+        std::cerr << "Building sparse hessian...\n";
+      buildSparseHessian();
+      if (debugging_)
+        loos::writeAsciiMatrix(prefix_ + "_H.asc", sparse_hessian_.dense(), meta_, false);
+
+      loos::Timer<> t;
+      if (verbosity_ > 1)
+        std::cerr << "Computing " << sparse_modes_ << " lowest modes of hessian...\n";
+      t.start();
+
+      loos::DoubleMatrix rigid = rigidBodyModes(blocker_->nodeList());
+      boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> result = lowestModes(sparse_hessian_, sparse_modes_, rigid, 1e-9, 2000, verbosity_);
+
+      t.stop();
+      if (verbosity_ > 1)
+        std::cerr << "Eigensolver took " << loos::timeAsString(t.elapsed()) << std::endl;
+
+      loos::DoubleMatrix vals = boost::get<0>(result);
+      loos::DoubleMatrix vecs = boost::get<1>(result);
+      uint nr = rigid.cols();
+
+      eigenvals_ = loos::DoubleMatrix(nr + vals.rows(), 1);
+      for (uint i=0; i<vals.rows(); ++i)
+        eigenvals_[nr + i] = vals[i];
+
+      eigenvecs_ = loos::DoubleMatrix(rigid.rows(), nr + vecs.cols());
+      std::copy(rigid.get(), rigid.get() + rigid.rows() * nr, eigenvecs_.get());
+      std::copy(vecs.get(), vecs.get() + vecs.rows() * vecs.cols(), eigenvecs_.get() + rigid.rows() * nr);
+    }
+
+
     loos::DoubleMatrix rsv_;
 
   };
@@ -58,6 +58,7 @@
 #include <loos.hpp>
 
 #include <limits>
+#include <boost/thread/thread.hpp>
 
 
 #include "hessian.hpp"
@@ -84,6 +85,10 @@ bool debug;
 string spring_desc;
 string bound_spring_desc;
 
+uint nmodes;
+double cutoff;
+uint nthreads;
+
 string fullHelpMessage() {
 
   string s = 
@@ -108,6 +113,20 @@ string fullHelpMessage() {
     "\tfoo_Hi.asc  - Pseudo-inverse of H\n"
     "\n"
     "\n"
+    "* Large Systems *\n"
+    "The dense hessian and its full decomposition grow with the square\n"
+    "and cube of the number of nodes.  With --modes=k, only nodes within\n"
+    "the cutoff are connected, the hessian is stored sparsely, and only\n"
+    "the k lowest non-zero modes are computed iteratively.  The cutoff\n"
+    "is taken from the spring function (i.e. 15 Angstroms for the default\n"
+    "distance spring) unless --cutoff is given, and must be given for\n"
+    "spring functions that connect all nodes.  Bound springs (see\n"
+    "--bound below) are kept however far apart their nodes are.  The\n"
+    "first 6 columns of foo_U.asc are still the rigid-body modes, followed\n"
+    "by the k requested modes.  The pseudo-inverse (foo_Hi.asc) is not\n"
+    "written in this mode.\n"
+    "\n"
+    "\n"
     "* Spring Constant Control *\n"
     "Contacts between beads in an ANM are connected by a single potential\n"
     "which is described by a hookean spring.  The stiffness of each connection\n"
@@ -151,6 +170,9 @@ string fullHelpMessage() {
     "\tsprings with a constant stiffness of \"100\" and all other\n"
     "\tresidues are connected by springs that decay exponentially\n"
     "\twith distance\n"
+    "\n"
+    "anm --modes=20 foo.pdb foo\n"
+    "\tCompute only the 20 lowest non-zero modes using a sparse hessian\n"
     "\n";
 
   return(s);
@@ -164,12 +186,15 @@ public:
     o.add_options()
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("spring,S", po::value<string>(&spring_desc)->default_value("distance"),"Spring function to use")
-      ("bound", po::value<string>(&bound_spring_desc), "Bound spring");
+      ("bound", po::value<string>(&bound_spring_desc), "Bound spring")
+      ("modes", po::value<uint>(&nmodes)->default_value(0), "Use a sparse hessian and only compute this many modes (0 = all)")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Contact cutoff for the sparse hessian (0 = use spring function's range)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use when building the hessian (0=all available)");
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("debug=%d, spring='%s', bound='%s'") % debug % spring_desc % bound_spring_desc;
+    oss << boost::format("debug=%d, spring='%s', bound='%s', modes=%d, cutoff=%f, threads=%d") % debug % spring_desc % bound_spring_desc % nmodes % cutoff % nthreads;
     return(oss.str());
   }
 };
@@ -221,6 +246,11 @@ int main(int argc, char *argv[]) {
   if (verbosity > 0)
     cerr << boost::format("Selected %d atoms from %s\n") % subset.size() % mopts->model_name;
 
+  if (nmodes != 0 && nmodes + 6 > 3 * subset.size()) {
+    cerr << boost::format("Error- cannot compute %d modes for %d nodes\n") % nmodes % subset.size();
+    exit(-1);
+  }
+
   // Determine which kind of scaling to apply to the Hessian...
   vector<SpringFunction*> springs;
   SpringFunction* spring = 0;
@@ -249,11 +279,18 @@ int main(int argc, char *argv[]) {
   }
 
 
+  if (nmodes != 0 && cutoff == 0.0 && blocker->range() == numeric_limits<double>::infinity()) {
+    cerr << "Error- the spring function connects all nodes, so a --cutoff is required with --modes\n";
+    exit(-1);
+  }
+
   ANM anm(blocker);
   anm.debugging(debug);
   anm.prefix(prefix);
   anm.meta(header);
   anm.verbosity(verbosity);
+  anm.sparse(nmodes, cutoff);
+  anm.threads(nthreads ? nthreads : boost::thread::hardware_concurrency());
 
   anm.solve();
 
@@ -262,7 +299,8 @@ int main(int argc, char *argv[]) {
   writeAsciiMatrix(prefix + "_U.asc", anm.eigenvectors(), header, false);
   writeAsciiMatrix(prefix + "_s.asc", anm.eigenvalues(), header, false);
 
-  writeAsciiMatrix(prefix + "_Hi.asc", anm.inverseHessian(), header, false);
+  if (nmodes == 0)
+    writeAsciiMatrix(prefix + "_Hi.asc", anm.inverseHessian(), header, false);
 
   for (vector<SuperBlock*>::iterator i = blocks.begin(); i != blocks.end(); ++i)
     delete *i;
@@ -23,6 +23,8 @@
 
 #include "enm-lib.hpp"
 
+#include <boost/thread/thread.hpp>
+
 
 using namespace std;
 using namespace loos;
@@ -81,41 +83,121 @@ namespace ENM {
 
 
 
-  void ElasticNetworkModel::buildHessian() {
-    uint n = blocker_->size();
-    loos::DoubleMatrix H(3*n,3*n);
+  namespace {
+
+    // Builds the hessian for a subset of the rows (i, i+stride, ...).
+    // In the first pass, each worker fills in the off-diagonal blocks
+    // for the contacts j < i of its rows (so no two threads write the
+    // same block).  In the second pass, the diagonal blocks are summed
+    // from the (now complete) columns.
+    struct DenseHessianWorker {
+      DenseHessianWorker(SuperBlock* b, const ContactFinder* f, DoubleMatrix* h, const uint first, const uint stride, string* err) :
+        blocker(b), finder(f), H(h), row(first), step(stride), diagonal(false), error(err) { }
+
+      void operator()() {
+        try {
+          vector<uint> js;
+          double B[9];
+          DoubleMatrix& M = *H;
 
-    for (uint i=1; i<n; ++i) {
-      for (uint j=0; j<i; ++j) {
-        loos::DoubleMatrix B = blocker_->block(j, i);
-        for (uint x = 0; x<3; ++x)
-          for (uint y = 0; y<3; ++y) {
-            H(i*3 + y, j*3 + x) = -B(y, x);
-            H(j*3 + x, i*3 + y) = -B(x ,y);
+          for (uint i=row; i<blocker->size(); i += step) {
+            finder->contacts(i, js);
+
+            if (!diagonal) {
+              for (vector<uint>::const_iterator jp = js.begin(); jp != js.end() && *jp < i; ++jp) {
+                uint j = *jp;
+                blocker->block(j, i, B);
+                for (uint x = 0; x<3; ++x)
+                  for (uint y = 0; y<3; ++y) {
+                    M(i*3 + y, j*3 + x) = -B[x*3 + y];
+                    M(j*3 + x, i*3 + y) = -B[y*3 + x];
+                  }
+              }
+
+            } else {
+              for (uint q=0; q<9; ++q)
+                B[q] = 0.0;
+              for (vector<uint>::const_iterator jp = js.begin(); jp != js.end(); ++jp)
+                for (uint x=0; x<3; ++x)
+                  for (uint y=0; y<3; ++y)
+                    B[x*3 + y] += M(*jp*3 + y, i*3 + x);
+
+              for (uint x=0; x<3; ++x)
+                for (uint y=0; y<3; ++y)
+                  M(i*3 + y, i*3 + x) = -B[x*3 + y];
+            }
           }
+        }
+        catch (std::exception& e) {
+          *error = e.what();
+        }
       }
+
+      SuperBlock* blocker;
+      const ContactFinder* finder;
+      DoubleMatrix* H;
+      uint row, step;
+      bool diagonal;
+      string* error;
+    };
+
+
+    void runWorkers(vector<DenseHessianWorker>& workers) {
+      boost::thread_group threads;
+      for (uint t=1; t<workers.size(); ++t)
+        threads.create_thread(boost::ref(workers[t]));
+      workers[0]();
+      threads.join_all();
     }
 
-    // Now handle the diagonal...
-    for (uint i=0; i<n; ++i) {
-      loos::DoubleMatrix B(3,3);
-      for (uint j=0; j<n; ++j) {
-        if (j == i)
-          continue;
-      
-        for (uint x=0; x<3; ++x)
-          for (uint y=0; y<3; ++y)
-            B(y,x) += H(j*3 + y, i*3 + x);
-      }
+  }
 
-      for (uint x=0; x<3; ++x)
-        for (uint y=0; y<3; ++y)
-          H(i*3 + y, i*3 + x) = -B(y,x);
+
+
+  void ElasticNetworkModel::buildHessian() {
+    uint n = blocker_->size();
+    loos::DoubleMatrix H(3*n,3*n);
+
+    // Pairs farther apart than the range of the springs contribute
+    // nothing, so they're never visited (the cutoff is padded so that
+    // round-off can't drop a pair the spring function would keep)
+    ContactFinder finder(blocker_->nodeList(), blocker_->range() * (1.0 + 1e-10));
+
+    uint nworkers = std::max(1u, std::min(nthreads_, n));
+    string error;
+    vector<DenseHessianWorker> workers;
+    for (uint t=0; t<nworkers; ++t)
+      workers.push_back(DenseHessianWorker(blocker_, &finder, &H, t, nworkers, &error));
+
+    runWorkers(workers);
+    if (error.empty()) {
+      for (uint t=0; t<nworkers; ++t)
+        workers[t].diagonal = true;
+      runWorkers(workers);
     }
 
+    if (!error.empty())
+      throw(std::runtime_error(error));
+
     hessian_ = H;
   }
 
 
 
+  void ElasticNetworkModel::buildSparseHessian() {
+    // An explicit cutoff truncates the unbound springs, but is
+    // stretched so that no bound spring is dropped
+    double cutoff = sparse_cutoff_ > 0.0 ? std::max(sparse_cutoff_, blocker_->boundRange()) : blocker_->range();
+    if (cutoff == std::numeric_limits<double>::infinity())
+      throw(std::runtime_error("The spring function connects all nodes, so a cutoff must be given for a sparse hessian"));
+
+    sparse_hessian_ = ENM::sparseHessian(blocker_, cutoff, nthreads_);
+    if (verbosity_ > 1)
+      std::cerr << boost::format("Sparse hessian has %d non-zero blocks (%.2f%% filled)\n")
+        % sparse_hessian_.nonzeroBlocks()
+        % (100.0 * sparse_hessian_.nonzeroBlocks() / (static_cast<double>(blocker_->size()) * blocker_->size()));
+  }
+
+
+
 };
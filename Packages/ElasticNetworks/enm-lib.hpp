@@ -31,6 +31,7 @@
 
 #include <loos.hpp>
 #include "hessian.hpp"
+#include "sparse-lib.hpp"
 
 //! Namespace to encapsulate Elastic Network Model routines
 namespace ENM {
@@ -72,7 +73,7 @@ namespace ENM {
      constructed, i.e. what nodes are used and how the spring function
      between them is calculated.
     */
-    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0) { }
+    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0), nthreads_(1), sparse_modes_(0), sparse_cutoff_(0.0) { }
     virtual ~ElasticNetworkModel() { }
 
     // Should we allow this?
@@ -97,6 +98,23 @@ namespace ENM {
     void verbosity(const int i) { verbosity_ = i; }
     int verbosity() const { return(verbosity_); }
 
+    //! Number of threads used to build the hessian
+    void threads(const uint n) { nthreads_ = n == 0 ? 1 : n; }
+    uint threads() const { return(nthreads_); }
+
+    //! Use a sparse hessian and only solve for the lowest modes
+    /**
+     * When \a nmodes is non-zero, only pairs of nodes within \a cutoff
+     * contribute to the hessian, which is stored as 3x3 blocks (see
+     * SparseBlockMatrix), and solve() finds only the \a nmodes lowest
+     * non-zero modes.  A \a cutoff of 0 uses the range of the spring
+     * function.  The cutoff is extended if necessary to reach every
+     * pair of bound nodes (see BoundSuperBlock).  Setting \a nmodes to
+     * 0 restores the dense solution.
+     */
+    void sparse(const uint nmodes, const double cutoff = 0.0) { sparse_modes_ = nmodes; sparse_cutoff_ = cutoff; }
+    uint sparseModes() const { return(sparse_modes_); }
+
     // -----------------------------------------------------
     //! Forwards to contained superblock
     SpringFunction::Params setParams(const SpringFunction::Params& v) {
@@ -120,6 +138,9 @@ namespace ENM {
     //! Accessors for eigenpairs and hessian
     const loos::DoubleMatrix& hessian() const { return(hessian_); }
 
+    //! The hessian when sparse() is in effect
+    const SparseBlockMatrix& sparseHessian() const { return(sparse_hessian_); }
+
 
 
   protected:
@@ -128,9 +149,14 @@ namespace ENM {
     //! Construct the hessian using the contained SuperBlock
     /**
      * It is not expected that subclasses will want to override this...
-     * Uses the contained SuperBlock to build a hessian
+     * Uses the contained SuperBlock to build a hessian.  Only pairs of
+     * nodes within the range of the SuperBlock are visited, and rows
+     * are divided among threads().
      */
     void buildHessian();
+
+    //! Construct the sparse hessian using the contained SuperBlock
+    void buildSparseHessian();
   
 
   protected:
@@ -143,11 +169,16 @@ namespace ENM {
     std::string meta_;
     bool debugging_;
     int verbosity_;
+    uint nthreads_;
 
     loos::DoubleMatrix eigenvecs_;
     loos::DoubleMatrix eigenvals_;
 
     loos::DoubleMatrix hessian_;
+
+    uint sparse_modes_;
+    double sparse_cutoff_;
+    SparseBlockMatrix sparse_hessian_;
   
   };
 
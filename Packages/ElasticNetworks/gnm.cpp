@@ -58,6 +58,8 @@
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
 
+#include "sparse-lib.hpp"
+
 using namespace std;
 using namespace loos;
 namespace po = boost::program_options;
@@ -71,6 +73,7 @@ string selection;
 string model_name;
 string prefix;
 double cutoff;
+uint nmodes;
 
 void fullHelp() {
   //string msg = 
@@ -94,6 +97,12 @@ void fullHelp() {
     "\tfoo_V.asc  - Right singular vectors\n"
     "\tfoo_Ki.asc - Pseudo-inverse of K\n"
     "\n"
+    "For large systems, --modes=k stores the Kirchoff matrix sparsely\n"
+    "and iteratively computes only the k lowest non-zero modes.  In this\n"
+    "case, foo_U.asc and foo_s.asc contain the constant (zero) mode\n"
+    "followed by the k requested modes, and neither foo_K.asc nor\n"
+    "foo_Ki.asc is written.\n"
+    "\n"
     "Notes:\n"
     "- The default selection (if none is specified) is to pick CA's\n"
     "- The output is ASCII format suitable for use with Matlab/Octave/Gnuplot\n"
@@ -128,7 +137,8 @@ void parseOptions(int argc, char *argv[]) {
       ("help", "Produce this help message")
       ("fullhelp", "Get extended help")
       ("selection,s", po::value<string>(&selection)->default_value("name == 'CA'"), "Which atoms to use for the network")
-      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact");
+      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact")
+      ("modes", po::value<uint>(&nmodes)->default_value(0), "Use a sparse Kirchoff matrix and only compute this many modes (0 = all)");
 
     po::options_description hidden("Hidden options");
     hidden.add_options()
@@ -192,6 +202,46 @@ Matrix kirchoff(AtomicGroup& group, const double cutoff) {
 
 
 
+// Only the lowest modes are computed, with the constant vector (the
+// zero mode) projected out of the search
+void sparseGNM(const AtomicGroup& subset, const string& header) {
+  Timer<WallTimer> timer;
+  cerr << "Computing sparse Kirchoff matrix - ";
+  timer.start();
+  ENM::SparseBlockMatrix K = ENM::sparseKirchhoff(subset, cutoff, normalization);
+  timer.stop();
+  cerr << "done.\n" << timer << endl;
+
+  uint n = subset.size();
+  DoubleMatrix constant(n, 1);
+  for (uint i=0; i<n; ++i)
+    constant[i] = 1.0 / sqrt(static_cast<double>(n));
+
+  cerr << "Computing lowest modes - ";
+  timer.start();
+  boost::tuple<DoubleMatrix, DoubleMatrix> result = ENM::lowestModes(K, nmodes, constant);
+  timer.stop();
+  cerr << "done.\n" << timer << endl;
+
+  Matrix S = boost::get<0>(result);
+  Matrix V = boost::get<1>(result);
+
+  Matrix U(n, nmodes + 1);
+  Matrix s(nmodes + 1, 1);
+  for (uint i=0; i<n; ++i)
+    U(i, 0) = constant[i];
+  for (uint j=0; j<nmodes; ++j) {
+    s[j+1] = S[j];
+    for (uint i=0; i<n; ++i)
+      U(i, j+1) = V(i, j);
+  }
+
+  writeAsciiMatrix(prefix + "_U.asc", U, header);
+  writeAsciiMatrix(prefix + "_s.asc", s, header);
+}
+
+
+
 int main(int argc, char *argv[]) {
 
   string header = invocationHeader(argc, argv);
@@ -201,6 +251,16 @@ int main(int argc, char *argv[]) {
   AtomicGroup subset = selectAtoms(model, selection);
 
   cout << boost::format("Selected %d atoms from %s\n") % subset.size() % model_name;
+
+  if (nmodes != 0) {
+    if (nmodes >= subset.size()) {
+      cerr << boost::format("Error- cannot compute %d modes for %d nodes\n") % nmodes % subset.size();
+      exit(-1);
+    }
+    sparseGNM(subset, header);
+    exit(0);
+  }
+
   Timer<WallTimer> timer;
   cerr << "Computing Kirchoff matrix - ";
   timer.start();
@@ -71,6 +71,9 @@ namespace ENM {
 
     uint size() const { return(static_cast<uint>(nodes.size())); }
 
+    //! The nodes the hessian is built from
+    const loos::AtomicGroup& nodeList() const { return(nodes); }
+
     // ------------------------------------------------------
     //! Forwards to the contained SpringFunction...
     virtual SpringFunction::Params setParams(const SpringFunction::Params& v) {
@@ -82,6 +85,12 @@ namespace ENM {
 
     //! Forwards to the contained SpringFunction...
     virtual uint paramSize() const { return(springs->paramSize()); }
+
+    //! Forwards to the contained SpringFunction...
+    virtual double range() const { return(springs->range()); }
+
+    //! Longest distance between any two nodes given their own spring (see BoundSuperBlock)
+    virtual double boundRange() const { return(0.0); }
     // ------------------------------------------------------
 
     //! Returns a 3x3 matrix representing a superblock in the Hessian for the two nodes
@@ -89,6 +98,16 @@ namespace ENM {
       return(blockImpl(j, i, springs));
     }
 
+    //! Computes the superblock for the two nodes into \a B (3x3, column-major)
+    /**
+     * This version does not allocate and is what the hessian builders
+     * use, calling it from several threads at once, so decorators
+     * should override both versions of block().
+     */
+    virtual void block(const uint j, const uint i, double* B) {
+      blockImpl(j, i, springs, B);
+    }
+
 
   protected:
 
@@ -99,23 +118,28 @@ namespace ENM {
      * with alternative spring functions...
      */
     loos::DoubleMatrix blockImpl(const uint j, const uint i, SpringFunction* fptr) {
+      loos::DoubleMatrix B(3, 3);
+      blockImpl(j, i, fptr, B.get());
+      return(B);
+    }
+
+    //! Non-allocating implementation of the superblock calculation
+    void blockImpl(const uint j, const uint i, SpringFunction* fptr, double* B) {
       if (i >= size() || j >= size())
         throw(std::runtime_error("Invalid index in Hessian SuperBlock"));
 
       if (fptr == 0)
         throw(std::runtime_error("No spring function defined for hessian!"));
 
-      loos::GCoord u = nodes[j]->coords();
-      loos::GCoord v = nodes[i]->coords();
+      const loos::GCoord& u = nodes[j]->coords();
+      const loos::GCoord& v = nodes[i]->coords();
       loos::GCoord d = v - u;
     
-      loos::DoubleMatrix K = fptr->constant(u, v, d);
-      loos::DoubleMatrix B(3, 3);
+      double K[9];
+      fptr->constant(u, v, d, K);
       for (uint y=0; y<3; ++y)
         for (uint x=0; x<3; ++x)
-          B(x, y) = d[x]*d[y] * K(x,y);
-
-      return(B);
+          B[y*3 + x] = d[x]*d[y] * K[y*3 + x];
     }
 
 
@@ -138,6 +162,9 @@ namespace ENM {
     //! Constructor that takes a SuperBlock to decorate
     SuperBlockDecorator(SuperBlock* b) : SuperBlock(*b), decorated(b) { }
 
+    double range() const { return(decorated->range()); }
+    double boundRange() const { return(decorated->boundRange()); }
+
   protected:
     SuperBlock *decorated;
   };
@@ -204,6 +231,13 @@ namespace ENM {
         return(decorated->block(j, i));
     }
 
+    void block(const uint j, const uint i, double* B) {
+      if (connectivity(j, i))
+        blockImpl(j, i, bound_spring, B);
+      else
+        decorated->block(j, i, B);
+    }
+
     //! Assign parameters and propagate to the decorated superblock
     SpringFunction::Params setParams(const SpringFunction::Params& v) {
       SpringFunction::Params u = bound_spring->setParams(v);
@@ -218,6 +252,20 @@ namespace ENM {
     //! Returns the aggregate parameter size
     uint paramSize() const { return(bound_spring->paramSize() + decorated->paramSize()); }
 
+    //! Range of the decorated superblock, extended to reach all bound nodes
+    double range() const { return(std::max(decorated->range(), boundRange())); }
+
+    //! Longest distance between bound nodes, here or in the decorated superblock
+    double boundRange() const {
+      double r2 = 0.0;
+      for (uint i=1; i<connectivity.cols(); ++i)
+        for (uint j=0; j<i; ++j)
+          if (connectivity(j, i))
+            r2 = std::max(r2, nodes[j]->coords().distance2(nodes[i]->coords()));
+
+      return(std::max(decorated->boundRange(), sqrt(r2)));
+    }
+
   private:
     SpringFunction* bound_spring;
     loos::Math::Matrix<int> connectivity;
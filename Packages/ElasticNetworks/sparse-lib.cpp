@@ -0,0 +1,785 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "sparse-lib.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <boost/thread/thread.hpp>
+
+
+using namespace std;
+using namespace loos;
+
+
+namespace ENM {
+
+  namespace {
+
+    // Columns of V are packed, so these are just pointer offsets...
+    DoubleMatrix joinColumns(const DoubleMatrix& A, const DoubleMatrix& B) {
+      if (A.cols() == 0)
+        return(B.copy());
+      if (B.cols() == 0)
+        return(A.copy());
+
+      DoubleMatrix C(A.rows(), A.cols() + B.cols());
+      copy(A.get(), A.get() + A.rows() * A.cols(), C.get());
+      copy(B.get(), B.get() + B.rows() * B.cols(), C.get() + A.rows() * A.cols());
+      return(C);
+    }
+
+
+    DoubleMatrix firstColumns(const DoubleMatrix& A, const uint k) {
+      DoubleMatrix C(A.rows(), k);
+      copy(A.get(), A.get() + A.rows() * k, C.get());
+      return(C);
+    }
+
+
+    // V = V - Q (Q' V), with Q having orthonormal columns
+    void projectOut(DoubleMatrix& V, const DoubleMatrix& Q) {
+      if (Q.cols() == 0 || V.cols() == 0)
+        return;
+
+      DoubleMatrix C = Math::MMMultiply(Q, V, true, false);
+      DoubleMatrix QC = Math::MMMultiply(Q, C);
+      for (ulong i=0; i<V.rows() * V.cols(); ++i)
+        V[i] -= QC[i];
+    }
+
+
+    // Orthonormalize the columns of V using the SVQB algorithm
+    // (Stathopoulos & Wu, SIAM J Sci Comput (2002) 23:2165).  Columns
+    // that are linearly dependent (to within droptol) are dropped, so
+    // the result may have fewer columns than V.
+    DoubleMatrix svqb(const DoubleMatrix& V, const double droptol) {
+      uint m = V.cols();
+      if (m == 0)
+        return(V);
+
+      DoubleMatrix G = Math::MMMultiply(V, V, true, false);
+      vector<double> d(m);
+      for (uint j=0; j<m; ++j)
+        d[j] = G(j, j) > 0.0 ? 1.0 / sqrt(G(j, j)) : 0.0;
+      for (uint j=0; j<m; ++j)
+        for (uint i=0; i<m; ++i)
+          G(i, j) *= d[i] * d[j];
+
+      DoubleMatrix theta = Math::eigenDecomp(G);
+      double tmax = theta[m-1];
+      vector<uint> kept;
+      for (uint j=0; j<m; ++j)
+        if (tmax > 0.0 && theta[j] > droptol * tmax)
+          kept.push_back(j);
+
+      DoubleMatrix T(m, kept.size());
+      for (uint q=0; q<kept.size(); ++q) {
+        double s = 1.0 / sqrt(theta[kept[q]]);
+        for (uint i=0; i<m; ++i)
+          T(i, q) = d[i] * G(i, kept[q]) * s;
+      }
+
+      return(Math::MMMultiply(V, T));
+    }
+
+
+    // One pass of SVQB leaves the result orthonormal only to about
+    // the square root of machine precision when V is ill-conditioned,
+    // so always take two...
+    DoubleMatrix orthonormalize(const DoubleMatrix& V) {
+      return(svqb(svqb(V, 1e-12), 1e-12));
+    }
+
+
+    double dot(const double* x, const double* y, const uint n) {
+      double s = 0.0;
+      for (uint i=0; i<n; ++i)
+        s += x[i] * y[i];
+      return(s);
+    }
+
+
+    // Block-Jacobi preconditioner, i.e. the inverses of the diagonal
+    // blocks.  Singular blocks (nodes with no or collinear contacts)
+    // are regularized.
+    class BlockJacobi {
+    public:
+      BlockJacobi(const SparseBlockMatrix& A) : bdim_(A.blockSize()), nblocks_(A.rows() / A.blockSize()) {
+        uint bb = bdim_ * bdim_;
+        inverses_.resize(nblocks_ * bb);
+
+        for (uint k=0; k<nblocks_; ++k) {
+          DoubleMatrix D = A.diagonalBlock(k);
+          DoubleMatrix ev = Math::eigenDecomp(D);
+          double lmax = ev[bdim_ - 1];
+          double* Di = &inverses_[k * bb];
+
+          if (lmax <= 0.0) {
+            for (uint i=0; i<bdim_; ++i)
+              Di[i * bdim_ + i] = 1.0;
+            continue;
+          }
+
+          for (uint i=0; i<bdim_; ++i) {
+            double s = 1.0 / max(ev[i], 1e-6 * lmax);
+            for (uint y=0; y<bdim_; ++y)
+              for (uint x=0; x<bdim_; ++x)
+                Di[y * bdim_ + x] += D(x, i) * D(y, i) * s;
+          }
+        }
+      }
+
+      void apply(const double* r, double* z) const {
+        uint bb = bdim_ * bdim_;
+        for (uint k=0; k<nblocks_; ++k) {
+          const double* Di = &inverses_[k * bb];
+          const double* rk = r + k * bdim_;
+          double* zk = z + k * bdim_;
+          for (uint x=0; x<bdim_; ++x) {
+            double s = 0.0;
+            for (uint y=0; y<bdim_; ++y)
+              s += Di[y * bdim_ + x] * rk[y];
+            zk[x] = s;
+          }
+        }
+      }
+
+      DoubleMatrix apply(const DoubleMatrix& R) const {
+        DoubleMatrix Z(R.rows(), R.cols());
+        for (uint j=0; j<R.cols(); ++j)
+          apply(R.get() + j * R.rows(), Z.get() + j * R.rows());
+        return(Z);
+      }
+
+    private:
+      uint bdim_, nblocks_;
+      vector<double> inverses_;
+    };
+
+
+    // Fall-back for problems too small for LOBPCG to make sense.  The
+    // constrained directions are shifted past the top of the spectrum
+    // so the lowest eigenpairs are the unconstrained ones.
+    boost::tuple<DoubleMatrix, DoubleMatrix> denseLowestModes(const SparseBlockMatrix& A, const uint k, const DoubleMatrix& Y) {
+      DoubleMatrix H = A.dense();
+      if (Y.cols() != 0) {
+        double shift = 2.0 * A.normEstimate() + 1.0;
+        DoubleMatrix YY = Math::MMMultiply(Y, Y, false, true);
+        for (ulong i=0; i<H.rows() * H.cols(); ++i)
+          H[i] += shift * YY[i];
+      }
+
+      DoubleMatrix ev = Math::eigenDecomp(H);
+      DoubleMatrix vals(k, 1);
+      for (uint i=0; i<k; ++i)
+        vals[i] = ev[i];
+
+      return(boost::tuple<DoubleMatrix, DoubleMatrix>(vals, firstColumns(H, k)));
+    }
+
+  }
+
+
+
+  void SparseBlockMatrix::add(const uint i, const uint j, const double* block) {
+    if (final_)
+      throw(std::logic_error("Cannot add to a SparseBlockMatrix after it has been finalized"));
+    if (i >= block_rows_ || j >= block_cols_)
+      throw(std::runtime_error("Invalid index in SparseBlockMatrix"));
+
+    uint bb = bdim_ * bdim_;
+    staged_.push_back(Entry(i, j, values_.size()));
+    values_.insert(values_.end(), block, block + bb);
+  }
+
+
+  void SparseBlockMatrix::finalize() {
+    if (final_)
+      return;
+
+    uint bb = bdim_ * bdim_;
+    sort(staged_.begin(), staged_.end());
+
+    vector<double> values;
+    values.reserve(values_.size());
+    columns_.clear();
+    row_start_.assign(block_rows_ + 1, 0);
+
+    for (vector<Entry>::const_iterator e = staged_.begin(); e != staged_.end(); ++e) {
+      const double* block = &values_[e->offset];
+      if (e != staged_.begin() && (e-1)->row == e->row && (e-1)->col == e->col) {
+        double* dest = &values[values.size() - bb];
+        for (uint q=0; q<bb; ++q)
+          dest[q] += block[q];
+      } else {
+        columns_.push_back(e->col);
+        values.insert(values.end(), block, block + bb);
+        ++row_start_[e->row + 1];
+      }
+    }
+
+    for (uint i=0; i<block_rows_; ++i)
+      row_start_[i+1] += row_start_[i];
+
+    values_.swap(values);
+    vector<Entry>().swap(staged_);
+    final_ = true;
+  }
+
+
+  void SparseBlockMatrix::checkFinal() const {
+    if (!final_)
+      throw(std::logic_error("SparseBlockMatrix used before being finalized"));
+  }
+
+
+  void SparseBlockMatrix::multiply(const double* x, double* y) const {
+    checkFinal();
+
+    uint bb = bdim_ * bdim_;
+    for (uint i=0; i<block_rows_; ++i) {
+      double* yi = y + i * bdim_;
+      for (uint r=0; r<bdim_; ++r)
+        yi[r] = 0.0;
+
+      for (uint k=row_start_[i]; k<row_start_[i+1]; ++k) {
+        const double* xj = x + columns_[k] * bdim_;
+        const double* B = &values_[k * bb];
+        for (uint c=0; c<bdim_; ++c) {
+          double xc = xj[c];
+          for (uint r=0; r<bdim_; ++r)
+            yi[r] += B[c * bdim_ + r] * xc;
+        }
+      }
+    }
+  }
+
+
+  DoubleMatrix SparseBlockMatrix::multiply(const DoubleMatrix& X) const {
+    if (X.rows() != cols())
+      throw(std::runtime_error("Matrix dimensions do not match in SparseBlockMatrix::multiply()"));
+
+    DoubleMatrix Y(rows(), X.cols());
+    for (uint j=0; j<X.cols(); ++j)
+      multiply(X.get() + j * X.rows(), Y.get() + j * Y.rows());
+
+    return(Y);
+  }
+
+
+  SparseBlockMatrix SparseBlockMatrix::submatrix(const Math::Range& rows, const Math::Range& cols) const {
+    checkFinal();
+    if (rows.second > block_rows_ || cols.second > block_cols_ || rows.first > rows.second || cols.first > cols.second)
+      throw(std::runtime_error("Invalid range in SparseBlockMatrix::submatrix()"));
+
+    uint bb = bdim_ * bdim_;
+    SparseBlockMatrix S(rows.second - rows.first, cols.second - cols.first, bdim_);
+    for (uint i=rows.first; i<rows.second; ++i)
+      for (uint k=row_start_[i]; k<row_start_[i+1]; ++k)
+        if (columns_[k] >= cols.first && columns_[k] < cols.second)
+          S.add(i - rows.first, columns_[k] - cols.first, &values_[k * bb]);
+
+    S.finalize();
+    return(S);
+  }
+
+
+  DoubleMatrix SparseBlockMatrix::diagonalBlock(const uint i) const {
+    checkFinal();
+
+    DoubleMatrix D(bdim_, bdim_);
+    vector<uint>::const_iterator begin = columns_.begin() + row_start_[i];
+    vector<uint>::const_iterator end = columns_.begin() + row_start_[i+1];
+    vector<uint>::const_iterator k = lower_bound(begin, end, i);
+    if (k != end && *k == i) {
+      const double* B = &values_[(k - columns_.begin()) * bdim_ * bdim_];
+      copy(B, B + bdim_ * bdim_, D.get());
+    }
+
+    return(D);
+  }
+
+
+  double SparseBlockMatrix::normEstimate() const {
+    checkFinal();
+
+    uint bb = bdim_ * bdim_;
+    double norm = 0.0;
+    for (uint i=0; i<block_rows_; ++i)
+      for (uint r=0; r<bdim_; ++r) {
+        double s = 0.0;
+        for (uint k=row_start_[i]; k<row_start_[i+1]; ++k)
+          for (uint c=0; c<bdim_; ++c)
+            s += fabs(values_[k * bb + c * bdim_ + r]);
+        norm = max(norm, s);
+      }
+
+    return(norm);
+  }
+
+
+  DoubleMatrix SparseBlockMatrix::dense() const {
+    checkFinal();
+
+    uint bb = bdim_ * bdim_;
+    DoubleMatrix M(rows(), cols());
+    for (uint i=0; i<block_rows_; ++i)
+      for (uint k=row_start_[i]; k<row_start_[i+1]; ++k)
+        for (uint c=0; c<bdim_; ++c)
+          for (uint r=0; r<bdim_; ++r)
+            M(i * bdim_ + r, columns_[k] * bdim_ + c) = values_[k * bb + c * bdim_ + r];
+
+    return(M);
+  }
+
+
+
+  namespace {
+
+    // Collects the indices of nearby nodes from a CellList
+    struct CollectContacts {
+      CollectContacts(const uint i, const double r2, vector<uint>& js) : self(i), cutoff2(r2), found(js) { }
+
+      bool operator()(const uint j, const double d2) {
+        if (j != self && d2 <= cutoff2)
+          found.push_back(j);
+        return(true);
+      }
+
+      uint self;
+      double cutoff2;
+      vector<uint>& found;
+    };
+
+
+    // Computes the superblocks for every contact j < i of a subset
+    // of the rows (i, i+stride, i+2*stride, ...).  Blocks that are
+    // entirely zero (i.e. beyond the reach of the spring) are dropped.
+    struct HessianRowWorker {
+      HessianRowWorker(SuperBlock* b, const ContactFinder* f, const uint first, const uint stride, string* err) :
+        blocker(b), finder(f), row(first), step(stride), error(err) { }
+
+      void operator()() {
+        try {
+          vector<uint> js;
+          double B[9];
+          for (uint i=row; i<blocker->size(); i += step) {
+            finder->contacts(i, js);
+            for (vector<uint>::const_iterator j = js.begin(); j != js.end() && *j < i; ++j) {
+              blocker->block(*j, i, B);
+
+              bool nonzero = false;
+              for (uint q=0; q<9; ++q)
+                nonzero |= (B[q] != 0.0);
+              if (!nonzero)
+                continue;
+
+              rows.push_back(i);
+              columns.push_back(*j);
+              blocks.insert(blocks.end(), B, B + 9);
+            }
+          }
+        }
+        catch (std::exception& e) {
+          *error = e.what();
+        }
+      }
+
+      SuperBlock* blocker;
+      const ContactFinder* finder;
+      uint row, step;
+      string* error;
+
+      vector<uint> rows, columns;
+      vector<double> blocks;
+    };
+
+  }
+
+
+
+  ContactFinder::ContactFinder(const AtomicGroup& nodes, const double cutoff) :
+    cutoff2_(cutoff * cutoff)
+  {
+    if (!(cutoff > 0.0))
+      throw(std::runtime_error("A positive cutoff is required to find contacts"));
+
+    crds_.reserve(nodes.size());
+    for (AtomicGroup::const_iterator i = nodes.begin(); i != nodes.end(); ++i)
+      crds_.push_back((*i)->coords());
+
+    if (cutoff != numeric_limits<double>::infinity()) {
+      cells_ = boost::shared_ptr<CellList>(new CellList(cutoff));
+      cells_->build(crds_);
+    }
+  }
+
+
+  void ContactFinder::contacts(const uint i, vector<uint>& js) const {
+    js.clear();
+    if (!cells_) {
+      for (uint j=0; j<crds_.size(); ++j)
+        if (j != i)
+          js.push_back(j);
+      return;
+    }
+
+    CollectContacts collector(i, cutoff2_, js);
+    cells_->visitNeighbors(crds_[i], collector);
+    sort(js.begin(), js.end());
+  }
+
+
+
+  vector< pair<uint, uint> > contactPairs(const AtomicGroup& nodes, const double cutoff) {
+    if (cutoff == numeric_limits<double>::infinity())
+      throw(std::runtime_error("A finite cutoff is required to find contacts"));
+
+    vector< pair<uint, uint> > pairs;
+    ContactFinder finder(nodes, cutoff);
+    vector<uint> js;
+
+    for (uint i=0; i<nodes.size(); ++i) {
+      finder.contacts(i, js);
+      for (vector<uint>::const_iterator j = js.begin(); j != js.end() && *j < i; ++j)
+        pairs.push_back(pair<uint, uint>(*j, i));
+    }
+
+    return(pairs);
+  }
+
+
+
+  SparseBlockMatrix sparseHessian(SuperBlock* blocker, const double cutoff, const uint nthreads) {
+    uint n = blocker->size();
+
+    // Pad the cutoff slightly so that pairs right at the edge of the
+    // spring range aren't lost to round-off (the spring function
+    // makes the final decision)
+    ContactFinder finder(blocker->nodeList(), cutoff * (1.0 + 1e-10));
+
+    uint nworkers = max(1u, min(nthreads, n));
+    string error;
+    vector<HessianRowWorker> workers;
+    for (uint t=0; t<nworkers; ++t)
+      workers.push_back(HessianRowWorker(blocker, &finder, t, nworkers, &error));
+
+    boost::thread_group threads;
+    for (uint t=1; t<nworkers; ++t)
+      threads.create_thread(boost::ref(workers[t]));
+    workers[0]();
+    threads.join_all();
+
+    if (!error.empty())
+      throw(std::runtime_error(error));
+
+    // Merge the workers' blocks back in row order so the diagonal sums
+    // don't depend on the number of threads
+    SparseBlockMatrix H(n, n, 3);
+    vector<double> diagonal(9 * n, 0.0);
+    vector<uint> cursor(nworkers, 0);
+    double nb[9];
+
+    for (uint i=0; i<n; ++i) {
+      HessianRowWorker& w = workers[i % nworkers];
+      uint& k = cursor[i % nworkers];
+      for (; k < w.rows.size() && w.rows[k] == i; ++k) {
+        uint j = w.columns[k];
+        const double* B = &w.blocks[9 * k];
+        for (uint q=0; q<9; ++q)
+          nb[q] = -B[q];
+
+        H.add(i, j, nb);
+        H.add(j, i, nb);
+        for (uint q=0; q<9; ++q) {
+          diagonal[9*i + q] += B[q];
+          diagonal[9*j + q] += B[q];
+        }
+      }
+    }
+
+    for (uint i=0; i<n; ++i)
+      H.add(i, i, &diagonal[9*i]);
+
+    H.finalize();
+    return(H);
+  }
+
+
+
+  SparseBlockMatrix sparseKirchhoff(const AtomicGroup& nodes, const double cutoff, const double normalization) {
+    uint n = nodes.size();
+    SparseBlockMatrix K(n, n, 1);
+    vector<double> degree(n, 0.0);
+
+    vector< pair<uint, uint> > pairs = contactPairs(nodes, cutoff);
+    double k = -normalization;
+    for (vector< pair<uint, uint> >::const_iterator p = pairs.begin(); p != pairs.end(); ++p) {
+      K.add(p->first, p->second, &k);
+      K.add(p->second, p->first, &k);
+      degree[p->first] += normalization;
+      degree[p->second] += normalization;
+    }
+
+    for (uint i=0; i<n; ++i)
+      K.add(i, i, &degree[i]);
+
+    K.finalize();
+    return(K);
+  }
+
+
+
+  DoubleMatrix rigidBodyModes(const AtomicGroup& nodes) {
+    uint n = nodes.size();
+    GCoord c = nodes.centroid();
+
+    DoubleMatrix M(3*n, 6);
+    for (uint i=0; i<n; ++i) {
+      GCoord d = nodes[i]->coords() - c;
+      uint k = 3*i;
+
+      M(k, 0) = 1.0;
+      M(k+1, 1) = 1.0;
+      M(k+2, 2) = 1.0;
+
+      // Infinitesimal rotations about x, y, and z
+      M(k+1, 3) = -d.z();
+      M(k+2, 3) = d.y();
+
+      M(k, 4) = d.z();
+      M(k+2, 4) = -d.x();
+
+      M(k, 5) = -d.y();
+      M(k+1, 5) = d.x();
+    }
+
+    return(orthonormalize(M));
+  }
+
+
+
+  boost::tuple<DoubleMatrix, DoubleMatrix> lowestModes(const SparseBlockMatrix& A,
+                                                       const uint k,
+                                                       const DoubleMatrix& Y,
+                                                       const double tol,
+                                                       const uint maxiter,
+                                                       const int verbosity) {
+    uint n = A.rows();
+    if (A.cols() != n)
+      throw(std::runtime_error("lowestModes() requires a square matrix"));
+    if (Y.cols() != 0 && Y.rows() != n)
+      throw(std::runtime_error("Constraints passed to lowestModes() do not match the matrix"));
+
+    uint nfree = n - Y.cols();
+    if (k == 0 || k > nfree)
+      throw(std::runtime_error("Invalid number of modes requested from lowestModes()"));
+
+    // A few extra vectors in the block speed up convergence of the
+    // highest wanted mode
+    uint m = min(nfree, k + max(4u, k / 4));
+    if (3 * m >= nfree) {
+      if (verbosity > 1)
+        cerr << "Problem is small, using dense eigensolver...\n";
+      return(denseLowestModes(A, k, Y));
+    }
+
+    double threshold = tol * A.normEstimate();
+    BlockJacobi preconditioner(A);
+
+    // Deterministic starting guess...
+    boost::mt19937 generator(5489u);
+    boost::uniform_real<> range(-1.0, 1.0);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > uniform(generator, range);
+
+    DoubleMatrix X(n, m);
+    for (ulong i=0; i<X.rows() * X.cols(); ++i)
+      X[i] = uniform();
+    projectOut(X, Y);
+    X = orthonormalize(X);
+    if (X.cols() < m)
+      throw(std::runtime_error("Unable to build a starting block in lowestModes()"));
+
+    DoubleMatrix AX = A.multiply(X);
+    DoubleMatrix P;
+    DoubleMatrix lambda(m, 1);
+
+    // Initial Rayleigh-Ritz so that X are approximate eigenvectors
+    {
+      DoubleMatrix G = Math::MMMultiply(X, AX, true, false);
+      lambda = Math::eigenDecomp(G);
+      X = Math::MMMultiply(X, G);
+      AX = Math::MMMultiply(AX, G);
+    }
+
+    vector<double> residuals(m);
+    uint iter;
+    bool converged = false;
+    for (iter = 0; iter < maxiter; ++iter) {
+
+      DoubleMatrix R(n, m);
+      for (uint j=0; j<m; ++j)
+        for (uint i=0; i<n; ++i)
+          R(i, j) = AX(i, j) - lambda[j] * X(i, j);
+
+      vector<uint> active;
+      for (uint j=0; j<m; ++j) {
+        residuals[j] = sqrt(dot(R.get() + j*n, R.get() + j*n, n));
+        if (residuals[j] > threshold)
+          active.push_back(j);
+      }
+
+      uint nconv = 0;
+      while (nconv < k && residuals[nconv] <= threshold)
+        ++nconv;
+
+      if (verbosity > 2 && iter % 50 == 0)
+        cerr << boost::format("LOBPCG iteration %d: %d of %d modes converged, max residual %g\n")
+          % iter % nconv % k % *max_element(residuals.begin(), residuals.begin() + k);
+
+      if (nconv == k) {
+        converged = true;
+        break;
+      }
+
+      // Search directions are the preconditioned residuals of
+      // unconverged vectors plus the previous step
+      DoubleMatrix W(n, active.size());
+      for (uint q=0; q<active.size(); ++q)
+        copy(R.get() + active[q] * n, R.get() + (active[q]+1) * n, W.get() + q * n);
+      W = preconditioner.apply(W);
+
+      DoubleMatrix C = joinColumns(W, P);
+      for (uint pass=0; pass<2; ++pass) {
+        projectOut(C, Y);
+        projectOut(C, X);
+      }
+      C = orthonormalize(C);
+      if (C.cols() == 0)
+        break;
+
+      DoubleMatrix AC = A.multiply(C);
+      DoubleMatrix S = joinColumns(X, C);
+      DoubleMatrix AS = joinColumns(AX, AC);
+
+      DoubleMatrix G = Math::MMMultiply(S, AS, true, false);
+      for (uint j=0; j<G.cols(); ++j)
+        for (uint i=0; i<j; ++i)
+          G(i, j) = G(j, i) = 0.5 * (G(i, j) + G(j, i));
+
+      DoubleMatrix theta = Math::eigenDecomp(G);
+      DoubleMatrix Z = firstColumns(G, m);
+      for (uint j=0; j<m; ++j)
+        lambda[j] = theta[j];
+
+      X = Math::MMMultiply(S, Z);
+      AX = Math::MMMultiply(AS, Z);
+      P = Math::MMMultiply(C, Math::submatrix(Z, Math::Range(m, Z.rows()), Math::Range(0, m)));
+    }
+
+    if (!converged)
+      cerr << boost::format("Warning- lowestModes() did not converge after %d iterations (max residual %g, threshold %g)\n")
+        % iter % *max_element(residuals.begin(), residuals.begin() + k) % threshold;
+    else if (verbosity > 1)
+      cerr << boost::format("LOBPCG converged in %d iterations\n") % iter;
+
+    DoubleMatrix vals(k, 1);
+    for (uint i=0; i<k; ++i)
+      vals[i] = lambda[i];
+
+    return(boost::tuple<DoubleMatrix, DoubleMatrix>(vals, firstColumns(X, k)));
+  }
+
+
+
+  DoubleMatrix conjugateGradient(const SparseBlockMatrix& A,
+                                 const DoubleMatrix& B,
+                                 const double tol,
+                                 const uint maxiter,
+                                 const int verbosity) {
+    uint n = A.rows();
+    if (A.cols() != n || B.rows() != n)
+      throw(std::runtime_error("Matrix dimensions do not match in conjugateGradient()"));
+
+    BlockJacobi preconditioner(A);
+    DoubleMatrix X(n, B.cols());
+    vector<double> r(n), z(n), p(n), q(n);
+    uint total = 0;
+    bool warned = false;
+
+    for (uint col=0; col<B.cols(); ++col) {
+      const double* b = B.get() + col * n;
+      double* x = X.get() + col * n;
+
+      double bnorm = sqrt(dot(b, b, n));
+      if (bnorm == 0.0)
+        continue;
+
+      copy(b, b + n, r.begin());
+      preconditioner.apply(&r[0], &z[0]);
+      p = z;
+      double rz = dot(&r[0], &z[0], n);
+
+      uint iter;
+      bool converged = false;
+      for (iter = 0; iter < maxiter; ++iter) {
+        A.multiply(&p[0], &q[0]);
+        double alpha = rz / dot(&p[0], &q[0], n);
+        for (uint i=0; i<n; ++i) {
+          x[i] += alpha * p[i];
+          r[i] -= alpha * q[i];
+        }
+
+        if (sqrt(dot(&r[0], &r[0], n)) <= tol * bnorm) {
+          converged = true;
+          break;
+        }
+
+        preconditioner.apply(&r[0], &z[0]);
+        double rz_next = dot(&r[0], &z[0], n);
+        double beta = rz_next / rz;
+        rz = rz_next;
+        for (uint i=0; i<n; ++i)
+          p[i] = z[i] + beta * p[i];
+      }
+
+      total += iter + 1;
+      if (!converged && !warned) {
+        cerr << "Warning- conjugateGradient() did not converge after " << maxiter << " iterations (is the matrix singular?)\n";
+        warned = true;
+      }
+    }
+
+    if (verbosity > 1 && B.cols() != 0)
+      cerr << boost::format("Conjugate gradient averaged %.1f iterations per vector\n") % (static_cast<double>(total) / B.cols());
+
+    return(X);
+  }
+
+
+};
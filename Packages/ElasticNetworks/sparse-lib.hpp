@@ -0,0 +1,200 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2010 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** \addtogroup ENM
+ *@{
+ */
+
+
+#if !defined(LOOS_SPARSE_LIB_HPP)
+#define LOOS_SPARSE_LIB_HPP
+
+#include <loos.hpp>
+#include "hessian.hpp"
+
+
+namespace ENM {
+
+
+  //! Matrix stored as a sparse set of small, dense square blocks
+  /**
+   * The matrix is divided into blocks of blockSize() x blockSize()
+   * elements (3x3 for an ANM hessian, 1x1 for a GNM Kirchhoff
+   * matrix) and only the non-zero blocks are stored, in compressed
+   * rows.  Blocks are added with add(), which sums repeated blocks,
+   * and the matrix must be finalized with finalize() before it can be
+   * used.
+   */
+  class SparseBlockMatrix {
+  public:
+    SparseBlockMatrix() : block_rows_(0), block_cols_(0), bdim_(0), final_(true) { }
+
+    //! Empty matrix of \a nrows x \a ncols blocks, each \a bdim x \a bdim
+    SparseBlockMatrix(const uint nrows, const uint ncols, const uint bdim) :
+      block_rows_(nrows), block_cols_(ncols), bdim_(bdim), final_(false) { }
+
+    uint rows() const { return(block_rows_ * bdim_); }
+    uint cols() const { return(block_cols_ * bdim_); }
+
+    //! Number of rows (or columns) in each block
+    uint blockSize() const { return(bdim_); }
+
+    //! Number of blocks stored
+    uint nonzeroBlocks() const { return(static_cast<uint>(columns_.size())); }
+
+    //! Add a block (stored column-major) at block-row \a i and block-column \a j
+    void add(const uint i, const uint j, const double* block);
+
+    //! Sort and merge the added blocks into compressed rows
+    void finalize();
+
+    //! Computes \a y = A \a x
+    void multiply(const double* x, double* y) const;
+
+    //! Computes A X for a set of column vectors
+    loos::DoubleMatrix multiply(const loos::DoubleMatrix& X) const;
+
+    //! Extract the blocks in the given (half-open) ranges of block-rows and block-columns
+    SparseBlockMatrix submatrix(const loos::Math::Range& rows, const loos::Math::Range& cols) const;
+
+    //! Returns the diagonal block for block-row \a i
+    loos::DoubleMatrix diagonalBlock(const uint i) const;
+
+    //! Upper bound on the largest eigenvalue (max absolute row sum)
+    double normEstimate() const;
+
+    //! Expand into a dense matrix
+    loos::DoubleMatrix dense() const;
+
+  private:
+    struct Entry {
+      Entry(const uint i, const uint j, const uint k) : row(i), col(j), offset(k) { }
+      bool operator<(const Entry& e) const { return(row < e.row || (row == e.row && col < e.col)); }
+      uint row, col, offset;
+    };
+
+    void checkFinal() const;
+
+    uint block_rows_, block_cols_, bdim_;
+    bool final_;
+    std::vector<Entry> staged_;
+
+    std::vector<uint> row_start_;
+    std::vector<uint> columns_;
+    std::vector<double> values_;
+  };
+
+
+
+  //! Finds the nodes that are in contact with a given node
+  /**
+   * Contacts are found with a CellList, so the cost grows with the
+   * number of contacts rather than the square of the number of
+   * nodes.  With an infinite cutoff, every node is in contact with
+   * every other one.  A ContactFinder may be shared between threads.
+   */
+  class ContactFinder {
+  public:
+    ContactFinder(const loos::AtomicGroup& nodes, const double cutoff);
+
+    //! Fills \a js with the nodes in contact with node \a i (in ascending order, excluding \a i)
+    void contacts(const uint i, std::vector<uint>& js) const;
+
+  private:
+    double cutoff2_;
+    std::vector<loos::GCoord> crds_;
+    boost::shared_ptr<loos::CellList> cells_;
+  };
+
+
+  //! List all pairs of nodes (j < i) that are no farther apart than \a cutoff
+  std::vector< std::pair<uint, uint> > contactPairs(const loos::AtomicGroup& nodes, const double cutoff);
+
+
+  //! Build the hessian for \a blocker, only considering nodes within \a cutoff
+  /**
+   * The result is identical to the dense hessian when the spring
+   * function vanishes beyond the cutoff (i.e. the default distance
+   * cutoff spring).  Otherwise, springs between nodes farther apart
+   * than \a cutoff are dropped.  The superblocks are computed by
+   * \a nthreads threads.
+   */
+  SparseBlockMatrix sparseHessian(SuperBlock* blocker, const double cutoff, const uint nthreads = 1);
+
+
+  //! Build the Kirchhoff matrix for a GNM
+  SparseBlockMatrix sparseKirchhoff(const loos::AtomicGroup& nodes, const double cutoff, const double normalization = 1.0);
+
+
+  //! Orthonormal basis for the rigid-body translations and rotations of \a nodes
+  /**
+   * The result is 3n x 6, unless the nodes are collinear, in which
+   * case only 5 independent modes exist.
+   */
+  loos::DoubleMatrix rigidBodyModes(const loos::AtomicGroup& nodes);
+
+
+  //! Find the lowest eigenpairs of a sparse, symmetric semi-definite matrix
+  /**
+   * Uses the locally optimal block preconditioned conjugate gradient
+   * method (LOBPCG, see <a href="http://dx.doi.org/10.1137/S1064827500366124">Knyazev,
+   * SIAM J Sci Comput (2001) 23:517</a>) with a block-Jacobi
+   * preconditioner.  The search is restricted to the space orthogonal
+   * to the columns of \a constraints, which must be orthonormal and
+   * are typically the known null space of \a A (e.g. rigidBodyModes()),
+   * so the \a k lowest non-trivial modes are returned directly.
+   *
+   * Convergence is reached when every residual is below \a tol times
+   * an estimate of the norm of \a A.  Small problems are handed off
+   * to a dense eigensolver.
+   *
+   * Returns a tuple of (eigenvalues, eigenvectors) in ascending order.
+   */
+  boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> lowestModes(const SparseBlockMatrix& A,
+                                                                   const uint k,
+                                                                   const loos::DoubleMatrix& constraints,
+                                                                   const double tol = 1e-9,
+                                                                   const uint maxiter = 2000,
+                                                                   const int verbosity = 0);
+
+
+  //! Solve A X = B for a symmetric positive-definite \a A
+  /**
+   * Each column is solved with block-Jacobi preconditioned conjugate
+   * gradients until the residual is below \a tol times the norm of
+   * that column of \a B.
+   */
+  loos::DoubleMatrix conjugateGradient(const SparseBlockMatrix& A,
+                                       const loos::DoubleMatrix& B,
+                                       const double tol = 1e-10,
+                                       const uint maxiter = 10000,
+                                       const int verbosity = 0);
+
+};
+
+
+#endif
+
+
+
+/** @} */
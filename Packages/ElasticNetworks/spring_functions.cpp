@@ -6,8 +6,26 @@
 
 #include "spring_functions.hpp"
 
+#include <boost/thread/mutex.hpp>
+
 namespace ENM {
 
+  namespace {
+    // Spring constants may be computed from several threads at once
+    // while building a hessian...
+    boost::mutex warning_lock;
+  }
+
+
+  void SpringFunction::warnNegative() {
+    boost::mutex::scoped_lock lock(warning_lock);
+    if (!warned) {
+      warned = true;
+      std::cerr << "Warning- negative spring constants found in " << name() << ".  Setting to 0.\n";
+    }
+  }
+
+
   std::vector<std::string> splitCommaSeparatedList(const std::string& s){
     std::vector<std::string> holder;
     std::string::size_type prev =s.find_first_not_of(",", 0);
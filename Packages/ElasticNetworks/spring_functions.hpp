@@ -32,6 +32,7 @@
 
 
 #include <loos.hpp>
+#include <limits>
 
 
 namespace ENM {
@@ -91,11 +92,29 @@ namespace ENM {
     //! How many internal constants there are
     virtual uint paramSize() const =0;
 
+    //! Distance beyond which the spring constant is always zero
+    /**
+     * Spring functions that connect every pair of nodes return
+     * infinity.  This is used to decide which pairs of nodes need to
+     * be considered when building a sparse hessian.
+     */
+    virtual double range() const { return(std::numeric_limits<double>::infinity()); }
 
   
     //! Actually compute the spring constant as a 3x3 matrix
     virtual loos::DoubleMatrix constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d)  =0;
 
+    //! Compute the spring constant into \a K (3x3, column-major) without allocating
+    /**
+     * This is what the hessian builders call, possibly from several
+     * threads at once.  The default forwards to the allocating
+     * version above.
+     */
+    virtual void constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d, double* K) {
+      loos::DoubleMatrix M = constant(u, v, d);
+      std::copy(M.get(), M.get() + 9, K);
+    }
+
   protected:
 
     //! Check for negative spring-constants
@@ -104,10 +123,7 @@ namespace ENM {
      */
     double checkConstant(double d) {
       if (d < 0.0) {
-        if (!warned) {
-          warned = true;
-          std::cerr << "Warning- negative spring constants found in " << name() << ".  Setting to 0.\n";
-        }
+        warnNegative();
         d = 0.0;
       }
 
@@ -115,6 +131,8 @@ namespace ENM {
     }
 
   private:
+    void warnNegative();
+
     bool warned;
   };
 
@@ -143,6 +161,12 @@ namespace ENM {
       return(B);
     }
 
+    void constant(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d, double* K) {
+      double k = checkConstant(constantImpl(u, v, d));
+      for (uint i=0; i<9; ++i)
+        K[i] = k;
+    }
+
   private:
 
     //! Implementation of the spring constant calculation
@@ -184,6 +208,8 @@ namespace ENM {
 
     uint paramSize() const { return(1); }
 
+    double range() const { return(sqrt(radius)); }
+
     double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
       double s = d.length2();
       if (s <= radius)
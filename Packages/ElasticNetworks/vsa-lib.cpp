@@ -46,6 +46,8 @@ namespace ENM {
     double vu = 0.0;
     f77int il = 7;
     f77int iu = n;
+    if (sparse_modes_ != 0 && sparse_modes_ + 6 < static_cast<uint>(n))
+      iu = sparse_modes_ + 6;
 
     char dpar = 'S';
     double abstol = 2.0 * dlamch_(&dpar);
@@ -82,11 +84,18 @@ namespace ENM {
       exit(-1);
     }
 
-    if (m != n-6) {
-      cerr << "ERROR- only got " << m << " eigenpairs instead of " << n-6 << endl;
+    if (m != iu-6) {
+      cerr << "ERROR- only got " << m << " eigenpairs instead of " << iu-6 << endl;
       exit(-10);
     }
 
+    // As with the full solution, the 6 unused slots (zeros) will sort
+    // to the front in place of the rigid-body modes
+    if (iu != n) {
+      W = submatrix(W, Math::Range(0, iu), Math::Range(0, 1));
+      Z = submatrix(Z, Math::Range(0, n), Math::Range(0, iu));
+    }
+
     vector<uint> indices = sortedIndex(W);
     W = permuteRows(W, indices);
     Z = permuteColumns(Z, indices);
@@ -141,7 +150,64 @@ namespace ENM {
 
 
 
-  void VSA::solve() {
+  // With a sparse hessian, the environment hessian is never inverted.
+  // Instead, Hee X = Hes is solved iteratively and the (dense, but
+  // subsystem-sized) effective matrices are built from X.
+  void VSA::sparseEffectiveMatrices() {
+
+    if (verbosity_ > 1)
+      std::cerr << "Building sparse hessian...\n";
+    buildSparseHessian();
+
+    uint nodes = blocker_->size();
+    uint l = subset_size_ * 3;
+
+    DoubleMatrix Hss = sparse_hessian_.submatrix(Math::Range(0, subset_size_), Math::Range(0, subset_size_)).dense();
+    DoubleMatrix Hes = sparse_hessian_.submatrix(Math::Range(subset_size_, nodes), Math::Range(0, subset_size_)).dense();
+    SparseBlockMatrix Hee = sparse_hessian_.submatrix(Math::Range(subset_size_, nodes), Math::Range(subset_size_, nodes));
+
+    if (debugging_) {
+      writeAsciiMatrix(prefix_ + "_H.asc", sparse_hessian_.dense(), meta_, false);
+      writeAsciiMatrix(prefix_ + "_Hss.asc", Hss, meta_, false);
+      writeAsciiMatrix(prefix_ + "_Hee.asc", Hee.dense(), meta_, false);
+      writeAsciiMatrix(prefix_ + "_Hse.asc", Math::transpose(Hes), meta_, false);
+    }
+
+    if (verbosity_ > 1)
+      std::cerr << "Solving for environment response...\n";
+    DoubleMatrix X = conjugateGradient(Hee, Hes, 1e-10, 10000, verbosity_);
+
+    if (verbosity_ > 1)
+      std::cerr << "Computing effective hessian...\n";
+    Hssp_ = Hss - Math::MMMultiply(Hes, X, true, false);
+
+    if (debugging_)
+      writeAsciiMatrix(prefix_ + "_Hssp.asc", Hssp_, meta_, false);
+
+    if (masses_.rows() == 0)
+      return;
+
+    if (verbosity_ > 1)
+      std::cerr << "Computing effective mass matrix...\n";
+
+    // Only the diagonal of the mass matrix is used...
+    DoubleMatrix MX(X.rows(), X.cols());
+    for (uint j=0; j<X.cols(); ++j)
+      for (uint i=0; i<X.rows(); ++i)
+        MX(i, j) = masses_(l + i, l + i) * X(i, j);
+
+    DoubleMatrix Ms = submatrix(masses_, Math::Range(0, l), Math::Range(0, l));
+    Msp_ = Ms + Math::MMMultiply(X, MX, true, false);
+
+    if (debugging_) {
+      writeAsciiMatrix(prefix_ + "_Ms.asc", Ms, meta_, false);
+      writeAsciiMatrix(prefix_ + "_Msp.asc", Msp_, meta_, false);
+    }
+  }
+
+
+
+  void VSA::effectiveMatrices() {
 
     if (verbosity_ > 1)
       std::cerr << "Building hessian...\n";
@@ -175,6 +241,33 @@ namespace ENM {
     if (debugging_)
       writeAsciiMatrix(prefix_ + "_Hssp.asc", Hssp_, meta_, false);
 
+    if (masses_.rows() == 0)
+      return;
+
+    // Build the effective mass matrix
+    DoubleMatrix Ms = submatrix(masses_, Math::Range(0, l), Math::Range(0, l));
+    DoubleMatrix Me = submatrix(masses_, Math::Range(l, n), Math::Range(l, n));
+
+    if (verbosity_ > 1)
+      std::cerr << "Computing effective mass matrix...\n";
+    Msp_ = Ms + Hse * Heei * Me * Heei * Hes;
+
+    if (debugging_) {
+      writeAsciiMatrix(prefix_ + "_Ms.asc", Ms, meta_, false);
+      writeAsciiMatrix(prefix_ + "_Me.asc", Me, meta_, false);
+      writeAsciiMatrix(prefix_ + "_Msp.asc", Msp_, meta_, false);
+    }
+  }
+
+
+
+  void VSA::solve() {
+
+    if (sparse_modes_ != 0)
+      sparseEffectiveMatrices();
+    else
+      effectiveMatrices();
+
     // Shunt in the event of using unit masses...  We can use the SVD to
     // to get the eigenpairs from Hssp
     if (masses_.rows() == 0) {
@@ -195,25 +288,18 @@ namespace ENM {
 
       reverseColumns(eigenvecs_);
       reverseRows(eigenvals_);
+
+      // Only keep the rigid-body modes plus the requested modes
+      uint m = sparse_modes_ + 6;
+      if (sparse_modes_ != 0 && m < eigenvals_.rows()) {
+        eigenvals_ = submatrix(eigenvals_, Math::Range(0, m), Math::Range(0, 1));
+        eigenvecs_ = submatrix(eigenvecs_, Math::Range(0, eigenvecs_.rows()), Math::Range(0, m));
+      }
       return;
 
     }
 
 
-    // Build the effective mass matrix
-    DoubleMatrix Ms = submatrix(masses_, Math::Range(0, l), Math::Range(0, l));
-    DoubleMatrix Me = submatrix(masses_, Math::Range(l, n), Math::Range(l, n));
-
-    if (verbosity_ > 1)
-      std::cerr << "Computing effective mass matrix...\n";
-    Msp_ = Ms + Hse * Heei * Me * Heei * Hes;
-
-    if (debugging_) {
-      writeAsciiMatrix(prefix_ + "_Ms.asc", Ms, meta_, false);
-      writeAsciiMatrix(prefix_ + "_Me.asc", Me, meta_, false);
-      writeAsciiMatrix(prefix_ + "_Msp.asc", Msp_, meta_, false);
-    }
-
     // Run the eigen-decomposition...
     boost::tuple<DoubleMatrix, DoubleMatrix> eigenpairs;
     Timer<> t;
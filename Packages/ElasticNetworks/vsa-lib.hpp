@@ -111,6 +111,8 @@ namespace ENM {
 
 
   private:
+    void effectiveMatrices();
+    void sparseEffectiveMatrices();
     boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> eigenDecomp(loos::DoubleMatrix& A, loos::DoubleMatrix& B);
     loos::DoubleMatrix massWeight(loos::DoubleMatrix& U, loos::DoubleMatrix& M);
 
@@ -38,6 +38,7 @@
 #include <loos.hpp>
 
 #include <limits>
+#include <boost/thread/thread.hpp>
 
 #include "hessian.hpp"
 #include "enm-lib.hpp"
@@ -67,6 +68,10 @@ string psf_file;
 string spring_desc;
 bool nomass;
 
+uint nmodes;
+double cutoff;
+uint nthreads;
+
 
 string fullHelpMessage() {
 
@@ -135,6 +140,17 @@ string fullHelpMessage() {
     "To disable masses (i.e. use unit masses for the subsystem and\n"
     "zero masses for the environment), use the \"--nomass 1\" option.\n"
     "\n\n"
+    "* Large Environments *\n\n"
+    "Inverting the environment hessian dominates the cost when the\n"
+    "environment is large.  With --modes=k, only nodes within the cutoff\n"
+    "are connected, the hessian is stored sparsely, and the environment\n"
+    "hessian is never inverted.  Instead, its response to the subsystem is\n"
+    "solved for iteratively (conjugate gradients).  Only the first 6\n"
+    "(rigid-body) modes and the k lowest non-zero subsystem modes are\n"
+    "written.  The cutoff is taken from the spring\n"
+    "function unless --cutoff is given, and must be given for spring\n"
+    "functions that connect all nodes.\n"
+    "\n\n"
     "EXAMPLES \n\n"
     "\n"
     "vsa --occupancies 1 foo.pdb 'segid == \"TRAN\" && name == \"CA\"'\\\n"
@@ -172,17 +188,23 @@ public:
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("occupancies", po::value<bool>(&occupancies_are_masses)->default_value(false), "Atom masses are stored in the PDB occupancy field")
       ("nomass", po::value<bool>(&nomass)->default_value(false), "Disable mass as part of the VSA solution")
-      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments");
+      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments")
+      ("modes", po::value<uint>(&nmodes)->default_value(0), "Use a sparse hessian and only compute this many modes (0 = all)")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Contact cutoff for the sparse hessian (0 = use spring function's range)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use when building the hessian (0=all available)");
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s'")
+    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s', modes=%d, cutoff=%f, threads=%d")
       % psf_file
       % debug
       % occupancies_are_masses
       % nomass
-      % spring_desc;
+      % spring_desc
+      % nmodes
+      % cutoff
+      % nthreads;
     return(oss.str());
   }
 
@@ -247,11 +269,18 @@ int main(int argc, char *argv[]) {
 
   SuperBlock* blocker = new SuperBlock(spring, composite);
 
+  if (nmodes != 0 && cutoff == 0.0 && blocker->range() == numeric_limits<double>::infinity()) {
+    cerr << "Error- the spring function connects all nodes, so a --cutoff is required with --modes\n";
+    exit(-1);
+  }
+
   VSA vsa(blocker, subsystem.size());
   vsa.prefix(prefix);
   vsa.meta(hdr);
   vsa.debugging(debug);
   vsa.verbosity(verbosity);
+  vsa.sparse(nmodes, cutoff);
+  vsa.threads(nthreads ? nthreads : boost::thread::hardware_concurrency());
 
   if (!nomass) {
     DoubleMatrix M = getMasses(composite);
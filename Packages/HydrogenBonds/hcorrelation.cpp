@@ -59,6 +59,7 @@ string model_name;
 vString traj_names;
 uint maxtime;
 uint skip;
+uint nthreads;
 bool any_hydrogen;
 
 // ---------------
@@ -93,7 +94,8 @@ string fullHelpMessage(void) {
     "correlation time-series is then averaged together, so what is written out is the average\n"
     "correlation at a given time, over all donors and all trajectories.  The maximum correlation\n"
     "time is set automatically based on the shortest trajectory.  However, it may be explicitly\n"
-    "set with the --maxtime T option.\n"
+    "set with the --maxtime T option.  The correlations are computed with FFTs, and the\n"
+    "--threads option sets how many threads are used for this (0 means all available).\n"
     "\n"
     "EXAMPLES\n"
     "\n"
@@ -131,7 +133,8 @@ public:
       ("periodic", po::value<bool>(&use_periodicity)->default_value(false), "Use periodic boundary")
       ("maxtime", po::value<uint>(&maxtime)->default_value(0), "Max time for correlation (0 = auto-size)")
       ("any", po::value<bool>(&any_hydrogen)->default_value(false), "Correlation for ANY hydrogen bound")
-      ("stderr", po::value<bool>(&use_stderr)->default_value(0), "Report standard error rather than standard deviation");
+      ("stderr", po::value<bool>(&use_stderr)->default_value(0), "Report standard error rather than standard deviation")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
 
   }
 
@@ -167,8 +170,9 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("skip=%d,stderr=%d,blow=%f,bhi=%f,angle=%f,periodic=%d,maxtime=%d,any=%d,acceptor=\"%s\",donor=\"%s\",model=\"%s\",trajs=\"%s\"")
+    oss << boost::format("skip=%d,threads=%d,stderr=%d,blow=%f,bhi=%f,angle=%f,periodic=%d,maxtime=%d,any=%d,acceptor=\"%s\",donor=\"%s\",model=\"%s\",trajs=\"%s\"")
       % skip
+      % nthreads
       % use_stderr
       % length_low
       % length_high
@@ -290,8 +294,9 @@ int main(int argc, char *argv[]) {
         traj->readFrame(skip-1);
 
       BondMatrix bonds = j->findHydrogenBondsMatrix(acceptors, traj, model);
+      vecvecDouble series;
       if (any_hydrogen) {
-        TimeSeries<double> ts;
+        vecDouble ts;
         for (uint j=0; j<bonds.rows(); ++j) {
           double val = 0.0;
           for (uint i=0; i<bonds.cols(); ++i)
@@ -301,10 +306,7 @@ int main(int argc, char *argv[]) {
             }
           ts.push_back(val);
         }
-        TimeSeries<double> tcorr = ts.correl(maxtime);
-        vecDouble vtmp;
-        copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-        correlations.push_back(vtmp);
+        series.push_back(ts);
             
       } else {
         for (uint i=0; i<bonds.cols(); ++i) {
@@ -316,19 +318,18 @@ int main(int argc, char *argv[]) {
             }
           
           if (found) {
-            TimeSeries<double> ts;
+            vecDouble ts;
             for (uint j=0; j<bonds.rows(); ++j)
               ts.push_back(bonds(j, i));
-            TimeSeries<double> tcorr = ts.correl(maxtime);
-            vecDouble vtmp;
-            copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-            correlations.push_back(vtmp);
+            series.push_back(ts);
           }
           
         }
         
       }
 
+      vecvecDouble tcorr = autocorrelations(series, maxtime, true, nthreads);
+      copy(tcorr.begin(), tcorr.end(), corr_appender);
     }
 
   }
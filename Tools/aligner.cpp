@@ -45,7 +45,8 @@ const uint min_align_selection_warning = 7;   // Warn user when selecting fewer
 
 
 const long memory_threshold = 75;             // Using more than this percentage of main memory to store
-                                              // the coordinates for aligning generates a warning
+                                              // the coordinates for aligning switches to aligning
+                                              // out-of-core
 
 typedef loos::alignment::vecMatrix   vMatrix;
 
@@ -88,6 +89,10 @@ string fullHelpMessage(void) {
     "is preserved.  However, the centroid of the selection will always be centered.  If the --noztrans\n"
     "option is turned on, then the selection will be centered in x and y, but the z-coordinates\n"
     "will be preserved.\n"
+    "\tFor the optimal alignment, the --align subset of every frame is normally cached in memory.\n"
+    "If this would use too much memory (or with --stream), the trajectory is instead read once\n"
+    "for each iteration, a block of frames at a time, and the frames are aligned in parallel using\n"
+    "--threads threads.  Note that --xyonly requires the coordinates to be cached.\n"
     "\n"
     "\n"
     "EXAMPLES\n"
@@ -134,7 +139,9 @@ public:
                   alignment_tol(1e-6),
                   maxiter(5000),
                   xy_only(false),
-                  no_ztrans(false)
+                  no_ztrans(false),
+                  stream(false),
+                  nthreads(1)
                   { }
 
     void addGeneric(po::options_description& o) {
@@ -146,15 +153,18 @@ public:
             ("reference", po::value<string>(&reference_name), "Align to a reference structure (non-iterative")
             ("refsel", po::value<string>(&reference_sel), "Selection to align against in reference (default is same as --align)")
             ("xyonly", po::value<bool>(&xy_only)->default_value(xy_only), "Only align in x and y (i.e. rotations about Z, but translated in x,y,z)")
-            ("noztrans", po::value<bool>(&no_ztrans)->default_value(no_ztrans), "Do not translate selection in Z");
+            ("noztrans", po::value<bool>(&no_ztrans)->default_value(no_ztrans), "Do not translate selection in Z")
+            ("stream", po::value<bool>(&stream)->default_value(stream), "Always align without caching the trajectory in memory")
+            ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use when aligning without caching (0=all available)");
     }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("align='%s',transform='%s',maxiter=%d,tolerance=%f,reference='%s',refsel='%s'")
+    oss << boost::format("align='%s',transform='%s',maxiter=%d,tolerance=%f,reference='%s',refsel='%s',stream=%d,threads=%d")
       % alignment_string % transform_string
       % maxiter % alignment_tol
-      % reference_name % reference_sel;
+      % reference_name % reference_sel
+      % stream % nthreads;
     return(oss.str());
   }
 
@@ -164,6 +174,8 @@ public:
     double alignment_tol;
     uint maxiter;
     bool xy_only, no_ztrans;
+    bool stream;
+    uint nthreads;
 };
 
 
@@ -235,18 +247,36 @@ int main(int argc, char *argv[]) {
 
     // estimate memory requirements...
     long used_memory = 3 * align_sub.size() * indices.size() * sizeof(double);
-    if (used_memory * 100l / availableMemory() > memory_threshold) {
+    long total_memory = availableMemory();
+    bool stream = topts->stream;
+    if (total_memory > 0 && used_memory * 100l / total_memory > memory_threshold) {
       cerr << boost::format("Warning- estimating that memory used for aligning is greater than %d%% of system memory.\n") % memory_threshold;
-      cerr << "         Consider subsampling the trajectory or using a smaller alignment selection.\n";
+      if (topts->xy_only)
+        cerr << "         Consider subsampling the trajectory or using a smaller alignment selection.\n";
+      else {
+        cerr << "         The trajectory will be aligned without caching it in memory.\n";
+        stream = true;
+      }
+    }
+    if (stream && topts->xy_only) {
+      cerr << "Error- --xyonly cannot be used with --stream\n";
+      exit(-1);
     }
 
-    if (verbosity)
-      cerr << "Reading coordinates...\n";
-    vMatrix coords = readCoords(align_sub, traj, indices, verbosity);
-    if (topts->xy_only)
-      zapZ(coords);
-    
-    boost::tuple<vector<XForm>,greal, int> res = iterativeAlignment(coords, topts->alignment_tol, topts->maxiter);
+    boost::tuple<vector<XForm>,greal, int> res;
+    if (stream) {
+      if (verbosity)
+        cerr << "Aligning without caching coordinates...\n";
+      res = iterativeAlignment(align_sub, traj, indices, topts->alignment_tol, topts->maxiter, topts->nthreads);
+    } else {
+      if (verbosity)
+        cerr << "Reading coordinates...\n";
+      vMatrix coords = readCoords(align_sub, traj, indices, verbosity);
+      if (topts->xy_only)
+        zapZ(coords);
+
+      res = iterativeAlignment(coords, topts->alignment_tol, topts->maxiter);
+    }
     greal final_rmsd = boost::get<1>(res);
     cerr << "Final RMSD between average structures is " << final_rmsd << endl;
     cerr << "Total iters = " << boost::get<2>(res) << endl;
@@ -302,6 +332,7 @@ int main(int argc, char *argv[]) {
 
     if (topts->xy_only)
       zapZ(refsub);
+    alignment::ReferenceSuperposition ref_superposition(refsub);
     
     pTrajectoryWriter outtraj = otopts->createTrajectory(prefopts->prefix);
     outtraj->setComments(header);
@@ -318,12 +349,12 @@ int main(int argc, char *argv[]) {
       if (topts->xy_only) {
         AtomicGroup flat_align = align_sub.copy();
         zapZ(flat_align);
-        GMatrix M = flat_align.superposition(refsub);
+        GMatrix M = ref_superposition.superposition(flat_align);
         M(2,2) = 1.0;    // Fix zapped z-part (see above)
         XForm W(M);
         applyto_sub.applyTransform(W);
       } else {
-        GMatrix M = align_sub.superposition(refsub);
+        GMatrix M = ref_superposition.superposition(align_sub);
         XForm W(M);
         applyto_sub.applyTransform(W);
       }
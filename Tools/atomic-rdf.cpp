@@ -79,10 +79,123 @@ string fullHelpMessage(void)
     "As with the other rdf tools (rdf, xy_rdf), histogram-min, histogram-max,\n"
     "and histogram-bins control the range over which the rdf is computed, and\n"
     "the number of bins used, in this case from 0 to 20 Angstroms, with 0.5\n"
-    "angstrom bins.\n";
+    "angstrom bins.\n"
+    "\n"
+    "Only pairs closer than histogram-max are examined (using a cell list),\n"
+    "and frames are divided among the number of threads given by --threads.\n";
     return(s);
     }
 
+
+// @cond TOOLS_INTERNAL
+class ToolOptions : public opts::OptionsPackage
+{
+public:
+  ToolOptions() : nthreads(1) { }
+
+  void addGeneric(po::options_description& o)
+  {
+    o.add_options()
+      ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use (0=all available)");
+  }
+
+  string print() const
+  {
+    ostringstream oss;
+    oss << boost::format("threads=%d") % nthreads;
+    return(oss.str());
+  }
+
+  uint nthreads;
+};
+
+
+// Histograms the pair distances for one group-1 atom.  The cell list
+// only visits group-2 atoms in nearby cells, so the caller must still
+// check the distance.
+struct PairBinner
+    {
+    PairBinner(vector<double>& h, const int self, const double mn, const double mn2, const double mx2, const double bw)
+        : hist(h), self_index(self), hist_min(mn), min2(mn2), max2(mx2), bin_width(bw) { }
+
+    bool operator()(const uint k, const double d2)
+        {
+        // skip "self" pairs 
+        if (static_cast<int>(k) == self_index)
+            {
+            return(true);
+            }
+        if ( (d2 < max2) && (d2 > min2) )
+            {
+            double d = sqrt(d2);
+            int bin = int((d-hist_min)/bin_width);
+            hist[bin]++;
+            }
+        return(true);
+        }
+
+    vector<double>& hist;
+    int self_index;
+    double hist_min, min2, max2, bin_width;
+    };
+
+
+// Histograms the distances between the atoms in one thread's share of
+// the trajectory (see ParallelFrameDriver).  Group-2 atoms are binned
+// into a periodic cell list each frame, so only pairs closer than
+// hist_max are examined.
+class AtomicRdfWorker
+    {
+public:
+    AtomicRdfWorker(const string& s1, const string& s2, const vector<int>* self,
+                    const double mn, const double mx, const int nbins)
+        : selection1(s1), selection2(s2), self_index(self),
+          hist_min(mn), min2(mn*mn), max2(mx*mx), bin_width((mx - mn)/nbins),
+          hist(nbins, 0.0), volume(0.0), cells(mx)
+        { }
+
+    void setup(AtomicGroup& system)
+        {
+        group1 = selectAtoms(system, selection1);
+        group2 = selectAtoms(system, selection2);
+        box_source = system;
+        }
+
+    void process(const uint)
+        {
+        GCoord box = box_source.periodicBox(); 
+        volume += box.x() * box.y() * box.z();
+
+        cells.build(group2, box);
+
+        // compute the distribution of g2 around g1 
+        for (uint j = 0; j < group1.size(); j++)
+            {
+            PairBinner binner(hist, (*self_index)[j], hist_min, min2, max2, bin_width);
+            cells.visitNeighbors(group1[j]->coords(), binner);
+            }
+        }
+
+    void merge(const AtomicRdfWorker& other)
+        {
+        for (uint i=0; i<hist.size(); ++i)
+            {
+            hist[i] += other.hist[i];
+            }
+        volume += other.volume;
+        }
+
+    string selection1, selection2;
+    const vector<int>* self_index;
+    double hist_min, min2, max2, bin_width;
+    AtomicGroup group1, group2, box_source;
+    vector<double> hist;
+    double volume;
+    CellList cells;
+    };
+// @endcond
+
+
 int main (int argc, char *argv[])
 {
 
@@ -90,6 +203,7 @@ int main (int argc, char *argv[])
 opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
 opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
 opts::RequiredArguments* ropts = new opts::RequiredArguments;
+ToolOptions* topts = new ToolOptions;
 
 // These are required command-line arguments (non-optional options)
 ropts->addArgument("selection1", "selection1");
@@ -99,7 +213,7 @@ ropts->addArgument("max", "max radius");
 ropts->addArgument("num_bins", "number of bins");
 
 opts::AggregateOptions options;
-options.add(bopts).add(tropts).add(ropts);
+options.add(bopts).add(tropts).add(ropts).add(topts);
 if (!options.parse(argc, argv))
   exit(-1);
 
@@ -144,56 +258,35 @@ if (group2.empty())
     exit(-1);
     }
 
-// Create the histogram and zero it out
-vector<double> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
-
-// loop over the frames of the trajectory
-vector<uint> framelist = tropts->frameList();
-uint framecnt = framelist.size();
-double volume = 0.0;
-unsigned long unique_pairs=0;
-for (uint index = 0; index<framecnt; ++index)
+// Find which group-2 atom (if any) is each group-1 atom, so "self"
+// pairs can be skipped
+map<const Atom*, int> group2_index;
+for (uint k = 0; k < group2.size(); k++)
     {
-    traj->readFrame(framelist[index]);
-
-    // update coordinates and periodic box
-    traj->updateGroupCoords(system);
-    GCoord box = system.periodicBox(); 
-    volume += box.x() * box.y() * box.z();
+    group2_index[group2[k].get()] = k;
+    }
 
-    unique_pairs = 0;
-    // compute the distribution of g2 around g1 
-    for (uint j = 0; j < group1.size(); j++)
+vector<int> self_index(group1.size(), -1);
+unsigned long unique_pairs = static_cast<unsigned long>(group1.size()) * group2.size();
+for (uint j = 0; j < group1.size(); j++)
+    {
+    map<const Atom*, int>::const_iterator m = group2_index.find(group1[j].get());
+    if (m != group2_index.end())
         {
-        pAtom a1 = group1[j];
-        GCoord p1 = a1->coords();
-        for (uint k = 0; k < group2.size(); k++)
-            {
-            pAtom a2 = group2[k];
-            // skip "self" pairs 
-            if (a1 == a2)
-                {
-                continue;
-                }
-            unique_pairs++;
-            GCoord p2 = a2->coords();
-            // Compute the distance squared, taking periodicity into account
-            double d2 = p1.distance2(p2, box);
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist[bin]++;
-                }
-            }
+        self_index[j] = m->second;
+        unique_pairs--;
         }
     }
 
+// loop over the frames of the trajectory, dividing them among the threads
+vector<uint> framelist = tropts->frameList();
+uint framecnt = framelist.size();
+AtomicRdfWorker worker(selection1, selection2, &self_index, hist_min, hist_max, num_bins);
+ParallelFrameDriver driver(system, traj, topts->nthreads, tropts->traj_type);
+driver.run(worker, framelist);
+
+vector<double>& hist = worker.hist;
+double volume = worker.volume;
 volume /= framecnt;
 
 
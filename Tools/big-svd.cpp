@@ -33,6 +33,8 @@
 
 #include <loos.hpp>
 #include <boost/format.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
 
 using namespace std;
 using namespace loos;
@@ -44,6 +46,9 @@ const double KB = 1024.0;
 const double MB = 1024 * KB;
 const double GB = 1024 * MB;
 
+// Number of frames read into memory at a time for --modes
+const uint frames_per_block = 512;
+
 // Don't include these classes in Doxygen
 // @cond TOOLS_INTERNAL
 
@@ -76,6 +81,22 @@ string fullHelpMessage(void) {
     "is written as b2ar_A.asc"
     "\n"
     "\n"
+    "\tbig-svd --prefix b2ar --modes 20 --selection '!hydrogen' b2ar.pdb b2ar.dcd\n"
+    "Computes only the top 20 singular values and vectors with a randomized SVD.\n"
+    "\n"
+    "NOTES\n"
+    "\tBy default, the entire coordinate matrix is held in memory.  For trajectories where\n"
+    "this is not possible, the --modes option computes only the largest singular values\n"
+    "and their vectors using a randomized range-finder (see Halko, Martinsson, and Tropp,\n"
+    "SIAM Review (2011) 53:217).  The trajectory is read in blocks of frames, and only\n"
+    "a few vectors the size of the selection are kept in memory (plus the requested\n"
+    "right singular vectors).  The trajectory is read once to find the average and a random\n"
+    "sketch of the range, then --iterations more times to refine it (each pass sharpens\n"
+    "the separation between the wanted and unwanted modes), and once more for the RSVs.\n"
+    "The sketch includes --oversample extra vectors to improve accuracy.  The output files\n"
+    "are the same as above, but only contain the requested number of modes.\n"
+    "\n"
+    "\n"
     "SEE ALSO\n"
     "\tsvd, kurskew, phase-pdb\n";
 
@@ -133,17 +154,40 @@ public:
   void addGeneric(po::options_description& o) {
     o.add_options()
       ("source", po::value<bool>(&write_source_matrix)->default_value(write_source_matrix), "Write out source matrix")
-      ("rsv", po::value<uint>(&subset_rsv)->default_value(0), "Only write out n-columns or RSV (0 = all)");
+      ("rsv", po::value<uint>(&subset_rsv)->default_value(0), "Only write out n-columns or RSV (0 = all)")
+      ("modes", po::value<uint>(&modes)->default_value(0), "Only compute this many modes with a randomized SVD (0 = all)")
+      ("oversample", po::value<uint>(&oversample)->default_value(10), "Extra vectors to use in the randomized SVD")
+      ("iterations", po::value<uint>(&iterations)->default_value(2), "Number of refinement passes for the randomized SVD")
+      ("seed", po::value<uint>(&seed)->default_value(0), "Random number seed for the randomized SVD (0 = auto)");
+  }
+
+  bool postConditions(po::variables_map& map) {
+    if (modes && write_source_matrix) {
+      cerr << "Error- cannot write the source matrix when using --modes\n";
+      return(false);
+    }
+    if (modes && iterations == 0) {
+      cerr << "Error- --iterations must be at least 1\n";
+      return(false);
+    }
+    return(true);
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("source=%d") % write_source_matrix;
+    oss << boost::format("source=%d,rsv=%d,modes=%d,oversample=%d,iterations=%d,seed=%d")
+      % write_source_matrix
+      % subset_rsv
+      % modes
+      % oversample
+      % iterations
+      % seed;
     return(oss.str());
   }
 
   bool write_source_matrix;
   uint subset_rsv;
+  uint modes, oversample, iterations, seed;
   
 };
 // @endcond
@@ -220,6 +264,199 @@ void normalizeRows(RealMatrix& A) {
 }
 
 
+// Reads the selected coordinates for a block of frames into the
+// columns of A, removing the average if one is given
+
+void readBlock(pTraj& traj, AtomicGroup& grp, const vector<uint>& indices, const uint start,
+               DoubleMatrix& A, const vector<double>* avg) {
+  uint m = A.rows();
+  for (uint i=0; i<A.cols(); ++i) {
+    traj->readFrame(indices[start + i]);
+    traj->updateGroupCoords(grp);
+    for (uint j=0; j<static_cast<uint>(grp.size()); ++j) {
+      GCoord c = grp[j]->coords();
+      A(3*j, i) = c.x();
+      A(3*j+1, i) = c.y();
+      A(3*j+2, i) = c.z();
+    }
+    if (avg)
+      for (uint j=0; j<m; ++j)
+        A(j, i) -= (*avg)[j];
+  }
+}
+
+
+// Orthonormalizes the columns of Y in place (Gram-Schmidt, applied
+// twice for stability).  Columns that are (numerically) in the span
+// of the preceding ones are replaced with random vectors.
+
+void orthonormalize(DoubleMatrix& Y) {
+  uint m = Y.rows();
+  uint l = Y.cols();
+  boost::normal_distribution<> normal;
+  boost::variate_generator<base_generator_type&, boost::normal_distribution<> > rnd(rng_singleton(), normal);
+
+  for (uint i=0; i<l; ++i) {
+    double* y = Y.get() + static_cast<ulong>(i) * m;
+    double original = 0.0;
+    for (uint k=0; k<m; ++k)
+      original += y[k] * y[k];
+    original = sqrt(original);
+
+    for (uint attempt = 0; ; ++attempt) {
+      for (uint pass = 0; pass < 2; ++pass)
+        for (uint j=0; j<i; ++j) {
+          const double* q = Y.get() + static_cast<ulong>(j) * m;
+          double d = 0.0;
+          for (uint k=0; k<m; ++k)
+            d += q[k] * y[k];
+          for (uint k=0; k<m; ++k)
+            y[k] -= d * q[k];
+        }
+
+      double norm = 0.0;
+      for (uint k=0; k<m; ++k)
+        norm += y[k] * y[k];
+      norm = sqrt(norm);
+
+      if (norm > 1e-10 * original && norm > 0.0) {
+        for (uint k=0; k<m; ++k)
+          y[k] /= norm;
+        break;
+      }
+      if (attempt > 10)
+        throw(NumericalError("Unable to construct an orthonormal basis for the randomized SVD"));
+
+      for (uint k=0; k<m; ++k)
+        y[k] = rnd();
+      original = 1.0;
+    }
+  }
+}
+
+
+// Randomized SVD of the centered coordinate matrix, reading the
+// trajectory in blocks so the full matrix is never stored.  The left
+// singular vectors are found via a Rayleigh-Ritz projection of AA'
+// onto the (refined) sketch Q, which mirrors the eigendecomposition
+// of AA' used for the full SVD below.  Returns the top k LSVs in U,
+// singular values in S, and (if nrsv > 0) the first nrsv RSVs as rows of Vt.
+
+void randomizedSVD(pTraj& traj, AtomicGroup& grp, const vector<uint>& indices,
+                   const uint k, const uint oversample, const uint iterations, const uint nrsv,
+                   RealMatrix& U, RealMatrix& S, RealMatrix& Vt) {
+  uint m = grp.size() * 3;
+  uint n = indices.size();
+  uint l = min(k + oversample, min(m, n));
+  uint nmodes = min(k, l);
+
+  TrackStorage store;
+  cerr << boost::format("Coordinate matrix is %d x %d, using a %d-vector sketch\n") % m % n % l;
+  cerr << boost::format("Working storage is %s\n") % store.memory(sizeof(double) * (3ul * m * l + static_cast<ulong>(m) * frames_per_block));
+
+  boost::normal_distribution<> normal;
+  boost::variate_generator<base_generator_type&, boost::normal_distribution<> > rnd(rng_singleton(), normal);
+
+  // Pass 1: Y = (X - avg 1') Omega = X Omega - avg (1' Omega)
+  DoubleMatrix Y(m, l);
+  vector<double> avg(m, 0.0);
+  vector<double> omega_sum(l, 0.0);
+
+  cerr << "Sketching...\n";
+  for (uint start = 0; start < n; start += frames_per_block) {
+    uint b = min(frames_per_block, n - start);
+    DoubleMatrix A(m, b);
+    readBlock(traj, grp, indices, start, A, 0);
+
+    DoubleMatrix Omega(b, l);
+    for (uint j=0; j<l; ++j)
+      for (uint i=0; i<b; ++i) {
+        Omega(i, j) = rnd();
+        omega_sum[j] += Omega(i, j);
+      }
+
+    DoubleMatrix P = MMMultiply(A, Omega);
+    for (ulong i=0; i<P.size(); ++i)
+      Y[i] += P[i];
+
+    for (uint i=0; i<b; ++i)
+      for (uint j=0; j<m; ++j)
+        avg[j] += A(j, i);
+  }
+
+  for (uint j=0; j<m; ++j)
+    avg[j] /= n;
+  for (uint i=0; i<l; ++i)
+    for (uint j=0; j<m; ++j)
+      Y(j, i) -= avg[j] * omega_sum[i];
+
+
+  // Refinement: Y = A A' Q.  The last pass gives the projection of AA' onto Q.
+  DoubleMatrix Q;
+  for (uint iter = 0; iter < iterations; ++iter) {
+    orthonormalize(Y);
+    Q = Y;
+    Y = DoubleMatrix(m, l);
+
+    cerr << boost::format("Pass %d of %d...\n") % (iter + 1) % iterations;
+    for (uint start = 0; start < n; start += frames_per_block) {
+      uint b = min(frames_per_block, n - start);
+      DoubleMatrix A(m, b);
+      readBlock(traj, grp, indices, start, A, &avg);
+
+      DoubleMatrix Z = MMMultiply(A, Q, true, false);
+      DoubleMatrix P = MMMultiply(A, Z);
+      for (ulong i=0; i<P.size(); ++i)
+        Y[i] += P[i];
+    }
+  }
+
+  DoubleMatrix G = MMMultiply(Q, Y, true, false);
+  for (uint j=0; j<l; ++j)
+    for (uint i=0; i<j; ++i)
+      G(i, j) = G(j, i) = (G(i, j) + G(j, i)) / 2.0;
+
+  DoubleMatrix W = eigenDecomp(G);
+  reverseColumns(G);
+  reverseRows(W);
+  DoubleMatrix UU = MMMultiply(Q, G);
+
+  U = RealMatrix(m, nmodes);
+  S = RealMatrix(nmodes, 1);
+  for (uint i=0; i<nmodes; ++i) {
+    S[i] = W[i] < 0.0 ? 0.0 : sqrt(W[i]);
+    for (uint j=0; j<m; ++j)
+      U(j, i) = UU(j, i);
+  }
+
+  // RSVs: V' = S^-1 U' A
+  uint nv = min(nrsv, nmodes);
+  if (nv == 0)
+    return;
+
+  DoubleMatrix Ui(m, nv);
+  for (uint i=0; i<nv; ++i) {
+    double konst = (S[i] > 0.0) ? (1.0/S[i]) : 0.0;
+    for (uint j=0; j<m; ++j)
+      Ui(j, i) = UU(j, i) * konst;
+  }
+
+  cerr << "Computing RSVs...\n";
+  Vt = RealMatrix(nv, n);
+  for (uint start = 0; start < n; start += frames_per_block) {
+    uint b = min(frames_per_block, n - start);
+    DoubleMatrix A(m, b);
+    readBlock(traj, grp, indices, start, A, &avg);
+
+    DoubleMatrix V = MMMultiply(Ui, A, true, false);
+    for (uint i=0; i<b; ++i)
+      for (uint j=0; j<nv; ++j)
+        Vt(j, start + i) = V(j, i);
+  }
+}
+
+
+
 int main(int argc, char *argv[]) {
 
   string hdr = invocationHeader(argc, argv);
@@ -246,6 +483,24 @@ int main(int argc, char *argv[]) {
 
   writeMap(prefix + ".map", subset);
 
+  if (topts->modes) {
+    if (topts->seed)
+      rng_singleton().seed(static_cast<uint>(topts->seed));
+    else
+      randomSeedRNG();
+
+    RealMatrix U, S, Vt;
+    uint nrsv = topts->subset_rsv ? topts->subset_rsv : topts->modes;
+    randomizedSVD(traj, subset, indices, topts->modes, topts->oversample, topts->iterations, nrsv, U, S, Vt);
+
+    cerr << "Writing results...";
+    writeAsciiMatrix(prefix + "_U.asc", U, hdr);
+    writeAsciiMatrix(prefix + "_s.asc", S, hdr);
+    writeAsciiMatrix(prefix + "_V.asc", Vt, hdr, true);
+    cerr << "done.\n";
+    exit(0);
+  }
+
   // Build AA'
 
   RealMatrix A = extractCoordinates(traj, subset, indices);
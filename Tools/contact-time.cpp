@@ -222,6 +222,17 @@ uint contacts(const AtomicGroup& target, const AtomicGroup& probe, const double
 }
 
 
+// Same as contacts(), but with the probe atoms already binned into a CellList
+uint contacts(const AtomicGroup& target, const CellList& probe, const double inner_radius, const double outer_radius) {
+  uint contact = 0;
+
+  for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i)
+    contact += probe.countWithin((*i)->coords(), inner_radius, outer_radius);
+
+  return(contact);
+}
+
+
 AtomicGroup pickNearbyAtoms(const AtomicGroup& target, const AtomicGroup& probe, const double radius, const bool symmetry) {
 
   GCoord c = probe.centroid();
@@ -376,6 +387,8 @@ int main(int argc, char *argv[]) {
   if (bopts->verbosity)
     slayer.start();
 
+  CellList probe_cells(topts->outer_cutoff);
+
   for (vector<uint>::iterator frame = indices.begin(); frame != indices.end(); ++frame) {
     traj->readFrame(*frame);
     traj->updateGroupCoords(model);
@@ -385,13 +398,20 @@ int main(int argc, char *argv[]) {
       exit(-1);
     }
 
+    if (!topts->fast_filter) {
+      if (topts->symmetry)
+        probe_cells.build(probe, model.periodicBox());
+      else
+        probe_cells.build(probe);
+    }
+
     M(t, 0) = t;
     for (uint i=0; i<targets.size(); ++i) {
       double d;
       if (topts->fast_filter)
         d = fastContacts(targets[i], myselves, topts->inner_cutoff, topts->outer_cutoff, topts->fast_pad, topts->symmetry);
       else
-        d = contacts(targets[i], probe, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
+        d = contacts(targets[i], probe_cells, topts->inner_cutoff, topts->outer_cutoff);
 
       M(t, i+1) = d;
     }
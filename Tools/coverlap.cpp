@@ -255,17 +255,17 @@ int main(int argc, char *argv[]) {
 
   cerr << "Reading left side matrices...\n";
   DoubleMatrix lS;
-  readAsciiMatrix(lefts_name, lS);
+  readMatrix(lefts_name, lS);
   DoubleMatrix lU;
-  readAsciiMatrix(leftU_name, lU);
+  readMatrix(leftU_name, lU);
   cerr << boost::format("Read in %d x %d eigenvectors...\n") % lU.rows() % lU.cols();
   cerr << boost::format("Read in %d eigenvalues...\n") % lS.rows();
 
   cerr << "Reading in right side matrices...\n";
   DoubleMatrix rS;
-  readAsciiMatrix(rights_name, rS);
+  readMatrix(rights_name, rS);
   DoubleMatrix rU;
-  readAsciiMatrix(rightU_name, rU);
+  readMatrix(rightU_name, rU);
   cerr << boost::format("Read in %d x %d eigenvectors...\n") % rU.rows() % rU.cols();
   cerr << boost::format("Read in %d eigenvalues...\n") % rS.rows();
 
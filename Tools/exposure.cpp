@@ -141,7 +141,8 @@ public:
 
 
 
-double density(const AtomicGroup& target, const AtomicGroup& probe, const double inner_radius, const double outer_radius) {
+// The probe atoms are binned into a CellList (built once per frame)
+double density(const AtomicGroup& target, const CellList& probe, const double inner_radius, const double outer_radius) {
   
   double or2 = outer_radius * outer_radius;
   double ir2 = inner_radius * inner_radius;
@@ -150,22 +151,10 @@ double density(const AtomicGroup& target, const AtomicGroup& probe, const double
   double vol_inn = 4.0/3.0 * M_PI * ir2 * inner_radius;
   double vol = vol_out - vol_inn;
 
-  GCoord box = target.periodicBox();
   ulong contacts = 0;
 
-  for (AtomicGroup::const_iterator j = target.begin(); j != target.end(); ++j) {
-    GCoord v = (*j)->coords();
-    ulong probed = 0;
-    
-    for (AtomicGroup::const_iterator i = probe.begin(); i != probe.end(); ++i) {
-      GCoord u = (*i)->coords();
-      double d = symmetry ? v.distance2(u, box) : v.distance2(u);
-      if (d >= ir2 && d <= or2) {
-        ++probed;
-      }
-    }
-    contacts += probed;
-  }
+  for (AtomicGroup::const_iterator j = target.begin(); j != target.end(); ++j)
+    contacts += probe.countWithin((*j)->coords(), inner_radius, outer_radius);
 
   double dens = static_cast<double>(contacts);
   if (average)
@@ -213,6 +202,7 @@ int main(int argc, char *argv[]) {
   cout << endl;
 
   ulong t = 0;
+  CellList probe_cells(outer_cutoff);
 
   PercentProgressWithTime watcher;
   ProgressCounter<PercentTrigger, EstimatingCounter> slayer(PercentTrigger(0.1), EstimatingCounter(indices.size()));
@@ -231,9 +221,14 @@ int main(int argc, char *argv[]) {
 
     cout << boost::format("%8d") % t;
 
+    if (symmetry)
+      probe_cells.build(probe, model.periodicBox());
+    else
+      probe_cells.build(probe);
+
     for (vGroup::const_iterator i = targets.begin(); i != targets.end(); ++i) {
       double d;
-      d = density(*i, probe, inner_cutoff, outer_cutoff);
+      d = density(*i, probe_cells, inner_cutoff, outer_cutoff);
       cout << boost::format("  %8.6f") % d;
     }
     cout << endl;
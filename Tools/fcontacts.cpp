@@ -172,13 +172,15 @@ public:
 
 
 
-// Check for atom equality only through atomid...
+// Check for atom equality by identity.  All groups are selected from
+// the same model, so they share atoms, and atom ids need not be unique
+// (e.g. in merged systems)...
 
-struct IdEquals : public binary_function<pAtom, pAtom, bool> 
+struct SameAtom : public binary_function<pAtom, pAtom, bool> 
 {
     bool operator()(const pAtom& a, const pAtom& b) const 
         {
-            return(a->id() == b->id());
+            return(a == b);
         }
 };
 
@@ -190,65 +192,40 @@ typedef vector< vector<double> >      FContactsList;
 
 
 
-// Return a list of target atoms that are in contact with probe
-AtomicGroup contacts(const AtomicGroup& probe, const AtomicGroup& target, const double inner_radius, const double outer_radius, const bool symmetry) {
+// Return a list of system atoms that are in contact with probe.  The
+// cell list holds the system coordinates, and excluded is a sorted
+// list of indices into the system for atoms that should be skipped.
+AtomicGroup contacts(const AtomicGroup& probe, const AtomicGroup& system, const CellList& cells, const vector<uint>& excluded, const double inner_radius, const double outer_radius) {
   
-    double or2 = outer_radius * outer_radius;
-    double ir2 = inner_radius * inner_radius;
-
-    GCoord box = target.periodicBox();
     AtomicGroup contacting_atoms;
     
-
     for (AtomicGroup::const_iterator j = probe.begin(); j != probe.end(); ++j) {
-        GCoord v = (*j)->coords();
-    
-        for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-            GCoord u = (*i)->coords();
-            double d = symmetry ? v.distance2(u, box) : v.distance2(u);
-            if (d >= ir2 && d <= or2)
-                contacting_atoms.append(*i);
-        }
-    }
-
-    return(contacting_atoms);
-}
-
+        vector<uint> nearby = cells.within((*j)->coords(), inner_radius, outer_radius);
 
-AtomicGroup pickNearbyAtoms(const AtomicGroup& probe, const AtomicGroup& target, const double radius, const bool symmetry) {
-
-    GCoord c = probe.centroid();
-    GCoord box = probe.periodicBox();
-    double maxrad = probe.radius() + radius;
-    maxrad *= maxrad;
-
-  
-    AtomicGroup nearby;
-    nearby.periodicBox(probe.periodicBox());
-    for (AtomicGroup::const_iterator i = target.begin(); i != target.end(); ++i) {
-        double d = symmetry ? c.distance2((*i)->coords(), box) : c.distance2((*i)->coords());
-        if (d <= maxrad)
-            nearby.append(*i);
+        for (vector<uint>::const_iterator i = nearby.begin(); i != nearby.end(); ++i)
+            if (!binary_search(excluded.begin(), excluded.end(), *i))
+                contacting_atoms.append(system[*i]);
     }
 
-    return(nearby);
+    return(contacting_atoms);
 }
 
 
 vector<double> fractionContactsToProbe(const AtomicGroup& probe,
-                                       const AtomicGroup& nearby,
+                                       const AtomicGroup& system,
+                                       const CellList& cells,
+                                       const vector<uint>& excluded,
                                        const vGroup& targets,
                                        const double inner_radius,
-                                       const double outer_radius,
-                                       const bool symmetry)
+                                       const double outer_radius)
 {
 
     // First, find which nearby atoms are actually in contact...
-    AtomicGroup nearby_contacts = contacts(probe, nearby, inner_radius, outer_radius, symmetry);
+    AtomicGroup nearby_contacts = contacts(probe, system, cells, excluded, inner_radius, outer_radius);
 
     vector<double> fracts(targets.size(), 0.0);
     for (uint i=0; i<targets.size(); ++i) {
-        AtomicGroup target_nearby = nearby_contacts.intersect(targets[i], IdEquals());
+        AtomicGroup target_nearby = nearby_contacts.intersect(targets[i], SameAtom());
         if (nearby_contacts.empty())
             fracts[i] = 0.0;
         else 
@@ -259,8 +236,9 @@ vector<double> fractionContactsToProbe(const AtomicGroup& probe,
 
         
 FContactsList fractionContacts(const AtomicGroup& system,
+                               CellList& cells,
                                const vGroup& probes,
-                               const vGroup& excludeds,
+                               const vector< vector<uint> >& excludeds,
                                const vGroup& targets,
                                const double inner_radius,
                                const double outer_radius,
@@ -268,11 +246,15 @@ FContactsList fractionContacts(const AtomicGroup& system,
 {
 
     FContactsList fclist;
+
+    if (symmetry)
+        cells.build(system, system.periodicBox());
+    else
+        cells.build(system);
     
     for (uint j=0; j<probes.size(); ++j) {
-        AtomicGroup nearby = pickNearbyAtoms(probes[j], excludeds[j], outer_radius, symmetry);
-        vector<double> v = fractionContactsToProbe(probes[j], nearby, targets,
-                                                   inner_radius, outer_radius, symmetry);
+        vector<double> v = fractionContactsToProbe(probes[j], system, cells, excludeds[j], targets,
+                                                   inner_radius, outer_radius);
         fclist.push_back(v);
     }
 
@@ -362,20 +344,32 @@ int main(int argc, char *argv[]) {
         for (vGroup::iterator i = myselves.begin(); i != myselves.end(); ++i) {
             AtomicGroup exclusive;
             for (vGroup::iterator j = molecules.begin(); j != molecules.end(); ++j)
-                if (i->containsAny(*j, IdEquals()))
+                if (i->containsAny(*j, SameAtom()))
                     exclusive.append(*j);
             excludes.push_back(exclusive);
         }
     } else
         excludes = myselves;
 
-    // This is system excluding requested probe atoms...
-    vGroup excludeds;
+    // For each probe, the indices of system atoms to ignore (looked up
+    // by the atom itself, as with SameAtom)...
+    map<const Atom*, uint> system_index;
+    for (uint i=0; i<system.size(); ++i)
+        system_index[system[i].get()] = i;
+
+    vector< vector<uint> > excludeds;
     for (vGroup::iterator i = excludes.begin(); i != excludes.end(); ++i) {
-        AtomicGroup pruned = system;
-        pruned.remove(*i);
-        excludeds.push_back(pruned);
+        vector<uint> excluded;
+        for (AtomicGroup::iterator j = i->begin(); j != i->end(); ++j) {
+            map<const Atom*, uint>::const_iterator k = system_index.find(j->get());
+            if (k != system_index.end())
+                excluded.push_back(k->second);
+        }
+        sort(excluded.begin(), excluded.end());
+        excludeds.push_back(excluded);
     }
+
+    CellList cells(topts->outer_cutoff);
     
     
     // Size of the output matrix
@@ -408,7 +402,7 @@ int main(int argc, char *argv[]) {
 
         M(t, 0) = *frame;
 
-        FContactsList fcl = fractionContacts(system, myselves, excludeds, targets, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
+        FContactsList fcl = fractionContacts(system, cells, myselves, excludeds, targets, topts->inner_cutoff, topts->outer_cutoff, topts->symmetry);
         vector<double> avg = average(fcl);
         if (topts->report_stddev) {
             vector<double> stds = stddevs(fcl, avg);
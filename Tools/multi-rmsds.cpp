@@ -84,6 +84,18 @@ string fullHelpMessage(void) {
     "down.  The tool will try to warn you if this is a possibility.  To use less memory, subsample\n"
     "the trajectory by using --skip or --stride, or use subsetter to pre-process the trajectory.\n"
     "\n"
+    "\tFor very large sets of trajectories, use the --blocksize option.  The selected coordinates are\n"
+    "then centered and written once to a scratch file (see --scratch), which is removed automatically,\n"
+    "and the matrix is computed a strip of --blocksize columns at a time and written directly to the\n"
+    "--binary file.  The full matrix is never held in memory, but one strip can be as large as\n"
+    "--blocksize times the number of frames.  Only the upper triangle is stored (as a triangular\n"
+    "binary matrix, which is read back as a full matrix).  The trajectory table is included in the\n"
+    "binary matrix metadata.\n"
+    "\n"
+    "\tBy default, the optimal superposition of each pair of frames is found with a singular value\n"
+    "decomposition.  The --qcp option uses Theobald's quaternion characteristic polynomial method\n"
+    "instead, which gives the same RMSDs (to within ~1e-10) and is considerably faster.\n"
+    "\n"
     "\tThis tool can be run in parallel with multiple threads for performance.  The --threads option\n"
     "controls how many threads are used.  The default is 1 (non-parallel).  Setting it to 0 will use\n"
     "as many threads as possible.  Note that if LOOS was built using a multi-threaded math library,\n"
@@ -99,6 +111,9 @@ string fullHelpMessage(void) {
     "This example uses all alpha-carbons and every frame in the trajectories, run\n"
     "in parallel with 8 threads of execution.\n"
     "\n"
+    "\tmulti-rmsds --blocksize=2000 --threads=0 --binary=rmsd.bin model.pdb sim1.dcd sim2.dcd sim3.dcd\n"
+    "As above, but for trajectories that are too long to cache in memory.\n"
+    "\n"
     "\tmulti-rmsds --selection backbone --skip=50 --stride=10 model.pdb sim1.dcd sim2.dcd sim3.dcd >rmsds.asc\n"
     "This example uses the backbone atoms, and skips the first 50 frames from each trajectory,\n"
     "and only takes every 10th subsequent frame from each trajectory.\n"
@@ -120,16 +135,32 @@ public:
     o.add_options()
       ("noout,N", po::value<bool>(&noop)->default_value(false), "Do not output the matrix (i.e. only calc pair-wise RMSD stats)")
       ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
-      ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix");
+      ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix")
+      ("qcp", po::value<bool>(&qcp)->default_value(false), "Use the QCP method for superposition instead of SVD (faster)")
+      ("binary", po::value<string>(&binary_name), "Write the matrix in binary format to this file rather than to stdout")
+      ("blocksize", po::value<uint>(&blocksize)->default_value(0), "Compute the matrix out-of-core in strips of this many frames (requires --binary or --noout)")
+      ("scratch", po::value<string>(&scratch), "Prefix for the scratch file used with --blocksize (default is based on --binary)");
+  }
+
+  bool postConditions(po::variables_map& m) {
+    if (blocksize && binary_name.empty() && !noop) {
+      cerr << "Error- --blocksize requires either --binary or --noout\n";
+      return(false);
+    }
+    return(true);
   }
 
 
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("stats=%d,noout=%d,nthreads=%d")
+    oss << boost::format("stats=%d,qcp=%d,noout=%d,binary='%s',blocksize=%d,scratch='%s',nthreads=%d")
       % stats
+      % qcp
       % noop
+      % binary_name
+      % blocksize
+      % scratch
       % nthreads;
 
     return(oss.str());
@@ -137,8 +168,11 @@ public:
 
 
   bool stats;
+  bool qcp;
   bool noop;
   uint nthreads;
+  uint blocksize;
+  string binary_name, scratch;
 };
 
 typedef vector<double>    vecDouble;
@@ -354,7 +388,7 @@ void checkMemoryUsage(long mem) {
       % (used_memory >> 20)
       % (mem >> 30);
     
-    cerr << "If your machine starts swapping, try subsampling the trajectories\n";
+    cerr << "If your machine starts swapping, try subsampling the trajectories or using --blocksize\n";
   }
 }
 
@@ -376,10 +410,29 @@ int main(int argc, char *argv[]) {
 
   verbosity = bopts->verbosity;
   report_stats = (verbosity || topts->noop);
+  if (topts->qcp)
+    alignment::superpositionMethod(alignment::QCP);
   AtomicGroup model = mtopts->model;
   pTraj traj = mtopts->trajectory;
   AtomicGroup subset = selectAtoms(model, sopts->selection);
   vector<uint> indices = mtopts->frameList();
+  string meta = header + "\n" + mtopts->trajectoryTable();
+
+  if (topts->blocksize) {
+    string prefix = topts->scratch;
+    if (prefix.empty())
+      prefix = topts->noop ? string("multi-rmsds") : topts->binary_name;
+    prefix += (boost::format(".%d.frames") % getpid()).str();
+
+    CenteredFrames T(subset, traj, indices, prefix, verbosity > 1);
+    if (verbosity > 1)
+      cerr << "Calculating RMSD...\n";
+    PairwiseRMSDStats stats = pairwiseRMSD(T, topts->noop ? string() : topts->binary_name, meta,
+                                           topts->blocksize, topts->nthreads, verbosity);
+    if (verbosity || topts->noop || topts->stats)
+      cerr << boost::format("Max rmsd = %.4f, avg rmsd = %.4f\n") % stats.max % stats.avg;
+    exit(0);
+  }
 
   long mem = availableMemory();
   uint nthreads = topts->nthreads ? topts->nthreads : boost::thread::hardware_concurrency();
@@ -409,9 +462,13 @@ int main(int argc, char *argv[]) {
 
 
   if (!topts->noop) {
-    cout << "# " << header << endl;
-    cout << mtopts->trajectoryTable();
-    cout << setprecision(matrix_precision) << M;
+    if (!topts->binary_name.empty())
+      writeBinaryMatrix(topts->binary_name, M, meta);
+    else {
+      cout << "# " << header << endl;
+      cout << mtopts->trajectoryTable();
+      cout << setprecision(matrix_precision) << M;
+    }
   }
 
 }
@@ -56,6 +56,8 @@ bool block_average = false;
 string block_filename;
 int ba_first, ba_last;
 
+uint nthreads;
+
 
 // @cond TOOLS_INTERNAL
 class ToolOptions : public opts::OptionsPackage
@@ -72,7 +74,8 @@ public:
       ("timeseries,T", po::value<string>(&timeseries_filename), "File name for outputing timeseries")
       ("block_average", po::value<string>(&block_filename),"File name for block averaging data")
       ("ba_first", po::value<int>(&ba_first), "Lower range of blocks to average over to calculate uncertainty")
-      ("ba_last", po::value<int>(&ba_last), "Upper range of blocks to average over to calculate uncertainty");
+      ("ba_last", po::value<int>(&ba_last), "Upper range of blocks to average over to calculate uncertainty")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   }
 
   void addHidden(po::options_description& o)
@@ -357,11 +360,150 @@ string fullHelpMessage(void)
 "    the third is the stdev of the value, and the last column is the \n"
 "    estimate of the statistical error from block averaging.  If the command\n"
 "    line hadn't included --block_average, the last column would be absent.\n"
+"\n"
+"    The --threads option divides the trajectory frames among multiple\n"
+"    threads, which can considerably speed up the calculation on a\n"
+"    multicore machine.\n"
         ;
     return(s);
     }
 
 
+// Splits the selection into the individual carbon positions and finds
+// the hydrogens bound to each carbon
+void findCarbonsAndHydrogens(AtomicGroup& system, vector<AtomicGroup>& selections,
+                             vector< vector<AtomicGroup> >& hydrogen_list)
+{
+// Break into individual carbons
+AtomicGroup main_selection = selectAtoms(system, selection);
+selections.clear();
+for (int i =first_carbon; i<=last_carbon; i++)
+    {
+    char carbon_name[4];
+    string sel_string = selection;
+    sprintf(carbon_name, "%d", i);
+    string name;
+    if (three_res_lipid)
+        {
+        name = string(" && name == \"C");
+        }
+    else  // implies one_res_lipid is true
+        {
+        name = string(" && name =~ \"C[123]");
+        }
+    name += string(carbon_name) + string("\"");
+    sel_string.insert(sel_string.size(), name);
+    selections.push_back(selectAtoms(main_selection, sel_string.c_str()));
+    }
+
+// Now, figure out which hydrogens go with each carbon selected
+// hydrogen_list mimics the structure of selections, so the hydrogens
+// bound to the jth carbon of the ith selection will be found at
+// hydrogen_list[i][j].
+hydrogen_list.clear();
+hydrogen_list.resize(selections.size());
+HydrogenSelector hyd_sel;
+for (unsigned int i=0; i<selections.size(); i++)
+    {
+    AtomicGroup *s = &(selections[i]);
+    AtomicGroup::Iterator iter(*s);
+    pAtom p;
+    while ((p = iter()))
+        {
+        vector<int> atom_ids = p->getBonds();
+        AtomicGroup bonded = system.groupFromID(atom_ids);
+        AtomicGroup bonded_hydrogens = bonded.select(hyd_sel);
+        if (bonded_hydrogens.size() == 0)
+            {
+            cerr << "No hydrogens found bound to carbon atom: "
+                 << p->name()
+                 << endl;
+       cerr << "This could happen if your lipid doesn't have explicit\n "
+            << "hydrogens, if you gave an incorrect selection string,\n "
+            << "or if the model file you supplied doesn't have "
+            << "connectivity information.";
+       cerr << endl;
+       cerr << "If you're using a PSF generated by gmxdump2pdb.pl, you\n"
+            << "should rerun it using the --hydrogens option so that \n"
+            << "bonds to hydrogen are correctly represented.\n";
+       cerr << endl;
+            exit(-1);
+            }
+
+        hydrogen_list[i].push_back(bonded_hydrogens);
+        }
+    }
+}
+
+
+// @cond TOOLS_INTERNAL
+
+// Computes the average order parameter for each carbon position in
+// one thread's share of the trajectory (see ParallelFrameDriver).
+// The values for each frame are stored directly into the shared
+// values array.
+class OrderParamWorker
+{
+public:
+  OrderParamWorker(vector< vector<float> >* v) : values(v) { }
+
+  void setup(AtomicGroup& system)
+  {
+    findCarbonsAndHydrogens(system, selections, hydrogen_list);
+    counts.assign(selections.size(), 0);
+  }
+
+  void process(const uint frame_index)
+  {
+    // loop over sets of selected carbons
+    for (unsigned int i=0; i<selections.size(); i++)
+        {
+        AtomicGroup *g = &(selections[i]);
+        for (uint j=0; j<g->size(); j++)
+            {
+            // get the carbon
+            pAtom carbon = g->getAtom(j);
+            // get the relevant hydrogens
+            AtomicGroup *hyds = &(hydrogen_list[i][j]);
+
+            AtomicGroup::Iterator iter(*hyds);
+            pAtom h;
+            while ( (h = iter()) )
+                {
+                GCoord v = carbon->coords() - h->coords();
+                double length = v.length();
+                double cos_val =  v[axis_index]/length;
+                double order = 0.5 - 1.5*cos_val*cos_val;
+                (*values)[i][frame_index] += order;
+                counts[i]++;
+                }
+            }
+        }
+
+    // turn the sum into an average
+    for (unsigned int i=0; i<selections.size(); i++)
+        {
+        // We used to take the absolute value immediately, but that produced
+        // results inconsistent with everyone else. Now, we're taking the
+        // absolute value of the ensemble average at each time point.  We'll
+        // see if that produces reasonable results.
+        (*values)[i][frame_index] = fabs((*values)[i][frame_index])/counts[i];
+        counts[i] = 0;
+        }
+  }
+
+  void merge(const OrderParamWorker&) { }
+
+private:
+  vector< vector<float> >* values;
+  vector<AtomicGroup> selections;
+  vector< vector<AtomicGroup> > hydrogen_list;
+  vector<int> counts;
+};
+
+// @endcond
+
+
 int main (int argc, char *argv[])
 {
 
@@ -463,63 +605,10 @@ if ( !one_res_lipid && !three_res_lipid)
 // This means we only have to test one to decide what to do.
 assert(one_res_lipid != three_res_lipid);
 
-// Now break into individual carbons
+// Now break into individual carbons and find their hydrogens
 vector<AtomicGroup> selections;
-for (int i =first_carbon; i<=last_carbon; i++)
-    {
-    char carbon_name[4];
-    string sel_string = selection;
-    sprintf(carbon_name, "%d", i);
-    string name;
-    if (three_res_lipid)
-        {
-        name = string(" && name == \"C");
-        }
-    else  // implies one_res_lipid is true
-        {
-        name = string(" && name =~ \"C[123]");
-        }
-    name += string(carbon_name) + string("\"");
-    sel_string.insert(sel_string.size(), name);
-    selections.push_back(selectAtoms(main_selection, sel_string.c_str()));
-    }
-
-// Now, figure out which hydrogens go with each carbon selected
-// hydrogen_list mimics the structure of selections, so the hydrogens
-// bound to the jth carbon of the ith selection will be found at
-// hydrogen_list[i][j].
-vector< vector<AtomicGroup> > hydrogen_list(selections.size());
-HydrogenSelector hyd_sel;
-for (unsigned int i=0; i<selections.size(); i++)
-    {
-    AtomicGroup *s = &(selections[i]);
-    AtomicGroup::Iterator iter(*s);
-    pAtom p;
-    while ((p = iter()))
-        {
-        vector<int> atom_ids = p->getBonds();
-        AtomicGroup bonded = system.groupFromID(atom_ids);
-        AtomicGroup bonded_hydrogens = bonded.select(hyd_sel);
-        if (bonded_hydrogens.size() == 0)
-            {
-            cerr << "No hydrogens found bound to carbon atom: "
-                 << p->name()
-                 << endl;
-       cerr << "This could happen if your lipid doesn't have explicit\n "
-            << "hydrogens, if you gave an incorrect selection string,\n "
-            << "or if the model file you supplied doesn't have "
-            << "connectivity information.";
-       cerr << endl;
-       cerr << "If you're using a PSF generated by gmxdump2pdb.pl, you\n"
-            << "should rerun it using the --hydrogens option so that \n"
-            << "bonds to hydrogen are correctly represented.\n";
-       cerr << endl;
-            exit(-1);
-            }
-
-        hydrogen_list[i].push_back(bonded_hydrogens);
-        }
-    }
+vector< vector<AtomicGroup> > hydrogen_list;
+findCarbonsAndHydrogens(system, selections, hydrogen_list);
 
 #ifdef DEBUG
 // Check to see if the correct hydrogens were found
@@ -546,13 +635,11 @@ const int num_frames = framelist.size();
 // carbon position, and turn this into an average at the end.
 // This will let us do better uncertainty analysis.
 vector<vector<float> > values;
-vector<int> counts;
 values.resize(selections.size());
 for (uint i=0; i<values.size(); i++)
     {
     values[i].insert(values[i].begin(), num_frames, 0.0);
     }
-counts.insert(counts.begin(), selections.size(), 0);
 
 ofstream timeseries_outfile;
 if (dump_timeseries)
@@ -580,62 +667,23 @@ if (dump_timeseries)
 
     }
 
-// loop over frames in the trajectory
-int frame_index = 0;
+// loop over frames in the trajectory, dividing them among the threads
+OrderParamWorker worker(&values);
+ParallelFrameDriver driver(system, traj, nthreads, tropts->traj_type);
+driver.run(worker, framelist);
+int frame_index = num_frames;
 
-for (uint i=0; i<framelist.size(); ++i)
+if (dump_timeseries)
     {
-    traj->readFrame(framelist[i]);
-    traj->updateGroupCoords(system);
-
-
-    // loop over sets of selected carbons
-    for (unsigned int i=0; i<selections.size(); i++)
-        {
-        AtomicGroup *g = &(selections[i]);
-        for (uint j=0; j<g->size(); j++)
-            {
-            // get the carbon
-            pAtom carbon = g->getAtom(j);
-            // get the relevant hydrogens
-            AtomicGroup *hyds = &(hydrogen_list[i][j]);
-
-            AtomicGroup::Iterator iter(*hyds);
-            pAtom h;
-            while ( (h = iter()) )
-                {
-                GCoord v = carbon->coords() - h->coords();
-                double length = v.length();
-                double cos_val =  v[axis_index]/length;
-                double order = 0.5 - 1.5*cos_val*cos_val;
-                values[i][frame_index] += order;
-                counts[i]++;
-                }
-            }
-        }
-    // turn the sum into an average
-    if (dump_timeseries)
-        {
-        timeseries_outfile << frame_index << "\t";
-        }
-    for (unsigned int i=0; i<selections.size(); i++)
+    for (int t=0; t<num_frames; ++t)
         {
-        // We used to take the absolute value immediately, but that produced
-        // results inconsistent with everyone else. Now, we're taking the
-        // absolute value of the ensemble average at each time point.  We'll
-        // see if that produces reasonable results.
-        values[i][frame_index] = fabs(values[i][frame_index])/counts[i];
-        if (dump_timeseries)
+        timeseries_outfile << t << "\t";
+        for (unsigned int i=0; i<selections.size(); i++)
             {
-            timeseries_outfile << boost::format("%8.3f") % values[i][frame_index];
+            timeseries_outfile << boost::format("%8.3f") % values[i][t];
             }
-        counts[i] = 0;
-        }
-    if (dump_timeseries)
-        {
         timeseries_outfile << endl;
         }
-    frame_index++;
     }
 
 // Print header
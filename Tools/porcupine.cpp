@@ -346,7 +346,7 @@ vector<double> determineScaling(const Matrix& U) {
   // First, handle singular values, if given
   if (!svals_file.empty()) {
     Matrix S;
-    readAsciiMatrix(svals_file, S);
+    readMatrix(svals_file, S);
     if (verbosity > 1)
       cerr << "Read singular values from file " << svals_file << endl;
     if (S.cols() != 1) {
@@ -421,7 +421,7 @@ int main(int argc, char *argv[]) {
 
   // First, read in the LSVs
   Matrix U;
-  readAsciiMatrix(ropts->value("lsv"), U);
+  readMatrix(ropts->value("lsv"), U);
   uint m = U.rows();
 
   vector<double> scalings = determineScaling(U);
@@ -45,6 +45,7 @@ string split_by, split_by2;
 double hist_min, hist_max;
 int num_bins;
 int skip;
+uint nthreads;
 
 // @cond TOOLS_INTERNAL
 class ToolOptions : public opts::OptionsPackage
@@ -56,6 +57,7 @@ public:
     o.add_options()
       ("split-mode",po::value<string>(&split_by)->default_value("by-molecule"), "how to split the selections (by-residue, molecule, segment, none)")
       ("split-mode2",po::value<string>(&split_by2)->default_value("by-molecule"), "how to split the second selection (by-residue, molecule, segment, none)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
       ;
   }
 
@@ -152,6 +154,12 @@ string s =
     "the tryptophan residues.  The program would use the center of mass of the\n"
     "carbon atoms to as the point from which to compute the RDF.\n"
     "\n"
+    "Only pairs closer than histogram-max are examined (using a cell list),\n"
+    "so the cost grows with the number of groups rather than the number\n"
+    "of pairs.  Frames are divided among the number of threads given by\n"
+    "--threads, so on a multicore machine the calculation can be sped up\n"
+    "considerably.\n"
+    "\n"
     "See also atomic-rdf and xy_rdf.\n"
     ;
 
@@ -231,6 +239,107 @@ uint doSplit(const AtomicGroup &system, const string selection,
     }
 
 
+
+// @cond TOOLS_INTERNAL
+
+// Histograms the pair distances for one group-1 molecule.  The cell
+// list only visits group-2 molecules in nearby cells, so the caller
+// must still check the distance.
+struct PairBinner
+    {
+    PairBinner(vector<double>& h, const vector<uint>& self, const double mn2, const double mx2, const double bw)
+        : hist(h), self_pairs(self), min2(mn2), max2(mx2), bin_width(bw) { }
+
+    bool operator()(const uint k, const double d2)
+        {
+        if ( (d2 < max2) && (d2 > min2) )
+            {
+            // skip "self" pairs -- in case selection1 and selection2 overlap
+            if (find(self_pairs.begin(), self_pairs.end(), k) != self_pairs.end())
+                {
+                return(true);
+                }
+            double d = sqrt(d2);
+            int bin = int((d-hist_min)/bin_width);
+            hist[bin]++;
+            }
+        return(true);
+        }
+
+    vector<double>& hist;
+    const vector<uint>& self_pairs;
+    double min2, max2, bin_width;
+    };
+
+
+// Histograms the distances between the groups in one thread's share
+// of the trajectory (see ParallelFrameDriver).  Group-2 molecules are
+// binned into a periodic cell list each frame, so only pairs closer
+// than hist_max are examined.
+class RdfWorker
+    {
+public:
+    RdfWorker(const split_mode s1, const split_mode s2,
+              const vector< vector<uint> >* self)
+        : split(s1), split2(s2), self_pairs(self),
+          hist(num_bins, 0.0), volume(0.0), cells(hist_max)
+        {
+        min2 = hist_min*hist_min;
+        max2 = hist_max*hist_max;
+        bin_width = (hist_max - hist_min)/num_bins;
+        }
+
+    void setup(AtomicGroup& system)
+        {
+        doSplit(system, selection1, split, g1_mols);
+        doSplit(system, selection2, split2, g2_mols);
+        box_source = system;
+        }
+
+    void process(const uint)
+        {
+        GCoord box = box_source.periodicBox(); 
+        volume += box.x() * box.y() * box.z();
+
+        g2_centers.resize(g2_mols.size());
+        for (unsigned int k = 0; k < g2_mols.size(); k++)
+            {
+            g2_centers[k] = g2_mols[k].centerOfMass();
+            }
+        cells.build(g2_centers, box);
+
+        // compute the distribution of g2 around g1 
+        for (unsigned int j = 0; j < g1_mols.size(); j++)
+            {
+            GCoord p1 = g1_mols[j].centerOfMass();
+            PairBinner binner(hist, (*self_pairs)[j], min2, max2, bin_width);
+            cells.visitNeighbors(p1, binner);
+            }
+        }
+
+    void merge(const RdfWorker& other)
+        {
+        for (uint i=0; i<hist.size(); ++i)
+            {
+            hist[i] += other.hist[i];
+            }
+        volume += other.volume;
+        }
+
+    split_mode split, split2;
+    const vector< vector<uint> >* self_pairs;
+    AtomicGroup box_source;
+    vector<AtomicGroup> g1_mols, g2_mols;
+    double min2, max2, bin_width;
+    vector<double> hist;
+    double volume;
+    vector<GCoord> g2_centers;
+    CellList cells;
+    };
+
+// @endcond
+
+
 int main (int argc, char *argv[])
 {
 
@@ -334,77 +443,28 @@ if (numgroups == 0)
 
 
 
-// read the initial coordinates into the system
 vector<uint> framelist = tropts->frameList();
-traj->readFrame(framelist[0]);
-traj->updateGroupCoords(system);
-
-// Create the histogram and zero it out
-vector<double> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
 
 // Precompute the overlap between the two groups (this can be an
 // expensive operation, so it's better to have it outside the
 // while-loop)
 
-unsigned long unique_pairs = 0;
-Math::Matrix<int, Math::RowMajor> group_overlap(g1_mols.size(), g2_mols.size());
-
-for (uint j=0; j<g1_mols.size(); ++j)
+vector< vector<uint> > self_pairs = matchGroups(g1_mols, g2_mols);
+unsigned long unique_pairs = static_cast<unsigned long>(g1_mols.size()) * g2_mols.size();
+for (uint j=0; j<self_pairs.size(); ++j)
     {
-    for (uint i=0; i<g2_mols.size(); ++i)
-      {
-      bool b = (g1_mols[j] == g2_mols[i]);
-      group_overlap(j, i) = b;
-      if ( !b )
-        {
-          ++unique_pairs;
-        }
-      }
+    unique_pairs -= self_pairs[j].size();
     }
 
 
-// loop over the frames of the trajectory
+// loop over the frames of the trajectory, dividing them among the threads
 uint framecount = framelist.size();
-double volume = 0.0;
-for (uint index = 0; index<framecount; ++index)
-    {
-    traj->readFrame(framelist[index]);
-    // update coordinates and periodic box
-    traj->updateGroupCoords(system);
-
-    GCoord box = system.periodicBox(); 
-    volume += box.x() * box.y() * box.z();
-
-    // compute the distribution of g2 around g1 
-    for (unsigned int j = 0; j < g1_mols.size(); j++)
-        {
-        GCoord p1 = g1_mols[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_mols.size(); k++)
-            {
-            // skip "self" pairs -- in case selection1 and selection2 overlap
-            if (group_overlap(j, k))
-                {
-                continue;
-                }
-            GCoord p2 = g2_mols[k].centerOfMass();
-            
-            // Compute the distance squared, taking periodicity into account
-            double d2 = p1.distance2(p2, box);
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist[bin]++;
-                }
-            }
-        }
-    }
+RdfWorker worker(split, split2, &self_pairs);
+ParallelFrameDriver driver(system, traj, nthreads, tropts->traj_type);
+driver.run(worker, framelist);
 
+vector<double>& hist = worker.hist;
+double volume = worker.volume;
 volume /= framecount;
 
 
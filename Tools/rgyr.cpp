@@ -37,9 +37,11 @@ using namespace loos;
 string fullHelpMessage()
     {
 string s =
-    "Usage: rgyr SystemFile Trajectory selection min max num_bins skip [by-molecule]\n" 
+    "Usage: rgyr SystemFile Trajectory selection min max num_bins skip [by-molecule [threads]]\n" 
     "\tby-molecule should be one if you want the selection\n"
     "\tbroken up based on connectivity, and 0 or absent otherwise.\n"
+    "\tthreads is the number of threads to use (default is 1, 0 uses\n"
+    "\tall available processors).\n"
     "\n"
     "\n"
     "SYNOPSIS\n"
@@ -74,10 +76,91 @@ string s =
     "POPE lipids, we need to turn on split-by-molecule.\n"
     "\n"
     "rgyr model-file traj.dcd 'resname==\"POPE\" 0 20 20 0 1\n"
+    "\n"
+    "Frames are divided among threads, so on a multicore machine this\n"
+    "can be sped up by giving the number of threads to use, e.g.\n"
+    "\n"
+    "rgyr model-file traj.dcd 'resname==\"POPE\" 0 20 20 0 1 8\n"
     ;
 return(s);
     }
 
+// @cond TOOLS_INTERNAL
+
+// Histograms the radius of gyration of each molecule in one thread's
+// share of the trajectory (see ParallelFrameDriver)
+class RgyrWorker
+    {
+public:
+    RgyrWorker(const string& sel, const bool split, const greal min, const greal max, const int nbins)
+        : selection(sel), split_by_molecule(split), hist_min(min), hist_max(max),
+          bin_width((max - min)/nbins), hist(nbins, 0.0), count(0)
+        { }
+
+    void setup(AtomicGroup& system)
+        {
+        vector<AtomicGroup> molecules;
+        if (split_by_molecule)
+            {
+            molecules = system.splitByMolecule();
+            }
+        else
+            {
+            molecules.push_back(system);
+            }
+
+        // Set up the selector to define the selected group
+        Parser parser(selection);
+        KernelSelector parsed_sel(parser.kernel());
+
+        // Loop over the molecules and add them to selection
+        molecule_groups.clear();
+        vector<AtomicGroup>::iterator m;
+        for (m=molecules.begin(); m!=molecules.end(); m++)
+            {
+            AtomicGroup tmp = m->select(parsed_sel);
+            if (tmp.size() > 0)
+                {
+                molecule_groups.push_back(tmp);
+                }
+            }
+        }
+
+    void process(const uint)
+        {
+        vector<AtomicGroup>::iterator m;
+        for (m=molecule_groups.begin(); m!=molecule_groups.end(); m++)
+            {
+            greal rad = m->radiusOfGyration();
+            if ( (rad >=hist_min) && (rad <hist_max) )
+                {
+                int bin = int((rad-hist_min)/bin_width);
+                hist[bin]++;
+                count++;
+                }
+            }
+        }
+
+    void merge(const RgyrWorker& other)
+        {
+        for (uint i=0; i<hist.size(); ++i)
+            {
+            hist[i] += other.hist[i];
+            }
+        count += other.count;
+        }
+
+    string selection;
+    bool split_by_molecule;
+    greal hist_min, hist_max, bin_width;
+    vector<AtomicGroup> molecule_groups;
+    vector<greal> hist;
+    int count;
+    };
+
+// @endcond
+
+
 int main (int argc, char *argv[])
 {
 if ( (argc <= 1) || 
@@ -112,74 +195,23 @@ if (argc >= 9)
     split_by_molecule = atoi(argv[8]);
     }
 
-greal bin_width = (hist_max - hist_min)/num_bins;
-
-
-
-vector<AtomicGroup> molecules;
-if (split_by_molecule)
-    {
-    molecules = system.splitByMolecule();
-    }
-else
+uint nthreads = 1;
+if (argc >= 10)
     {
-    molecules.push_back(system);
+    nthreads = atoi(argv[9]);
     }
 
-// Set up the selector to define the selected group
-Parser parser(selection);
-KernelSelector parsed_sel(parser.kernel());
+RgyrWorker worker(selection, split_by_molecule, hist_min, hist_max, num_bins);
 
+// Skip the initial frames as equilibration, then divide the rest
+// of the trajectory among the threads
+vector<uint> frames = assignTrajectoryFrames(traj, "", skip);
+ParallelFrameDriver driver(system, traj, nthreads);
+driver.run(worker, frames);
 
-// Loop over the molecules and add them to selection
-vector<AtomicGroup> molecule_groups;
-vector<AtomicGroup>::iterator m;
-for (m=molecules.begin(); m!=molecules.end(); m++)
-    {
-    AtomicGroup tmp = m->select(parsed_sel);
-    if (tmp.size() > 0)
-        {
-        molecule_groups.push_back(tmp);
-        }
-    }
-
-
-// Skip the initial frames as equilibration
-if (skip > 0)
-{
-  traj->readFrame(skip - 1); 
-}
-
-// read the initial coordinates into the system
-traj->updateGroupCoords(system);
-
-// Create the histogram and zero it out
-vector<greal> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
-
-// loop over the frames of the trajectory
-int frame = 0;
-int count = 0;
-while (traj->readFrame())
-    {
-    // update coordinates and periodic box
-    traj->updateGroupCoords(system);
-
-    vector<AtomicGroup>::iterator m;
-    for (m=molecule_groups.begin(); m!=molecule_groups.end(); m++)
-        {
-        greal rad = m->radiusOfGyration();
-        if ( (rad >=hist_min) && (rad <hist_max) )
-            {
-            int bin = int((rad-hist_min)/bin_width);
-            hist[bin]++;
-            count++;
-            }
-        }
-    frame++;
-    }
-
+vector<greal>& hist = worker.hist;
+int count = worker.count;
+greal bin_width = worker.bin_width;
 
 // Output the results
 cout << "# Rgyr\tProb\tCum" << endl;
@@ -197,4 +229,3 @@ for (int i = 0; i < num_bins; i++)
 
     }
 }
-
@@ -85,6 +85,9 @@ string fullHelpMessage(void) {
     "selected and in the sequence of atoms (i.e. the first atom in the --align selection is\n"
     "matched with the first atom in the --talign selection.)\n"
     "\n"
+    "\tThe --threads option divides the trajectory frames among multiple threads\n"
+    "when superimposing onto a target and calculating the RMSDs.\n"
+    "\n"
     "SEE ALSO\n"
     "\trmsds\n";
 
@@ -101,19 +104,21 @@ public:
       ("target", po::value<string>(&target_name), "Compute RMSD against this reference target (must have coordinates)")
       ("talign", po::value<string>(&target_align)->default_value(""), "Selection for target to use to align (default is to use --align)")
       ("trmsd", po::value<string>(&target_selection)->default_value(""), "Compute the RMSD over this selection for the target (default is to use --rmsd)")
-      ("tolerance", po::value<double>(&tol)->default_value(1e-6), "Tolerance to use for iterative alignment");
+      ("tolerance", po::value<double>(&tol)->default_value(1e-6), "Tolerance to use for iterative alignment")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   }
 
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("align='%s', iterative=%d, target='%s', talign='%s', trmsd='%s', tolerance=%f, rmsd='%s'")
+    oss << boost::format("align='%s', target='%s', talign='%s', trmsd='%s', tolerance=%f, rmsd='%s', threads=%d")
       % alignment
       % target_name
       % target_align
       % target_selection
       % tol
-      % selection;
+      % selection
+      % nthreads;
 
     return(oss.str());
   }
@@ -141,6 +146,62 @@ public:
   string target_align, target_selection;
   double tol;
   string selection;
+  uint nthreads;
+};
+
+
+// Superimposes each frame onto the target (see ParallelFrameDriver).
+// Each frame's transform is stored directly into the shared
+// transforms vector.  The target is only centered once, and is
+// shared by all threads.
+
+class TargetAligner {
+public:
+  TargetAligner(const string& sel, const alignment::ReferenceSuperposition* target, vector<XForm>* xforms)
+    : _selection(sel), _target(target), _xforms(xforms) { }
+
+  void setup(AtomicGroup& model) { _subset = selectAtoms(model, _selection); }
+
+  void process(const uint i) {
+    GMatrix M = _target->superposition(_subset);
+    (*_xforms)[i] = XForm(M);
+  }
+
+  void merge(const TargetAligner&) { }
+
+private:
+  string _selection;
+  const alignment::ReferenceSuperposition* _target;
+  vector<XForm>* _xforms;
+  AtomicGroup _subset;
+};
+
+
+
+// Computes the RMSD of each frame to the target after applying that
+// frame's transform (if any)
+
+class RMSDCalculator {
+public:
+  RMSDCalculator(const string& sel, const AtomicGroup* target, const vector<XForm>* xforms, vector<double>* rmsds)
+    : _selection(sel), _target(target), _xforms(xforms), _rmsds(rmsds) { }
+
+  void setup(AtomicGroup& model) { _subset = selectAtoms(model, _selection); }
+
+  void process(const uint i) {
+    if (!_xforms->empty())
+      _subset.applyTransform((*_xforms)[i]);
+    (*_rmsds)[i] = _subset.rmsd(*_target);
+  }
+
+  void merge(const RMSDCalculator&) { }
+
+private:
+  string _selection;
+  const AtomicGroup* _target;
+  const vector<XForm>* _xforms;
+  vector<double>* _rmsds;
+  AtomicGroup _subset;
 };
 
 
@@ -167,6 +228,7 @@ int main(int argc, char *argv[]) {
   pTraj ptraj = tropts->trajectory;
   AtomicGroup subset = selectAtoms(molecule, topts->selection);
   vector<uint> indices = tropts->frameList();
+  ParallelFrameDriver driver(molecule, ptraj, topts->nthreads, tropts->traj_type);
 
   AtomicGroup target;
   AtomicGroup target_subset;
@@ -207,13 +269,10 @@ int main(int argc, char *argv[]) {
       AtomicGroup target_align = selectAtoms(target, topts->target_align);
       cerr << boost::format("Aligning using %d atoms from \"%s\".\n") % target_align.size() % topts->alignment;
 
-      for (uint i=0; i<indices.size(); i++) {
-        ptraj->readFrame(indices[i]);
-        ptraj->updateGroupCoords(molecule);
-        GMatrix M = align_subset.superposition(target_align);
-        XForm W(M);
-        transforms.push_back(W);
-      }
+      transforms.resize(indices.size());
+      alignment::ReferenceSuperposition reference(target_align);
+      TargetAligner aligner(topts->alignment, &reference, &transforms);
+      driver.run(aligner, indices);
       
     }
     
@@ -227,7 +286,7 @@ int main(int argc, char *argv[]) {
   } else
     target = target_subset;
 
-  vector<double> rmsds;
+  vector<double> rmsds(indices.size());
   double avg_rmsd = 0.0;
 
   if (subset.size() != target.size()) {
@@ -235,14 +294,10 @@ int main(int argc, char *argv[]) {
     exit(-10);
   }
 
-  for (uint i=0; i<indices.size(); i++) {
-      ptraj->readFrame(indices[i]);
-      ptraj->updateGroupCoords(subset);
-      subset.applyTransform(transforms[i]);
-      double d = target.rmsd(subset);
-      rmsds.push_back(d);
-      avg_rmsd += d;
-  }
+  RMSDCalculator calculator(topts->selection, &target, &transforms, &rmsds);
+  driver.run(calculator, indices);
+  for (uint i=0; i<rmsds.size(); i++)
+    avg_rmsd += rmsds[i];
 
   avg_rmsd /= indices.size();
   double std_rmsd = 0.0;
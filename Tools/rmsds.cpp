@@ -85,6 +85,17 @@ string fullHelpMessage(void) {
     "the trajectory either by using the --range1 and --range2 options, or use subsetter to pre-process\n"
     "the trajectory.\n"
     "\n"
+    "\tFor very large trajectories, use the --blocksize option.  The selected coordinates are then\n"
+    "centered and written once to a scratch file (see --scratch), which is removed automatically, and\n"
+    "the matrix is computed a strip of --blocksize columns at a time and written directly to the\n"
+    "--binary file.  The full matrix is never held in memory, but one strip can be as large as\n"
+    "--blocksize times the number of frames.  With one trajectory, only the upper triangle is\n"
+    "computed and stored (as a triangular binary matrix, which is read back as a full matrix).\n"
+    "\n"
+    "\tBy default, the optimal superposition of each pair of frames is found with a singular value\n"
+    "decomposition.  The --qcp option uses Theobald's quaternion characteristic polynomial method\n"
+    "instead, which gives the same RMSDs (to within ~1e-10) and is considerably faster.\n"
+    "\n"
     "\tThis tool can be run in parallel with multiple threads for performance.  The --threads option\n"
     "controls how many threads are used.  The default is 1 (non-parallel).  Setting it to 0 will use\n"
     "as many threads as possible.  Note that if LOOS was built using a multi-threaded math library,\n"
@@ -100,6 +111,13 @@ string fullHelpMessage(void) {
     "This example uses all alpha-carbons and every frame in the trajectory, run\n"
     "in parallel with 8 threads of execution.\n"
     "\n"
+    "\trmsds --binary=rmsd.bin model.pdb simulation.dcd\n"
+    "As above, but the matrix is written to rmsd.bin in the LOOS binary matrix\n"
+    "format, which is much smaller and faster to read than the ASCII matrix.\n"
+    "\n"
+    "\trmsds --blocksize=2000 --threads=0 --binary=rmsd.bin model.pdb long-simulation.dcd\n"
+    "As above, but for a trajectory that is too long to cache in memory.\n"
+    "\n"
     "\trmsds inactive.pdb inactive.dcd active.pdb active.dcd >rmsd.asc\n"
     "This example uses all alpha-carbons and compares the \"inactive\" simulation\n"
     "with the \"active\" one.\n"
@@ -141,7 +159,11 @@ public:
       ("sel2", po::value<string>(&sel2)->default_value("name == 'CA'"), "Atom selection for second system")
       ("skip2", po::value<uint>(&skip2)->default_value(0), "Skip n-frames of second trajectory")
       ("range2", po::value<string>(&range2), "Matlab-style range of frames to use from second trajectory")
-      ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix");
+      ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix")
+      ("qcp", po::value<bool>(&qcp)->default_value(false), "Use the QCP method for superposition instead of SVD (faster)")
+      ("binary", po::value<string>(&binary_name), "Write the matrix in binary format to this file rather than to stdout")
+      ("blocksize", po::value<uint>(&blocksize)->default_value(0), "Compute the matrix out-of-core in strips of this many frames (requires --binary or --noout)")
+      ("scratch", po::value<string>(&scratch), "Prefix for the scratch files used with --blocksize (default is based on --binary)");
 
   }
 
@@ -165,6 +187,14 @@ public:
     return( ! ( (m.count("model1") && m.count("traj1")) && !(m.count("model2") ^ m.count("traj2"))) );
   }
 
+  bool postConditions(po::variables_map& m) {
+    if (blocksize && binary_name.empty() && !noop) {
+      cerr << "Error- --blocksize requires either --binary or --noout\n";
+      return(false);
+    }
+    return(true);
+  }
+
 
   string help() const {
     return("model-1 trajectory-1 [model-2 trajectory-2]");
@@ -173,9 +203,13 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("stats=%d,noout=%d,nthreads=%d,sel1='%s',skip1=%d,range1='%s',sel2='%s',skip2=%d,range2='%s',model1='%s',traj1='%s',model2='%s',traj2='%s'")
+    oss << boost::format("stats=%d,qcp=%d,noout=%d,binary='%s',blocksize=%d,scratch='%s',nthreads=%d,sel1='%s',skip1=%d,range1='%s',sel2='%s',skip2=%d,range2='%s',model1='%s',traj1='%s',model2='%s',traj2='%s'")
       % stats
+      % qcp
       % noop
+      % binary_name
+      % blocksize
+      % scratch
       % nthreads
       % sel1
       % skip1
@@ -193,10 +227,13 @@ public:
 
 
   bool stats;
+  bool qcp;
   bool noop;
   uint skip1, skip2;
   uint nthreads;
+  uint blocksize;
   string range1, range2;
+  string binary_name, scratch;
   string model1, traj1, model2, traj2;
   string sel1, sel2;
 };
@@ -477,7 +514,49 @@ void checkMemoryUsage(long mem) {
       % (used_memory >> 20)
       % (mem >> 30);
     
-    cerr << "If your machine starts swapping, try subsampling the trajectories\n";
+    cerr << "If your machine starts swapping, try subsampling the trajectories or using --blocksize\n";
+  }
+}
+
+
+
+// Computes the matrix out-of-core, writing it straight to the binary file
+
+void tiledRMSDs(AtomicGroup& subset, pTraj& traj, const vector<uint>& indices, ToolOptions* topts, const string& header) {
+  string prefix = topts->scratch;
+  if (prefix.empty())
+    prefix = topts->noop ? string("rmsds") : topts->binary_name;
+  prefix += (boost::format(".%d") % getpid()).str();
+
+  string outname = topts->noop ? string() : topts->binary_name;
+  uint nthreads = topts->nthreads;
+
+  if (verbosity > 1)
+    cerr << "Reading trajectory - " << topts->traj1 << endl;
+  CenteredFrames T(subset, traj, indices, prefix + ".frames1", verbosity > 1);
+
+  if (topts->model2.empty()) {
+    if (verbosity > 1)
+      cerr << "Calculating RMSD...\n";
+    PairwiseRMSDStats stats = pairwiseRMSD(T, outname, header, topts->blocksize, nthreads, verbosity);
+    if (verbosity || topts->noop || topts->stats)
+      cerr << boost::format("Max rmsd = %.4f, avg rmsd = %.4f\n") % stats.max % stats.avg;
+
+  } else {
+    AtomicGroup model2 = createSystem(topts->model2);
+    pTraj traj2 = createTrajectory(topts->traj2, model2);
+    AtomicGroup subset2 = selectAtoms(model2, topts->sel2);
+    vector<uint> indices2 = assignTrajectoryFrames(traj2, topts->range2, topts->skip2);
+
+    if (verbosity > 1)
+      cerr << "Reading trajectory - " << topts->traj2 << endl;
+    CenteredFrames T2(subset2, traj2, indices2, prefix + ".frames2", verbosity > 1);
+
+    if (verbosity > 1)
+      cerr << "Calculating RMSD...\n";
+    PairwiseRMSDStats stats = pairwiseRMSD(T, T2, outname, header, topts->blocksize, nthreads, verbosity);
+    if (verbosity || topts->noop || topts->stats)
+      cerr << boost::format("Max rmsd = %.4f, avg rmsd = %.4f\n") % stats.max % stats.avg;
   }
 }
 
@@ -497,11 +576,18 @@ int main(int argc, char *argv[]) {
 
   verbosity = bopts->verbosity;
   report_stats = (verbosity || topts->noop);
+  if (topts->qcp)
+    alignment::superpositionMethod(alignment::QCP);
   AtomicGroup model = createSystem(topts->model1);
   pTraj traj = createTrajectory(topts->traj1, model);
   AtomicGroup subset = selectAtoms(model, topts->sel1);
   vector<uint> indices = assignTrajectoryFrames(traj, topts->range1, topts->skip1);
 
+  if (topts->blocksize) {
+    tiledRMSDs(subset, traj, indices, topts, header);
+    exit(0);
+  }
+
   long mem = availableMemory();
   uint nthreads = topts->nthreads ? topts->nthreads : boost::thread::hardware_concurrency();
   
@@ -560,8 +646,12 @@ int main(int argc, char *argv[]) {
   }
 
   if (!topts->noop) {
-    cout << "# " << header << endl;
-    cout << setprecision(matrix_precision) << M;
+    if (!topts->binary_name.empty())
+      writeBinaryMatrix(topts->binary_name, M, header);
+    else {
+      cout << "# " << header << endl;
+      cout << setprecision(matrix_precision) << M;
+    }
   }
 
 }
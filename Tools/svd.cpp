@@ -31,6 +31,7 @@
 
 #include <loos.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace std;
 using namespace loos;
@@ -42,6 +43,8 @@ namespace po = loos::OptionsFramework::po;
 extern "C" {
   void dgesvd_(char*, char*, int*, int*, double*, int*, double*, double*, int*, double*, int*, double*, int*, int*);
   void sgesvd_(char*, char*, int*, int*, float*, int*, float*, float*, int*, float*, int*, float*, int*, int*);
+  void dsyevr_(char*, char*, char*, int*, double*, int*, double*, double*, int*, int*, double*, int*,
+               double*, double*, int*, int*, double*, int*, int*, int*, int*);
 }
 #endif
 
@@ -53,6 +56,13 @@ typedef double svdreal;
 typedef Math::Matrix<svdreal, Math::ColMajor> Matrix;
 
 
+// Frames read at a time when accumulating the covariance
+const uint frames_per_block = 256;
+
+// Width of the column slabs of the covariance matrix updated by each thread
+const uint columns_per_slab = 128;
+
+
 
 // Globals
 string header("NO HEADER SPECIFIED");
@@ -71,7 +81,11 @@ public:
     alignment_tol(1e-6),
     splitv(true),
     autoname(true),
-    terms(0)
+    binary(false),
+    terms(0),
+    method("svd"),
+    rsv(true),
+    nthreads(1)
   { }
 
 
@@ -84,7 +98,11 @@ public:
       ("source", po::value<bool>(&include_source)->default_value(include_source), "Write out source conformation matrix")
       ("splitv", po::value<bool>(&splitv)->default_value(splitv), "Automatically split V matrix (when using multiple trajectories)")
       ("autoname", po::value<bool>(&autoname)->default_value(autoname), "Automatically name V files based on traj filename")
-      ("terms", po::value<uint>(&terms), "# of terms of the SVD to output");
+      ("binary", po::value<bool>(&binary)->default_value(binary), "Write matrices in binary format (.bin) rather than ASCII (.asc)")
+      ("terms", po::value<uint>(&terms), "# of terms of the SVD to output")
+      ("method", po::value<string>(&method)->default_value(method), "How to compute the SVD (svd, covariance, or auto)")
+      ("rsv", po::value<bool>(&rsv)->default_value(rsv), "Write out the right singular vectors")
+      ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use (0=all available)");
   }
 
 
@@ -92,6 +110,16 @@ public:
     if (autoname)
       splitv = true;
 
+    if (!(method == "svd" || method == "covariance" || method == "auto")) {
+      cerr << "Error- unknown method '" << method << "'\n";
+      return(false);
+    }
+
+    if (method == "covariance" && include_source) {
+      cerr << "Error- the source matrix cannot be written when using the covariance method\n";
+      return(false);
+    }
+
     return(true);
   }
 
@@ -100,15 +128,19 @@ public:
   string print() const {
     ostringstream oss;
 
-    oss << boost::format("align='%s', svd='%s', tolerance=%f, noalign=%d, source=%d, splitv=%d, autoname=%d, terms=%d")
+    oss << boost::format("align='%s', svd='%s', tolerance=%f, noalign=%d, source=%d, splitv=%d, autoname=%d, binary=%d, terms=%d, method='%s', rsv=%d, threads=%d")
       % alignment_string
       % svd_string
+      % alignment_tol
       % noalign
       % include_source
-      % alignment_tol
       % splitv
       % autoname
-      % terms;
+      % binary
+      % terms
+      % method
+      % rsv
+      % nthreads;
     return(oss.str());
   }
 
@@ -116,8 +148,11 @@ public:
   string alignment_string, svd_string;
   bool noalign, include_source;
   double alignment_tol;
-  bool splitv, autoname;
+  bool splitv, autoname, binary;
   uint terms;
+  string method;
+  bool rsv;
+  uint nthreads;
 };
 
 // @endcond
@@ -158,6 +193,26 @@ string s =
   "\toutput.map     - mapping of selection onto rows of output matrices\n"
   "\toutput_avg.pdb - average structure across the trajectory\n"
   "\n"
+  "By default, the SVD is computed directly from the coordinate matrix.\n"
+  "When there are many more frames than coordinates (3 x number of atoms),\n"
+  "it is much faster and uses far less memory to compute the eigenvectors\n"
+  "of the covariance matrix instead.  The --method=covariance option does\n"
+  "this.  The trajectory is read in blocks and the covariance is accumulated\n"
+  "as it is read (using --threads threads), so the coordinate matrix is never\n"
+  "stored.  The RSVs are then computed with a second pass through the\n"
+  "trajectory, which can be skipped with --rsv=0.  The output files are the\n"
+  "same, though the signs of the vectors may differ, and very small singular\n"
+  "values are less accurate since the covariance squares them.  The --source\n"
+  "option cannot be used with this method.  With --method=auto, the covariance\n"
+  "is used whenever there are more frames than coordinates (unless --source\n"
+  "is given).\n"
+  "\n"
+  "With --binary=1, the matrices are written in the LOOS binary matrix\n"
+  "format with a .bin extension instead.  These are much smaller and\n"
+  "faster to read and write than the ASCII matrices, and are accepted\n"
+  "by the tools that read svd output (e.g. porcupine, coverlap, svdcolmap,\n"
+  "and enmovie).\n"
+  "\n"
   "\n"
   "UNITS AND PCA COMPARISON\n"
   "\n"
@@ -263,6 +318,28 @@ void writeAverage(const AtomicGroup& avg) {
 }
 
 
+// Reads the transformed coords, less the average, for frames
+// [start, start + M.cols()) into the columns of M
+
+void readCoords(Matrix& M, AtomicGroup& frame, const AtomicGroup& avg, const vector<XForm>& xforms,
+                pTraj traj, const vector<uint>& indices, const uint start) {
+  uint natoms = frame.size();
+
+  for (uint i=0; i<M.cols(); ++i) {
+    traj->readFrame(indices[start + i]);
+    traj->updateGroupCoords(frame);
+    frame.applyTransform(xforms[start + i]);
+
+    for (uint j=0; j<natoms; j++) {
+      GCoord c = frame[j]->coords() - avg[j]->coords();
+      M(j*3,i) = c.x();
+      M(j*3+1,i) = c.y();
+      M(j*3+2,i) = c.z();
+    }
+  }
+}
+
+
 // Calculates the transformed avg structure, then extracts the
 // transformed coords from the DCD with the avg subtraced out...
 
@@ -271,26 +348,167 @@ Matrix extractCoords(const AtomicGroup& subset, const vector<XForm>& xforms, pTr
   AtomicGroup avg = averageStructure(subset, xforms, traj, indices);
   writeAverage(avg);
 
-  uint natoms = subset.size();
   AtomicGroup frame = subset.copy();
   uint n = indices.size();
-  uint m = natoms * 3;
+  uint m = subset.size() * 3;
   Matrix M(m, n);
+  readCoords(M, frame, avg, xforms, traj, indices, 0);
 
-  for (uint i=0; i<n; ++i) {
-    traj->readFrame(indices[i]);
-    traj->updateGroupCoords(frame);
-    frame.applyTransform(xforms[i]);
+  return(M);
+}
 
-    for (uint j=0; j<natoms; j++) {
-      GCoord c = frame[j]->coords() - avg[j]->coords();
-      M(j*3,i) = c.x();
-      M(j*3+1,i) = c.y();
-      M(j*3+2,i) = c.z();
+
+
+// Adds B B' to the lower triangle of C for the column slabs assigned
+// to this thread
+
+struct CovarianceWorker {
+  CovarianceWorker(Matrix* c, const Matrix* b, const uint f, const uint st, string* e)
+    : C(c), B(b), first(f), stride(st), error(e) { }
+
+  void operator()() {
+    try {
+      f77int m = C->rows();
+      f77int k = B->cols();
+      f77int ld = m;
+      double one = 1.0;
+
+      for (uint c0 = first * columns_per_slab; c0 < C->cols(); c0 += stride * columns_per_slab) {
+        f77int rows = m - c0;
+        f77int cols = min(columns_per_slab, C->cols() - c0);
+        const double* b = B->get() + c0;
+        double* c = C->get() + static_cast<ulong>(c0) * m + c0;
+
+#if defined(__linux__) || defined(__CYGWIN__) || defined(__FreeBSD__)
+        char ta = 'N';
+        char tb = 'T';
+        dgemm_(&ta, &tb, &rows, &cols, &k, &one, b, &ld, b, &ld, &one, c, &ld);
+#else
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, rows, cols, k, one, b, ld, b, ld, one, c, ld);
+#endif
+      }
+    }
+    catch (std::exception& e) {
+      *error = e.what();
     }
   }
 
-  return(M);
+  Matrix* C;
+  const Matrix* B;
+  uint first, stride;
+  string* error;
+};
+
+
+// Accumulates the lower triangle of A A' without ever storing A.
+// Each block of frames is added to the covariance with a rank-k
+// update, split over nthreads threads.
+
+Matrix accumulateCovariance(const AtomicGroup& subset, const AtomicGroup& avg, const vector<XForm>& xforms,
+                            pTraj traj, const vector<uint>& indices, const uint nthreads) {
+  uint m = subset.size() * 3;
+  uint n = indices.size();
+  AtomicGroup frame = subset.copy();
+  Matrix C(m, m);
+
+  uint nslabs = (m + columns_per_slab - 1) / columns_per_slab;
+  uint nt = nthreads ? nthreads : boost::thread::hardware_concurrency();
+  nt = max(1u, min(nt, nslabs));
+
+  for (uint start = 0; start < n; start += frames_per_block) {
+    Matrix B(m, min(frames_per_block, n - start));
+    readCoords(B, frame, avg, xforms, traj, indices, start);
+
+    vector<string> errors(nt);
+    boost::thread_group threads;
+    for (uint t=1; t<nt; ++t)
+      threads.create_thread(CovarianceWorker(&C, &B, t, nt, &(errors[t])));
+    CovarianceWorker(&C, &B, 0, nt, &(errors[0]))();
+    threads.join_all();
+
+    for (uint t=0; t<nt; ++t)
+      if (!errors[t].empty())
+        throw(runtime_error(errors[t]));
+  }
+
+  return(C);
+}
+
+
+// Eigendecomposition of the covariance (lower triangle of C).  If
+// terms is nonzero, only the largest terms eigenpairs are found.
+// Returns the eigenvectors in descending order of eigenvalue in U,
+// and the singular values (square roots of the eigenvalues) in S.
+
+void covarianceEigen(Matrix& C, const uint terms, Matrix& U, Matrix& S) {
+  char jobz = 'V', range = terms ? 'I' : 'A', uplo = 'L';
+  f77int n = C.rows();
+  f77int lda = n, ldz = n;
+  f77int il = terms ? n - terms + 1 : 1;
+  f77int iu = n;
+  double vl = 0.0, vu = 0.0;
+  double abstol = dlamch_("Safe minimum");
+  f77int found, info;
+  f77int wanted = iu - il + 1;
+
+  Matrix W(n, 1);
+  Matrix Z(n, wanted);
+  vector<f77int> isuppz(2 * wanted);
+
+  f77int lwork = -1, liwork = -1, iprework;
+  double prework;
+  dsyevr_(&jobz, &range, &uplo, &n, C.get(), &lda, &vl, &vu, &il, &iu, &abstol, &found, W.get(), Z.get(), &ldz,
+          &isuppz[0], &prework, &lwork, &iprework, &liwork, &info);
+  if (info != 0)
+    throw(NumericalError("dsyevr failed to estimate workspace", info));
+
+  lwork = static_cast<f77int>(prework);
+  liwork = iprework;
+  vector<double> work(lwork);
+  vector<f77int> iwork(liwork);
+  dsyevr_(&jobz, &range, &uplo, &n, C.get(), &lda, &vl, &vu, &il, &iu, &abstol, &found, W.get(), Z.get(), &ldz,
+          &isuppz[0], &work[0], &lwork, &iwork[0], &liwork, &info);
+  if (info != 0)
+    throw(NumericalError("dsyevr failed", info));
+
+  U = Matrix(n, found);
+  S = Matrix(found, 1);
+  for (f77int i=0; i<found; ++i) {
+    f77int k = found - i - 1;
+    S[i] = W[k] < 0.0 ? 0.0 : sqrt(W[k]);
+    for (f77int j=0; j<n; ++j)
+      U(j, i) = Z(j, k);
+  }
+}
+
+
+// RSVs from a second pass through the trajectory, V' = S^-1 U' A.
+// Only the first k RSVs are computed.
+
+Matrix rightSingularVectors(const AtomicGroup& subset, const AtomicGroup& avg, const vector<XForm>& xforms,
+                            pTraj traj, const vector<uint>& indices, const Matrix& U, const Matrix& S, const uint k) {
+  uint m = subset.size() * 3;
+  uint n = indices.size();
+  AtomicGroup frame = subset.copy();
+
+  Matrix Us(m, k);
+  for (uint i=0; i<k; ++i) {
+    double konst = (S[i] > 0.0) ? 1.0 / S[i] : 0.0;
+    for (uint j=0; j<m; ++j)
+      Us(j, i) = U(j, i) * konst;
+  }
+
+  Matrix Vt(k, n);
+  for (uint start = 0; start < n; start += frames_per_block) {
+    Matrix B(m, min(frames_per_block, n - start));
+    readCoords(B, frame, avg, xforms, traj, indices, start);
+    Matrix V = MMMultiply(Us, B, true, false);
+    for (uint i=0; i<V.cols(); ++i)
+      for (uint j=0; j<k; ++j)
+        Vt(j, start + i) = V(j, i);
+  }
+
+  return(Vt);
 }
 
 
@@ -312,23 +530,33 @@ void write_map(const string& fname, const AtomicGroup& grp) {
 }
 
 
+// Writes the matrix in ASCII or binary format, adding the appropriate
+// extension to the filename
+void writeMatrix(const string& basename, const Matrix& M, const string& header, const Math::Range& start, const Math::Range& end, const bool trans, const bool binary) {
+  if (binary)
+    writeBinaryMatrix(basename + ".bin", M, header, start, end, trans);
+  else
+    writeAsciiMatrix(basename + ".asc", M, header, start, end, trans);
+}
+
+
 void writeMatrixChunk(opts::OutputPrefix* popts, opts::MultiTrajOptions* tropts, ToolOptions* topts, const Matrix& Vt, const Math::Range& start, const Math::Range& end, const string& header, const uint index) {
   string filename;
 
   if (topts->autoname) {
     boost::filesystem::path p(tropts->mtraj[index]->filename());
 #if BOOST_FILESYSTEM_VERSION >= 3
-    filename = p.stem().string() + "_V.asc";
+    filename = p.stem().string() + "_V";
 #else
-    filename = p.stem() + "_V.asc";
+    filename = p.stem() + "_V";
 #endif
   } else {
     ostringstream oss;
-    oss << boost::format("%s_V_%04d.asc") % popts->prefix % index;
+    oss << boost::format("%s_V_%04d") % popts->prefix % index;
     filename = oss.str();
   }
 
-  writeAsciiMatrix(filename, Vt, header, start, end, true);
+  writeMatrix(filename, Vt, header, start, end, true, topts->binary);
 }
 
 
@@ -370,56 +598,105 @@ int main(int argc, char *argv[]) {
     xforms = doAlign(alignsub, ptraj, indices, topts->alignment_tol);   // Honors indices
   }
 
-  cerr << argv[0] << ": Extracting coordinates...\n";
-  Matrix A = extractCoords(svdsub, xforms, ptraj, indices);   // Honors indices
-  f77int m = A.rows();
-  f77int n = A.cols();
+  uint ncoords = svdsub.size() * 3;
+  uint nframes = indices.size();
+  bool covariance = (topts->method == "covariance"
+                     || (topts->method == "auto" && nframes > ncoords && !topts->include_source));
+
+  f77int m = ncoords;
+  f77int n = nframes;
   f77int sn = m<n ? m : n;
 
+  if (topts->terms) {
+    int terms = static_cast<int>(topts->terms);
+    if (terms > m || terms > sn || terms > n) {
+      cerr << "ERROR- The number of terms requested exceeds matrix dimensions.\n";
+      exit(-1);
+    }
+  }
+
+  Matrix U, S, Vt;
+  svdreal* work = 0;
+
+  if (covariance) {
+    cerr << argv[0] << ": Computing average structure...\n";
+    AtomicGroup avg = averageStructure(svdsub, xforms, ptraj, indices);
+    writeAverage(avg);
+
+    double estimate = 2.0 * static_cast<double>(m)*m*sizeof(svdreal);
+    if (topts->rsv)
+      estimate += static_cast<double>(topts->terms ? topts->terms : sn) * n * sizeof(svdreal);
+    cerr << boost::format("%s: Allocating estimated %.3f GB for %d x %d covariance\n")
+      % argv[0]
+      % (estimate / gigabytes)
+      % m
+      % m;
+
+    cerr << argv[0] << ": Accumulating covariance...\n";
+    Timer<WallTimer> timer;
+    timer.start();
+    Matrix C = accumulateCovariance(svdsub, avg, xforms, ptraj, indices, topts->nthreads);
+    cerr << argv[0] << ": Calculating eigendecomposition...\n";
+    covarianceEigen(C, topts->terms, U, S);
+    C.reset();
+    if (topts->rsv) {
+      cerr << argv[0] << ": Calculating RSVs...\n";
+      Vt = rightSingularVectors(svdsub, avg, xforms, ptraj, indices, U, S, topts->terms ? topts->terms : sn);
+    }
+    timer.stop();
+    cerr << argv[0] << ": Done!  Calculation took " << timeAsString(timer.elapsed()) << endl;
 
-  if (topts->include_source)
-    writeAsciiMatrix(prefix + "_A.asc", A, header);
+  } else {
 
-  double estimate = static_cast<double>(m)*m*sizeof(svdreal) + static_cast<double>(n)*n*sizeof(svdreal) + static_cast<double>(m)*n*sizeof(svdreal) + sn*sizeof(svdreal);
-  cerr << boost::format("%s: Allocating estimated %.3f GB for %d x %d SVD\n")
-    % argv[0]
-    % (estimate / gigabytes)
-    % m
-    % n;
+    cerr << argv[0] << ": Extracting coordinates...\n";
+    Matrix A = extractCoords(svdsub, xforms, ptraj, indices);   // Honors indices
 
-  char jobu = 'A', jobvt = 'A';
-  f77int lda = m, ldu = m, ldvt = n, lwork= -1, info;
-  svdreal prework[10], *work;
+    if (topts->include_source)
+      writeMatrix(prefix + "_A", A, header, Math::Range(0,0), Math::Range(A.rows(), A.cols()), false, topts->binary);
 
-  Matrix U(m,m);
-  Matrix S(sn,1);
-  Matrix Vt(n,n);
+    double estimate = static_cast<double>(m)*m*sizeof(svdreal) + static_cast<double>(m)*n*sizeof(svdreal) + sn*sizeof(svdreal);
+    if (topts->rsv)
+      estimate += static_cast<double>(n)*n*sizeof(svdreal);
+    cerr << boost::format("%s: Allocating estimated %.3f GB for %d x %d SVD\n")
+      % argv[0]
+      % (estimate / gigabytes)
+      % m
+      % n;
+
+    char jobu = 'A', jobvt = topts->rsv ? 'A' : 'N';
+    f77int lda = m, ldu = m, ldvt = topts->rsv ? n : 1, lwork= -1, info;
+    svdreal prework[10];
+
+    U = Matrix(m,m);
+    S = Matrix(sn,1);
+    Vt = topts->rsv ? Matrix(n,n) : Matrix(1,1);
   
-  // First, request the optimal size of the work array...
-  SVDFUNC(&jobu, &jobvt, &m, &n, A.get(), &lda, S.get(), U.get(), &ldu, Vt.get(), &ldvt, prework, &lwork, &info);
-  if (info != 0) {
-    cerr << "Error code from size request to dgesvd was " << info << endl;
-    exit(-2);
-  }
+    // First, request the optimal size of the work array...
+    SVDFUNC(&jobu, &jobvt, &m, &n, A.get(), &lda, S.get(), U.get(), &ldu, Vt.get(), &ldvt, prework, &lwork, &info);
+    if (info != 0) {
+      cerr << "Error code from size request to dgesvd was " << info << endl;
+      exit(-2);
+    }
 
-  lwork = (f77int)prework[0];
-  estimate += lwork * sizeof(svdreal);
-  cerr << argv[0] << ": SVD requests " << lwork << " extra space for a grand total of " << estimate / gigabytes << " GB\n";
-  work = new svdreal[lwork];
-
-  cerr << argv[0] << ": Calculating SVD...\n";
-  Timer<WallTimer> timer;
-  timer.start();
-  SVDFUNC(&jobu, &jobvt, &m, &n, A.get(), &lda, S.get(), U.get(), &ldu, Vt.get(), &ldvt, work, &lwork, &info);
-  timer.stop();
-  cerr << argv[0] << ": Done!  Calculation took " << timeAsString(timer.elapsed()) << endl;
-
-  if (info > 0) {
-    cerr << "Convergence error in dgesvd\n";
-    exit(-3);
-  } else if (info < 0) {
-    cerr << "Error in " << info << "th argument to dgesvd\n";
-    exit(-4);
+    lwork = (f77int)prework[0];
+    estimate += lwork * sizeof(svdreal);
+    cerr << argv[0] << ": SVD requests " << lwork << " extra space for a grand total of " << estimate / gigabytes << " GB\n";
+    work = new svdreal[lwork];
+
+    cerr << argv[0] << ": Calculating SVD...\n";
+    Timer<WallTimer> timer;
+    timer.start();
+    SVDFUNC(&jobu, &jobvt, &m, &n, A.get(), &lda, S.get(), U.get(), &ldu, Vt.get(), &ldvt, work, &lwork, &info);
+    timer.stop();
+    cerr << argv[0] << ": Done!  Calculation took " << timeAsString(timer.elapsed()) << endl;
+
+    if (info > 0) {
+      cerr << "Convergence error in dgesvd\n";
+      exit(-3);
+    } else if (info < 0) {
+      cerr << "Error in " << info << "th argument to dgesvd\n";
+      exit(-4);
+    }
   }
 
 
@@ -430,38 +707,36 @@ int main(int argc, char *argv[]) {
 
   if (topts->terms) {
     int terms = static_cast<int>(topts->terms);
-    if (terms > m || terms > sn || terms > n) {
-      cerr << "ERROR- The number of terms requested exceeds matrix dimensions.\n";
-      exit(-1);
-    }
     Usize = Math::Range(m, terms);
     Ssize = Math::Range(terms, 1);
     Vsize = Math::Range(terms, n);
   }
 
   cerr << argv[0] << ": Writing results...\n";
-  writeAsciiMatrix(prefix + "_U.asc", U, header, orig, Usize);
-  writeAsciiMatrix(prefix + "_s.asc", S, header, orig, Ssize);
-
-  if (topts->splitv && tropts->mtraj.size() > 1) {
-    // Need to reconstruct what row-ranges correspond to the input trajectories...
-    uint a = 0;
-    uint curtraj = 0;
-    int terms = topts->terms ? static_cast<int>(topts->terms) : sn;
-
-    for (uint i=0; i<n; ++i) {
-      MultiTrajectory::Location loc = tropts->mtraj.frameIndexToLocation(i);
-      if (loc.first != curtraj) {
-        writeMatrixChunk(popts, tropts, topts, Vt, Math::Range(0, a), Math::Range(terms, i), header, curtraj);
-        a = i;
-        curtraj = loc.first;
+  writeMatrix(prefix + "_U", U, header, orig, Usize, false, topts->binary);
+  writeMatrix(prefix + "_s", S, header, orig, Ssize, false, topts->binary);
+
+  if (topts->rsv) {
+    if (topts->splitv && tropts->mtraj.size() > 1) {
+      // Need to reconstruct what row-ranges correspond to the input trajectories...
+      uint a = 0;
+      uint curtraj = 0;
+      int terms = topts->terms ? static_cast<int>(topts->terms) : sn;
+
+      for (uint i=0; i<n; ++i) {
+        MultiTrajectory::Location loc = tropts->mtraj.frameIndexToLocation(i);
+        if (loc.first != curtraj) {
+          writeMatrixChunk(popts, tropts, topts, Vt, Math::Range(0, a), Math::Range(terms, i), header, curtraj);
+          a = i;
+          curtraj = loc.first;
+        }
       }
-    }
 
-    writeMatrixChunk(popts, tropts, topts, Vt, Math::Range(0, a), Math::Range(terms, n), header, curtraj);
+      writeMatrixChunk(popts, tropts, topts, Vt, Math::Range(0, a), Math::Range(terms, n), header, curtraj);
     
-  } else
-    writeAsciiMatrix(prefix + "_V.asc", Vt, header, orig, Vsize, true);
+    } else
+      writeMatrix(prefix + "_V", Vt, header, orig, Vsize, true, topts->binary);
+  }
   
   cerr << argv[0] << ": done!\n";
 
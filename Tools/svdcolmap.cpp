@@ -30,6 +30,7 @@
 
 
 #include <loos.hpp>
+#include <boost/filesystem.hpp>
 
 
 using namespace std;
@@ -115,6 +116,16 @@ vector<pAtom> getAtoms(AtomicGroup& grp, const vector<int>& ids) {
 
 
 
+// svd may have written either ASCII (.asc) or binary (.bin) matrices
+string svdFilename(const string& prefix, const string& name) {
+  string fname = prefix + name + ".asc";
+  if (!boost::filesystem::exists(fname) && boost::filesystem::exists(prefix + name + ".bin"))
+    fname = prefix + name + ".bin";
+  return(fname);
+}
+
+
+
 int main(int argc, char *argv[]) {
 
 
@@ -147,12 +158,13 @@ int main(int argc, char *argv[]) {
     atoms = getAtoms(model, indices);
   }
 
+  string Uname = svdFilename(ropts->value("svd_prefix"), "_U");
   Matrix U;
-  readAsciiMatrix(ropts->value("svd_prefix") + "_U.asc", U);
+  readMatrix(Uname, U);
   uint m = U.rows();
   uint n = U.cols();
 
-  cerr << "Read in " << m << " x " << n << " matrix from " << ropts->value("svd_prefix") + "_U.asc" << endl;
+  cerr << "Read in " << m << " x " << n << " matrix from " << Uname << endl;
 
   if (m % 3 != 0) {
     cerr << "Error- dimensions of LSVs are bad.\n";
@@ -166,9 +178,10 @@ int main(int argc, char *argv[]) {
     exit(-11);
   }
 
+  string Sname = svdFilename(ropts->value("svd_prefix"), "_s");
   Matrix S;
-  readAsciiMatrix(ropts->value("svd_prefix") + "_s.asc", S);
-  cerr << "Read in " << S.rows() << " singular values from " << ropts->value("svd_prefix") + "_s.asc" << endl;
+  readMatrix(Sname, S);
+  cerr << "Read in " << S.rows() << " singular values from " << Sname << endl;
 
   pAtom pa;
   AtomicGroup::Iterator iter(model);
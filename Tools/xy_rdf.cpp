@@ -43,6 +43,7 @@ int timeseries_interval;
 string output_directory;
 bool sel1_spans, sel2_spans;
 bool reselect_leaflet = false;
+uint nthreads;
 
 
 // @cond TOOLS_INTERNAL
@@ -59,6 +60,7 @@ public:
       ("sel1-spans", "Selection 1 appears in both leaflets")
       ("sel2-spans", "Selection 2 appears in both leaflets")
       ("reselect", "Recompute leaflet location for each frame")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
        ;
 
   }
@@ -119,7 +121,7 @@ public:
   string print() const
   {
     ostringstream oss;
-    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, timeseries=%d, timeseries-directory='%s', sel1-spans=%d, sel2-spans=%d reselect=%d")
+    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, timeseries=%d, timeseries-directory='%s', sel1-spans=%d, sel2-spans=%d reselect=%d, threads=%d")
       % split_by
       % selection1
       % selection2
@@ -130,7 +132,8 @@ public:
       % output_directory
       % sel1_spans
       % sel2_spans
-      % reselect_leaflet;
+      % reselect_leaflet
+      % nthreads;
     return(oss.str());
   }
 
@@ -247,40 +250,257 @@ string s =
     "Note: the 5th column (\"Cum\") is not a density like the other values, \n"
     "but rather the absolute number of molecules of the second selection \n"
     "found around the first selection.\n"
+    "\n"
+    "Only pairs closer than histogram-max are examined (using a cell list),\n"
+    "and frames are divided among the number of threads given by --threads.\n"
     ;
 
     return (s);
     }
 
-void assign_leaflet(vector<AtomicGroup> &molecules,
-                    vector<AtomicGroup> &upper,
-                    vector<AtomicGroup> &lower,
+// Splits the molecules into leaflets, returning the indices of the
+// molecules in each
+void assign_leaflet(const vector<AtomicGroup> &molecules,
+                    vector<uint> &upper,
+                    vector<uint> &lower,
                     const bool spans
                     )
     {
     upper.clear();
     lower.clear();
-    if (spans)
-        {
-        upper = molecules;
-        lower = molecules;
-        return;
-        }
-
     for (unsigned int i = 0; i < molecules.size(); i++)
         {
+        if (spans)
+            {
+            upper.push_back(i);
+            lower.push_back(i);
+            continue;
+            }
+
         GCoord c = molecules[i].centerOfMass();
         if (c.z() >=0.0)
             {
-            upper.push_back(molecules[i]);
+            upper.push_back(i);
             }
         else
             {
-            lower.push_back(molecules[i]);
+            lower.push_back(i);
             }
         }
     }
 
+
+// Splits the selection into molecules, as requested by --split-mode
+vector<AtomicGroup> splitGroup(AtomicGroup &group, const split_mode split)
+    {
+    vector<AtomicGroup> mols;
+    if (split == BY_MOLECULE)
+        {
+        mols = group.splitByMolecule();
+        }
+    else if (split == BY_RESIDUE)
+        {
+        mols = group.splitByResidue();
+        }
+    else if (split == BY_SEGMENT)
+        {
+        mols = group.splitByUniqueSegid();
+        }
+    return(mols);
+    }
+
+
+// @cond TOOLS_INTERNAL
+
+// Histograms and pair counts for one timeseries interval (or the
+// whole trajectory when not writing a timeseries)
+struct Interval
+    {
+    Interval() : hist_upper(num_bins, 0.0), hist_lower(num_bins, 0.0),
+                 area(0.0), upper_pairs(0), lower_pairs(0) { }
+
+    void add(const Interval& other)
+        {
+        for (int i=0; i<num_bins; ++i)
+            {
+            hist_upper[i] += other.hist_upper[i];
+            hist_lower[i] += other.hist_lower[i];
+            }
+        area += other.area;
+        upper_pairs += other.upper_pairs;
+        lower_pairs += other.lower_pairs;
+        }
+
+    vector<double> hist_upper, hist_lower;
+    double area;
+    unsigned long upper_pairs, lower_pairs;
+    };
+
+
+// Histograms the lateral pair distances for one group-1 molecule.
+// The cell list only visits group-2 molecules in nearby cells, so the
+// caller must still check the distance.  Points are indices into the
+// leaflet's list of group-2 molecules.
+struct PairBinner
+    {
+    PairBinner(vector<double>& h, const vector<uint>& leaflet, const vector<uint>& self,
+               const double mn2, const double mx2, const double bw)
+        : hist(h), leaflet2(leaflet), self_pairs(self), min2(mn2), max2(mx2), bin_width(bw) { }
+
+    bool operator()(const uint k, const double d2)
+        {
+        if ( (d2 < max2) && (d2 > min2) )
+            {
+            // skip "self" pairs
+            if (find(self_pairs.begin(), self_pairs.end(), leaflet2[k]) != self_pairs.end())
+                {
+                return(true);
+                }
+            double d = sqrt(d2);
+            int bin = int((d-hist_min)/bin_width);
+            hist[bin]++;
+            }
+        return(true);
+        }
+
+    vector<double>& hist;
+    const vector<uint>& leaflet2;
+    const vector<uint>& self_pairs;
+    double min2, max2, bin_width;
+    };
+
+
+// Accumulates the histograms for one thread's share of the trajectory
+// (see ParallelFrameDriver).  Results are kept separately for each
+// timeseries interval, so they can be written out in order once all
+// threads are done.
+class XYRdfWorker
+    {
+public:
+    XYRdfWorker(const split_mode s, const vector< vector<uint> >* self,
+                const vector<uint>& g1u, const vector<uint>& g1l,
+                const vector<uint>& g2u, const vector<uint>& g2l)
+        : split(s), self_pairs(self),
+          g1_upper(g1u), g1_lower(g1l), g2_upper(g2u), g2_lower(g2l),
+          cells(hist_max)
+        {
+        min2 = hist_min*hist_min;
+        max2 = hist_max*hist_max;
+        bin_width = (hist_max - hist_min)/num_bins;
+        }
+
+    void setup(AtomicGroup& system)
+        {
+        AtomicGroup group1 = selectAtoms(system, selection1);
+        group1.pruneBonds();
+        AtomicGroup group2 = selectAtoms(system, selection2);
+        group2.pruneBonds();
+
+        g1_mols = splitGroup(group1, split);
+        g2_mols = splitGroup(group2, split);
+        box_source = system;
+        }
+
+    // Frame 0 is an interval by itself, then each interval ends with
+    // a frame whose index is a multiple of timeseries_interval.
+    static uint intervalOf(const uint index)
+        {
+        if (!timeseries_interval)
+            {
+            return(0);
+            }
+        return((index + timeseries_interval - 1) / timeseries_interval);
+        }
+
+    void process(const uint index)
+        {
+        GCoord box = box_source.periodicBox(); 
+        Interval& interval = intervals[intervalOf(index)];
+        interval.area += box.x() * box.y();
+
+        if (reselect_leaflet)
+            {
+            assign_leaflet(g1_mols, g1_upper, g1_lower, sel1_spans);
+            assign_leaflet(g2_mols, g2_upper, g2_lower, sel2_spans);
+            }
+
+        // Only the lateral distance matters, so the centers are
+        // projected onto the x-y plane and the cell list only has one
+        // layer in z
+        GCoord lateral_box(box.x(), box.y(), hist_max);
+        g1_centers.resize(g1_mols.size());
+        for (uint j = 0; j < g1_mols.size(); j++)
+            {
+            g1_centers[j] = g1_mols[j].centerOfMass();
+            g1_centers[j].z() = 0.0;
+            }
+        g2_centers.resize(g2_mols.size());
+        for (uint k = 0; k < g2_mols.size(); k++)
+            {
+            g2_centers[k] = g2_mols[k].centerOfMass();
+            g2_centers[k].z() = 0.0;
+            }
+
+        // compute the distribution of g2 around g1 for each leaflet
+        interval.lower_pairs += histogram(g1_lower, g2_lower, lateral_box, interval.hist_lower);
+        interval.upper_pairs += histogram(g1_upper, g2_upper, lateral_box, interval.hist_upper);
+        }
+
+    // Returns the number of (non-self) pairs in the leaflet
+    unsigned long histogram(const vector<uint>& leaflet1, const vector<uint>& leaflet2,
+                            const GCoord& box, vector<double>& hist)
+        {
+        leaflet_centers.resize(leaflet2.size());
+        in_leaflet2.assign(g2_mols.size(), false);
+        for (uint k = 0; k < leaflet2.size(); k++)
+            {
+            leaflet_centers[k] = g2_centers[leaflet2[k]];
+            in_leaflet2[leaflet2[k]] = true;
+            }
+        cells.build(leaflet_centers, box);
+
+        unsigned long pairs = static_cast<unsigned long>(leaflet1.size()) * leaflet2.size();
+        for (uint j = 0; j < leaflet1.size(); j++)
+            {
+            const vector<uint>& self = (*self_pairs)[leaflet1[j]];
+            for (uint m = 0; m < self.size(); m++)
+                {
+                if (in_leaflet2[self[m]])
+                    {
+                    pairs--;
+                    }
+                }
+
+            PairBinner binner(hist, leaflet2, self, min2, max2, bin_width);
+            cells.visitNeighbors(g1_centers[leaflet1[j]], binner);
+            }
+
+        return(pairs);
+        }
+
+    void merge(const XYRdfWorker& other)
+        {
+        for (map<uint, Interval>::const_iterator i = other.intervals.begin(); i != other.intervals.end(); ++i)
+            {
+            intervals[i->first].add(i->second);
+            }
+        }
+
+    split_mode split;
+    const vector< vector<uint> >* self_pairs;
+    vector<uint> g1_upper, g1_lower, g2_upper, g2_lower;
+    AtomicGroup box_source;
+    vector<AtomicGroup> g1_mols, g2_mols;
+    double min2, max2, bin_width;
+    map<uint, Interval> intervals;
+    vector<GCoord> g1_centers, g2_centers, leaflet_centers;
+    vector<bool> in_leaflet2;
+    CellList cells;
+    };
+
+// @endcond
+
+
 int main (int argc, char *argv[])
 {
 
@@ -330,22 +550,12 @@ group2.pruneBonds();
 
 // Split the groups into chunks, depending on how the user asked
 // us to.  
-vector<AtomicGroup> g1_mols, g2_mols;
-if (split == BY_MOLECULE)
-    {
-    g1_mols = group1.splitByMolecule();
-    g2_mols = group2.splitByMolecule();
-    }
-else if (split == BY_RESIDUE)
-    {
-    g1_mols = group1.splitByResidue();
-    g2_mols = group2.splitByResidue();
-    }
-else if (split == BY_SEGMENT)
-    {
-    g1_mols = group1.splitByUniqueSegid();
-    g2_mols = group2.splitByUniqueSegid();
-    }
+vector<AtomicGroup> g1_mols = splitGroup(group1, split);
+vector<AtomicGroup> g2_mols = splitGroup(group2, split);
+
+// Precompute which molecules appear in both selections, so "self"
+// pairs can be skipped
+vector< vector<uint> > self_pairs = matchGroups(g1_mols, g2_mols);
 
 // read the initial coordinates into the system
 traj->updateGroupCoords(system);
@@ -353,120 +563,37 @@ traj->updateGroupCoords(system);
 // Now that we have some real coordinates, we need to subdivide the groups
 // one more time, into upper and lower leaflets. This assumes that the 
 // coordinates are properly centered and imaged.
-vector<AtomicGroup> g1_upper, g1_lower;
-vector<AtomicGroup> g2_upper, g2_lower;
+vector<uint> g1_upper, g1_lower;
+vector<uint> g2_upper, g2_lower;
 
 assign_leaflet(g1_mols, g1_upper, g1_lower, sel1_spans);
 assign_leaflet(g2_mols, g2_upper, g2_lower, sel2_spans);
 
 
-// Create 2 histograms -- one for top, one for bottom
-// Also create 2 histograms to store the total
-vector<double> hist_lower, hist_upper;
-vector<double> hist_lower_total, hist_upper_total;
-hist_lower.reserve(num_bins);
-hist_upper.reserve(num_bins);
-hist_lower_total.reserve(num_bins);
-hist_upper_total.reserve(num_bins);
-hist_lower.insert(hist_lower.begin(), num_bins, 0.0);
-hist_upper.insert(hist_upper.begin(), num_bins, 0.0);
-hist_lower_total.insert(hist_lower_total.begin(), num_bins, 0.0);
-hist_upper_total.insert(hist_upper_total.begin(), num_bins, 0.0);
-
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
-
-// loop over the frames of the traj file
-double area = 0.0;
-double interval_area = 0.0;
-uint cum_upper_pairs = 0;
-uint cum_lower_pairs = 0;
-uint interval_upper_pairs = 0;
-uint interval_lower_pairs = 0;
-
+// loop over the frames of the traj file, dividing them among the threads
 vector<uint> framelist = tropts->frameList();
 uint framecnt = framelist.size();
 
+XYRdfWorker worker(split, &self_pairs, g1_upper, g1_lower, g2_upper, g2_lower);
+ParallelFrameDriver driver(system, traj, nthreads, tropts->traj_type);
+driver.run(worker, framelist);
 
-for (uint index = 0; index<framecnt; ++index) 
-    {
-    // update coordinates and periodic box
-    traj->readFrame(framelist[index]);
-    traj->updateGroupCoords(system);
-    GCoord box = system.periodicBox(); 
-    area += box.x() * box.y();
-    interval_area += box.x() * box.y();
-
-    if (reselect_leaflet)
-        {
-        assign_leaflet(g1_mols, g1_upper, g1_lower, sel1_spans);
-        assign_leaflet(g2_mols, g2_upper, g2_lower, sel2_spans);
-        }
-
-    // compute the distribution of g2 around g1 for the lower leaflet
-    for (unsigned int j = 0; j < g1_lower.size(); j++)
-        {
-        GCoord p1 = g1_lower[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_lower.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_lower[j] == g2_lower[k])
-                {
-                continue;
-                }
-
-            cum_lower_pairs++;
-            interval_lower_pairs++;
-
-            GCoord p2 = g2_lower[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_lower[bin]++;
-                }
-            }
-        }
-
-    // compute the distribution of g2 around g1 for the upper leaflet
-    for (unsigned int j = 0; j < g1_upper.size(); j++)
-        {
-        GCoord p1 = g1_upper[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_upper.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_upper[j] == g2_upper[k])
-                {
-                continue;
-                }
-
-            cum_upper_pairs++;
-            interval_lower_pairs++;
-
-            GCoord p2 = g2_upper[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_upper[bin]++;
-                }
-            }
-        }
 
+// Go through the intervals in order, writing out the timeseries if
+// requested, and summing them for the final histograms
+Interval overall;
+for (map<uint, Interval>::const_iterator iv = worker.intervals.begin(); iv != worker.intervals.end(); ++iv)
+    {
+    const Interval& interval = iv->second;
+    overall.add(interval);
 
-    // if requested, write out timeseries as well
-    if (timeseries_interval && (index % timeseries_interval == 0))
+    // The last interval is only written if it was complete
+    uint index = iv->first * timeseries_interval;
+    if (timeseries_interval && index < framecnt)
         {
-        interval_area /= timeseries_interval;
-        double upper_expected = interval_upper_pairs / interval_area;
-        double lower_expected = interval_lower_pairs / interval_area;
+        double interval_area = interval.area / timeseries_interval;
+        double upper_expected = interval.upper_pairs / interval_area;
+        double lower_expected = interval.lower_pairs / interval_area;
 
 
         // create the output file
@@ -489,20 +616,20 @@ for (uint index = 0; index<framecnt; ++index)
             double norm = M_PI*(d_outer*d_outer - d_inner*d_inner);
 
             double upper = 0.0;
-            if (interval_upper_pairs > 0)
+            if (interval.upper_pairs > 0)
             {
-              upper = hist_upper[m]/(norm*upper_expected);
+              upper = interval.hist_upper[m]/(norm*upper_expected);
             }
 
             double lower = 0.0;
-            if (interval_lower_pairs > 0)
+            if (interval.lower_pairs > 0)
             {
-              lower = hist_lower[m]/(norm*lower_expected);
+              lower = interval.hist_lower[m]/(norm*lower_expected);
             }
 
-            double total = (hist_upper[m] + hist_lower[m])/
+            double total = (interval.hist_upper[m] + interval.hist_lower[m])/
                                 (norm*(upper_expected + lower_expected) );
-            cum += (hist_upper[m] + hist_lower[m])/(group1.size()*timeseries_interval);
+            cum += (interval.hist_upper[m] + interval.hist_lower[m])/(group1.size()*timeseries_interval);
 
             out << d << "\t"
                 << total << "\t"
@@ -514,45 +641,16 @@ for (uint index = 0; index<framecnt; ++index)
 
         out << endl; // blank line for gnuplot
         out.close();
-        
-        // sum up the total histograms
-        for (int i=0; i<num_bins; ++i)
-            {
-            hist_upper_total[i] += hist_upper[i];
-            hist_lower_total[i] += hist_lower[i];
-            }
-
-        // rezero the histograms
-        hist_upper.assign(num_bins, 0.0);
-        hist_lower.assign(num_bins, 0.0);
-
-        // zero out the area
-        interval_area = 0.0;
-        interval_upper_pairs = 0;
-        interval_lower_pairs = 0;
         }
-
     }
 
 // normalize the area
-area /= framecnt;
+double area = overall.area / framecnt;
 
-// If we didn't write timeseries, then we need to copy the interval histograms
-// to the total ones.  If we did, we need to add in the additional data points
-// since the last time we wrote out a times series file
-if (!timeseries_interval)
-    {
-    hist_lower_total = hist_lower;
-    hist_upper_total = hist_upper;
-    }
-else if (framecnt % timeseries_interval != 0)
-    {
-    for (int i=0; i< num_bins; i++)
-        {
-        hist_lower_total[i] += hist_lower[i];
-        hist_upper_total[i] += hist_upper[i];
-        }
-    }
+vector<double>& hist_lower_total = overall.hist_lower;
+vector<double>& hist_upper_total = overall.hist_upper;
+unsigned long cum_upper_pairs = overall.upper_pairs;
+unsigned long cum_lower_pairs = overall.lower_pairs;
 
 double upper_expected = cum_upper_pairs / area;
 double lower_expected = cum_lower_pairs / area;
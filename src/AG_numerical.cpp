@@ -89,8 +89,12 @@ namespace loos {
     if (atoms.size() == 1)
       return(atoms[0]->coords());
 
-    for (i = atoms.begin(); i != atoms.end(); i++)
-      c += (*i)->coords();
+    if (isPacked()) {
+      for (CoordinateStore::const_iterator j = _coordstore->begin(); j != _coordstore->end(); ++j)
+        c += *j;
+    } else
+      for (i = atoms.begin(); i != atoms.end(); i++)
+        c += (*i)->coords();
 
     c /= atoms.size();
     return(c);
@@ -170,10 +174,11 @@ namespace loos {
       c = centroid();
     }
     greal radius = 0.0;
-    const_iterator i;
+    std::vector<GCoord> scratch;
+    const GCoord* crds = contiguousCoords(scratch);
 
-    for (i=atoms.begin(); i != atoms.end(); i++) {
-      greal d = c.distance2((*i)->coords());
+    for (uint i=0; i<atoms.size(); i++) {
+      greal d = c.distance2(crds[i]);
       if (d > radius)
         radius = d;
     }
@@ -189,8 +194,12 @@ namespace loos {
     greal radius = 0;
     const_iterator i;
 
-    for (i = atoms.begin(); i != atoms.end(); i++)
-      radius += c.distance2((*i)->coords());
+    if (isPacked()) {
+      for (CoordinateStore::const_iterator j = _coordstore->begin(); j != _coordstore->end(); ++j)
+        radius += c.distance2(*j);
+    } else
+      for (i = atoms.begin(); i != atoms.end(); i++)
+        radius += c.distance2((*i)->coords());
 
     radius = sqrt(radius / atoms.size());
     return(radius);
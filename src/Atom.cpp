@@ -20,11 +20,55 @@
 */
 
 #include <Atom.hpp>
+#include <CoordinateStore.hpp>
 #include <algorithm>
 #include <boost/format.hpp>
 
 namespace loos {
 
+  Atom::Atom(const Atom& a)
+    : _id(a._id), _index(a._index), _record(a._record), _name(a._name), _altloc(a._altloc),
+      _resname(a._resname), _chainid(a._chainid), _resid(a._resid), _atomic_number(a._atomic_number),
+      _icode(a._icode), _b(a._b), _q(a._q), _charge(a._charge), _mass(a._mass),
+      _segid(a._segid), _pdbelement(a._pdbelement), _atom_type(a._atom_type),
+      _coords(a.coords()), _velocities(a._velocities), mask(a.mask),
+      _coordp(&_coords), bonds(a.bonds)
+  { }
+
+
+  Atom& Atom::operator=(const Atom& a) {
+    if (this == &a)
+      return(*this);
+
+    GCoord c = a.coords();
+    _id = a._id;
+    _index = a._index;
+    _record = a._record;
+    _name = a._name;
+    _altloc = a._altloc;
+    _resname = a._resname;
+    _chainid = a._chainid;
+    _resid = a._resid;
+    _atomic_number = a._atomic_number;
+    _icode = a._icode;
+    _b = a._b;
+    _q = a._q;
+    _charge = a._charge;
+    _mass = a._mass;
+    _segid = a._segid;
+    _pdbelement = a._pdbelement;
+    _atom_type = a._atom_type;
+    _velocities = a._velocities;
+    mask = a.mask;
+    bonds = a.bonds;
+
+    // Assignment only copies coordinate values; any store binding
+    // of this atom is left alone
+    *_coordp = c;
+    return(*this);
+  }
+
+
   int Atom::id(void) const { return(_id); }
   void Atom::id(const int i) { _id = i; }
 
@@ -50,19 +94,19 @@ namespace loos {
     setPropertyBit(anumbit);
   }
 
-  std::string Atom::name(void) const { return(_name); }
+  const std::string& Atom::name(void) const { return(_name); }
   void Atom::name(const std::string s) { _name = s; }
 
   std::string Atom::altLoc(void) const { return(_altloc); }
   void Atom::altLoc(const std::string s) { _altloc = s; }
 
-  std::string Atom::chainId(void) const { return(_chainid); }
+  const std::string& Atom::chainId(void) const { return(_chainid); }
   void Atom::chainId(const std::string s) { _chainid = s; }
 
-  std::string Atom::resname(void) const { return(_resname); }
+  const std::string& Atom::resname(void) const { return(_resname); }
   void Atom::resname(const std::string s) { _resname = s; }
 
-  std::string Atom::segid(void) const { return(_segid); }
+  const std::string& Atom::segid(void) const { return(_segid); }
   void Atom::segid(const std::string s) { _segid = s; }
 
   std::string Atom::iCode(void) const { return(_icode); }
@@ -71,9 +115,30 @@ namespace loos {
   std::string Atom::PDBelement(void) const { return(_pdbelement); }
   void Atom::PDBelement(const std::string s) { _pdbelement = s; }
 
-  const GCoord& Atom::coords(void) const { return(_coords); }
-  GCoord& Atom::coords(void) { setPropertyBit(coordsbit); return(_coords); }
-  void Atom::coords(const GCoord& c) { _coords = c; setPropertyBit(coordsbit); }
+  const GCoord& Atom::coords(void) const { return(*_coordp); }
+  GCoord& Atom::coords(void) { setPropertyBit(coordsbit); return(*_coordp); }
+  void Atom::coords(const GCoord& c) { *_coordp = c; setPropertyBit(coordsbit); }
+
+
+  void Atom::bindCoords(const pCoordinateStore& store, const uint i) {
+    GCoord c = *_coordp;
+    if (_coordstore && _coordstore != store)
+      _coordstore->invalidate();
+    _coordstore = store;
+    _coordp = &((*_coordstore)[i]);
+    *_coordp = c;
+  }
+
+
+  void Atom::unbindCoords() {
+    if (!_coordstore)
+      return;
+
+    _coords = *_coordp;
+    _coordp = &_coords;
+    _coordstore->invalidate();
+    _coordstore.reset();
+  }
 
 
   const GCoord& Atom::velocities() const { return(_velocities); }
@@ -160,7 +225,7 @@ namespace loos {
      checkProperty(Atom::massbit | Atom::chargebit)
      \endverbatim
     */
-  bool Atom::checkProperty(const bits bitmask) { return((mask & bitmask) != 0); }
+  bool Atom::checkProperty(const bits bitmask) const { return((mask & bitmask) != 0); }
 
 
   // DEPRECATED: will likely be removed in future versions of LOOS
@@ -204,6 +269,7 @@ namespace loos {
     _record = "ATOM";
     _atom_type = -1;
     mask = nullbit;   // Nullbit means nothing was set...
+    _coordp = &_coords;
   }
 
   void Atom::setPropertyBit(const bits bitmask) { mask |= bitmask; }
@@ -214,7 +280,7 @@ namespace loos {
   std::ostream& operator<<(std::ostream& os, const loos::Atom& a) {
     os << "<ATOM INDEX='" << a._index << "' ID='" << a._id << "' NAME='" << a._name << "' ";
     os << "RESID='" << a._resid << "' RESNAME='" << a._resname << "' ";
-    os << "COORDS='" << a._coords << "' ";
+    os << "COORDS='" << a.coords() << "' ";
     os << "VELOCITIES='" << a._velocities << "' ";
     os << "ALTLOC='" << a._altloc << "' CHAINID='" << a._chainid << "' ICODE='" << a._icode << "' SEGID='" << a._segid << "' ";
     os << "B='" << a._b << "' Q='" << a._q << "' CHARGE='" << a._charge << "' MASS='" << a._mass << "'";
@@ -41,6 +41,11 @@ namespace loos {
    * coordinate internally.  Bonds are included, but are represented as a
    * vector of atom-id's, which are assumed to be unique per atom...
    *
+   * The coordinates may instead live in a shared CoordinateStore
+   * (see AtomicGroup::packCoords()), in which case coords() is a view
+   * into that store.  Copying an Atom always gives the copy its own
+   * coordinates.
+   *
    * Most properties are derived from the PDB file specification.
    * Exceptions are noted below.  Accessors for each property are
    * provided and should be self-explanatory...
@@ -95,6 +100,10 @@ namespace loos {
       _coords = c;
     }
 
+    //! Copies an atom.  The copy does not share any CoordinateStore
+    Atom(const Atom& a);
+
+    Atom& operator=(const Atom& a);
 
     ~Atom() { }
 
@@ -111,19 +120,19 @@ namespace loos {
     int atomic_number(void) const;
     void atomic_number(const int);
 
-    std::string name(void) const;
+    const std::string& name(void) const;
     void name(const std::string);
 
     std::string altLoc(void) const;
     void altLoc(const std::string);
 
-    std::string chainId(void) const;
+    const std::string& chainId(void) const;
     void chainId(const std::string);
 
-    std::string resname(void) const;
+    const std::string& resname(void) const;
     void resname(const std::string);
 
-    std::string segid(void) const;
+    const std::string& segid(void) const;
     void segid(const std::string);
 
     std::string iCode(void) const;
@@ -155,7 +164,7 @@ namespace loos {
 
     // For python, make sure to return a copy (not a ref), otherwise we
     // get memory errors...
-    GCoord coords(void) { return(_coords); }
+    GCoord coords(void) { return(*_coordp); }
     GCoord velocities() { return(_velocities); }
 
 #endif // !defined(SWIG)
@@ -166,6 +175,25 @@ namespace loos {
     //! Sets the velocities
     void velocities(const GCoord&);
 
+#if !defined(SWIG)
+    //! Redirects the coordinates into slot \a i of a shared CoordinateStore
+    /**
+     * The current coordinates are copied into the store.  If the
+     * atom was bound to a different store, that store is invalidated.
+     * This is normally handled by AtomicGroup::packCoords()...
+     */
+    void bindCoords(const pCoordinateStore& store, const uint i);
+
+    //! Moves the coordinates back into the Atom, invalidating and releasing any CoordinateStore
+    void unbindCoords();
+
+    //! True if the coordinates live in a CoordinateStore
+    bool hasBoundCoords() const { return(_coordstore.get() != 0); }
+
+    //! True if the coordinates live in \a store
+    bool boundTo(const pCoordinateStore& store) const { return(_coordstore == store); }
+#endif // !defined(SWIG)
+
     double bfactor(void) const;
     void bfactor(const double);
 
@@ -230,7 +258,7 @@ namespace loos {
      checkProperty(Atom::massbit | Atom::chargebit)
      \endverbatim
     */
-    bool checkProperty(const bits bitmask);
+    bool checkProperty(const bits bitmask) const;
 
     
     //! Sets user-defined bits
@@ -276,6 +304,11 @@ namespace loos {
     GCoord _velocities;
     unsigned long mask;
 
+    // Where the coordinates actually live, either _coords or a slot
+    // in _coordstore
+    GCoord* _coordp;
+    pCoordinateStore _coordstore;
+
     std::vector<int> bonds;
   };
 
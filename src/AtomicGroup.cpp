@@ -46,6 +46,7 @@ namespace loos {
 
 
   const double AtomicGroup::superposition_zero_singular_value  =  1e-10;
+  const ulong AtomicGroup::cell_list_min_pairs = 65536;
 
 
   AtomicGroup* AtomicGroup::clone(void) const {
@@ -108,6 +109,7 @@ namespace loos {
 
     atoms.erase(iter);
     _sorted = false;
+    _coordstore.reset();
   }
 
 
@@ -119,6 +121,7 @@ namespace loos {
       atoms.push_back(*i);
 
     _sorted = false;
+    _coordstore.reset();
     return(*this);
   }
 
@@ -151,9 +154,10 @@ namespace loos {
   AtomicGroup& AtomicGroup::remove(const AtomicGroup& grp) {
 
 
-    if (&grp == this)
+    if (&grp == this) {
       atoms.clear();      // Assume caller meant to clean out AtomicGroup
-    else {
+      _coordstore.reset();
+    } else {
       std::vector<pAtom>::const_iterator i;
 
       for (i=grp.atoms.begin(); i != grp.atoms.end(); i++)
@@ -176,6 +180,7 @@ namespace loos {
   AtomicGroup& AtomicGroup::operator+=(const pAtom& rhs) {
     atoms.push_back(rhs);
     _sorted = false;
+    _coordstore.reset();
     return(*this);
   }
 
@@ -241,8 +246,10 @@ namespace loos {
   void AtomicGroup::sort(void) {
     CmpById comp;
 
-    if (! _sorted)
+    if (! _sorted) {
       std::sort(atoms.begin(), atoms.end(), comp);
+      _coordstore.reset();
+    }
 
     _sorted = true;
   }
@@ -293,6 +300,7 @@ namespace loos {
     atoms.erase(boost::get<0>(iters), boost::get<1>(iters));
 
     _sorted = false;
+    _coordstore.reset();
 
     res.box = box;
     return(res);
@@ -927,6 +935,12 @@ namespace loos {
       if (! atoms[0]->checkProperty(Atom::indexbit))
         throw(LOOSError(*(atoms[0]), "Cannot use copyCoordinatesWithIndex() on an atom that does not have an index set"));
 
+    if (isPacked() && _coordstore->hasFrameIndices()) {
+      _coordstore->gather(coords);
+      flagPackedCoords();
+      return;
+    }
+
     for (uint i=0; i<atoms.size(); ++i)
     {
       uint index = atoms[i]->index();
@@ -934,6 +948,56 @@ namespace loos {
     }
   }
 
+  void AtomicGroup::packCoords() {
+    pCoordinateStore store(new CoordinateStore(atoms.size()));
+
+    for (uint i=0; i<atoms.size(); ++i) {
+      atoms[i]->bindCoords(store, i);
+      if (atoms[i]->checkProperty(Atom::indexbit))
+        store->frameIndex(i, atoms[i]->index());
+      else
+        store->clearFrameIndices();
+    }
+
+    _coordstore = store;
+  }
+
+
+  void AtomicGroup::unpackCoords() {
+    if (!_coordstore)
+      return;
+
+    // Only release atoms that are still in this group's store; others
+    // may since have been packed by another group...
+    for (iterator i = atoms.begin(); i != atoms.end(); ++i)
+      if ((*i)->boundTo(_coordstore))
+        (*i)->unbindCoords();
+    _coordstore.reset();
+  }
+
+
+  const GCoord* AtomicGroup::contiguousCoords(std::vector<GCoord>& scratch) const {
+    if (isPacked())
+      return(atoms.empty() ? 0 : &((*_coordstore)[0]));
+
+    scratch.resize(atoms.size());
+    for (uint i=0; i<atoms.size(); ++i)
+      scratch[i] = atoms[i]->coords();
+    return(scratch.empty() ? 0 : &(scratch[0]));
+  }
+
+
+  void AtomicGroup::flagPackedCoords() {
+    if (_coordstore->written())
+      return;
+
+    // Taking a non-const ref to an atom's coords flags them as set
+    for (iterator i = atoms.begin(); i != atoms.end(); ++i)
+      (*i)->coords();
+    _coordstore->written(true);
+  }
+
+
   void AtomicGroup::copyVelocitiesWithIndex(const std::vector<GCoord> &velocities) {
     if (! atoms.empty())
       if (! atoms[0]->checkProperty(Atom::indexbit))
@@ -40,6 +40,8 @@
 
 
 #include <Atom.hpp>
+#include <CoordinateStore.hpp>
+#include <CellList.hpp>
 #include <XForm.hpp>
 #include <PeriodicBox.hpp>
 #include <utils.hpp>
@@ -81,6 +83,9 @@ namespace loos {
    * will return true.  The periodic box is shared between the parent
    * group and all derived groups.  AtomicGroup copies have non-shared
    * periodic boxes...
+   *
+   * The coordinates of a group can optionally be packed into a single
+   * contiguous buffer (see packCoords()).
    */
 
 
@@ -94,6 +99,11 @@ namespace loos {
     // the superposition code...
     static const double superposition_zero_singular_value;
 
+    // Number of atom pairs above which distance searches (within(),
+    // contactWith(), findBonds()) switch from a brute-force loop to
+    // a CellList
+    static const ulong cell_list_min_pairs;
+
   public:
     AtomicGroup() : _sorted(false) { }
 
@@ -113,6 +123,7 @@ namespace loos {
     //! Copy constructor (atoms and box shared)
     AtomicGroup(const AtomicGroup& g) :
       _sorted(g._sorted),
+      _coordstore(g._coordstore),
       atoms(g.atoms),
       box(g.box)
       { }
@@ -152,7 +163,7 @@ namespace loos {
 #endif
 
     //! Append the atom onto the group
-    AtomicGroup& append(pAtom pa) { atoms.push_back(pa); _sorted = false; return(*this); }
+    AtomicGroup& append(pAtom pa) { atoms.push_back(pa); _sorted = false; _coordstore.reset(); return(*this); }
     //! Append a vector of atoms
     AtomicGroup& append(std::vector<pAtom> pas);
     //! Append an entire AtomicGroup onto this one (concatenation)
@@ -634,6 +645,37 @@ namespace loos {
     //! Copy coordinates from a vector of GCoords using the atom index as an index into the vector.
     void copyCoordinatesWithIndex(const std::vector<GCoord>& coords);
 
+    //! Copy coordinates from separate x, y, and z arrays using the atom index as an index into them.
+    /**
+     * This is meant for trajectory formats that do not interleave
+     * their coordinates, such as DCDs...
+     */
+    template<typename T>
+    void copyCoordinatesWithIndex(const std::vector<T>& x, const std::vector<T>& y, const std::vector<T>& z) {
+      copyCoordinatesWithIndex(x.empty() ? 0 : &x[0], y.empty() ? 0 : &y[0], z.empty() ? 0 : &z[0], x.size());
+    }
+
+    //! Copy coordinates from separate x, y, and z arrays holding \a n atoms each
+    /**
+     * This allows coordinates to be taken directly from a buffer that
+     * is not a vector (e.g. a memory-mapped file)
+     */
+    template<typename T>
+    void copyCoordinatesWithIndex(const T* x, const T* y, const T* z, const uint n) {
+      if (isPacked() && _coordstore->hasFrameIndices()) {
+        _coordstore->gather(x, y, z, n);
+        flagPackedCoords();
+        return;
+      }
+
+      for (iterator i = atoms.begin(); i != atoms.end(); ++i) {
+        uint idx = (*i)->index();
+        if (idx >= n)
+          throw(LOOSError(**i, "Atom index into trajectory frame is out of bounds"));
+        (*i)->coords(GCoord(x[idx], y[idx], z[idx]));
+      }
+    }
+
     //! Copy velocities from a vector of GCoords using the atom index as an index into the vector.
     /**
      * This can be used to update a group's velocities if they come from a separate trajectory...
@@ -778,16 +820,64 @@ namespace loos {
     std::vector<double> coordsAsVector() const;
 
 
+    //! Pack the coordinates of all atoms into one contiguous buffer
+    /**
+     * Afterwards, each Atom::coords() is a view into a CoordinateStore
+     * laid out in the same order as this group and shared with its
+     * light copies.  Groups selected from this one keep referring into
+     * the store.  The numerical routines on the packed group then
+     * stream over contiguous memory, and updating the packed group from
+     * a trajectory (Trajectory::updateGroupCoords()) copies the frame
+     * straight into the buffer instead of visiting every Atom.
+     *
+     * Typical use is to pack the whole model right after it is read:
+     * \code
+     * AtomicGroup model = createSystem("foo.psf");
+     * model.packCoords();
+     * pTraj traj = createTrajectory("foo.dcd", model);
+     * \endcode
+     *
+     * Changing the membership or order of the group (appending,
+     * removing, sorting, or excising atoms) discards its packed layout,
+     * although the atoms themselves stay in the store.  Do not replace
+     * atoms through operator[] or iterators while a group is packed.
+     *
+     * Packing a group whose atoms are already packed elsewhere (e.g. a
+     * subset selected from a packed model) moves them into the new
+     * store, and the group that owned the old store is no longer
+     * packed.
+     */
+    void packCoords();
+
+    //! Return the coordinates of a packed group to the individual atoms
+    void unpackCoords();
+
+    //! True if this group's coordinates are laid out in a CoordinateStore (see packCoords())
+    bool isPacked() const { return(_coordstore && _coordstore->valid()); }
+
+#if !defined(SWIG)
+    //! The packed coordinates (null if the group is not packed)
+    pCoordinateStore coordinateStore() const { return(_coordstore); }
+#endif
+
+
   private:
 
 	// These are functors for calculating distance between two coords
     // without and with periodicity.  These can be passed to functions
     // that need to support both ways of calculating distances, such
     // was within_private() below...
+    // The functors also know how to build a CellList that uses the
+    // same distance metric.  bin() returns false if that is not possible.
     struct Distance2WithoutPeriodicity {
       double operator()(const GCoord& a, const GCoord& b) const {
         return(a.distance2(b));
       }
+
+      bool bin(CellList& cells, const GCoord* crds, const uint n) const {
+        cells.build(crds, n);
+        return(true);
+      }
     };
 
     struct Distance2WithPeriodicity {
@@ -797,10 +887,57 @@ namespace loos {
         return(a.distance2(b, _box));
       }
 
+      bool bin(CellList& cells, const GCoord* crds, const uint n) const {
+        if (_box.x() <= 0.0 || _box.y() <= 0.0 || _box.z() <= 0.0)
+          return(false);
+        cells.build(crds, n, _box);
+        return(true);
+      }
+
       GCoord _box;
     };
 
 
+    // Visitors for CellList searches in the routines below
+
+    struct AnyPairWithin {
+      AnyPairWithin(const double d2) : dist2(d2), found(false) { }
+      bool operator()(const uint i, const double d) {
+        found = (d <= dist2);
+        return(!found);
+      }
+      double dist2;
+      bool found;
+    };
+
+    struct CountPairsWithin {
+      CountPairsWithin(const double d2, const uint m, const uint n) : dist2(d2), max(m), count(n) { }
+      bool operator()(const uint i, const double d) {
+        if (d <= dist2)
+          ++count;
+        return(count < max);
+      }
+      double dist2;
+      uint max, count;
+    };
+
+    struct BondPartners {
+      BondPartners(const double d2, const uint j, std::vector<uint>& p) : dist2(d2), self(j), partners(p) { }
+      bool operator()(const uint i, const double d) {
+        if (i > self && d < dist2)
+          partners.push_back(i);
+        return(true);
+      }
+      double dist2;
+      uint self;
+      std::vector<uint>& partners;
+    };
+
+    bool useCellList(const double dist, const uint n) const {
+      return(dist > 0.0 && static_cast<ulong>(size()) * n >= cell_list_min_pairs);
+    }
+
+
 
     // Find all atoms in the current group that are within dist
     // angstroms of any atom in the passed group.  The distance
@@ -817,16 +954,33 @@ namespace loos {
       double dist2 = dist * dist;
       std::vector<uint> indices;
 
-      for (uint j=0; j<size(); j++) {
-        GCoord c = atoms[j]->coords();
-        for (uint i=0; i<grp.size(); i++) {
-          if (distance_functor(c, grp.atoms[i]->coords()) <= dist2) {
-            indices.push_back(j);
-            break;
+      std::vector<GCoord> scratch;
+      const GCoord* grpcrds = grp.contiguousCoords(scratch);
+
+      bool searched = false;
+      if (useCellList(dist, grp.size())) {
+        CellList cells(dist);
+        searched = distance_functor.bin(cells, grpcrds, grp.size());
+        if (searched)
+          for (uint j=0; j<size(); j++) {
+            AnyPairWithin op(dist2);
+            cells.visitNeighbors(atoms[j]->coords(), op);
+            if (op.found)
+              indices.push_back(j);
           }
-        }
       }
 
+      if (!searched)
+        for (uint j=0; j<size(); j++) {
+          GCoord c = atoms[j]->coords();
+          for (uint i=0; i<grp.size(); i++) {
+            if (distance_functor(c, grpcrds[i]) <= dist2) {
+              indices.push_back(j);
+              break;
+            }
+          }
+        }
+
       if (indices.size() == 0)
         return(res);
 
@@ -842,10 +996,24 @@ namespace loos {
       double dist2 = dist * dist;
       uint ncontacts = 0;
 
+      std::vector<GCoord> scratch;
+      const GCoord* grpcrds = grp.contiguousCoords(scratch);
+
+      if (useCellList(dist, grp.size())) {
+        CellList cells(dist);
+        if (distance_function.bin(cells, grpcrds, grp.size())) {
+          CountPairsWithin op(dist2, std::max(min_contacts, 1u), 0);
+          for (uint j = 0; j<size(); ++j)
+            if (!cells.visitNeighbors(atoms[j]->coords(), op))
+              return(true);
+          return(false);
+        }
+      }
+
       for (uint j = 0; j<size(); ++j) {
 	GCoord c = atoms[j]->coords();
 	for (uint i = 0; i<grp.size(); ++i)
-	  if (distance_function(c, grp.atoms[i]->coords()) <= dist2)
+	  if (distance_function(c, grpcrds[i]) <= dist2)
 	    if (++ncontacts >= min_contacts)
 	      return(true);
       }
@@ -859,19 +1027,41 @@ namespace loos {
 	   */
 	  template<typename DistanceCalc>
 	  void findBondsImpl(const double dist, const DistanceCalc& distance_function) {
-		  iterator ij;
 		  double dist2 = dist * dist;
 		  double current_dist2;
 
-		  for (ij = begin(); ij != end() - 1; ++ij) {
-			  iterator ii;
-			  GCoord u = (*ij)->coords();
+		  std::vector<GCoord> scratch;
+		  const GCoord* crds = contiguousCoords(scratch);
+		  uint n = size();
+
+		  // Bonds are added in the same order as the brute-force
+		  // search would add them
+		  if (useCellList(dist, n)) {
+			  CellList cells(dist);
+			  if (distance_function.bin(cells, crds, n)) {
+				  std::vector<uint> partners;
+				  for (uint j = 0; j + 1 < n; ++j) {
+					  partners.clear();
+					  BondPartners op(dist2, j, partners);
+					  cells.visitNeighbors(crds[j], op);
+					  std::sort(partners.begin(), partners.end());
+					  for (std::vector<uint>::const_iterator i = partners.begin(); i != partners.end(); ++i) {
+						  atoms[j]->addBond(atoms[*i]);
+						  atoms[*i]->addBond(atoms[j]);
+					  }
+				  }
+				  return;
+			  }
+		  }
 
-			  for (ii = ij + 1; ii != end(); ++ii) {
-				  current_dist2 = distance_function(u, (*ii)->coords());
+		  for (uint j = 0; j + 1 < n; ++j) {
+			  GCoord u = crds[j];
+
+			  for (uint i = j + 1; i < n; ++i) {
+				  current_dist2 = distance_function(u, crds[i]);
 				  if (current_dist2 < dist2) {
-					  (*ij)->addBond(*ii);
-					  (*ii)->addBond(*ij);
+					  atoms[j]->addBond(atoms[i]);
+					  atoms[i]->addBond(atoms[j]);
 				  }
 			  }
 		  }
@@ -890,7 +1080,7 @@ namespace loos {
 
     int rangeCheck(int) const;
 
-    void addAtom(pAtom pa) { atoms.push_back(pa); _sorted = false; }
+    void addAtom(pAtom pa) { atoms.push_back(pa); _sorted = false; _coordstore.reset(); }
     void deleteAtom(pAtom pa);
 
     boost::tuple<iterator, iterator> calcSubsetIterators(const int offset, const int len = 0);
@@ -918,7 +1108,17 @@ namespace loos {
     double *coordsAsArray(void) const;
     double *transformedCoordsAsArray(const XForm&) const;
 
+    // Returns a pointer to the group's coordinates as a contiguous
+    // array.  This is the CoordinateStore for a packed group,
+    // otherwise the coordinates are gathered into scratch.
+    const GCoord* contiguousCoords(std::vector<GCoord>& scratch) const;
+
+    // Marks the atoms as having coordinates the first time a packed
+    // store is filled from a trajectory
+    void flagPackedCoords();
+
     bool _sorted;
+    pCoordinateStore _coordstore;
 
 
   protected:
@@ -0,0 +1,312 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <algorithm>
+
+#include <CellList.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+
+  // Helper visitors for the canned queries...
+
+  namespace {
+
+    struct CollectWithin {
+      CollectWithin(const double i2, const double o2, std::vector<uint>& r) : inner2(i2), outer2(o2), result(r) { }
+      bool operator()(const uint i, const double d) {
+        if (d >= inner2 && d <= outer2)
+          result.push_back(i);
+        return(true);
+      }
+
+      double inner2, outer2;
+      std::vector<uint>& result;
+    };
+
+
+    struct AnyWithin {
+      AnyWithin(const double d2) : dist2(d2), found(false) { }
+      bool operator()(const uint i, const double d) {
+        if (d <= dist2)
+          found = true;
+        return(!found);
+      }
+
+      double dist2;
+      bool found;
+    };
+
+
+    struct CountWithin {
+      CountWithin(const double i2, const double o2) : inner2(i2), outer2(o2), count(0) { }
+      bool operator()(const uint i, const double d) {
+        if (d >= inner2 && d <= outer2)
+          ++count;
+        return(true);
+      }
+
+      double inner2, outer2;
+      uint count;
+    };
+
+  }
+
+
+
+  CellList::CellList(const double cutoff) : _cutoff(cutoff), _periodic(false) {
+    if (cutoff <= 0.0)
+      throw(LOOSError("CellList cutoff must be positive"));
+
+    for (uint k=0; k<3; ++k) {
+      _origin[k] = 0.0;
+      _width[k] = cutoff;
+      _dims[k] = 1;
+    }
+    _start.assign(2, 0);
+  }
+
+
+
+  void CellList::build(const GCoord* crds, const uint n) {
+    _periodic = false;
+
+    if (n > 0) {
+      double lo[3] = { crds[0].x(), crds[0].y(), crds[0].z() };
+      double hi[3] = { lo[0], lo[1], lo[2] };
+      for (uint i=1; i<n; ++i) {
+        double p[3] = { crds[i].x(), crds[i].y(), crds[i].z() };
+        for (uint k=0; k<3; ++k) {
+          if (p[k] < lo[k])
+            lo[k] = p[k];
+          if (p[k] > hi[k])
+            hi[k] = p[k];
+        }
+      }
+
+      for (uint k=0; k<3; ++k) {
+        double extent = hi[k] - lo[k];
+        _origin[k] = lo[k];
+        _dims[k] = std::max(1, static_cast<int>(extent / _cutoff));
+      }
+      limitCells(n);
+      for (uint k=0; k<3; ++k)
+        _width[k] = std::max((hi[k] - lo[k]) / _dims[k], _cutoff);
+    }
+
+    bin(crds, n);
+  }
+
+
+  void CellList::build(const GCoord* crds, const uint n, const GCoord& box) {
+    for (uint k=0; k<3; ++k)
+      if (box[k] <= 0.0)
+        throw(LOOSError("CellList requires a periodic box with positive dimensions"));
+
+    _periodic = true;
+    _box = box;
+    for (uint k=0; k<3; ++k) {
+      _origin[k] = 0.0;
+      _dims[k] = std::max(1, static_cast<int>(box[k] / _cutoff));
+    }
+    limitCells(n);
+    for (uint k=0; k<3; ++k)
+      _width[k] = box[k] / _dims[k];
+
+    bin(crds, n);
+  }
+
+
+  void CellList::build(const AtomicGroup& grp) {
+    if (grp.isPacked()) {
+      build(grp.empty() ? 0 : &((*grp.coordinateStore())[0]), grp.size());
+      return;
+    }
+
+    _scratch.resize(grp.size());
+    for (uint i=0; i<grp.size(); ++i)
+      _scratch[i] = grp[i]->coords();
+    build(_scratch);
+  }
+
+
+  void CellList::build(const AtomicGroup& grp, const GCoord& box) {
+    if (grp.isPacked()) {
+      build(grp.empty() ? 0 : &((*grp.coordinateStore())[0]), grp.size(), box);
+      return;
+    }
+
+    _scratch.resize(grp.size());
+    for (uint i=0; i<grp.size(); ++i)
+      _scratch[i] = grp[i]->coords();
+    build(_scratch, box);
+  }
+
+
+
+  // Cells can only grow (so they stay at least as wide as the cutoff),
+  // and very sparse or very large systems would otherwise end up with
+  // many more cells than points.  Halve the longest dimension until
+  // the grid is comparable in size to the number of points.
+  void CellList::limitCells(const uint n) {
+    double max_cells = 2.0 * n + 27.0;
+
+    while (static_cast<double>(_dims[0]) * _dims[1] * _dims[2] > max_cells) {
+      uint k = 0;
+      if (_dims[1] > _dims[k])
+        k = 1;
+      if (_dims[2] > _dims[k])
+        k = 2;
+      _dims[k] = (_dims[k] + 1) / 2;
+    }
+  }
+
+
+
+  // Counting-sort the points into cells, keeping a copy of the
+  // coordinates in cell order so the queries walk contiguous memory
+  void CellList::bin(const GCoord* crds, const uint n) {
+    uint ncells = _dims[0] * _dims[1] * _dims[2];
+
+    _start.assign(ncells + 1, 0);
+    _cellof.resize(n);
+    _order.resize(n);
+    _crds.resize(n);
+
+    for (uint i=0; i<n; ++i) {
+      double p[3] = { crds[i].x(), crds[i].y(), crds[i].z() };
+      int idx[3];
+      for (uint k=0; k<3; ++k) {
+        double x = p[k];
+        if (_periodic)
+          x -= _box[k] * floor(x / _box[k]);
+        else
+          x -= _origin[k];
+
+        idx[k] = static_cast<int>(x / _width[k]);
+        if (idx[k] >= _dims[k])
+          idx[k] = _dims[k] - 1;
+        else if (idx[k] < 0)
+          idx[k] = 0;
+      }
+
+      uint cell = (idx[2] * _dims[1] + idx[1]) * _dims[0] + idx[0];
+      _cellof[i] = cell;
+      ++_start[cell+1];
+    }
+
+    for (uint c=0; c<ncells; ++c)
+      _start[c+1] += _start[c];
+
+    // _start[c] is used as a fill-pointer and restored afterwards
+    for (uint i=0; i<n; ++i) {
+      uint s = _start[_cellof[i]]++;
+      _order[s] = i;
+      _crds[s] = crds[i];
+    }
+
+    for (uint c=ncells; c>0; --c)
+      _start[c] = _start[c-1];
+    _start[0] = 0;
+  }
+
+
+
+  // Determine which cells along dimension k must be searched for
+  // a query at x.  Returns the number of cells (1-3) stored in cells.
+  uint CellList::neighborCells(const double x, const uint k, int* cells) const {
+    int d = _dims[k];
+
+    if (_periodic) {
+      double y = x - _box[k] * floor(x / _box[k]);
+      int i = static_cast<int>(y / _width[k]);
+      if (i >= d)
+        i = d - 1;
+
+      // With fewer than 3 cells, every cell is a neighbor
+      if (d < 3) {
+        for (int j=0; j<d; ++j)
+          cells[j] = j;
+        return(d);
+      }
+
+      cells[0] = (i + d - 1) % d;
+      cells[1] = i;
+      cells[2] = (i + 1) % d;
+      return(3);
+    }
+
+    // Points at the upper edge were binned into the last cell, so a
+    // query beyond the grid must still see it...
+    double y = (x - _origin[k]) / _width[k];
+    int i = (y < -1.0) ? -2 : (y > d) ? d : static_cast<int>(floor(y));
+
+    uint m = 0;
+    for (int j = i-1; j <= i+1; ++j)
+      if (j >= 0 && j < d)
+        cells[m++] = j;
+
+    return(m);
+  }
+
+
+
+  void CellList::checkCutoff(const double dist) const {
+    if (dist > _cutoff)
+      throw(LOOSError("CellList queried with a distance larger than its cutoff"));
+  }
+
+
+  std::vector<uint> CellList::within(const GCoord& c, const double inner, const double outer) const {
+    checkCutoff(outer);
+
+    std::vector<uint> result;
+    CollectWithin op(inner * inner, outer * outer, result);
+    visitNeighbors(c, op);
+    std::sort(result.begin(), result.end());
+
+    return(result);
+  }
+
+
+  bool CellList::anyWithin(const GCoord& c, const double dist) const {
+    checkCutoff(dist);
+
+    AnyWithin op(dist * dist);
+    visitNeighbors(c, op);
+    return(op.found);
+  }
+
+
+  uint CellList::countWithin(const GCoord& c, const double inner, const double outer) const {
+    checkCutoff(outer);
+
+    CountWithin op(inner * inner, outer * outer);
+    visitNeighbors(c, op);
+    return(op.count);
+  }
+
+
+}
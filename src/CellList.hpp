@@ -0,0 +1,167 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_CELL_LIST_HPP)
+#define LOOS_CELL_LIST_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+#include <Coord.hpp>
+
+
+namespace loos {
+
+  class AtomicGroup;
+
+
+  //! Spatial binning of coordinates for fixed-cutoff neighbor searches
+  /**
+   * A CellList divides space into cells that are at least as wide as
+   * the cutoff and sorts a set of coordinates into them.  All points
+   * within the cutoff of a query point are then guaranteed to lie in
+   * the query's cell or one of its 26 neighbors, so finding neighbors
+   * of M points among N binned ones costs O(N+M) rather than O(N*M).
+   *
+   * The list may be built with or without periodicity.  When a
+   * periodic box is given, cells wrap around the box and all
+   * distances are minimum-image distances (i.e. GCoord::distance2(c, box)),
+   * so results are identical to a brute-force search.  The cutoff
+   * passed to the queries must not exceed the one the list was
+   * constructed with.
+   *
+   * The list owns its buffers and reuses them across calls to build(),
+   * so the typical use is to keep one around and rebuild it each frame:
+   * \code
+   * CellList cells(4.5);
+   * while (traj->readFrame()) {
+   *   traj->updateGroupCoords(model);
+   *   cells.build(solvent, model.periodicBox());
+   *   for (AtomicGroup::iterator i = protein.begin(); i != protein.end(); ++i)
+   *     nearby += cells.within((*i)->coords(), 4.5).size();
+   * }
+   * \endcode
+   *
+   * The indices returned refer to the order of the coordinates (or
+   * atoms) passed to build().
+   */
+  class CellList {
+  public:
+    explicit CellList(const double cutoff);
+
+    double cutoff() const { return(_cutoff); }
+
+    //! Bin coordinates without periodicity
+    void build(const GCoord* crds, const uint n);
+
+    //! Bin coordinates using the periodic box
+    void build(const GCoord* crds, const uint n, const GCoord& box);
+
+    void build(const std::vector<GCoord>& crds) { build(crds.empty() ? 0 : &(crds[0]), crds.size()); }
+    void build(const std::vector<GCoord>& crds, const GCoord& box) { build(crds.empty() ? 0 : &(crds[0]), crds.size(), box); }
+
+    //! Bin the coordinates of the atoms in a group without periodicity
+    void build(const AtomicGroup& grp);
+
+    //! Bin the coordinates of the atoms in a group using the periodic box
+    void build(const AtomicGroup& grp, const GCoord& box);
+
+
+    //! Number of binned points
+    uint size() const { return(_order.size()); }
+
+    bool isPeriodic() const { return(_periodic); }
+
+
+    //! Calls \a visitor for each binned point that may be within the cutoff of \a c
+    /**
+     * The visitor is called as visitor(index, d2) where index is the
+     * index of the binned point and d2 is its squared distance from
+     * \a c.  Points beyond the cutoff may also be visited, so the
+     * caller must test d2 itself.  Returning false from the visitor
+     * stops the search, in which case visitNeighbors() also returns
+     * false.
+     */
+    template<typename Visitor>
+    bool visitNeighbors(const GCoord& c, Visitor& visitor) const {
+      if (_order.empty())
+        return(true);
+
+      int cells[3][3];
+      uint ncells[3];
+      ncells[0] = neighborCells(c.x(), 0, cells[0]);
+      ncells[1] = neighborCells(c.y(), 1, cells[1]);
+      ncells[2] = neighborCells(c.z(), 2, cells[2]);
+
+      for (uint a=0; a<ncells[2]; ++a)
+        for (uint b=0; b<ncells[1]; ++b)
+          for (uint d=0; d<ncells[0]; ++d) {
+            uint cell = (cells[2][a] * _dims[1] + cells[1][b]) * _dims[0] + cells[0][d];
+            for (uint s = _start[cell]; s < _start[cell+1]; ++s)
+              if (!visitor(_order[s], distance2(c, _crds[s])))
+                return(false);
+          }
+
+      return(true);
+    }
+
+
+    //! Indices of all binned points within \a dist of \a c
+    std::vector<uint> within(const GCoord& c, const double dist) const { return(within(c, 0.0, dist)); }
+
+    //! Indices of all binned points whose distance from \a c is in [inner, outer]
+    std::vector<uint> within(const GCoord& c, const double inner, const double outer) const;
+
+    //! True if any binned point is within \a dist of \a c
+    bool anyWithin(const GCoord& c, const double dist) const;
+
+    //! Number of binned points whose distance from \a c is in [inner, outer]
+    uint countWithin(const GCoord& c, const double inner, const double outer) const;
+
+
+  private:
+    void checkCutoff(const double dist) const;
+    void bin(const GCoord* crds, const uint n);
+    void limitCells(const uint n);
+    uint neighborCells(const double x, const uint k, int* cells) const;
+
+    double distance2(const GCoord& a, const GCoord& b) const {
+      return(_periodic ? a.distance2(b, _box) : a.distance2(b));
+    }
+
+    double _cutoff;
+    bool _periodic;
+    GCoord _box;
+    double _origin[3], _width[3];
+    int _dims[3];
+
+    std::vector<uint> _start;     // Offset into _order/_crds for each cell
+    std::vector<uint> _order;     // Index of each binned point, sorted by cell
+    std::vector<GCoord> _crds;    // Coordinates, sorted by cell
+    std::vector<uint> _cellof;    // Scratch: cell of each input point
+    std::vector<GCoord> _scratch; // Scratch: gathered coordinates for an AtomicGroup
+  };
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_COORDINATE_STORE_HPP)
+#define LOOS_COORDINATE_STORE_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/utility.hpp>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+#include <Coord.hpp>
+
+
+namespace loos {
+
+
+  //! Contiguous block of coordinates shared by a set of Atoms
+  /**
+   * A CoordinateStore is created by AtomicGroup::packCoords().  Each
+   * packed Atom has its coordinates redirected into one slot of the
+   * store, so Atom::coords() becomes a view into a single contiguous
+   * array rather than a value embedded in each heap-allocated Atom.
+   *
+   * The store also remembers the trajectory frame index (i.e.
+   * Atom::index()) for each slot, so a frame can be copied into it
+   * with one pass over contiguous memory (or a straight copy when
+   * slot i always comes from frame index i) without touching the
+   * Atoms themselves.
+   */
+  class CoordinateStore : public boost::noncopyable {
+  public:
+    typedef std::vector<GCoord>::iterator         iterator;
+    typedef std::vector<GCoord>::const_iterator   const_iterator;
+
+    explicit CoordinateStore(const uint n) : _coords(n), _indices(n, 0), _maxindex(0),
+                                             _indexed(true), _identity(true), _written(false),
+                                             _valid(true) { }
+
+    uint size() const { return(_coords.size()); }
+
+    GCoord& operator[](const uint i) { return(_coords[i]); }
+    const GCoord& operator[](const uint i) const { return(_coords[i]); }
+
+    iterator begin() { return(_coords.begin()); }
+    iterator end() { return(_coords.end()); }
+    const_iterator begin() const { return(_coords.begin()); }
+    const_iterator end() const { return(_coords.end()); }
+
+
+    //! Sets the trajectory frame index that slot \a i is read from
+    void frameIndex(const uint i, const uint idx) {
+      _indices[i] = idx;
+      if (idx > _maxindex)
+        _maxindex = idx;
+      if (idx != i)
+        _identity = false;
+    }
+
+    //! Flags the store as not having valid frame indices (e.g. atoms without an index)
+    void clearFrameIndices() { _indexed = false; _identity = false; }
+
+    //! True if every slot has a valid frame index
+    bool hasFrameIndices() const { return(_indexed); }
+
+    //! True if slot i is always read from frame index i
+    bool identityMapped() const { return(_identity); }
+
+    //! False once an Atom has been moved out of the store
+    bool valid() const { return(_valid); }
+    void invalidate() { _valid = false; }
+
+    //! Whether or not the store has been filled from a trajectory
+    bool written() const { return(_written); }
+    void written(const bool b) { _written = b; }
+
+
+    //! Copies coordinates out of a frame using the stored frame indices
+    void gather(const std::vector<GCoord>& frame) {
+      checkFrame(frame.size());
+
+      if (_identity)
+        std::copy(frame.begin(), frame.begin() + _coords.size(), _coords.begin());
+      else
+        for (uint i=0; i<_coords.size(); ++i)
+          _coords[i] = frame[_indices[i]];
+    }
+
+    //! Copies coordinates out of a frame stored as separate x, y, and z arrays (e.g. a DCD)
+    template<typename T>
+    void gather(const std::vector<T>& x, const std::vector<T>& y, const std::vector<T>& z) {
+      gather(x.empty() ? 0 : &x[0], y.empty() ? 0 : &y[0], z.empty() ? 0 : &z[0], x.size());
+    }
+
+    //! Copies coordinates out of separate x, y, and z arrays of n atoms each
+    template<typename T>
+    void gather(const T* x, const T* y, const T* z, const uint n) {
+      checkFrame(n);
+
+      for (uint i=0; i<_coords.size(); ++i) {
+        uint j = _indices[i];
+        _coords[i].set(x[j], y[j], z[j]);
+      }
+    }
+
+
+  private:
+    void checkFrame(const uint n) const {
+      if (!_indexed)
+        throw(LOOSError("Packed coordinates have no atom indices and cannot be read from a trajectory"));
+      if (!_coords.empty() && _maxindex >= n)
+        throw(LOOSError("Atom index into trajectory frame is out of bounds"));
+    }
+
+
+    std::vector<GCoord> _coords;
+    std::vector<uint> _indices;
+    uint _maxindex;
+    bool _indexed, _identity, _written, _valid;
+  };
+
+
+}
+
+#endif
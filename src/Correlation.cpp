@@ -0,0 +1,301 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include <exception>
+
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <Correlation.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  FFTCorrelator::FFTCorrelator(const uint n, const uint maxlag) : _n(n), _maxlag(maxlag), _m(1) {
+    if (n == 0)
+      throw(LOOSError("Cannot correlate an empty series"));
+    if (maxlag > n)
+      throw(LOOSError("Can't take correlation time longer than time series"));
+
+    // Lags up to maxlag-1 must not wrap around onto the other end of
+    // the series...
+    ulong needed = static_cast<ulong>(n) + (maxlag > 0 ? maxlag - 1 : 0);
+    uint bits = 0;
+    while (_m < needed) {
+      _m <<= 1;
+      ++bits;
+    }
+
+    _bitrev.resize(_m);
+    for (uint i=0; i<_m; ++i) {
+      uint r = 0;
+      for (uint b=0; b<bits; ++b)
+        if (i & (1u << b))
+          r |= 1u << (bits - b - 1);
+      _bitrev[i] = r;
+    }
+
+    _twiddle.resize(_m / 2 + 1);
+    for (uint k=0; k<_twiddle.size(); ++k) {
+      double theta = -2.0 * M_PI * k / _m;
+      _twiddle[k] = std::complex<double>(cos(theta), sin(theta));
+    }
+
+    _work.resize(_m);
+  }
+
+
+  // In-place radix-2 transform of the workspace.  The inverse is not
+  // scaled.
+
+  void FFTCorrelator::transform(const bool inverse) {
+    for (uint i=0; i<_m; ++i)
+      if (i < _bitrev[i])
+        std::swap(_work[i], _work[_bitrev[i]]);
+
+    for (uint len = 2; len <= _m; len <<= 1) {
+      uint half = len / 2;
+      uint stride = _m / len;
+      for (uint i=0; i<_m; i += len)
+        for (uint j=0; j<half; ++j) {
+          std::complex<double> w = inverse ? std::conj(_twiddle[j * stride]) : _twiddle[j * stride];
+          std::complex<double> t = w * _work[i + j + half];
+          _work[i + j + half] = _work[i + j] - t;
+          _work[i + j] += t;
+        }
+    }
+  }
+
+
+  void FFTCorrelator::autocorrelate(const double* x, double* c) {
+    for (uint i=0; i<_n; ++i)
+      _work[i] = std::complex<double>(x[i], 0.0);
+    std::fill(_work.begin() + _n, _work.end(), std::complex<double>(0.0, 0.0));
+
+    transform(false);
+    for (uint i=0; i<_m; ++i)
+      _work[i] = std::norm(_work[i]);
+    transform(true);
+
+    for (uint k=0; k<_maxlag; ++k)
+      c[k] = _work[k].real() / _m;
+  }
+
+
+  void FFTCorrelator::autocorrelate(const double* x, const double* y, double* cx, double* cy) {
+    for (uint i=0; i<_n; ++i)
+      _work[i] = std::complex<double>(x[i], y[i]);
+    std::fill(_work.begin() + _n, _work.end(), std::complex<double>(0.0, 0.0));
+
+    transform(false);
+
+    // Separate the transforms of x and y from Z, using
+    //   X[k] = (Z[k] + Z*[m-k]) / 2  and  Y[k] = (Z[k] - Z*[m-k]) / 2i
+    // The power spectra are real and even, so both inverse transforms
+    // are real and can share one complex transform.
+    for (uint i=0; i<=_m/2; ++i) {
+      uint j = (_m - i) & (_m - 1);
+      std::complex<double> zi = _work[i];
+      std::complex<double> zj = std::conj(_work[j]);
+      double px = std::norm(zi + zj) / 4.0;
+      double py = std::norm(zi - zj) / 4.0;
+      _work[i] = _work[j] = std::complex<double>(px, py);
+    }
+    transform(true);
+
+    for (uint k=0; k<_maxlag; ++k) {
+      cx[k] = _work[k].real() / _m;
+      cy[k] = _work[k].imag() / _m;
+    }
+  }
+
+
+
+  void directAutocorrelation(const double* x, const uint n, const uint maxlag, double* c) {
+    for (uint k=0; k<maxlag; ++k) {
+      double sum = 0.0;
+      for (uint j=0; j+k<n; ++j)
+        sum += x[j] * x[j+k];
+      c[k] = sum;
+    }
+  }
+
+
+
+  namespace {
+
+    // Series i and j (if j != i) are correlated together
+    typedef std::pair<uint, uint>    SeriesPair;
+
+
+    struct CorrelationWorker {
+      CorrelationWorker(const std::vector< std::vector<double> >* s, const std::vector<SeriesPair>* p,
+                        std::vector< std::vector<double> >* r, const uint l, const bool nrm,
+                        const double t, const bool d, const uint f, const uint st, std::string* e)
+        : series(s), pairs(p), results(r), maxlag(l), normalize(nrm), tol(t), direct(d),
+          first(f), stride(st), error(e) { }
+
+
+      // Returns false if the series is constant
+      bool prepare(const std::vector<double>& src, std::vector<double>& dst) {
+        dst = src;
+        if (!normalize)
+          return(true);
+
+        double n = dst.size();
+        double avg = 0.0;
+        for (uint i=0; i<dst.size(); ++i)
+          avg += dst[i];
+        avg /= n;
+
+        double var = 0.0;
+        for (uint i=0; i<dst.size(); ++i) {
+          dst[i] -= avg;
+          var += dst[i] * dst[i];
+        }
+        double dev = sqrt(var / n);
+        if (dev < tol)
+          return(false);
+
+        for (uint i=0; i<dst.size(); ++i)
+          dst[i] /= dev;
+        return(true);
+      }
+
+
+      void finish(const uint i, const bool constant) {
+        std::vector<double>& c = (*results)[i];
+        uint n = (*series)[i].size();
+        if (constant)
+          c.assign(maxlag, 1.0);
+        else
+          for (uint k=0; k<maxlag; ++k)
+            c[k] /= (n - k);
+      }
+
+
+      void operator()() {
+        try {
+          std::vector<double> x, y;
+          for (uint p = first; p < pairs->size(); p += stride) {
+            uint i = (*pairs)[p].first;
+            uint j = (*pairs)[p].second;
+            uint n = (*series)[i].size();
+
+            (*results)[i].resize(maxlag);
+            bool xc = !prepare((*series)[i], x);
+            bool yc = false;
+            if (j != i) {
+              (*results)[j].resize(maxlag);
+              yc = !prepare((*series)[j], y);
+            }
+
+            if (direct) {
+              directAutocorrelation(&x[0], n, maxlag, &((*results)[i][0]));
+              if (j != i)
+                directAutocorrelation(&y[0], n, maxlag, &((*results)[j][0]));
+            } else {
+              if (!fft || fft->size() != n)
+                fft = boost::shared_ptr<FFTCorrelator>(new FFTCorrelator(n, maxlag));
+              if (j != i)
+                fft->autocorrelate(&x[0], &y[0], &((*results)[i][0]), &((*results)[j][0]));
+              else
+                fft->autocorrelate(&x[0], &((*results)[i][0]));
+            }
+
+            finish(i, xc);
+            if (j != i)
+              finish(j, yc);
+          }
+        }
+        catch (std::exception& e) {
+          *error = e.what();
+        }
+      }
+
+      const std::vector< std::vector<double> >* series;
+      const std::vector<SeriesPair>* pairs;
+      std::vector< std::vector<double> >* results;
+      uint maxlag;
+      bool normalize;
+      double tol;
+      bool direct;
+      uint first, stride;
+      std::string* error;
+      boost::shared_ptr<FFTCorrelator> fft;
+    };
+
+  }
+
+
+
+  std::vector< std::vector<double> > autocorrelations(const std::vector< std::vector<double> >& series,
+                                                      const uint maxlag,
+                                                      const bool normalize,
+                                                      const uint nthreads,
+                                                      const double tol,
+                                                      const bool direct)
+  {
+    std::vector<SeriesPair> pairs;
+    for (uint i=0; i<series.size(); ++i) {
+      if (series[i].size() < maxlag || series[i].empty())
+        throw(LOOSError(boost::str(boost::format("Can't take correlation time (%d) longer than time series %d (%d)")
+                                   % maxlag % i % series[i].size())));
+
+      if (i+1 < series.size() && series[i+1].size() == series[i].size()) {
+        pairs.push_back(SeriesPair(i, i+1));
+        ++i;
+      } else
+        pairs.push_back(SeriesPair(i, i));
+    }
+
+    std::vector< std::vector<double> > results(series.size());
+    if (pairs.empty() || maxlag == 0)
+      return(results);
+
+    uint nt = nthreads ? nthreads : boost::thread::hardware_concurrency();
+    if (nt == 0)
+      nt = 1;
+    nt = std::min(nt, static_cast<uint>(pairs.size()));
+
+    std::vector<std::string> errors(nt);
+    boost::thread_group threads;
+    for (uint t=1; t<nt; ++t)
+      threads.create_thread(CorrelationWorker(&series, &pairs, &results, maxlag, normalize, tol, direct,
+                                              t, nt, &(errors[t])));
+    CorrelationWorker(&series, &pairs, &results, maxlag, normalize, tol, direct, 0, nt, &(errors[0]))();
+    threads.join_all();
+
+    for (uint t=0; t<nt; ++t)
+      if (!errors[t].empty())
+        throw(LOOSError(errors[t]));
+
+    return(results);
+  }
+
+
+}
@@ -0,0 +1,113 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_CORRELATION_HPP)
+#define LOOS_CORRELATION_HPP
+
+#include <vector>
+#include <complex>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+
+  //! Autocorrelation of real series via the FFT
+  /**
+   * Uses the Wiener-Khinchin theorem: the series is zero-padded to a
+   * power of two long enough that the circular correlation does not
+   * wrap around for lags less than maxLag(), transformed, and the
+   * inverse transform of its power spectrum gives the lagged sums.
+   * This takes O(n log n) time rather than the O(n*maxlag) of the
+   * direct sum.
+   *
+   * Two series of the same length can be correlated with a single
+   * complex transform by packing one into the real part and the
+   * other into the imaginary part.
+   *
+   * An FFTCorrelator holds its own workspace, so each thread should
+   * use its own.
+   */
+  class FFTCorrelator {
+  public:
+    //! Correlator for series of \a n points, for lags 0 to \a maxlag-1
+    FFTCorrelator(const uint n, const uint maxlag);
+
+    //! Length of the series to correlate
+    uint size() const { return(_n); }
+
+    //! Number of lags computed
+    uint maxLag() const { return(_maxlag); }
+
+    //! Length of the zero-padded transform
+    uint paddedSize() const { return(_m); }
+
+    //! Computes c[k] = sum(x[j] * x[j+k], j=0..n-k-1) for k < maxLag()
+    void autocorrelate(const double* x, double* c);
+
+    //! Correlates two series at once (see above)
+    void autocorrelate(const double* x, const double* y, double* cx, double* cy);
+
+  private:
+    void transform(const bool inverse);
+
+    uint _n, _maxlag, _m;
+    std::vector<uint> _bitrev;
+    std::vector< std::complex<double> > _twiddle;
+    std::vector< std::complex<double> > _work;
+  };
+
+
+
+  //! Direct summation of the lagged products (see FFTCorrelator::autocorrelate())
+  void directAutocorrelation(const double* x, const uint n, const uint maxlag, double* c);
+
+
+  //! Autocorrelation functions for a batch of series
+  /**
+   * Each series is correlated for lags 0 to \a maxlag-1 and each lag
+   * is divided by the number of products summed, i.e. c[k] is the
+   * average of x[j]*x[j+k].  If \a normalize is true, the mean is
+   * first subtracted from each series and it is then divided by its
+   * standard deviation, so c[0] is 1.  A series with a standard
+   * deviation below \a tol is considered constant and its
+   * correlation is 1 for all lags.  This matches
+   * TimeSeries::correl().
+   *
+   * The series need not have the same length, but each must have at
+   * least \a maxlag points.  Consecutive series of the same length
+   * are correlated in pairs, and the pairs are divided among
+   * \a nthreads threads (0 means use all available).  Setting
+   * \a direct uses the direct O(n*maxlag) sum instead of the FFT.
+   */
+  std::vector< std::vector<double> > autocorrelations(const std::vector< std::vector<double> >& series,
+                                                      const uint maxlag,
+                                                      const bool normalize = true,
+                                                      const uint nthreads = 1,
+                                                      const double tol = 1e-8,
+                                                      const bool direct = false);
+
+}
+
+
+#endif
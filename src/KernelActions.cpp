@@ -162,8 +162,10 @@ namespace loos {
       Value v = stack->pop();
       Value r(-1);
       boost::smatch what;
-      
-      if (boost::regex_search(v.getString(), what, regexp)) {
+
+      // The matches refer into the string, so it must outlive them
+      std::string s = v.getString();
+      if (boost::regex_search(s, what, regexp)) {
         unsigned i;
         int val;
         for (i=0; i<what.size(); i++) {
@@ -106,6 +106,7 @@ namespace loos {
     public:
       explicit pushString(const std::string str) : Action("pushString"), val(str) { }
       void execute(void);
+      const Value& value(void) const { return(val); }
       std::string name(void) const;
     };
 
@@ -115,6 +116,7 @@ namespace loos {
     public:
       explicit pushInt(const long i) : Action("pushInt"), val(i) { }
       void execute(void);
+      const Value& value(void) const { return(val); }
       std::string name(void) const;
     };
 
@@ -190,6 +192,7 @@ namespace loos {
       explicit matchRegex(const std::string s) : Action("matchRegex"), regexp(s, boost::regex::perl|boost::regex::icase), pattern(s) { }
       void execute(void);
       std::string name(void) const;
+      const boost::regex& regex(void) const { return(regexp); }
     
     private:
       std::string pattern;
@@ -224,6 +227,7 @@ namespace loos {
 
       void execute(void);
       std::string name(void) const;
+      const boost::regex& regex(void) const { return(regexp); }
 
     private:
       boost::regex regexp;
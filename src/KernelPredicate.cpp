@@ -0,0 +1,402 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <vector>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+#include <boost/regex.hpp>
+
+#include <KernelPredicate.hpp>
+#include <Kernel.hpp>
+#include <Atom.hpp>
+#include <Selectors.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    namespace {
+
+      // Operands...
+
+      struct IntOperand {
+        virtual ~IntOperand() { }
+        virtual long value(const Atom&) const =0;
+      };
+      typedef boost::shared_ptr<IntOperand>   pIntOperand;
+
+
+      struct StringOperand {
+        virtual ~StringOperand() { }
+        virtual const std::string& value(const Atom&) const =0;
+      };
+      typedef boost::shared_ptr<StringOperand>   pStringOperand;
+
+
+      struct IntConstant : public IntOperand {
+        explicit IntConstant(const long i) : val(i) { }
+        long value(const Atom&) const { return(val); }
+        long val;
+      };
+
+      struct AtomId : public IntOperand {
+        long value(const Atom& a) const { return(a.id()); }
+      };
+
+      struct AtomResid : public IntOperand {
+        long value(const Atom& a) const { return(a.resid()); }
+      };
+
+      struct AtomIndex : public IntOperand {
+        long value(const Atom& a) const { return(static_cast<long>(a.index())); }
+      };
+
+
+      struct StringConstant : public StringOperand {
+        explicit StringConstant(const std::string& s) : val(s) { }
+        const std::string& value(const Atom&) const { return(val); }
+        std::string val;
+      };
+
+      // Refers directly to one of the atom's string properties
+      struct AtomString : public StringOperand {
+        typedef const std::string& (Atom::*Accessor)(void) const;
+
+        explicit AtomString(Accessor f) : accessor(f) { }
+        const std::string& value(const Atom& a) const { return((a.*accessor)()); }
+        Accessor accessor;
+      };
+
+
+      // Equivalent to extractNumber, but converts the capture in place
+      struct ExtractNumber : public IntOperand {
+        ExtractNumber(const pStringOperand& s, const boost::regex& r) : str(s), regexp(r) { }
+
+        long value(const Atom& a) const {
+          const std::string& s = str->value(a);
+          boost::match_results<std::string::const_iterator> what;
+
+          if (boost::regex_search(s, what, regexp))
+            for (uint i=0; i<what.size(); ++i) {
+              if (!what[i].matched)
+                continue;
+
+              // Same as reading an int from a stream: leading space and
+              // a sign are allowed, and trailing junk is ignored
+              std::string::const_iterator j = what[i].first;
+              char buf[32];
+              uint n = 0;
+              while (j != what[i].second && n < sizeof(buf) - 1)
+                buf[n++] = *j++;
+              buf[n] = '\0';
+
+              char* end;
+              errno = 0;
+              long val = strtol(buf, &end, 10);
+              if (end != buf && errno == 0 && val >= INT_MIN && val <= INT_MAX)
+                return(val);
+            }
+
+          return(-1);
+        }
+
+        pStringOperand str;
+        boost::regex regexp;
+      };
+
+
+
+      // Predicates...
+
+      struct TruePredicate : public Predicate {
+        bool operator()(const Atom&) const { return(true); }
+      };
+
+
+      struct HydrogenPredicate : public Predicate {
+        bool operator()(const Atom& a) const {
+          bool masscheck = true;
+          if (a.checkProperty(Atom::massbit))
+            masscheck = (a.mass() < 1.1);
+
+          const std::string& n = a.name();
+          return(!n.empty() && n[0] == 'H' && masscheck);
+        }
+      };
+
+
+      // BackboneSelector only looks at names, so a non-owning pAtom is
+      // enough to call it
+      struct NullDeleter { void operator()(const void*) const { } };
+
+      struct BackbonePredicate : public Predicate {
+        bool operator()(const Atom& a) const {
+          pAtom pa(const_cast<Atom*>(&a), NullDeleter());
+          return(bbsel(pa));
+        }
+        BackboneSelector bbsel;
+      };
+
+
+      struct NotPredicate : public Predicate {
+        explicit NotPredicate(const pPredicate& p) : pred(p) { }
+        bool operator()(const Atom& a) const { return(!(*pred)(a)); }
+        pPredicate pred;
+      };
+
+      struct AndPredicate : public Predicate {
+        AndPredicate(const pPredicate& l, const pPredicate& r) : lhs(l), rhs(r) { }
+        bool operator()(const Atom& a) const { return((*lhs)(a) && (*rhs)(a)); }
+        pPredicate lhs, rhs;
+      };
+
+      struct OrPredicate : public Predicate {
+        OrPredicate(const pPredicate& l, const pPredicate& r) : lhs(l), rhs(r) { }
+        bool operator()(const Atom& a) const { return((*lhs)(a) || (*rhs)(a)); }
+        pPredicate lhs, rhs;
+      };
+
+
+      enum Relation { EQUALS, LESS, LESS_EQUALS, GREATER, GREATER_EQUALS };
+
+
+      // Integer relations follow compare() and the Kernel actions,
+      // including the quirk that < and <= are false if either side is
+      // negative.
+      struct IntRelation : public Predicate {
+        IntRelation(const Relation r, const pIntOperand& l, const pIntOperand& rr) : rel(r), lhs(l), rhs(rr) { }
+
+        bool operator()(const Atom& a) const {
+          long x = lhs->value(a);
+          long y = rhs->value(a);
+          int e = x - y;
+
+          switch(rel) {
+          case EQUALS: return(e == 0);
+          case LESS: return(x >= 0 && y >= 0 && e < 0);
+          case LESS_EQUALS: return(x >= 0 && y >= 0 && e <= 0);
+          case GREATER: return(e > 0);
+          case GREATER_EQUALS: return(e >= 0);
+          }
+          return(false);
+        }
+
+        Relation rel;
+        pIntOperand lhs, rhs;
+      };
+
+
+      struct StringRelation : public Predicate {
+        StringRelation(const Relation r, const pStringOperand& l, const pStringOperand& rr) : rel(r), lhs(l), rhs(rr) { }
+
+        bool operator()(const Atom& a) const {
+          const std::string& x = lhs->value(a);
+          const std::string& y = rhs->value(a);
+
+          switch(rel) {
+          case EQUALS: return(x == y);
+          case LESS: return(x < y);
+          case LESS_EQUALS: return(!(y < x));
+          case GREATER: return(y < x);
+          case GREATER_EQUALS: return(!(x < y));
+          }
+          return(false);
+        }
+
+        Relation rel;
+        pStringOperand lhs, rhs;
+      };
+
+
+      // Holds no per-call state, so a compiled selection can be
+      // evaluated by several threads at once
+      struct RegexPredicate : public Predicate {
+        RegexPredicate(const pStringOperand& s, const boost::regex& r) : str(s), regexp(r) { }
+
+        bool operator()(const Atom& a) const {
+          return(boost::regex_search(str->value(a), regexp));
+        }
+
+        pStringOperand str;
+        boost::regex regexp;
+      };
+
+
+
+      // The symbolic stack used while compiling
+      struct Item {
+        enum ItemType { INT, STRING, BOOL };
+
+        explicit Item(const pIntOperand& p) : type(INT), integer(p) { }
+        explicit Item(const pStringOperand& p) : type(STRING), str(p) { }
+        explicit Item(const pPredicate& p) : type(BOOL), pred(p) { }
+
+        ItemType type;
+        pIntOperand integer;
+        pStringOperand str;
+        pPredicate pred;
+      };
+
+
+      class Compiler {
+      public:
+        bool compile(const Action* act) {
+          if (const pushInt* p = dynamic_cast<const pushInt*>(act))
+            return(push(Item(pIntOperand(new IntConstant(p->value().getInt())))));
+
+          if (const pushString* p = dynamic_cast<const pushString*>(act))
+            return(push(Item(pStringOperand(new StringConstant(p->value().getString())))));
+
+          if (dynamic_cast<const pushAtomId*>(act))
+            return(push(Item(pIntOperand(new AtomId))));
+          if (dynamic_cast<const pushAtomResid*>(act))
+            return(push(Item(pIntOperand(new AtomResid))));
+          if (dynamic_cast<const pushAtomIndex*>(act))
+            return(push(Item(pIntOperand(new AtomIndex))));
+
+          if (dynamic_cast<const pushAtomName*>(act))
+            return(push(Item(pStringOperand(new AtomString(&Atom::name)))));
+          if (dynamic_cast<const pushAtomResname*>(act))
+            return(push(Item(pStringOperand(new AtomString(&Atom::resname)))));
+          if (dynamic_cast<const pushAtomSegid*>(act))
+            return(push(Item(pStringOperand(new AtomString(&Atom::segid)))));
+          if (dynamic_cast<const pushAtomChainId*>(act))
+            return(push(Item(pStringOperand(new AtomString(&Atom::chainId)))));
+
+          if (dynamic_cast<const logicalTrue*>(act))
+            return(push(Item(pPredicate(new TruePredicate))));
+          if (dynamic_cast<const Hydrogen*>(act))
+            return(push(Item(pPredicate(new HydrogenPredicate))));
+          if (dynamic_cast<const Backbone*>(act))
+            return(push(Item(pPredicate(new BackbonePredicate))));
+
+          if (dynamic_cast<const equals*>(act))
+            return(relation(EQUALS));
+          if (dynamic_cast<const lessThan*>(act))
+            return(relation(LESS));
+          if (dynamic_cast<const lessThanEquals*>(act))
+            return(relation(LESS_EQUALS));
+          if (dynamic_cast<const greaterThan*>(act))
+            return(relation(GREATER));
+          if (dynamic_cast<const greaterThanEquals*>(act))
+            return(relation(GREATER_EQUALS));
+
+          if (const matchRegex* p = dynamic_cast<const matchRegex*>(act)) {
+            if (!top(Item::STRING))
+              return(false);
+            pStringOperand s = pop().str;
+            return(push(Item(pPredicate(new RegexPredicate(s, p->regex())))));
+          }
+
+          if (const extractNumber* p = dynamic_cast<const extractNumber*>(act)) {
+            if (!top(Item::STRING))
+              return(false);
+            pStringOperand s = pop().str;
+            return(push(Item(pIntOperand(new ExtractNumber(s, p->regex())))));
+          }
+
+          if (dynamic_cast<const logicalNot*>(act)) {
+            if (!top(Item::BOOL))
+              return(false);
+            pPredicate p = pop().pred;
+            return(push(Item(pPredicate(new NotPredicate(p)))));
+          }
+
+          if (dynamic_cast<const logicalAnd*>(act) || dynamic_cast<const logicalOr*>(act)) {
+            if (stack.size() < 2 || stack[stack.size()-1].type != Item::BOOL || stack[stack.size()-2].type != Item::BOOL)
+              return(false);
+            pPredicate rhs = pop().pred;
+            pPredicate lhs = pop().pred;
+            if (dynamic_cast<const logicalAnd*>(act))
+              return(push(Item(pPredicate(new AndPredicate(lhs, rhs)))));
+            return(push(Item(pPredicate(new OrPredicate(lhs, rhs)))));
+          }
+
+          // Anything else (floats, dup, drop, etc) is left to the Kernel
+          return(false);
+        }
+
+
+        pPredicate result() const {
+          if (stack.size() != 1 || stack[0].type != Item::BOOL)
+            return(pPredicate());
+          return(stack[0].pred);
+        }
+
+
+      private:
+        bool push(const Item& item) { stack.push_back(item); return(true); }
+
+        Item pop() {
+          Item item = stack.back();
+          stack.pop_back();
+          return(item);
+        }
+
+        bool top(const Item::ItemType t) const {
+          return(!stack.empty() && stack.back().type == t);
+        }
+
+        // Only like types may be compared
+        bool relation(const Relation rel) {
+          if (stack.size() < 2)
+            return(false);
+
+          Item rhs = pop();
+          Item lhs = pop();
+          if (lhs.type != rhs.type)
+            return(false);
+
+          if (lhs.type == Item::INT)
+            return(push(Item(pPredicate(new IntRelation(rel, lhs.integer, rhs.integer)))));
+          if (lhs.type == Item::STRING)
+            return(push(Item(pPredicate(new StringRelation(rel, lhs.str, rhs.str)))));
+
+          return(false);
+        }
+
+        std::vector<Item> stack;
+      };
+
+    }
+
+
+
+    pPredicate compileKernel(const Kernel& kernel) {
+      const std::vector<Action*>& commands = kernel.commands();
+      if (commands.empty())
+        return(pPredicate());
+
+      Compiler compiler;
+      for (std::vector<Action*>::const_iterator i = commands.begin(); i != commands.end(); ++i)
+        if (!compiler.compile(*i))
+          return(pPredicate());
+
+      return(compiler.result());
+    }
+
+  }
+
+}
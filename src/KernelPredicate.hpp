@@ -0,0 +1,74 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_KERNELPREDICATE_HPP)
+#define LOOS_KERNELPREDICATE_HPP
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  class Kernel;
+
+  namespace internal {
+
+
+    //! A compiled selection: a tree of typed nodes that tests an atom
+    /**
+     * The Kernel stores a selection as a postfix program for a stack
+     * machine, where every value pushed (including each atom's name,
+     * resname, and segid) is boxed in a heap-allocated Value.
+     * compileKernel() walks that program once, with a symbolic stack,
+     * and builds an equivalent tree in which string operands are
+     * referenced rather than copied, regular expressions are compiled
+     * once, and the logical operators short-circuit.
+     *
+     * Since the selection language has no side-effects, short-circuiting
+     * does not change the result.  Programs whose operand types cannot
+     * be resolved when compiling (e.g. comparing a string to a number,
+     * which is a run-time error for the Kernel) are not compiled, so the
+     * Kernel is left to report the error as before.
+     */
+    class Predicate {
+    public:
+      virtual ~Predicate() { }
+      virtual bool operator()(const Atom& atom) const =0;
+    };
+
+    typedef boost::shared_ptr<Predicate>    pPredicate;
+
+
+    //! Compiles the kernel's commands, returning a null pointer if it cannot be compiled
+    pPredicate compileKernel(const Kernel& kernel);
+
+  }
+
+}
+
+
+#endif
@@ -0,0 +1,72 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <MappedFile.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    MappedFile::MappedFile(const std::string& fname) : _data(0), _size(0) {
+      int fd = open(fname.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw(FileOpenError(fname));
+
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw(FileOpenError(fname, "Cannot determine the size of the file"));
+      }
+      _size = st.st_size;
+
+      if (_size) {
+        void* p = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+          close(fd);
+          throw(FileOpenError(fname, "Cannot map the file into memory"));
+        }
+        _data = static_cast<char*>(p);
+      }
+
+      // The mapping remains valid after the file is closed
+      close(fd);
+    }
+
+
+    MappedFile::~MappedFile() {
+      if (_data)
+        munmap(_data, _size);
+    }
+
+  }
+
+}
@@ -0,0 +1,85 @@
+/*
+  MappedFile.hpp
+
+  Memory-mapped files...
+*/
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#if !defined(LOOS_MAPPEDFILE_HPP)
+#define LOOS_MAPPEDFILE_HPP
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    //! A private mapping of an entire file into memory
+    /**
+     * The mapping is copy-on-write, so the mapped data may be modified
+     * without changing the file.  It is unmapped when the object is
+     * destroyed.  Throws a FileOpenError if the file cannot be opened
+     * or mapped.
+     */
+    class MappedFile {
+    public:
+      explicit MappedFile(const std::string& fname);
+      ~MappedFile();
+
+      const char* data() const { return(_data); }
+      char* data() { return(_data); }
+      boost::uint64_t size() const { return(_size); }
+
+    private:
+      MappedFile(const MappedFile&);
+      MappedFile& operator=(const MappedFile&);
+
+      char* _data;
+      boost::uint64_t _size;
+    };
+
+
+    // Deleter for a shared_array that points into a MappedFile.  The
+    // mapping is kept alive until the last shared_array referring to
+    // it is gone.
+    struct MappedFileHolder {
+      explicit MappedFileHolder(const boost::shared_ptr<MappedFile>& f) : file(f) { }
+      void operator()(const void*) { file.reset(); }
+      boost::shared_ptr<MappedFile> file;
+    };
+
+  }
+
+}
+
+
+#endif
@@ -0,0 +1,177 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+#include <algorithm>
+
+#include <MatrixBinary.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // On-disk layout (native byte order, which is checked on read):
+    //
+    //   char[8]   magic
+    //   uint32    byte-order mark
+    //   uint32    version
+    //   uint32    element type code
+    //   uint32    element size
+    //   uint32    layout code
+    //   uint32    (reserved)
+    //   uint64    rows
+    //   uint64    columns
+    //   uint64    number of elements stored
+    //   uint64    length of metadata
+    //   char[]    metadata
+    //   (padding to a multiple of data_alignment)
+    //   data
+
+    const char matrix_magic[8] = { 'L', 'O', 'O', 'S', 'M', 'A', 'T', '\0' };
+    const boost::uint32_t matrix_bom = 0x01020304;
+    const boost::uint32_t matrix_version = 1;
+
+    // Alignment (in bytes) of the start of the data in the file
+    const boost::uint64_t data_alignment = 64;
+
+    // Size of the chunks the metadata is read in
+    const std::streamsize metadata_block_size = 65536;
+
+
+    template<typename T>
+    void writeValue(std::ostream& os, const T& t) {
+      os.write(reinterpret_cast<const char*>(&t), sizeof(T));
+    }
+
+    template<typename T>
+    void readValue(std::istream& is, T& t) {
+      is.read(reinterpret_cast<char*>(&t), sizeof(T));
+      if (!is)
+        throw(MatrixReadError("Binary matrix header is truncated"));
+    }
+
+  }
+
+
+  namespace internal {
+
+    void writeBinaryMatrixHeader(std::ostream& os, BinaryMatrixHeader& hdr) {
+      boost::uint32_t reserved = 0;
+
+      os.write(matrix_magic, 8);
+      writeValue(os, matrix_bom);
+      writeValue(os, matrix_version);
+      writeValue(os, hdr.type);
+      writeValue(os, hdr.element_size);
+      writeValue(os, hdr.order);
+      writeValue(os, reserved);
+      writeValue(os, hdr.rows);
+      writeValue(os, hdr.cols);
+      writeValue(os, hdr.count);
+      writeValue(os, static_cast<boost::uint64_t>(hdr.meta.size()));
+      os.write(hdr.meta.data(), hdr.meta.size());
+
+      boost::uint64_t n = 8 + 6 * sizeof(boost::uint32_t) + 4 * sizeof(boost::uint64_t) + hdr.meta.size();
+      hdr.offset = ((n + data_alignment - 1) / data_alignment) * data_alignment;
+      for (; n < hdr.offset; ++n)
+        os.put('\0');
+    }
+
+
+    void readBinaryMatrixHeader(std::istream& is, BinaryMatrixHeader& hdr) {
+      char magic[8];
+      is.read(magic, 8);
+      if (!is || std::memcmp(magic, matrix_magic, 8) != 0)
+        throw(MatrixReadError("Not a binary matrix"));
+
+      boost::uint32_t bom, version, reserved;
+      readValue(is, bom);
+      if (bom != matrix_bom)
+        throw(MatrixReadError("Binary matrix was written on a machine with a different byte order"));
+      readValue(is, version);
+      if (version != matrix_version)
+        throw(MatrixReadError("Unsupported binary matrix version"));
+
+      readValue(is, hdr.type);
+      readValue(is, hdr.element_size);
+      readValue(is, hdr.order);
+      readValue(is, reserved);
+      readValue(is, hdr.rows);
+      readValue(is, hdr.cols);
+      readValue(is, hdr.count);
+
+      // The metadata length comes from the file, so the metadata is
+      // read a block at a time rather than allocated up front (a corrupt
+      // length could otherwise ask for gigabytes)
+      boost::uint64_t metalen;
+      readValue(is, metalen);
+      hdr.meta.clear();
+      char buf[metadata_block_size];
+      for (boost::uint64_t left = metalen; left > 0; ) {
+        std::streamsize n = static_cast<std::streamsize>(std::min(left, static_cast<boost::uint64_t>(metadata_block_size)));
+        is.read(buf, n);
+        if (is.gcount() != n)
+          throw(FileReadError("binary matrix", "Metadata is truncated or its length is corrupt"));
+        hdr.meta.append(buf, n);
+        left -= n;
+      }
+
+      boost::uint64_t expected;
+      if (hdr.order == BinaryMatrixOrder<Math::Triangular>::code) {
+        if (hdr.rows != hdr.cols)
+          throw(MatrixReadError("Binary triangular matrix is not square"));
+        expected = (hdr.rows * (hdr.rows + 1)) / 2;
+      } else if (hdr.order == BinaryMatrixOrder<Math::ColMajor>::code || hdr.order == BinaryMatrixOrder<Math::RowMajor>::code)
+        expected = hdr.rows * hdr.cols;
+      else
+        throw(MatrixReadError("Unknown layout in binary matrix"));
+
+      if (hdr.count != expected)
+        throw(MatrixReadError("Binary matrix size does not match its dimensions"));
+
+      // Skip the padding rather than seeking, since the header need
+      // not start at the beginning of the stream
+      boost::uint64_t n = 8 + 6 * sizeof(boost::uint32_t) + 4 * sizeof(boost::uint64_t) + metalen;
+      hdr.offset = ((n + data_alignment - 1) / data_alignment) * data_alignment;
+      std::streamsize padding = static_cast<std::streamsize>(hdr.offset - n);
+      is.ignore(padding);
+      if (!is || is.gcount() != padding)
+        throw(MatrixReadError("Binary matrix is truncated"));
+    }
+
+  }
+
+
+
+  bool isBinaryMatrix(const std::string& fname) {
+    std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!ifs)
+      return(false);
+
+    char magic[8];
+    ifs.read(magic, 8);
+    return(ifs && std::memcmp(magic, matrix_magic, 8) == 0);
+  }
+
+}
@@ -0,0 +1,349 @@
+/*
+  MatrixBinary.hpp
+
+  Binary reading and writing of Matrix objects...
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_MATRIXBINARY_HPP)
+#define LOOS_MATRIXBINARY_HPP
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
+
+#include <loos_defs.hpp>
+#include <MatrixImpl.hpp>
+#include <MatrixRead.hpp>
+#include <MatrixWrite.hpp>
+#include <MappedFile.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    // Type codes for the elements of a binary matrix.  Only these
+    // types can be written...
+    template<typename T> struct BinaryMatrixType;
+    template<> struct BinaryMatrixType<float>  { static const boost::uint32_t code = 1; };
+    template<> struct BinaryMatrixType<double> { static const boost::uint32_t code = 2; };
+    template<> struct BinaryMatrixType<int>    { static const boost::uint32_t code = 3; };
+    template<> struct BinaryMatrixType<uint>   { static const boost::uint32_t code = 4; };
+    template<> struct BinaryMatrixType<long>   { static const boost::uint32_t code = 5; };
+    template<> struct BinaryMatrixType<ulong>  { static const boost::uint32_t code = 6; };
+
+    // ...and codes for the layout of the data
+    template<class P> struct BinaryMatrixOrder;
+    template<> struct BinaryMatrixOrder<Math::ColMajor>   { static const boost::uint32_t code = 0; };
+    template<> struct BinaryMatrixOrder<Math::RowMajor>   { static const boost::uint32_t code = 1; };
+    template<> struct BinaryMatrixOrder<Math::Triangular> { static const boost::uint32_t code = 2; };
+
+
+    //! Everything in a binary matrix file but the data
+    struct BinaryMatrixHeader {
+      BinaryMatrixHeader() : type(0), element_size(0), order(0), rows(0), cols(0), count(0), offset(0) { }
+
+      boost::uint32_t type, element_size, order;
+      boost::uint64_t rows, cols, count;
+      std::string meta;
+
+      // Offset from the start of the header to the data (set when
+      // reading or writing the header)
+      boost::uint64_t offset;
+    };
+
+
+    //! Write the header, padding the stream so the data will be aligned
+    void writeBinaryMatrixHeader(std::ostream& os, BinaryMatrixHeader& hdr);
+
+    //! Read the header, leaving the stream at the start of the data
+    void readBinaryMatrixHeader(std::istream& is, BinaryMatrixHeader& hdr);
+
+
+    // Copies data stored as type S into the matrix, converting the
+    // layout if necessary
+    template<typename S, typename T, class P>
+    void convertBinaryMatrix(std::istream& is, const BinaryMatrixHeader& hdr, Math::Matrix<T,P,Math::SharedArray>& M) {
+      // e.g. a long written where it is 8 bytes, read where it is 4
+      if (hdr.element_size != sizeof(S))
+        throw(MatrixReadError("Binary matrix element size does not match this machine's size for its type"));
+
+      std::vector<S> buf(hdr.count);
+      if (hdr.count)
+        is.read(reinterpret_cast<char*>(&buf[0]), hdr.count * sizeof(S));
+      if (!is)
+        throw(MatrixReadError("Binary matrix is truncated"));
+
+      if (hdr.order == BinaryMatrixOrder<P>::code) {
+        for (ulong i=0; i<hdr.count; ++i)
+          M[i] = static_cast<T>(buf[i]);
+        return;
+      }
+
+      ulong k = 0;
+      if (hdr.order == BinaryMatrixOrder<Math::Triangular>::code) {
+        // Expand a triangular matrix into a full, symmetric one
+        for (uint j=0; j<hdr.rows; ++j)
+          for (uint i=0; i<=j; ++i) {
+            T t = static_cast<T>(buf[k++]);
+            M(j, i) = t;
+            M(i, j) = t;
+          }
+      } else if (hdr.order == BinaryMatrixOrder<Math::ColMajor>::code) {
+        for (uint i=0; i<hdr.cols; ++i)
+          for (uint j=0; j<hdr.rows; ++j)
+            M(j, i) = static_cast<T>(buf[k++]);
+      } else {
+        for (uint j=0; j<hdr.rows; ++j)
+          for (uint i=0; i<hdr.cols; ++i)
+            M(j, i) = static_cast<T>(buf[k++]);
+      }
+    }
+
+  }
+
+
+  //! Write a submatrix to a stream in binary format
+  /**
+   * The binary format stores the dimensions, element type, layout,
+   * and \a meta string in a header, followed by the raw matrix data
+   * in native byte order.  Unlike writeAsciiMatrix(), there is no
+   * loss of precision and the file can be read back with
+   * readBinaryMatrix() without any parsing.
+   *
+   * When the whole matrix is written, the data is written exactly as
+   * it is stored in memory.  Otherwise (or if \a trans is set), the
+   * requested submatrix is written in column-major order.  As with
+   * writeAsciiMatrix(), the range and \a trans are ignored for
+   * triangular matrices.
+   */
+  template<class T, class P>
+  std::ostream& writeBinaryMatrix(std::ostream& os, const Math::Matrix<T,P,Math::SharedArray>& M,
+                                  const std::string& meta, const Math::Range& start,
+                                  const Math::Range& end, const bool trans = false) {
+    internal::BinaryMatrixHeader hdr;
+    hdr.type = internal::BinaryMatrixType<T>::code;
+    hdr.element_size = sizeof(T);
+    hdr.meta = meta;
+
+    bool whole = (internal::BinaryMatrixOrder<P>::code == internal::BinaryMatrixOrder<Math::Triangular>::code)
+      || (!trans && start.first == 0 && start.second == 0 && end.first == M.rows() && end.second == M.cols());
+
+    if (whole) {
+      hdr.order = internal::BinaryMatrixOrder<P>::code;
+      hdr.rows = M.rows();
+      hdr.cols = M.cols();
+      hdr.count = M.size();
+      internal::writeBinaryMatrixHeader(os, hdr);
+      if (hdr.count)
+        os.write(reinterpret_cast<const char*>(M.get()), hdr.count * sizeof(T));
+      return(os);
+    }
+
+    uint ja = start.first, jb = end.first;
+    uint ia = start.second, ib = end.second;
+
+    hdr.order = internal::BinaryMatrixOrder<Math::ColMajor>::code;
+    hdr.rows = trans ? ib - ia : jb - ja;
+    hdr.cols = trans ? jb - ja : ib - ia;
+    hdr.count = hdr.rows * hdr.cols;
+    internal::writeBinaryMatrixHeader(os, hdr);
+
+    // Output is column-major, so each column is contiguous
+    std::vector<T> column(hdr.rows);
+    if (trans) {
+      for (uint j=ja; j<jb; ++j) {
+        for (uint i=ia; i<ib; ++i)
+          column[i-ia] = M(j, i);
+        if (!column.empty())
+          os.write(reinterpret_cast<const char*>(&column[0]), column.size() * sizeof(T));
+      }
+    } else {
+      for (uint i=ia; i<ib; ++i) {
+        for (uint j=ja; j<jb; ++j)
+          column[j-ja] = M(j, i);
+        if (!column.empty())
+          os.write(reinterpret_cast<const char*>(&column[0]), column.size() * sizeof(T));
+      }
+    }
+
+    return(os);
+  }
+
+
+  //! Write an entire matrix to a stream in binary format
+  template<class T, class P>
+  std::ostream& writeBinaryMatrix(std::ostream& os, const Math::Matrix<T,P,Math::SharedArray>& M,
+                                  const std::string& meta, const bool trans = false) {
+    Math::Range start(0,0);
+    Math::Range end(M.rows(), M.cols());
+    return(writeBinaryMatrix(os, M, meta, start, end, trans));
+  }
+
+
+  //! Write a submatrix to a file in binary format
+  template<class T, class P>
+  void writeBinaryMatrix(const std::string& fname, const Math::Matrix<T,P,Math::SharedArray>& M,
+                         const std::string& meta, const Math::Range& start,
+                         const Math::Range& end, const bool trans = false) {
+    std::ofstream ofs(fname.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!ofs.is_open())
+      throw(std::runtime_error("Cannot open " + fname + " for writing."));
+    writeBinaryMatrix(ofs, M, meta, start, end, trans);
+    if (!ofs)
+      throw(std::runtime_error("Error while writing " + fname));
+  }
+
+
+  //! Write an entire matrix to a file in binary format
+  template<class T, class P>
+  void writeBinaryMatrix(const std::string& fname, const Math::Matrix<T,P,Math::SharedArray>& M,
+                         const std::string& meta, const bool trans = false) {
+    Math::Range start(0,0);
+    Math::Range end(M.rows(), M.cols());
+    writeBinaryMatrix(fname, M, meta, start, end, trans);
+  }
+
+
+
+  //! Read a binary matrix from a stream
+  /**
+   * The data is converted to the type and layout of the requested
+   * matrix if they differ from what was written.  A triangular matrix
+   * may be read into a full matrix (which will be symmetric), but a
+   * full matrix cannot be read as a triangular one.
+   */
+  template<class T, class P>
+  void readBinaryMatrix(std::istream& is, Math::Matrix<T,P,Math::SharedArray>& M) {
+    internal::BinaryMatrixHeader hdr;
+    internal::readBinaryMatrixHeader(is, hdr);
+
+    bool tri = (hdr.order == internal::BinaryMatrixOrder<Math::Triangular>::code);
+    if (!tri && internal::BinaryMatrixOrder<P>::code == internal::BinaryMatrixOrder<Math::Triangular>::code)
+      throw(MatrixReadError("Binary matrix layout is incompatible with the requested matrix"));
+
+    Math::Matrix<T,P,Math::SharedArray> R(hdr.rows, hdr.cols);
+    switch(hdr.type) {
+    case 1: internal::convertBinaryMatrix<float>(is, hdr, R); break;
+    case 2: internal::convertBinaryMatrix<double>(is, hdr, R); break;
+    case 3: internal::convertBinaryMatrix<int>(is, hdr, R); break;
+    case 4: internal::convertBinaryMatrix<uint>(is, hdr, R); break;
+    case 5: internal::convertBinaryMatrix<long>(is, hdr, R); break;
+    case 6: internal::convertBinaryMatrix<ulong>(is, hdr, R); break;
+    default: throw(MatrixReadError("Unknown element type in binary matrix"));
+    }
+
+    R.metaData(hdr.meta);
+    M = R;
+  }
+
+
+  //! Read a binary matrix from a file
+  /**
+   * If the file holds the same element type and layout as the
+   * requested matrix, the file is mapped into memory and the matrix
+   * refers directly to the mapped data, so no copying is done and
+   * pages are only read from disk as they are accessed.  The mapping
+   * is private, so changes to the matrix are never written back to
+   * the file.  Otherwise, the data is read and converted as with the
+   * stream version.
+   */
+  template<class T, class P>
+  void readBinaryMatrix(const std::string& fname, Math::Matrix<T,P,Math::SharedArray>& M) {
+    std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!ifs)
+      throw(MatrixReadError("Cannot open " + fname + " for reading."));
+
+    internal::BinaryMatrixHeader hdr;
+    internal::readBinaryMatrixHeader(ifs, hdr);
+
+    if (hdr.type != internal::BinaryMatrixType<T>::code || hdr.element_size != sizeof(T)
+        || hdr.order != internal::BinaryMatrixOrder<P>::code || hdr.count == 0) {
+      ifs.seekg(0);
+      readBinaryMatrix(ifs, M);
+      return;
+    }
+    ifs.close();
+
+    boost::shared_ptr<internal::MappedFile> file(new internal::MappedFile(fname));
+    if (hdr.offset + hdr.count * sizeof(T) > file->size())
+      throw(MatrixReadError("Binary matrix " + fname + " is truncated"));
+
+    T* p = reinterpret_cast<T*>(file->data() + hdr.offset);
+    boost::shared_array<T> data(p, internal::MappedFileHolder(file));
+
+    Math::Matrix<T,P,Math::SharedArray> R(data, hdr.rows, hdr.cols);
+    R.metaData(hdr.meta);
+    M = R;
+  }
+
+
+  //! Read a binary matrix from a file, returning a newly created matrix
+  template<class T, class P>
+  Math::Matrix<T,P,Math::SharedArray> readBinaryMatrix(const std::string& fname) {
+    Math::Matrix<T,P,Math::SharedArray> M;
+    readBinaryMatrix(fname, M);
+    return(M);
+  }
+
+
+  //! True if the file is a binary matrix
+  bool isBinaryMatrix(const std::string& fname);
+
+
+  //! Read a matrix from a file in either binary or ASCII format
+  /**
+   * Tools that read matrices should use this rather than
+   * readAsciiMatrix() so they transparently accept either format.
+   */
+  template<class T, class P>
+  void readMatrix(const std::string& fname, Math::Matrix<T,P,Math::SharedArray>& M) {
+    if (isBinaryMatrix(fname))
+      readBinaryMatrix(fname, M);
+    else
+      readAsciiMatrix(fname, M);
+  }
+
+  //! Read a matrix in either binary or ASCII format, returning a newly created matrix
+  template<class T, class P>
+  Math::Matrix<T,P,Math::SharedArray> readMatrix(const std::string& fname) {
+    Math::Matrix<T,P,Math::SharedArray> M;
+    readMatrix(fname, M);
+    return(M);
+  }
+
+}
+
+
+#endif
@@ -161,6 +161,14 @@ writeAsciiMatrix(filename, M, "My matrix");
                                                  StoragePolicy<T>(p, OrderPolicy::size()),
                                                  meta("") { }
 
+      //! Share an existing block of data (e.g. memory-mapped) with a Matrix.
+      /**
+       * The data is released according to \a p's deleter...
+       */
+      Matrix(const boost::shared_array<T>& p, const uint b, const uint a) : OrderPolicy(b, a),
+                                                                         StoragePolicy<T>(p, OrderPolicy::size()),
+                                                                         meta("") { }
+
       //! Create a new block of data for the requested Matrix
       Matrix(const uint b, const uint a) : OrderPolicy(b, a),
                                            StoragePolicy<T>(OrderPolicy::size()),
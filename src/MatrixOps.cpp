@@ -54,6 +54,7 @@ namespace loos {
       double* work = new double[lwork+1];
 
       dsyev_(&jobz, &uplo, &n, M.get(), &lda, W.get(), work, &lwork, &info);
+      delete[] work;
       if (info != 0)
 	throw(NumericalError("DSYEV reported an error"), info);
       
@@ -82,6 +83,7 @@ namespace loos {
       float* work = new float[lwork+1];
 
       ssyev_(&jobz, &uplo, &n, M.get(), &lda, W.get(), work, &lwork, &info);
+      delete[] work;
       if (info != 0)
 	throw(NumericalError("SSYEV reported an error"), info);
       
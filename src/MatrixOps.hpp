@@ -182,11 +182,10 @@ namespace loos {
     }
 
     
-    //! Randomly shuffle the columns of a matrix
+    //! Randomly shuffle the columns of a matrix using the given generator
     template<typename T>
-    T shuffleColumns(const T& A) {
+    T shuffleColumns(const T& A, base_generator_type& rng) {
       std::vector<float> random_numbers(A.cols());
-      base_generator_type& rng = rng_singleton();
       boost::uniform_real<> rngmap(0.0, 1.0);
       boost::variate_generator<base_generator_type&, boost::uniform_real<> > rnd(rng, rngmap);
 
@@ -198,11 +197,17 @@ namespace loos {
     }
 
 
-    //!! Randomly shuffle the rows of a single column vector
+    //! Randomly shuffle the columns of a matrix
     template<typename T>
-    T shuffleColumnVector(const T& v) {
+    T shuffleColumns(const T& A) {
+      return(shuffleColumns(A, rng_singleton()));
+    }
+
+
+    //!! Randomly shuffle the rows of a single column vector using the given generator
+    template<typename T>
+    T shuffleColumnVector(const T& v, base_generator_type& rng) {
       std::vector<float> random_numbers(v.size());
-      base_generator_type& rng = rng_singleton();
       boost::uniform_real<> rngmap(0.0, 1.0);
       boost::variate_generator<base_generator_type&, boost::uniform_real<> > rnd(rng, rngmap);
 
@@ -220,6 +225,13 @@ namespace loos {
     }
 
 
+    //!! Randomly shuffle the rows of a single column vector
+    template<typename T>
+    T shuffleColumnVector(const T& v) {
+      return(shuffleColumnVector(v, rng_singleton()));
+    }
+
+
     template<typename T>
     void reverseColumns(T& A) {
       uint m = A.rows();
@@ -330,14 +342,15 @@ namespace loos {
 
 
     // Returns: z-score, raw covariance overlap, and stddev used in the z-score
+    // The shuffles are drawn from the given generator
     template<typename T>
-    boost::tuple<double, double, double> zCovarianceOverlap(const T& lamA, const T& UA, const T& lamB, const T& UB, const uint tries) {
+    boost::tuple<double, double, double> zCovarianceOverlap(const T& lamA, const T& UA, const T& lamB, const T& UB, const uint tries, base_generator_type& rng) {
       double coverlap = covarianceOverlap(lamA, UA, lamB, UB);
       std::vector<double> random_coverlaps(tries);
 
       for (uint i=0; i<tries; ++i) {
-        T shuffled_lamA = shuffleColumnVector(lamA);
-        T shuffled_lamB = shuffleColumnVector(lamB);
+        T shuffled_lamA = shuffleColumnVector(lamA, rng);
+        T shuffled_lamB = shuffleColumnVector(lamB, rng);
         random_coverlaps[i] = covarianceOverlap(shuffled_lamA, UA, shuffled_lamB, UB);
       }
 
@@ -349,6 +362,13 @@ namespace loos {
     }
 
 
+    // Returns: z-score, raw covariance overlap, and stddev used in the z-score
+    template<typename T>
+    boost::tuple<double, double, double> zCovarianceOverlap(const T& lamA, const T& UA, const T& lamB, const T& UB, const uint tries) {
+      return(zCovarianceOverlap(lamA, UA, lamB, UB, tries, rng_singleton()));
+    }
+
+
   };
 
 
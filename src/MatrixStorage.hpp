@@ -63,6 +63,7 @@ namespace loos {
 
       SharedArray(const ulong n) : dim_(n) { allocate(n); }
       SharedArray(T* p, const ulong n) : dim_(n), dptr(p) { }
+      SharedArray(const boost::shared_array<T>& p, const ulong n) : dim_(n), dptr(p) { }
 
       // In some cases, BOOST makes dptr(0) a shared_array<int> which
       // will cause subsequent type problems.  So, we force it to be a NULL
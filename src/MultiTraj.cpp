@@ -87,6 +87,12 @@ namespace loos {
 	}
 
 
+	void MultiTrajectory::setAtomSubsetImpl() {
+		for (uint i=0; i<_trajectories.size(); ++i)
+			_trajectories[i]->setAtomSubset(_atom_subset);
+	}
+
+
 	void MultiTrajectory::initWithList(const std::vector<std::string>& filenames, const AtomicGroup& model) {
 		for (uint i=0; i<filenames.size(); ++i) {
 			pTraj traj = createTrajectory(filenames[i], model);
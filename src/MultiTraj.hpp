@@ -37,6 +37,8 @@ namespace loos {
 	 * This class can be used just about anywhere a regular Trajectory/pTraj can be used.
 	 * Note that the skip and stride settings are applied to each sub-trajectory (as opposed
 	 * to the composite trajectory).  They are also set ONLY at instantiation.
+	 * An atom subset (see Trajectory::setAtomSubset()) is passed on to every
+	 * sub-trajectory.
 	 *
 	 */
 	class MultiTrajectory : public Trajectory {
@@ -81,6 +83,8 @@ namespace loos {
 		//! Add a trajectory (by filename)
 		void addTrajectory(const std::string& filename) {
 			pTraj traj = createTrajectory(filename, _model);
+			if (hasAtomSubset())
+				traj->setAtomSubset(_atom_subset);
 			_trajectories.push_back(traj);
 			if (traj->nframes() > _skip)
 				_nframes += (traj->nframes() - _skip) / _stride;
@@ -164,6 +168,7 @@ namespace loos {
 		virtual bool parseFrame();
 		virtual void updateGroupCoordsImpl(AtomicGroup& g);
 		virtual void updateGroupVelocitiesImpl(AtomicGroup& g);
+		virtual void setAtomSubsetImpl();
 
 		void findNextUsableTraj();
 
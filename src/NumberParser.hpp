@@ -0,0 +1,229 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_NUMBER_PARSER_HPP)
+#define LOOS_NUMBER_PARSER_HPP
+
+#include <limits>
+
+#include <boost/cstdint.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    // Limits for which a decimal mantissa and power of ten are both
+    // exactly representable, so a single multiply or divide gives the
+    // correctly rounded result (Clinger's fast path)
+    template<typename T> struct ExactDecimal;
+
+    template<> struct ExactDecimal<float> {
+      static boost::uint64_t maxMantissa() { return(static_cast<boost::uint64_t>(1) << 24); }
+      static int maxExponent() { return(10); }
+    };
+
+    template<> struct ExactDecimal<double> {
+      static boost::uint64_t maxMantissa() { return(static_cast<boost::uint64_t>(1) << 53); }
+      static int maxExponent() { return(22); }
+    };
+
+
+    inline double exactPowerOfTen(const int k) {
+      static const double powers[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+      };
+      return(powers[k]);
+    }
+
+
+    inline bool isSpace(const char c) {
+      return(c == ' ' || (c >= '\t' && c <= '\r'));
+    }
+
+    inline bool isDigit(const char c) {
+      return(c >= '0' && c <= '9');
+    }
+
+
+    //! Parse a decimal floating point number in [p, e) without allocating
+    /**
+     * Leading whitespace is skipped and the longest number found is
+     * converted, as with operator>>() on a stream in the "C" locale.
+     * On success, \a p is left at the first character past the number.
+     *
+     * Only numbers whose value can be computed exactly are handled
+     * (which includes all fixed-format fields in PDB files and the
+     * output of most LOOS tools).  Otherwise, false is returned and
+     * \a p is unchanged, so the caller can fall back to a stream.
+     */
+    template<typename T>
+    bool parseNumber(const char*& p, const char* e, T& val) {
+      const char* s = p;
+      while (s != e && isSpace(*s))
+        ++s;
+
+      bool negative = false;
+      if (s != e && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        ++s;
+      }
+
+      boost::uint64_t mantissa = 0;
+      int digits = 0, significant = 0, exponent = 0;
+
+      for (; s != e && isDigit(*s); ++s, ++digits)
+        if (mantissa || *s != '0') {
+          if (++significant > 19)
+            return(false);
+          mantissa = mantissa * 10 + (*s - '0');
+        }
+
+      if (s != e && *s == '.')
+        for (++s; s != e && isDigit(*s); ++s, ++digits) {
+          if (mantissa || *s != '0') {
+            if (++significant > 19)
+              return(false);
+            mantissa = mantissa * 10 + (*s - '0');
+          }
+          --exponent;
+        }
+
+      if (!digits)
+        return(false);
+
+      if (s != e && (*s == 'e' || *s == 'E')) {
+        ++s;
+        bool negexp = false;
+        if (s != e && (*s == '-' || *s == '+')) {
+          negexp = (*s == '-');
+          ++s;
+        }
+        if (s == e || !isDigit(*s))
+          return(false);
+        int k = 0;
+        for (; s != e && isDigit(*s); ++s)
+          if ((k = k * 10 + (*s - '0')) > 1000)
+            return(false);
+        exponent += negexp ? -k : k;
+      }
+
+      T v;
+      if (mantissa == 0)
+        v = 0;
+      else {
+        if (mantissa > ExactDecimal<T>::maxMantissa())
+          return(false);
+        if (exponent < 0) {
+          if (-exponent > ExactDecimal<T>::maxExponent())
+            return(false);
+          v = static_cast<T>(mantissa) / static_cast<T>(exactPowerOfTen(-exponent));
+        } else {
+          if (exponent > ExactDecimal<T>::maxExponent())
+            return(false);
+          v = static_cast<T>(mantissa) * static_cast<T>(exactPowerOfTen(exponent));
+        }
+      }
+
+      val = negative ? -v : v;
+      p = s;
+      return(true);
+    }
+
+
+    //! Parse a decimal integer in [p, e) without allocating (see parseNumber())
+    template<typename T>
+    bool parseInteger(const char*& p, const char* e, T& val) {
+      const char* s = p;
+      while (s != e && isSpace(*s))
+        ++s;
+
+      bool negative = false;
+      if (s != e && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        ++s;
+      }
+      if (negative && !std::numeric_limits<T>::is_signed)
+        return(false);
+
+      long long v = 0;
+      int digits = 0, significant = 0;
+      for (; s != e && isDigit(*s); ++s, ++digits)
+        if (v || *s != '0') {
+          if (++significant > 18)
+            return(false);
+          v = v * 10 + (*s - '0');
+        }
+
+      if (!digits)
+        return(false);
+
+      if (negative)
+        v = -v;
+      if (v < static_cast<long long>(std::numeric_limits<T>::min())
+          || (v > 0 && static_cast<unsigned long long>(v) > static_cast<unsigned long long>(std::numeric_limits<T>::max())))
+        return(false);
+
+      val = static_cast<T>(v);
+      p = s;
+      return(true);
+    }
+
+
+    // Picks the parser for a type.  Types without one (including
+    // chars, which a stream reads as characters) always fall back.
+    template<typename T, bool integral = std::numeric_limits<T>::is_integer && (sizeof(T) > 1)>
+    struct ValueParser {
+      static bool parse(const char*& p, const char* e, T& val) { return(parseInteger(p, e, val)); }
+    };
+
+    template<typename T>
+    struct ValueParser<T, false> {
+      static bool parse(const char*&, const char*, T&) { return(false); }
+    };
+
+    template<> struct ValueParser<float, false> {
+      static bool parse(const char*& p, const char* e, float& val) { return(parseNumber(p, e, val)); }
+    };
+
+    template<> struct ValueParser<double, false> {
+      static bool parse(const char*& p, const char* e, double& val) { return(parseNumber(p, e, val)); }
+    };
+
+
+    //! Parse a value of any type in [p, e) without allocating, if possible (see parseNumber())
+    template<typename T>
+    bool parseValue(const char*& p, const char* e, T& val) {
+      return(ValueParser<T>::parse(p, e, val));
+    }
+
+
+  }
+
+}
+
+
+#endif
@@ -22,6 +22,7 @@
 
 #include <utils_structural.hpp>
 #include <OptionsFramework.hpp>
+#include <PrefetchTraj.hpp>
 
 #include <boost/lambda/lambda.hpp>
 
@@ -300,6 +301,7 @@ namespace loos {
 
       opts.add_options()
         ("skip,k", po::value<unsigned int>(&skip)->default_value(skip), "Number of frames to skip")
+        ("prefetch", po::value<unsigned int>(&prefetch)->default_value(prefetch), "Read up to this many frames ahead in the background (0 = off)")
         ("modeltype", po::value<std::string>(), modeltypes.c_str())
         ("trajtype", po::value<std::string>(), trajtypes.c_str());
     };
@@ -332,6 +334,9 @@ namespace loos {
       } else
         trajectory = createTrajectory(traj_name, model);
 
+      if (prefetch > 0)
+        trajectory = pTraj(new PrefetchTrajectory(trajectory, prefetch));
+
       if (skip > 0)
         trajectory->readFrame(skip-1);
 
@@ -341,7 +346,7 @@ namespace loos {
     std::string BasicTrajectory::help() const { return("model trajectory"); }
     std::string BasicTrajectory::print() const {
       std::ostringstream oss;
-      oss << boost::format("model='%s', model_type='%s', traj='%s', traj_type='%s', skip=%d") % model_name % model_type % traj_name % traj_type % skip;
+      oss << boost::format("model='%s', model_type='%s', traj='%s', traj_type='%s', skip=%d, prefetch=%d") % model_name % model_type % traj_name % traj_type % skip % prefetch;
       return(oss.str());
     }
 
@@ -358,7 +363,8 @@ namespace loos {
         ("modeltype", po::value<std::string>(&model_type)->default_value(model_type), modeltypes.c_str())
         ("trajtype", po::value<std::string>(&traj_type)->default_value(traj_type), trajtypes.c_str())
         ("stride,i", po::value<unsigned int>(&stride)->default_value(stride), "Take every ith frame")
-        ("range,r", po::value<std::string>(&frame_index_spec), "Which frames to use (matlab style range, overrides stride and skip)");
+        ("range,r", po::value<std::string>(&frame_index_spec), "Which frames to use (matlab style range, overrides stride and skip)")
+        ("prefetch", po::value<unsigned int>(&prefetch)->default_value(prefetch), "Read up to this many frames ahead in the background (0 = off)");
     };
 
     void TrajectoryWithFrameIndices::addHidden(po::options_description& opts) {
@@ -391,6 +397,10 @@ namespace loos {
         trajectory = createTrajectory(traj_name, model);
       else
         trajectory = createTrajectory(traj_name, traj_type, model);
+
+      // Read ahead along the requested frames rather than sequentially
+      if (prefetch > 0)
+        trajectory = pTraj(new PrefetchTrajectory(trajectory, frameList(), prefetch));
       
       return(true);
     }
@@ -403,6 +413,8 @@ namespace loos {
         oss << ", skip=" << skip;
       else if (!frame_index_spec.empty())
         oss << ", range='" << frame_index_spec << "'";
+      if (prefetch > 0)
+        oss << ", prefetch=" << prefetch;
       
       return(oss.str());
     }
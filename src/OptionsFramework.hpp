@@ -489,14 +489,19 @@ namespace loos {
      * provides --skip (-k) option for skipping the first n-frames.
      * 
      * The contained trajectory object will already be skipped to the
-     * correct frame by postConditions().
+     * correct frame by postConditions().  If --prefetch is given, the
+     * trajectory is wrapped in a PrefetchTrajectory that reads that many
+     * frames ahead on a background thread.
      **/
     class BasicTrajectory : public OptionsPackage {
     public:
-      BasicTrajectory() : skip(0) { }
+      BasicTrajectory() : skip(0), prefetch(0) { }
 
 
       unsigned int skip;
+
+      //! Number of frames to read ahead on a background thread (0 = none)
+      unsigned int prefetch;
       std::string model_name, model_type, traj_name, traj_type;
 
       //! Model that describes the trajectory
@@ -530,16 +535,21 @@ namespace loos {
      * which frames of the trajectory to operate over.
      *
      * Use TrajectoryWithFrameIndices::frameList() to get a vector of
-     * unsigned ints representing which frames the user requested.
+     * unsigned ints representing which frames the user requested.  If
+     * --prefetch is given, the trajectory reads ahead along that list
+     * on a background thread (see PrefetchTrajectory).
      **/
     class TrajectoryWithFrameIndices : public OptionsPackage {
     public:
-      TrajectoryWithFrameIndices() : skip(0), stride(1), frame_index_spec("") { }
+      TrajectoryWithFrameIndices() : skip(0), stride(1), prefetch(0), frame_index_spec("") { }
 
       //! Returns the list of frames the user requested
       std::vector<uint> frameList() const;
 
       unsigned int skip, stride;
+
+      //! Number of frames to read ahead on a background thread (0 = none)
+      unsigned int prefetch;
       std::string frame_index_spec;
       std::string model_name, model_type, traj_name, traj_type;
 
@@ -0,0 +1,308 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <fstream>
+#include <algorithm>
+#include <exception>
+#include <cstdio>
+#include <ctime>
+
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <PairwiseRMSD.hpp>
+#include <MatrixBinary.hpp>
+#include <alignment.hpp>
+#include <ProgressCounters.hpp>
+#include <ProgressTriggers.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  CenteredFrames::CenteredFrames(AtomicGroup& subset, pTraj& traj, const std::vector<uint>& indices,
+                                 const std::string& scratch, const bool updates)
+    : _nframes(indices.size()), _natoms(subset.size())
+  {
+    if (_natoms == 0)
+      throw(LOOSError("Cannot compute RMSDs for an empty selection"));
+
+    std::ofstream ofs(scratch.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!ofs)
+      throw(FileOpenError(scratch));
+
+    PercentProgressWithTime watcher;
+    PercentTrigger trigger(0.1);
+    ProgressCounter<PercentTrigger, EstimatingCounter> slayer(trigger, EstimatingCounter(_nframes));
+    if (updates) {
+      slayer.attach(&watcher);
+      slayer.start();
+    }
+
+    std::vector<double> v(3 * _natoms);
+    try {
+      for (uint j=0; j<_nframes; ++j) {
+        if (!traj->readFrame(indices[j]))
+          throw(FileReadError(traj->filename(), "Cannot read trajectory frame"));
+        traj->updateGroupCoords(subset);
+        for (uint i=0; i<_natoms; ++i) {
+          GCoord c = subset[i]->coords();
+          v[i*3] = c.x();
+          v[i*3+1] = c.y();
+          v[i*3+2] = c.z();
+        }
+        alignment::centerAtOrigin(v);
+
+        ofs.write(reinterpret_cast<const char*>(&v[0]), v.size() * sizeof(double));
+        if (!ofs)
+          throw(FileWriteError(scratch));
+        if (updates)
+          slayer.update();
+      }
+      ofs.close();
+      if (!ofs)
+        throw(FileWriteError(scratch));
+
+      _file = boost::shared_ptr<internal::MappedFile>(new internal::MappedFile(scratch));
+    }
+    catch (...) {
+      std::remove(scratch.c_str());
+      throw;
+    }
+
+    // The mapping stays valid once the file is unlinked
+    std::remove(scratch.c_str());
+
+    if (updates)
+      slayer.finish();
+  }
+
+
+
+
+  namespace {
+
+    // Number of rows in a tile
+    const uint tile_rows = 64;
+
+
+    // Hands out tiles to the worker threads
+    class TileQueue {
+    public:
+      explicit TileQueue(const uint n) : _next(0), _n(n) { }
+
+      bool next(uint& t) {
+        boost::lock_guard<boost::mutex> lock(_mtx);
+        if (_next >= _n)
+          return(false);
+        t = _next++;
+        return(true);
+      }
+
+    private:
+      boost::mutex _mtx;
+      uint _next, _n;
+    };
+
+
+    struct StripResult {
+      StripResult() : max(0.0), sum(0.0) { }
+      double max, sum;
+      std::string error;
+    };
+
+
+    // Computes tiles of the strip holding columns [c0, c1).  When B is
+    // null, only the upper triangle of A against itself is computed
+    // and the strip is packed as in a Triangular matrix.  Otherwise,
+    // the strip is column-major.
+
+    struct StripWorker {
+      StripWorker(const CenteredFrames* a, const CenteredFrames* b, const uint first, const uint last,
+                  const uint n, float* s, TileQueue* q, StripResult* r)
+        : A(a), B(b), c0(first), c1(last), nrows(n), strip(s), queue(q), result(r) { }
+
+      void operator()() {
+        try {
+          uint t;
+          uint natoms = A->natoms();
+          ulong base = (static_cast<ulong>(c0) * (c0 + 1)) / 2;
+
+          while (queue->next(t)) {
+            uint r0 = t * tile_rows;
+            uint r1 = std::min(r0 + tile_rows, nrows);
+
+            for (uint i=r0; i<r1; ++i) {
+              if (B == 0) {
+                for (uint j=std::max(i, c0); j<c1; ++j) {
+                  float d = 0.0;
+                  if (i != j) {
+                    d = alignment::centeredRMSD(A->frame(j), A->frame(i), natoms);
+                    accumulate(d);
+                  }
+                  strip[(static_cast<ulong>(j) * (j + 1)) / 2 + i - base] = d;
+                }
+              } else {
+                for (uint j=c0; j<c1; ++j) {
+                  float d = alignment::centeredRMSD(A->frame(i), B->frame(j), natoms);
+                  accumulate(d);
+                  strip[static_cast<ulong>(j - c0) * nrows + i] = d;
+                }
+              }
+            }
+          }
+        }
+        catch (std::exception& e) {
+          result->error = e.what();
+        }
+      }
+
+      void accumulate(const float d) {
+        result->sum += d;
+        if (d > result->max)
+          result->max = d;
+      }
+
+      const CenteredFrames* A;
+      const CenteredFrames* B;
+      uint c0, c1, nrows;
+      float* strip;
+      TileQueue* queue;
+      StripResult* result;
+    };
+
+
+
+    PairwiseRMSDStats tiledRMSD(const CenteredFrames& A, const CenteredFrames* B,
+                                const std::string& fname, const std::string& meta,
+                                const uint blocksize, const uint nthreads, const bool verbose)
+    {
+      if (B != 0 && A.natoms() != B->natoms())
+        throw(LOOSError("Cannot compute RMSDs between selections with different numbers of atoms"));
+
+      uint nrows = A.size();
+      uint ncols = B ? B->size() : A.size();
+      uint bs = blocksize ? blocksize : 1;
+      uint nt = nthreads ? nthreads : boost::thread::hardware_concurrency();
+      if (nt == 0)
+        nt = 1;
+
+      std::ofstream ofs;
+      if (!fname.empty()) {
+        ofs.open(fname.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+          throw(FileOpenError(fname));
+
+        internal::BinaryMatrixHeader hdr;
+        hdr.type = internal::BinaryMatrixType<float>::code;
+        hdr.element_size = sizeof(float);
+        hdr.rows = nrows;
+        hdr.cols = ncols;
+        if (B) {
+          hdr.order = internal::BinaryMatrixOrder<Math::ColMajor>::code;
+          hdr.count = static_cast<boost::uint64_t>(nrows) * ncols;
+        } else {
+          hdr.order = internal::BinaryMatrixOrder<Math::Triangular>::code;
+          hdr.count = (static_cast<boost::uint64_t>(nrows) * (nrows + 1)) / 2;
+        }
+        hdr.meta = meta;
+        internal::writeBinaryMatrixHeader(ofs, hdr);
+      }
+
+      PairwiseRMSDStats stats;
+      double sum = 0.0;
+      std::vector<float> strip;
+      time_t start_time = time(0);
+      uint nstrips = (ncols + bs - 1) / bs;
+
+      for (uint b=0; b<nstrips; ++b) {
+        uint c0 = b * bs;
+        uint c1 = std::min(c0 + bs, ncols);
+        uint rows = B ? nrows : c1;
+        ulong size = B ? static_cast<ulong>(c1 - c0) * nrows
+          : (static_cast<ulong>(c1) * (c1 + 1)) / 2 - (static_cast<ulong>(c0) * (c0 + 1)) / 2;
+        strip.resize(size);
+
+        uint ntiles = (rows + tile_rows - 1) / tile_rows;
+        uint n = std::min(nt, ntiles);
+        TileQueue queue(ntiles);
+        std::vector<StripResult> results(n);
+
+        boost::thread_group threads;
+        for (uint t=1; t<n; ++t)
+          threads.create_thread(StripWorker(&A, B, c0, c1, rows, &strip[0], &queue, &(results[t])));
+        if (n > 0)
+          StripWorker(&A, B, c0, c1, rows, &strip[0], &queue, &(results[0]))();
+        threads.join_all();
+
+        for (uint t=0; t<n; ++t) {
+          if (!results[t].error.empty())
+            throw(LOOSError(results[t].error));
+          sum += results[t].sum;
+          if (results[t].max > stats.max)
+            stats.max = results[t].max;
+        }
+
+        if (ofs.is_open()) {
+          ofs.write(reinterpret_cast<const char*>(&strip[0]), size * sizeof(float));
+          if (!ofs)
+            throw(FileWriteError(fname));
+        }
+
+        if (verbose) {
+          double done = B ? static_cast<double>(c1) / ncols : (static_cast<double>(c1) * c1) / (static_cast<double>(ncols) * ncols);
+          time_t dt = time(0) - start_time;
+          uint d = static_cast<uint>(dt * (1.0 - done) / done);
+          std::cerr << boost::format("Strip %5d /%5d, Elapsed = %5d s, Remaining = %02d:%02d:%02d\n")
+            % (b+1) % nstrips % dt % (d / 3600) % ((d % 3600) / 60) % (d % 60);
+        }
+      }
+
+      double total = B ? static_cast<double>(nrows) * ncols : (static_cast<double>(nrows) * (nrows - 1)) / 2;
+      if (total > 0)
+        stats.avg = sum / total;
+
+      return(stats);
+    }
+
+  }
+
+
+
+  PairwiseRMSDStats pairwiseRMSD(const CenteredFrames& A, const std::string& fname, const std::string& meta,
+                                 const uint blocksize, const uint nthreads, const bool verbose)
+  {
+    return(tiledRMSD(A, 0, fname, meta, blocksize, nthreads, verbose));
+  }
+
+
+  PairwiseRMSDStats pairwiseRMSD(const CenteredFrames& A, const CenteredFrames& B,
+                                 const std::string& fname, const std::string& meta,
+                                 const uint blocksize, const uint nthreads, const bool verbose)
+  {
+    return(tiledRMSD(A, &B, fname, meta, blocksize, nthreads, verbose));
+  }
+
+}
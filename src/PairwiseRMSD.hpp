@@ -0,0 +1,112 @@
+/*
+  PairwiseRMSD.hpp
+
+  Out-of-core all-to-all RMSD
+*/
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_PAIRWISERMSD_HPP)
+#define LOOS_PAIRWISERMSD_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+#include <MappedFile.hpp>
+
+
+namespace loos {
+
+  //! Centered coordinates for a set of trajectory frames, kept in a scratch file
+  /**
+   * The selected atoms for each frame are read once, centered at the
+   * origin, and written to a scratch file which is then mapped into
+   * memory.  The scratch file is removed as soon as it is mapped, so
+   * nothing is left behind even if the program is interrupted.  Only
+   * the frames actually being used need to be resident, so this can
+   * hold far more frames than will fit in memory.
+   */
+  class CenteredFrames {
+  public:
+    CenteredFrames(AtomicGroup& subset, pTraj& traj, const std::vector<uint>& indices,
+                   const std::string& scratch, const bool updates = false);
+
+    uint size() const { return(_nframes); }
+    uint natoms() const { return(_natoms); }
+
+    //! Packed xyz coordinates for the ith frame
+    const double* frame(const uint i) const {
+      return(reinterpret_cast<const double*>(_file->data()) + static_cast<ulong>(i) * 3 * _natoms);
+    }
+
+  private:
+    boost::shared_ptr<internal::MappedFile> _file;
+    uint _nframes, _natoms;
+  };
+
+
+
+  //! Summary of a pair-wise RMSD calculation
+  struct PairwiseRMSDStats {
+    PairwiseRMSDStats() : max(0.0), avg(0.0) { }
+    double max, avg;
+  };
+
+
+  //! Computes the all-to-all RMSD between the frames in A using tiles
+  /**
+   * The matrix is computed a strip of \a blocksize columns at a time.
+   * Each strip is split into tiles of rows that are handed out to \a
+   * nthreads threads (0 means use all available cores), and the
+   * finished strip is appended to \a fname.  Only the strip being
+   * computed is held in memory, which is up to \a blocksize times
+   * the number of frames values (rather than the whole matrix).
+   *
+   * Since the matrix is symmetric, only the upper triangle is
+   * computed and it is written as a triangular binary matrix (see
+   * writeBinaryMatrix()).  Reading it with readBinaryMatrix() into a
+   * RealMatrix gives the full matrix.  If \a fname is empty, no
+   * matrix is written and only the statistics are returned.
+   */
+  PairwiseRMSDStats pairwiseRMSD(const CenteredFrames& A, const std::string& fname, const std::string& meta,
+                                 const uint blocksize, const uint nthreads, const bool verbose = false);
+
+  //! Computes the RMSD between every frame in A and every frame in B
+  /**
+   * As above, but the rectangular A.size() x B.size() matrix is
+   * written column-major, a strip of columns of B at a time.
+   */
+  PairwiseRMSDStats pairwiseRMSD(const CenteredFrames& A, const CenteredFrames& B,
+                                 const std::string& fname, const std::string& meta,
+                                 const uint blocksize, const uint nthreads, const bool verbose = false);
+
+}
+
+
+#endif
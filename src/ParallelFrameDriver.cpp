@@ -0,0 +1,57 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <boost/filesystem.hpp>
+
+#include <ParallelFrameDriver.hpp>
+#include <sfactories.hpp>
+
+
+namespace loos {
+
+
+  ParallelFrameDriver::ParallelFrameDriver(const AtomicGroup& model, const pTraj& traj, const uint nthreads, const std::string& traj_type)
+    : _model(model), _traj(traj), _nthreads(nthreads), _traj_type(traj_type)
+  {
+    if (_nthreads == 0)
+      _nthreads = boost::thread::hardware_concurrency();
+    if (_nthreads == 0)
+      _nthreads = 1;
+  }
+
+
+  // Only trajectories backed by a single file can be opened again by
+  // each thread
+  bool ParallelFrameDriver::canReopen() const {
+    boost::system::error_code ec;
+    return(boost::filesystem::is_regular_file(_traj->filename(), ec));
+  }
+
+
+  pTraj ParallelFrameDriver::openTrajectory(const AtomicGroup& model) const {
+    if (_traj_type.empty())
+      return(createTrajectory(_traj->filename(), model));
+
+    return(createTrajectory(_traj->filename(), _traj_type, model));
+  }
+
+}
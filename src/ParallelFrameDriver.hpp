@@ -0,0 +1,206 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_PARALLEL_FRAME_DRIVER_HPP)
+#define LOOS_PARALLEL_FRAME_DRIVER_HPP
+
+#include <string>
+#include <vector>
+#include <exception>
+
+#include <boost/thread/thread.hpp>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+
+
+namespace loos {
+
+
+  //! Runs a per-frame analysis over a trajectory using multiple threads
+  /**
+   * The list of frames (e.g. from assignTrajectoryFrames() or
+   * TrajectoryWithFrameIndices::frameList()) is divided into
+   * contiguous blocks, one per thread.  Each thread has its own copy
+   * of the model and its own trajectory (opened from the same file),
+   * so the threads share no mutable state.  The first thread uses the
+   * model and trajectory passed to the driver.
+   *
+   * The analysis is supplied as a worker class that must provide:
+   * \code
+   * class Worker {
+   * public:
+   *   Worker(const Worker&);                 // Workers are copied for each thread
+   *   void setup(AtomicGroup& model);        // Make selections from this thread's model
+   *   void process(const uint i);            // The model holds the coordinates for frames[i]
+   *   void merge(const Worker& other);       // Fold another worker's results into this one
+   * };
+   * \endcode
+   *
+   * The worker passed to run() handles the first block, and the
+   * workers for the remaining blocks are merged into it in frame
+   * order once all threads are done, so results that are appended to
+   * in process() stay in trajectory order.  Results indexed by \a i
+   * may also be written directly into storage shared by all workers,
+   * since each frame is processed by exactly one thread.
+   *
+   * Calls to setup() are made serially before any threads are started,
+   * so they may safely use the selection parser.  Only process() runs
+   * concurrently.
+   *
+   * When only one thread is requested, or when the trajectory cannot
+   * be reopened (e.g. a MultiTrajectory or one read from a stream),
+   * the frames are processed serially, exactly as a regular
+   * readFrame()/updateGroupCoords() loop would.  Either way, once
+   * run() returns, the trajectory and model passed to the driver are
+   * left at the last frame in the list.
+   */
+  class ParallelFrameDriver {
+  public:
+
+    //! Drive frames from \a traj, using up to \a nthreads threads (0 = all available)
+    /**
+     * If the trajectory type had to be given explicitly when it was
+     * created, pass it as \a traj_type so the other threads can reopen
+     * it.
+     */
+    ParallelFrameDriver(const AtomicGroup& model, const pTraj& traj, const uint nthreads = 1, const std::string& traj_type = "");
+
+    //! Number of threads that will be used (at most)
+    uint threads() const { return(_nthreads); }
+
+
+    //! Process each frame in \a frames with \a worker (see class description)
+    template<class W>
+    void run(W& worker, const std::vector<uint>& frames) {
+      uint n = _nthreads;
+      if (n > frames.size())
+        n = frames.size();
+
+      if (n <= 1 || !canReopen()) {
+        AtomicGroup model(_model);
+        worker.setup(model);
+        Task<W> task(&worker, &model, _traj, &frames, 0, frames.size(), 0);
+        task();
+        return;
+      }
+
+      // Copy the workers before any of them has been setup...
+      std::vector<W> workers(n-1, worker);
+      std::vector<AtomicGroup> models(n);
+      std::vector<pTraj> trajs(n);
+      std::vector<std::string> errors(n);
+
+      models[0] = _model;
+      trajs[0] = _traj;
+      worker.setup(models[0]);
+      for (uint k=1; k<n; ++k) {
+        models[k] = _model.copy();
+        trajs[k] = openTrajectory(models[k]);
+        workers[k-1].setup(models[k]);
+      }
+
+      boost::thread_group threads;
+      for (uint k=1; k<n; ++k)
+        threads.create_thread(Task<W>(&(workers[k-1]), &(models[k]), trajs[k], &frames,
+                                      blockStart(k, n, frames.size()), blockStart(k+1, n, frames.size()), &(errors[k])));
+
+      Task<W>(&worker, &(models[0]), trajs[0], &frames, 0, blockStart(1, n, frames.size()), &(errors[0]))();
+      threads.join_all();
+
+      for (uint k=0; k<n; ++k)
+        if (!errors[k].empty())
+          throw(LOOSError(errors[k]));
+
+      for (uint k=1; k<n; ++k)
+        worker.merge(workers[k-1]);
+
+      // The first block ends before the last frame, so finish where
+      // the serial loop would have
+      _traj->readFrame(frames.back());
+      _traj->updateGroupCoords(models[0]);
+    }
+
+
+  private:
+
+    // Reads and processes a block of frames.  When error is non-null,
+    // exceptions are caught and their message stored there so they can
+    // be rethrown in the calling thread.
+    template<class W>
+    struct Task {
+      Task(W* w, AtomicGroup* m, const pTraj& t, const std::vector<uint>* f, const uint b, const uint e, std::string* err)
+        : worker(w), model(m), traj(t), frames(f), begin(b), end(e), error(err) { }
+
+      void operator()() {
+        if (error == 0) {
+          processBlock();
+          return;
+        }
+
+        try {
+          processBlock();
+        }
+        catch (std::exception& e) {
+          *error = e.what();
+        }
+        catch (...) {
+          *error = "Unknown exception while processing trajectory frames";
+        }
+      }
+
+      void processBlock() {
+        for (uint i=begin; i<end; ++i) {
+          traj->readFrame((*frames)[i]);
+          traj->updateGroupCoords(*model);
+          worker->process(i);
+        }
+      }
+
+      W* worker;
+      AtomicGroup* model;
+      pTraj traj;
+      const std::vector<uint>* frames;
+      uint begin, end;
+      std::string* error;
+    };
+
+
+    static uint blockStart(const uint k, const uint n, const uint nframes) {
+      return(static_cast<uint>((static_cast<unsigned long>(k) * nframes) / n));
+    }
+
+    bool canReopen() const;
+    pTraj openTrajectory(const AtomicGroup& model) const;
+
+    AtomicGroup _model;
+    pTraj _traj;
+    uint _nthreads;
+    std::string _traj_type;
+  };
+
+
+}
+
+#endif
@@ -68,7 +68,10 @@ namespace loos {
    *  Finally, the standard precedence and associativity that apply in
    *  C++ apply here.  Expressions are evaluated left to right and
    *  parenthesis may be used to alter precedence/evaluation order.
-   *  Unlike C/C++ however, the logical operators do not short-circuit.
+   *  When the selection is run by the Kernel itself, the logical
+   *  operators do not short-circuit, but they do when it is compiled
+   *  by the KernelSelector (the default).  Since selections have no
+   *  side-effects, the results are the same.
    *
    *  If there is a syntax error in the selection string, then a
    *  runtime_error() is thrown.
@@ -0,0 +1,245 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <exception>
+#include <algorithm>
+
+#include <PrefetchTraj.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+	PrefetchTrajectory::PrefetchTrajectory(const pTraj& traj, const uint depth)
+		: _traj(traj),
+		  _depth(depth == 0 ? 1 : depth),
+		  _description(traj->description()),
+		  _traj_filename(traj->filename()),
+		  _natoms(traj->natoms()),
+		  _nframes(traj->nframes()),
+		  _timestep(traj->timestep()),
+		  _has_velocities(traj->hasVelocities()),
+		  _velocity_conversion(traj->velocityConversionFactor()),
+		  _next(1),
+		  _position(0),
+		  _generation(0),
+		  _reading(false),
+		  _quit(false)
+	{
+		init();
+	}
+
+
+	PrefetchTrajectory::PrefetchTrajectory(const pTraj& traj, const std::vector<uint>& frames, const uint depth)
+		: _traj(traj),
+		  _depth(depth == 0 ? 1 : depth),
+		  _frames(frames),
+		  _description(traj->description()),
+		  _traj_filename(traj->filename()),
+		  _natoms(traj->natoms()),
+		  _nframes(traj->nframes()),
+		  _timestep(traj->timestep()),
+		  _has_velocities(traj->hasVelocities()),
+		  _velocity_conversion(traj->velocityConversionFactor()),
+		  _next(frames.empty() ? 1 : frames[0]),
+		  _position(0),
+		  _generation(0),
+		  _reading(false),
+		  _quit(false)
+	{
+		init();
+	}
+
+
+	void PrefetchTrajectory::init() {
+		_filename = _traj_filename;
+
+		// The first frame is read here, so it is cached just as with
+		// any other trajectory...
+		if (_nframes > 0) {
+			_traj->rewind();
+			readInto(_current);
+		}
+		_current.index = 0;
+		_current.ok = true;
+		cached_first = true;
+
+		_thread = boost::thread(&PrefetchTrajectory::readAhead, this);
+	}
+
+
+	PrefetchTrajectory::~PrefetchTrajectory() {
+		{
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_space.notify_all();
+		_thread.join();
+	}
+
+
+
+	// Copies the wrapped trajectory's current frame
+	void PrefetchTrajectory::readInto(Frame& frame) {
+		frame.coords = _traj->coords();
+		if (_has_velocities)
+			frame.velocities = _traj->velocities();
+		frame.has_box = _traj->hasPeriodicBox();
+		if (frame.has_box)
+			frame.box = _traj->periodicBox();
+	}
+
+
+	// Body of the background thread.  The wrapped trajectory is only
+	// used without the lock held, so the main thread is never blocked
+	// by I/O unless it is waiting for the frame being read.
+	void PrefetchTrajectory::readAhead() {
+		boost::unique_lock<boost::mutex> lock(_mutex);
+
+		while (true) {
+			while (!_quit && (_buffer.size() >= _depth || _next >= _nframes))
+				_space.wait(lock);
+			if (_quit)
+				return;
+
+			uint i = _next;
+			unsigned long generation = _generation;
+			_reading = true;
+			lock.unlock();
+
+			Frame frame;
+			frame.index = i;
+			try {
+				frame.ok = _traj->readFrame(i);
+				if (frame.ok)
+					readInto(frame);
+			}
+			catch (std::exception& e) {
+				frame.error = e.what();
+			}
+			catch (...) {
+				frame.error = "Unknown error while reading ahead in " + _traj_filename;
+			}
+
+			lock.lock();
+			_reading = false;
+
+			// Discard the frame if the buffer was reset while reading
+			if (generation == _generation) {
+				_buffer.push_back(Frame());
+				std::swap(_buffer.back(), frame);
+				advance();
+			}
+			_ready.notify_all();
+		}
+	}
+
+
+	// Moves on to the frame after _next.  Must be called with the lock held
+	void PrefetchTrajectory::advance() {
+		if (_frames.empty()) {
+			++_next;
+			return;
+		}
+
+		++_position;
+		_next = (_position < _frames.size()) ? _frames[_position] : _nframes;
+	}
+
+
+	// Must be called with the lock held.  When reading along a list,
+	// the thread picks it up at frame i (looking ahead of where it
+	// was first), or stops after frame i if it isn't in the list.
+	void PrefetchTrajectory::restartAt(const uint i) {
+		_buffer.clear();
+		_next = i;
+		++_generation;
+
+		if (!_frames.empty()) {
+			std::vector<uint>::const_iterator p = std::find(_frames.begin() + std::min(_position, static_cast<uint>(_frames.size())), _frames.end(), i);
+			if (p == _frames.end())
+				p = std::find(_frames.begin(), _frames.end(), i);
+			_position = (p == _frames.end()) ? _frames.size() : static_cast<uint>(p - _frames.begin());
+		}
+
+		_space.notify_all();
+	}
+
+
+
+	bool PrefetchTrajectory::parseFrame() {
+		uint i = _current_frame;
+		if (i >= _nframes)
+			return(false);
+
+		{
+			boost::unique_lock<boost::mutex> lock(_mutex);
+
+			while (true) {
+				if (!_buffer.empty()) {
+					if (_buffer.front().index == i)
+						break;
+					restartAt(i);
+				} else if (_next != i)
+					restartAt(i);
+				else
+					_ready.wait(lock);
+			}
+
+			std::swap(_current, _buffer.front());
+			_buffer.pop_front();
+		}
+		_space.notify_all();
+
+		if (!_current.error.empty())
+			throw(LOOSError(_current.error));
+
+		return(_current.ok);
+	}
+
+
+	// The wrapped trajectory can only be changed while the thread is
+	// not reading from it.  Frames already in the buffer were read with
+	// the old subset, so the thread starts again from the first of them.
+	void PrefetchTrajectory::setAtomSubsetImpl() {
+		boost::unique_lock<boost::mutex> lock(_mutex);
+		while (_reading)
+			_ready.wait(lock);
+
+		_traj->setAtomSubset(_atom_subset);
+		restartAt(_buffer.empty() ? _next : _buffer.front().index);
+	}
+
+
+	void PrefetchTrajectory::updateGroupCoordsImpl(AtomicGroup& g) {
+		g.copyCoordinatesWithIndex(_current.coords);
+		if (_current.has_box)
+			g.periodicBox(_current.box);
+	}
+
+
+	void PrefetchTrajectory::updateGroupVelocitiesImpl(AtomicGroup& g) {
+		g.copyVelocitiesWithIndex(_current.velocities);
+	}
+
+}
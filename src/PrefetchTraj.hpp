@@ -0,0 +1,163 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_PREFETCHTRAJ_HPP)
+#define LOOS_PREFETCHTRAJ_HPP
+
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+
+
+
+namespace loos {
+
+	//! Reads frames from another trajectory ahead of time on a background thread
+	/**
+	 * This class wraps an existing trajectory (pTraj) and can be used
+	 * anywhere a regular Trajectory can.  A background thread reads and
+	 * decodes the frames that follow the current one into a buffer that
+	 * holds up to \a depth frames, so reading a frame sequentially
+	 * returns as soon as that frame is ready and I/O overlaps with
+	 * whatever is done with the previous frame.
+	 *
+	 * If the frames to be read are known ahead of time (e.g. a --range
+	 * or a stride), they can be given as a list and the background
+	 * thread reads ahead along that list instead of sequentially.
+	 *
+	 * Reading frames out of order is still correct.  If the requested
+	 * frame is not the next one in the buffer, the buffer is discarded
+	 * and the background thread starts again from the requested frame
+	 * (picking up the list from there if the frame is in it).
+	 *
+	 * An atom subset (see Trajectory::setAtomSubset()) is passed on
+	 * to the wrapped trajectory.  Any frames already read ahead are
+	 * discarded and read again with the new subset.
+	 *
+	 * Once wrapped, the original trajectory belongs to the background
+	 * thread and must not be used directly.
+	 */
+	class PrefetchTrajectory : public Trajectory {
+	public:
+
+		//! Wrap \a traj, reading up to \a depth frames ahead
+		explicit PrefetchTrajectory(const pTraj& traj, const uint depth = 4);
+
+		//! Wrap \a traj, reading up to \a depth frames ahead in the order given by \a frames
+		PrefetchTrajectory(const pTraj& traj, const std::vector<uint>& frames, const uint depth = 4);
+
+		virtual ~PrefetchTrajectory();
+
+		virtual std::string description() const { return(_description); }
+
+		//! The filename of the wrapped trajectory
+		virtual std::string filename() const { return(_traj_filename); }
+
+		virtual uint natoms() const { return(_natoms); }
+		virtual float timestep() const { return(_timestep); }
+		virtual uint nframes() const { return(_nframes); }
+
+		virtual bool hasVelocities() const { return(_has_velocities); }
+		virtual double velocityConversionFactor() const { return(_velocity_conversion); }
+
+		virtual bool hasPeriodicBox() const { return(_current.has_box); }
+		virtual GCoord periodicBox() const { return(_current.box); }
+
+		virtual std::vector<GCoord> coords() const { return(_current.coords); }
+
+		//! Maximum number of frames read ahead
+		uint depth() const { return(_depth); }
+
+	private:
+
+		// One decoded frame
+		struct Frame {
+			Frame() : index(0), ok(false), has_box(false) { }
+
+			uint index;
+			bool ok;
+			std::string error;
+			std::vector<GCoord> coords;
+			std::vector<GCoord> velocities;
+			bool has_box;
+			GCoord box;
+		};
+
+
+		virtual void rewindImpl() { }
+		virtual void seekNextFrameImpl() { }
+		virtual void seekFrameImpl(const uint) { }
+		virtual bool parseFrame();
+		virtual void updateGroupCoordsImpl(AtomicGroup& g);
+		virtual void updateGroupVelocitiesImpl(AtomicGroup& g);
+		virtual std::vector<GCoord> velocitiesImpl() const { return(_current.velocities); }
+		virtual void setAtomSubsetImpl();
+
+		void init();
+		void readAhead();
+		void readInto(Frame& frame);
+		void advance();
+		void restartAt(const uint i);
+
+		PrefetchTrajectory(const PrefetchTrajectory&);
+		PrefetchTrajectory& operator=(const PrefetchTrajectory&);
+
+
+		pTraj _traj;
+		uint _depth;
+		std::vector<uint> _frames;  // Order to read ahead in (empty = sequential)
+
+		std::string _description, _traj_filename;
+		uint _natoms, _nframes;
+		float _timestep;
+		bool _has_velocities;
+		double _velocity_conversion;
+
+		Frame _current;
+
+		// Shared with the background thread...
+		boost::mutex _mutex;
+		boost::condition_variable _ready, _space;
+		std::deque<Frame> _buffer;
+		uint _next;                // Next frame the thread will read
+		uint _position;            // ...and its position in _frames
+		unsigned long _generation; // Incremented whenever the buffer is discarded
+		bool _reading;             // The thread is using the wrapped trajectory
+		bool _quit;
+
+		boost::thread _thread;
+	};
+
+}
+
+
+
+#endif
@@ -187,6 +187,9 @@ namespace loos {
   }
 
   bool KernelSelector::operator()(const pAtom& pa) const {
+    if (pred && pa)
+      return((*pred)(*pa));
+
     krnl.execute(pa);
     if (krnl.stack().size() != 1) {
       throw(LOOSError("Execution error - unexpected values on stack"));
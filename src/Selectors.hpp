@@ -30,6 +30,7 @@
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
 #include <Kernel.hpp>
+#include <KernelPredicate.hpp>
 
 
 namespace loos {
@@ -215,15 +216,27 @@ namespace loos {
    * KernelSelector sel(parsed.kernel());
    * \endcode
    *
+   * By default, the Kernel is compiled into a tree of predicates (see
+   * internal::compileKernel()) which is considerably faster than
+   * running the Kernel's stack machine.  If the Kernel cannot be
+   * compiled, or if \a compile is false, the Kernel itself is executed
+   * for each atom.
    */
   class KernelSelector : public AtomSelector {
   public:
-    explicit KernelSelector(Kernel& k) : krnl(k) { }
+    explicit KernelSelector(Kernel& k, const bool compile = true) : krnl(k) {
+      if (compile)
+        pred = internal::compileKernel(krnl);
+    }
 
     bool operator()(const pAtom& pa) const;
 
+    //! True if the compiled predicate tree is used rather than the Kernel
+    bool isCompiled() const { return(pred.get() != 0); }
+
   private:
     Kernel& krnl;
+    internal::pPredicate pred;
 
   };
 
@@ -0,0 +1,398 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <SystemCache.hpp>
+#include <TrajectoryIndex.hpp>
+#include <MappedFile.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // On-disk layout (native byte order, which is checked on read):
+    //
+    //   char[8]       magic
+    //   uint32        byte-order mark
+    //   uint32        version
+    //   char[8]       file type
+    //   uint64        source file size
+    //   int64         source file modification time
+    //   uint64        hash of the whole source file
+    //   uint32        size of an AtomRecord
+    //   uint32        group flags
+    //   double[3]     periodic box
+    //   uint64        number of atoms
+    //   uint64        number of interned strings
+    //   uint64        total length of the strings
+    //   uint64        total number of bonds
+    //   AtomRecord[]  atoms
+    //   uint64[]      offset of each string (plus one past the end)
+    //   uint64[]      offset of each atom's bonds (plus one past the end)
+    //   int32[]       bonds (atom ids)
+    //   char[]        strings
+    //
+    // Every section but the last is a multiple of 8 bytes long, so the
+    // mapped records are suitably aligned.
+
+    const char cache_magic[8] = { 'L', 'O', 'O', 'S', 'S', 'Y', 'S', '\0' };
+    const boost::uint32_t cache_bom = 0x01020304;
+    const boost::uint32_t cache_version = 2;
+
+    const boost::uint32_t periodic_flag = 0x01;
+    const boost::uint32_t sorted_flag = 0x02;
+
+
+    // Indices into AtomRecord::strings
+    enum { RECORD_NAME, NAME, ALTLOC, RESNAME, CHAINID, ICODE, SEGID, PDBELEMENT, NUM_STRINGS };
+
+    struct AtomRecord {
+      double b, q, charge, mass;
+      double coords[3];
+      double velocities[3];
+      boost::uint64_t mask;
+      boost::int32_t id, resid, atomic_number, atom_type;
+      boost::uint32_t index;
+      boost::uint32_t strings[NUM_STRINGS];
+      boost::uint32_t pad;
+    };
+
+
+    struct Header {
+      char magic[8];
+      boost::uint32_t bom;
+      boost::uint32_t version;
+      char filetype[8];
+      boost::uint64_t size;
+      boost::int64_t mtime;
+      boost::uint64_t hash;
+      boost::uint32_t record_size;
+      boost::uint32_t flags;
+      double box[3];
+      boost::uint64_t natoms;
+      boost::uint64_t nstrings;
+      boost::uint64_t string_bytes;
+      boost::uint64_t nbonds;
+    };
+
+
+    void fileTypeTag(const std::string& filetype, char* tag) {
+      std::memset(tag, 0, 8);
+      std::memcpy(tag, filetype.data(), std::min(filetype.size(), static_cast<std::string::size_type>(8)));
+    }
+
+
+    // Assigns each distinct string an index, in order of appearance
+    class StringTable {
+    public:
+      StringTable() : _offsets(1, 0) { }
+
+      boost::uint32_t intern(const std::string& s) {
+        std::map<std::string, boost::uint32_t>::iterator i = _index.find(s);
+        if (i != _index.end())
+          return(i->second);
+
+        boost::uint32_t k = _offsets.size() - 1;
+        _index[s] = k;
+        _data += s;
+        _offsets.push_back(_data.size());
+        return(k);
+      }
+
+      const std::vector<boost::uint64_t>& offsets() const { return(_offsets); }
+      const std::string& data() const { return(_data); }
+      boost::uint64_t size() const { return(_offsets.size() - 1); }
+
+    private:
+      std::map<std::string, boost::uint32_t> _index;
+      std::vector<boost::uint64_t> _offsets;
+      std::string _data;
+    };
+
+  }
+
+
+  const std::string SystemCache::suffix(".loossys");
+  bool SystemCache::_enabled = true;
+  boost::uint64_t SystemCache::_minimum_size = 1048576;
+
+
+  SystemCache::SystemCache(const std::string& filename, const std::string& filetype)
+    : _filename(filename), _cachename(filename + suffix), _filetype(filetype)
+  { }
+
+
+
+  pAtomicGroup SystemCache::read() const {
+    pAtomicGroup null_group;
+    if (!_enabled)
+      return(null_group);
+
+    internal::FileStamp current;
+    if (!internal::stampFile(_filename, current, true) || current.size < _minimum_size)
+      return(null_group);
+
+    boost::system::error_code ec;
+    if (!boost::filesystem::is_regular_file(_cachename, ec))
+      return(null_group);
+
+    boost::shared_ptr<internal::MappedFile> file;
+    try {
+      file = boost::shared_ptr<internal::MappedFile>(new internal::MappedFile(_cachename));
+    }
+    catch (...) {
+      return(null_group);
+    }
+
+    const char* data = file->data();
+    boost::uint64_t length = file->size();
+    if (length < sizeof(Header))
+      return(null_group);
+
+    Header hdr;
+    std::memcpy(&hdr, data, sizeof(Header));
+
+    char expected_type[8];
+    fileTypeTag(_filetype, expected_type);
+    if (std::memcmp(hdr.magic, cache_magic, 8) != 0
+        || hdr.bom != cache_bom
+        || hdr.version != cache_version
+        || std::memcmp(hdr.filetype, expected_type, 8) != 0
+        || hdr.record_size != sizeof(AtomRecord))
+      return(null_group);
+
+    internal::FileStamp cached;
+    cached.size = hdr.size;
+    cached.mtime = hdr.mtime;
+    cached.hash = hdr.hash;
+    if (cached != current)
+      return(null_group);
+
+    // Guard against a truncated or corrupted cache (the counts are
+    // checked against the length first so the sums can't overflow)
+    if (hdr.natoms > length || hdr.nstrings > length || hdr.string_bytes > length || hdr.nbonds > length)
+      return(null_group);
+    boost::uint64_t expected_length = sizeof(Header)
+      + hdr.natoms * sizeof(AtomRecord)
+      + (hdr.nstrings + 1) * sizeof(boost::uint64_t)
+      + (hdr.natoms + 1) * sizeof(boost::uint64_t)
+      + ((hdr.nbonds * sizeof(boost::int32_t) + 7) & ~static_cast<boost::uint64_t>(7))
+      + hdr.string_bytes;
+    if (expected_length != length)
+      return(null_group);
+
+    const AtomRecord* records = reinterpret_cast<const AtomRecord*>(data + sizeof(Header));
+    const boost::uint64_t* string_offsets = reinterpret_cast<const boost::uint64_t*>(records + hdr.natoms);
+    const boost::uint64_t* bond_offsets = string_offsets + hdr.nstrings + 1;
+    const boost::int32_t* bonds = reinterpret_cast<const boost::int32_t*>(bond_offsets + hdr.natoms + 1);
+    const char* string_data = data + (length - hdr.string_bytes);
+
+    std::vector<std::string> strings(hdr.nstrings);
+    for (boost::uint64_t i=0; i<hdr.nstrings; ++i) {
+      if (string_offsets[i] > string_offsets[i+1] || string_offsets[i+1] > hdr.string_bytes)
+        return(null_group);
+      strings[i].assign(string_data + string_offsets[i], string_offsets[i+1] - string_offsets[i]);
+    }
+
+    if (bond_offsets[0] != 0 || bond_offsets[hdr.natoms] != hdr.nbonds)
+      return(null_group);
+
+    pAtomicGroup grp(new AtomicGroup);
+    std::vector<int> atom_bonds;
+    for (boost::uint64_t i=0; i<hdr.natoms; ++i) {
+      const AtomRecord& r = records[i];
+      for (uint k=0; k<NUM_STRINGS; ++k)
+        if (r.strings[k] >= hdr.nstrings)
+          return(null_group);
+      if (bond_offsets[i] > bond_offsets[i+1])
+        return(null_group);
+
+      pAtom pa(new Atom);
+      pa->id(r.id);
+      pa->index(r.index);
+      pa->recordName(strings[r.strings[RECORD_NAME]]);
+      pa->name(strings[r.strings[NAME]]);
+      pa->altLoc(strings[r.strings[ALTLOC]]);
+      pa->resname(strings[r.strings[RESNAME]]);
+      pa->chainId(strings[r.strings[CHAINID]]);
+      pa->resid(r.resid);
+      pa->atomic_number(r.atomic_number);
+      pa->iCode(strings[r.strings[ICODE]]);
+      pa->bfactor(r.b);
+      pa->occupancy(r.q);
+      pa->charge(r.charge);
+      pa->mass(r.mass);
+      pa->segid(strings[r.strings[SEGID]]);
+      pa->PDBelement(strings[r.strings[PDBELEMENT]]);
+      pa->atomType(r.atom_type);
+      pa->coords(GCoord(r.coords[0], r.coords[1], r.coords[2]));
+      pa->velocities(GCoord(r.velocities[0], r.velocities[1], r.velocities[2]));
+
+      atom_bonds.assign(bonds + bond_offsets[i], bonds + bond_offsets[i+1]);
+      pa->setBonds(atom_bonds);
+
+      // The setters above flag properties that may not have been set
+      // in the original, so restore its property bits exactly
+      pa->clearProperty(static_cast<Atom::bits>(~0u));
+      pa->setProperty(static_cast<Atom::bits>(r.mask));
+
+      grp->append(pa);
+    }
+
+    if (hdr.flags & periodic_flag)
+      grp->periodicBox(GCoord(hdr.box[0], hdr.box[1], hdr.box[2]));
+    if (hdr.flags & sorted_flag)
+      grp->sort();
+
+    return(grp);
+  }
+
+
+
+  // The cache is written to a temporary file that is then renamed, so
+  // concurrent readers never see a partially written cache.
+  bool SystemCache::write(const AtomicGroup& grp) const {
+    if (!_enabled)
+      return(false);
+
+    internal::FileStamp current;
+    if (!internal::stampFile(_filename, current, true) || current.size < _minimum_size)
+      return(false);
+
+    Header hdr;
+    std::memset(&hdr, 0, sizeof(Header));
+    std::memcpy(hdr.magic, cache_magic, 8);
+    hdr.bom = cache_bom;
+    hdr.version = cache_version;
+    fileTypeTag(_filetype, hdr.filetype);
+    hdr.size = current.size;
+    hdr.mtime = current.mtime;
+    hdr.hash = current.hash;
+    hdr.record_size = sizeof(AtomRecord);
+    if (grp.isPeriodic()) {
+      hdr.flags |= periodic_flag;
+      GCoord box = grp.periodicBox();
+      for (uint k=0; k<3; ++k)
+        hdr.box[k] = box[k];
+    }
+    if (grp.sorted())
+      hdr.flags |= sorted_flag;
+
+    StringTable strings;
+    std::vector<AtomRecord> records(grp.size());
+    std::vector<boost::uint64_t> bond_offsets(1, 0);
+    std::vector<boost::int32_t> bonds;
+
+    for (uint i=0; i<grp.size(); ++i) {
+      const Atom& a = *(grp[i]);
+      AtomRecord& r = records[i];
+      std::memset(&r, 0, sizeof(AtomRecord));
+
+      r.b = a.bfactor();
+      r.q = a.occupancy();
+      r.charge = a.checkProperty(Atom::chargebit) ? a.charge() : 0.0;
+      r.mass = a.mass();
+      for (uint k=0; k<3; ++k) {
+        r.coords[k] = a.coords()[k];
+        r.velocities[k] = a.velocities()[k];
+      }
+      for (uint k=0; k<32; ++k)
+        if (a.checkProperty(static_cast<Atom::bits>(1u << k)))
+          r.mask |= (1u << k);
+      r.id = a.id();
+      r.resid = a.resid();
+      r.atomic_number = a.atomic_number();
+      r.atom_type = a.atomType();
+      r.index = a.index();
+
+      r.strings[RECORD_NAME] = strings.intern(a.recordName());
+      r.strings[NAME] = strings.intern(a.name());
+      r.strings[ALTLOC] = strings.intern(a.altLoc());
+      r.strings[RESNAME] = strings.intern(a.resname());
+      r.strings[CHAINID] = strings.intern(a.chainId());
+      r.strings[ICODE] = strings.intern(a.iCode());
+      r.strings[SEGID] = strings.intern(a.segid());
+      r.strings[PDBELEMENT] = strings.intern(a.PDBelement());
+
+      if (a.checkProperty(Atom::bondsbit)) {
+        std::vector<int> b = a.getBonds();
+        bonds.insert(bonds.end(), b.begin(), b.end());
+      }
+      bond_offsets.push_back(bonds.size());
+    }
+
+    hdr.natoms = records.size();
+    hdr.nstrings = strings.size();
+    hdr.string_bytes = strings.data().size();
+    hdr.nbonds = bonds.size();
+
+    // Pad the bonds to keep the sections aligned
+    std::vector<boost::int32_t> padded_bonds(bonds);
+    if (padded_bonds.size() % 2)
+      padded_bonds.push_back(0);
+
+    boost::system::error_code ec;
+    boost::filesystem::path tmpname = boost::filesystem::unique_path(_cachename + ".%%%%%%%%", ec);
+    if (ec)
+      return(false);
+
+    {
+      std::ofstream ofs(tmpname.string().c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+      if (!ofs)
+        return(false);
+
+      ofs.write(reinterpret_cast<const char*>(&hdr), sizeof(Header));
+      if (!records.empty())
+        ofs.write(reinterpret_cast<const char*>(&records[0]), records.size() * sizeof(AtomRecord));
+      ofs.write(reinterpret_cast<const char*>(&(strings.offsets()[0])), strings.offsets().size() * sizeof(boost::uint64_t));
+      ofs.write(reinterpret_cast<const char*>(&bond_offsets[0]), bond_offsets.size() * sizeof(boost::uint64_t));
+      if (!padded_bonds.empty())
+        ofs.write(reinterpret_cast<const char*>(&padded_bonds[0]), padded_bonds.size() * sizeof(boost::int32_t));
+      ofs.write(strings.data().data(), strings.data().size());
+
+      ofs.close();
+      if (ofs.fail()) {
+        boost::filesystem::remove(tmpname, ec);
+        return(false);
+      }
+    }
+
+    boost::filesystem::rename(tmpname, _cachename, ec);
+    if (ec) {
+      boost::filesystem::remove(tmpname, ec);
+      return(false);
+    }
+
+    return(true);
+  }
+
+}
@@ -0,0 +1,97 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_SYSTEM_CACHE_HPP)
+#define LOOS_SYSTEM_CACHE_HPP
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+
+  //! Binary copy of a parsed system file, kept alongside it
+  /**
+   * Parsing a large PSF, prmtop, or PDB can take many seconds, and a
+   * pipeline of tools will parse the same file over and over.  The
+   * first time createSystem() reads a large enough file, the resulting
+   * AtomicGroup is written next to it in a compact binary form (as
+   * "model.psf.loossys").  Later calls map the cache into memory and
+   * rebuild the group from it rather than parsing the original.
+   *
+   * The cache holds everything stored in the AtomicGroup: each atom's
+   * fields and property bits, its bonds, and the periodic box.  Strings
+   * are interned, so each distinct atom name, residue name, etc. is
+   * only stored once.  Anything specific to the file's class (e.g. PDB
+   * remarks) is not kept.
+   *
+   * As with TrajectoryIndex, the cache records the size and
+   * modification time of the source file, along with the file type it
+   * was parsed as.  Unlike a trajectory index, a change anywhere in a
+   * system file (e.g. an edited charge) changes the result, so the
+   * whole file is hashed rather than just its ends.  This is still
+   * much cheaper than parsing it.  If any of these no longer match,
+   * the cache is ignored and will be replaced.  Failure to write the
+   * cache is silently ignored.
+   *
+   * Only files of at least minimumSize() bytes are cached, and caching
+   * can be globally disabled via SystemCache::enabled(false).
+   */
+  class SystemCache {
+  public:
+    //! \a filetype is the type the file is parsed as (i.e. "psf")
+    SystemCache(const std::string& filename, const std::string& filetype);
+
+    //! Rebuilds the system from the cache, returning a null pointer if it is missing, stale, or disabled
+    pAtomicGroup read() const;
+
+    //! Saves the system, returning false if it could not (or should not) be written
+    bool write(const AtomicGroup& grp) const;
+
+    //! Name of the cache file
+    std::string cacheName() const { return(_cachename); }
+
+    //! Globally enable or disable the use of cache files
+    static void enabled(const bool b) { _enabled = b; }
+    static bool enabled() { return(_enabled); }
+
+    //! Smallest system file (in bytes) that will be cached
+    static void minimumSize(const boost::uint64_t n) { _minimum_size = n; }
+    static boost::uint64_t minimumSize() { return(_minimum_size); }
+
+    //! Suffix appended to the system file name to form the cache name
+    static const std::string suffix;
+
+  private:
+    std::string _filename, _cachename, _filetype;
+    static bool _enabled;
+    static boost::uint64_t _minimum_size;
+  };
+
+}
+
+#endif
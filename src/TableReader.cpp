@@ -0,0 +1,172 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2012, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <algorithm>
+
+#include <TableReader.hpp>
+
+
+namespace loos {
+
+  const uint TableReader::block_size;
+
+
+  void TableReader::selectColumns(const std::vector<uint>& cols) {
+    _columns = cols;
+    _last = _columns.empty() ? 0 : *(std::max_element(_columns.begin(), _columns.end()));
+    _tokens.resize(_columns.empty() ? 0 : _last + 1);
+  }
+
+
+  void TableReader::stream(std::istream& is) {
+    LineReader::stream(is);
+    _pos = _fill = 0;
+    _eof = false;
+    _begin = _end = 0;
+  }
+
+
+  // Returns the next line in the buffer (without the newline),
+  // reading another block from the stream as necessary
+
+  bool TableReader::nextRawLine(const char*& b, const char*& e) {
+    while (true) {
+      char* start = &(_buffer[0]) + _pos;
+      size_t avail = _fill - _pos;
+
+      char* nl = static_cast<char*>(std::memchr(start, '\n', avail));
+      if (nl) {
+        b = start;
+        e = nl;
+        _pos += (nl - start) + 1;
+        return(true);
+      }
+
+      if (_eof) {
+        if (!avail)
+          return(false);
+        b = start;
+        e = start + avail;
+        _pos = _fill;
+        return(true);
+      }
+
+      // Keep the partial line and fill the rest of the buffer,
+      // growing it if the line won't fit...
+      std::memmove(&(_buffer[0]), start, avail);
+      _pos = 0;
+      _fill = avail;
+      if (_fill == _buffer.size())
+        _buffer.resize(2 * _buffer.size());
+
+      std::streamsize n = _is->rdbuf()->sgetn(&(_buffer[0]) + _fill, _buffer.size() - _fill);
+      if (n <= 0) {
+        _eof = true;
+        _is->setstate(std::ios_base::eofbit);
+      } else
+        _fill += n;
+    }
+  }
+
+
+  bool TableReader::getNext() {
+    if (!_lines.empty()) {
+      _current_line = _lines.back();
+      _lines.pop_back();
+      _begin = _current_line.data();
+      _end = _begin + _current_line.size();
+      return(true);
+    }
+
+    const char* b;
+    const char* e;
+    while (nextRawLine(b, e)) {
+      ++_lineno;
+
+      if (_comment_char != '\0') {
+        const char* c = static_cast<const char*>(std::memchr(b, _comment_char, e - b));
+        if (c)
+          e = c;
+      }
+
+      if (!_leading_chars.empty())
+        while (b != e && _leading_chars.find(*b) != std::string::npos)
+          ++b;
+
+      if (b != e) {
+        _begin = b;
+        _end = e;
+        return(true);
+      }
+    }
+
+    _begin = _end = 0;
+    return(false);
+  }
+
+
+  std::string TableReader::line() const {
+    return(std::string(_begin, _end));
+  }
+
+
+  // Locates the start and end of each column up to the last one
+  // selected, without parsing them
+
+  void TableReader::findColumns() {
+    const char* p = _begin;
+    for (uint k=0; k<=_last; ++k) {
+      while (p != _end && internal::isSpace(*p))
+        ++p;
+      if (p == _end) {
+        std::ostringstream oss;
+        oss << "Missing column " << k;
+        error(oss.str());
+      }
+      const char* e = p;
+      while (e != _end && !internal::isSpace(*e))
+        ++e;
+      _tokens[k] = Token(p, e);
+      p = e;
+    }
+  }
+
+
+  // Note: the line count is one past the current line (as with
+  // LineReader::lineNumber())
+  void TableReader::error(const std::string& msg) const {
+    throw(FileReadErrorWithLine(_name, msg, _lineno - 1));
+  }
+
+
+  // A stream would read [b, e) as more than one value (or fail part
+  // way through it), so rather than guess, the token is rejected
+  void TableReader::trailingError(const char* b, const char* e) const {
+    std::ostringstream oss;
+    oss << "Cannot parse '" << std::string(b, e) << "' at line " << _lineno - 1;
+    if (!_name.empty())
+      oss << " of " << _name;
+    throw(ParseError(oss.str()));
+  }
+
+
+}
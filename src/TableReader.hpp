@@ -0,0 +1,231 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2012, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_TABLE_READER_HPP)
+#define LOOS_TABLE_READER_HPP
+
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+#include <LineReader.hpp>
+#include <NumberParser.hpp>
+
+
+namespace loos {
+
+
+    //! Class for quickly reading whitespace-separated tables of numbers
+    /**
+     * This is a LineReader that reads its stream in large blocks and
+     * parses numbers in place, rather than copying each line and
+     * building a stringstream for it.  Comments and leading whitespace
+     * are stripped and blank lines are skipped, as with LineReader.
+     * Numbers are parsed independently of the locale.  Values the
+     * fast parser does not handle (e.g. more digits than fit exactly
+     * in a double) are passed to a stream, so each number is the same
+     * as reading it with operator>>().  Unlike a stream, a token that
+     * starts with a number but has other characters after it (e.g.
+     * "1-2", which a stream reads as 1 and -2) is a ParseError rather
+     * than being split.
+     *
+     * By default, readRow() returns all of the numbers at the start of
+     * each line.  If columns are chosen with selectColumns(), only
+     * those are parsed, and the rest of the line is skipped over.
+     *
+     * Since the stream is read ahead in blocks, it should not be read
+     * from elsewhere while the TableReader is in use.
+     */
+    class TableReader : public LineReader {
+    public:
+        TableReader(std::istream& is)
+            : LineReader(is), _buffer(block_size), _pos(0), _fill(0), _eof(false),
+              _begin(0), _end(0), _last(0)
+        { }
+
+        TableReader(std::istream& is, const std::string& name)
+            : LineReader(is, name), _buffer(block_size), _pos(0), _fill(0), _eof(false),
+              _begin(0), _end(0), _last(0)
+        { }
+
+        //! Only return these columns (numbered from 0) in this order
+        /**
+         * An empty list returns all columns.  With a selection, a line
+         * that is missing a selected column, or where it is not a
+         * number, is an error.
+         */
+        void selectColumns(const std::vector<uint>& cols);
+
+        const std::vector<uint>& selectedColumns() const { return(_columns); }
+
+        virtual void stream(std::istream& is);
+        virtual std::istream& stream() const { return(LineReader::stream()); }
+
+        virtual bool getNext();
+        virtual std::string line() const;
+
+        //! Read the next line of the table into \a row, returning false at the end
+        /**
+         * Without a column selection, the row holds the numbers up to
+         * the first token that is not a number, as when parsing the
+         * line with a stream.  A token that is only partly a number is
+         * a ParseError.
+         */
+        template<typename T>
+        bool readRow(std::vector<T>& row) {
+            if (!getNext())
+                return(false);
+
+            if (_columns.empty())
+                parseLine(row);
+            else {
+                row.resize(_columns.size());
+                parseColumns(&(row[0]));
+            }
+            return(true);
+        }
+
+
+        //! Read the rest of the table into contiguous row-major storage
+        /**
+         * Rows are appended to \a data and their width is returned in
+         * \a ncols.  Without a column selection, every row must have
+         * the same number of columns.  Returns the number of rows read.
+         */
+        template<typename T>
+        ulong readRows(std::vector<T>& data, uint& ncols) {
+            ulong nrows = 0;
+
+            if (!_columns.empty()) {
+                ncols = _columns.size();
+                while (getNext()) {
+                    size_t n = data.size();
+                    data.resize(n + ncols);
+                    parseColumns(&(data[n]));
+                    ++nrows;
+                }
+                return(nrows);
+            }
+
+            std::vector<T> row;
+            ncols = 0;
+            while (getNext()) {
+                parseLine(row);
+                if (nrows == 0)
+                    ncols = row.size();
+                else if (row.size() != ncols)
+                    error("Row has the wrong number of columns");
+                data.insert(data.end(), row.begin(), row.end());
+                ++nrows;
+            }
+            return(nrows);
+        }
+
+
+    private:
+        static const uint block_size = 1048576;
+
+        typedef std::pair<const char*, const char*>    Token;
+
+        bool nextRawLine(const char*& b, const char*& e);
+        void findColumns();
+        void error(const std::string& msg) const;
+        void trailingError(const char* b, const char* e) const;
+
+
+        // Parses one whitespace-delimited token.  Returns false if
+        // nothing could be parsed, otherwise advances p past the value.
+        template<typename T>
+        bool parseToken(const char*& p, const char* e, T& val) const {
+            if (internal::parseValue(p, e, val))
+                return(true);
+
+            std::string token(p, e);
+            std::istringstream iss(token);
+            if (!(iss >> val))
+                return(false);
+            p += iss.eof() ? token.size() : static_cast<size_t>(iss.tellg());
+            return(true);
+        }
+
+
+        template<typename T>
+        void parseLine(std::vector<T>& row) const {
+            row.clear();
+            const char* p = _begin;
+            while (true) {
+                while (p != _end && internal::isSpace(*p))
+                    ++p;
+                if (p == _end)
+                    break;
+                const char* e = p;
+                while (e != _end && !internal::isSpace(*e))
+                    ++e;
+
+                T val;
+                const char* q = p;
+                if (!parseToken(q, e, val))
+                    break;
+                row.push_back(val);
+
+                if (q != e)
+                    trailingError(p, e);
+                p = e;
+            }
+        }
+
+
+        template<typename T>
+        void parseColumns(T* out) {
+            findColumns();
+            for (uint i=0; i<_columns.size(); ++i) {
+                const Token& t = _tokens[_columns[i]];
+                const char* p = t.first;
+                if (!parseToken(p, t.second, out[i]) || p != t.second) {
+                    std::ostringstream oss;
+                    oss << "Cannot parse column " << _columns[i] << " ('" << std::string(t.first, t.second) << "')";
+                    error(oss.str());
+                }
+            }
+        }
+
+
+        std::vector<char> _buffer;
+        size_t _pos, _fill;
+        bool _eof;
+
+        const char* _begin;
+        const char* _end;
+
+        std::vector<uint> _columns;
+        uint _last;
+        std::vector<Token> _tokens;
+    };
+
+}
+
+
+#endif
@@ -33,6 +33,8 @@
 #include <sstream>
 
 #include <loos_defs.hpp>
+#include <Correlation.hpp>
+#include <TableReader.hpp>
 
 namespace loos {
 
@@ -92,7 +94,7 @@ public:
 
     //! Read a simple text file and create a timeseries
     //! The file is assumed to be simple columnated data.  Blank lines and 
-    //! lines starting with "#" are ignored.
+    //! comments (starting with "#") are ignored.  Columns are numbered from 1.
     TimeSeries (const std::string &filename, const int col=2) {
         std::ifstream ifs(filename.c_str());
         if (!ifs) {
@@ -100,26 +102,16 @@ public:
                                      + filename));
         }
 
-        std::string line;
-        while (ifs.good()) {
-            getline(ifs, line);
-            if ( (line.substr(0,1) == "#") || (line.empty()) ){
-                // comment -- do nothing
-            }
-            else {
-                std::stringstream s(line);
-                double val;
-                int i=0;
-                while (i < col) {
-                    if (!s.good()) {
-                  throw(std::runtime_error("Problem reading timeseries file "
-                                           + filename));
-                    }
-                    s >> val;
-                    i++;
-                }
-                _data.push_back(val);    
-            }
+        TableReader reader(ifs, filename);
+        reader.selectColumns(std::vector<uint>(1, col - 1));
+        std::vector<double> row;
+        try {
+            while (reader.readRow(row))
+                _data.push_back(row[0]);
+        }
+        catch (FileReadError& e) {
+            throw(std::runtime_error("Problem reading timeseries file "
+                                     + filename + "\n" + e.what()));
         }
     }
 
@@ -465,19 +457,61 @@ public:
       return (block_ave2 - block_ave*block_ave)*ratio;
     }
 
+    //! Autocorrelation of the time series, for lags 0 to max_time-1
+    //! in steps of interval.  If normalize is set, the average is
+    //! removed and the series is scaled by its standard deviation
+    //! first (a constant series has a correlation of 1 everywhere).
+    //! The correlation is computed with FFTs (see loos::FFTCorrelator),
+    //! so the cost is O(N log N) regardless of max_time.
     TimeSeries<T> correl(const int max_time, 
                          const int interval=1, 
                          const bool normalize=true,
                          T tol=1.0e-8) const {
+      return(correlImpl(max_time, interval, normalize, tol, false));
+    }
+
+    //! Same as correl(), but computed by direct O(N*max_time)
+    //! summation rather than with FFTs
+    TimeSeries<T> correl_direct(const int max_time, 
+                                const int interval=1, 
+                                const bool normalize=true,
+                                T tol=1.0e-8) const {
+      return(correlImpl(max_time, interval, normalize, tol, true));
+    }
+
+  // Vector interface...
+  void push_back(const T& x) { _data.push_back(x); }
+
+  iterator begin() { return(_data.begin()); }
+  iterator end() { return(_data.end()); }
+
+#if !defined(SWIG)
+  const_iterator begin() const { return(_data.begin()); }
+  const_iterator end() const { return(_data.end()); }
+#endif
+
+
+private:
+
+    TimeSeries<T> correlImpl(const int max_time, 
+                             const int interval,
+                             const bool normalize,
+                             T tol,
+                             const bool direct) const {
 
       TimeSeries<T> data = copy();
       uint n = abs(max_time);
       if (n > data.size()) {
         throw(std::runtime_error("Can't take correlation time longer than time series"));
       }
+      if (interval <= 0)
+        throw(std::runtime_error("Correlation interval must be positive"));
 
-      n /= interval;
-      TimeSeries<T> c(n, 0.0);
+      // Lags 0, interval, 2*interval, ... < n
+      uint nc = (n + interval - 1) / interval;
+      TimeSeries<T> c(nc, 0.0);
+      if (n == 0)
+        return(c);
 
       // normalize the data
       if (normalize) {
@@ -486,47 +520,31 @@ public:
             
           // drop through if this is a constant array
           if (dev < tol) {
-            c._data.assign(n, 1.0);
+            c._data.assign(nc, 1.0);
             return(c);
           }
             
           data /= dev;
       }
 
-      std::vector<int> num_pairs(n);
-      num_pairs.assign(n, 0);
-      // TODO: This is the O(N^2) way -- there are much faster
-      // algorithms for long time series
-      for (int i = 0; i < max_time; i+=interval) {
-        int index = i / interval;
-        for (unsigned int j = 0; j < data.size() - i; j++) {
-          c[index] += data[j] * data[j+i];
-          num_pairs[index]++;
-        }
-
+      std::vector<double> x(data.begin(), data.end());
+      std::vector<double> sums(n);
+      if (direct)
+        directAutocorrelation(&x[0], x.size(), n, &sums[0]);
+      else {
+        FFTCorrelator fft(x.size(), n);
+        fft.autocorrelate(&x[0], &sums[0]);
       }
 
       // Divide each value by the number of pairs used to generated it
-      for (uint i = 0; i < n; i++) {
-        c[i] /= num_pairs[i];
+      for (uint i = 0; i < nc; i++) {
+        uint lag = i * interval;
+        c[i] = sums[lag] / (x.size() - lag);
       }
 
       return(c);
     }
 
-  // Vector interface...
-  void push_back(const T& x) { _data.push_back(x); }
-
-  iterator begin() { return(_data.begin()); }
-  iterator end() { return(_data.end()); }
-
-#if !defined(SWIG)
-  const_iterator begin() const { return(_data.begin()); }
-  const_iterator end() const { return(_data.end()); }
-#endif
-
-
-private:
     std::vector<T> _data;
 };
 
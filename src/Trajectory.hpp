@@ -24,6 +24,7 @@
 
 #include <istream>
 #include <string>
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
@@ -60,12 +61,20 @@ namespace loos {
 	 *  derived class must also then set the cached_first flag to true
 	 *  after the readFrame(0).  See the DCD class for an example of
 	 *  this.
+	 *
+	 *  A subset of atoms can be registered with setAtomSubset() when
+	 *  only some of the atoms in each frame will be used.  Formats that
+	 *  support it (DCD, TRR, XTC and Amber NetCDF) then read or decode
+	 *  only those atoms.  The others read everything, as usual.
 	 */
 
 	class Trajectory  {
 	public:
 		typedef boost::shared_ptr<std::istream>      pStream;
 
+		//! A run of atoms in a frame (first index, number of atoms)
+		typedef std::pair<uint, uint>                AtomRange;
+
 
 		Trajectory() : cached_first(false), _filename("unset"), _current_frame(0) { }
 
@@ -83,7 +92,8 @@ namespace loos {
 		}
 
 
-		Trajectory(const Trajectory& t) : ifs(t.ifs), cached_first(t.cached_first), _filename(t._filename), _current_frame(t._current_frame)
+		Trajectory(const Trajectory& t) : ifs(t.ifs), cached_first(t.cached_first), _filename(t._filename), _current_frame(t._current_frame),
+		                                  _atom_subset(t._atom_subset)
 		{
 		}
 
@@ -276,6 +286,94 @@ namespace loos {
 			return(_current_frame);
 		}
 
+
+		//! Only read the atoms with these indices into the frame from now on
+		/**
+		 * This is a promise that only these atoms (by Atom::index())
+		 * will be used from subsequent frames.  Formats that support
+		 * it will skip the rest of each frame, so the coordinates (and
+		 * velocities) of other atoms in coords(), or copied by
+		 * updateGroupCoords(), are undefined.  The frame that is
+		 * currently loaded is not affected.
+		 *
+		 * An empty list reads all atoms again (see clearAtomSubset()).
+		 */
+		void setAtomSubset(const std::vector<uint>& indices) {
+			std::vector<uint> subset(indices);
+			std::sort(subset.begin(), subset.end());
+			subset.erase(std::unique(subset.begin(), subset.end()), subset.end());
+			if (!subset.empty() && subset.back() >= natoms())
+				throw(LOOSError("Atom subset index is out of range for the trajectory"));
+
+			_atom_subset.swap(subset);
+			setAtomSubsetImpl();
+		}
+
+		//! Only read the atoms in \a g from now on (using their Atom::index())
+		void setAtomSubset(const AtomicGroup& g) {
+			std::vector<uint> indices = atomIndices(g);
+			if (indices.empty())
+				throw(LOOSError("Cannot set an empty atom subset for a trajectory"));
+			setAtomSubset(indices);
+		}
+
+		//! Read all atoms in each frame again
+		void clearAtomSubset() {
+			_atom_subset.clear();
+			setAtomSubsetImpl();
+		}
+
+		bool hasAtomSubset() const { return(!_atom_subset.empty()); }
+
+		//! The sorted indices of the atoms that are read (empty means all)
+		const std::vector<uint>& atomSubset() const { return(_atom_subset); }
+
+
+		//! Read a batch of frames into a contiguous block of coordinates
+		/**
+		 * The coordinates of the atoms with indices \a atoms (all atoms,
+		 * in order, if empty) in each of the frames in \a frames are
+		 * stored in \a buffer, which must hold frames.size() x
+		 * atoms.size() x 3 values.  Frame \a frames[k], atom \a
+		 * atoms[j] starts at buffer[(k * atoms.size() + j) * 3].
+		 * Frames and atoms may be in any order and may repeat.
+		 *
+		 * Formats that can do so (DCD, XTC and Amber NetCDF) read the
+		 * block directly.  Others read the frames one at a time with
+		 * only the requested atoms (see setAtomSubset()).  Either way,
+		 * the current frame, the readFrame() iterator and the atom
+		 * subset are not changed.
+		 */
+		void readFrames(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer) {
+			checkFrameBatch(frames, atoms);
+			if (!frames.empty())
+				readFramesImpl(frames, atoms, buffer);
+		}
+
+		//! Read a batch of frames into a contiguous single-precision block (see above)
+		void readFrames(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer) {
+			checkFrameBatch(frames, atoms);
+			if (!frames.empty())
+				readFramesImpl(frames, atoms, buffer);
+		}
+
+		//! Read a batch of frames into \a buffer, resizing it to fit
+		template<typename T>
+		void readFrames(const std::vector<uint>& frames, const std::vector<uint>& atoms, std::vector<T>& buffer) {
+			buffer.resize(frames.size() * (atoms.empty() ? natoms() : atoms.size()) * 3);
+			if (!buffer.empty())
+				readFrames(frames, atoms, &buffer[0]);
+		}
+
+		//! Read a batch of frames for the atoms in \a g (using their Atom::index())
+		template<typename T>
+		void readFrames(const std::vector<uint>& frames, const AtomicGroup& g, std::vector<T>& buffer) {
+			std::vector<uint> atoms = atomIndices(g);
+			if (atoms.empty())
+				throw(LOOSError("Cannot read frames for an empty group"));
+			readFrames(frames, atoms, buffer);
+		}
+
 	protected:
 		void setInputStream(const std::string& fname) throw(FileOpenError)
 		{
@@ -302,6 +400,114 @@ namespace loos {
 		std::string _filename;   // Remember filename (if passed)
 		uint _current_frame;
 
+		std::vector<uint> _atom_subset;   // Sorted atom indices to read (empty means all)
+
+
+		// Atom indices for a group (throws if any are unset)
+		static std::vector<uint> atomIndices(const AtomicGroup& g) {
+			std::vector<uint> indices;
+			indices.reserve(g.size());
+			for (AtomicGroup::const_iterator i = g.begin(); i != g.end(); ++i) {
+				if (! (*i)->checkProperty(Atom::indexbit))
+					throw(LOOSError(**i, "Atom has an unset index property and cannot be used to select trajectory atoms"));
+				indices.push_back((*i)->index());
+			}
+			return(indices);
+		}
+
+
+		void checkFrameBatch(const std::vector<uint>& frames, const std::vector<uint>& atoms) const {
+			uint nf = nframes();
+			for (std::vector<uint>::const_iterator i = frames.begin(); i != frames.end(); ++i)
+				if (*i >= nf)
+					throw(FileReadError(_filename, "Requested frame is out of range"));
+			uint na = natoms();
+			for (std::vector<uint>::const_iterator i = atoms.begin(); i != atoms.end(); ++i)
+				if (*i >= na)
+					throw(LOOSError("Atom index into trajectory frame is out of bounds"));
+		}
+
+
+		//! Reads a batch of frames one at a time (see readFrames())
+		/**
+		 * Derived classes can fall back on this.  Only the requested
+		 * atoms are read (through setAtomSubset()), and the current
+		 * frame and atom subset are restored afterwards by reading
+		 * the current frame again.
+		 */
+		template<typename T>
+		void readFramesByFrame(const std::vector<uint>& frames, const std::vector<uint>& atoms, T* buffer) {
+			uint saved_frame = _current_frame;
+			bool saved_cached = cached_first;
+			std::vector<uint> saved_subset(_atom_subset);
+
+			// Packing the scratch group lets updateGroupCoords() copy the
+			// requested atoms into contiguous memory in one pass
+			AtomicGroup scratch;
+			for (std::vector<uint>::const_iterator i = atoms.begin(); i != atoms.end(); ++i) {
+				pAtom pa(new Atom);
+				pa->index(*i);
+				scratch.append(pa);
+			}
+			scratch.packCoords();
+
+			try {
+				if (!atoms.empty())
+					setAtomSubset(atoms);
+
+				for (uint k=0; k<frames.size(); ++k) {
+					seekFrame(frames[k]);
+					if (!parseFrame())
+						throw(FileReadError(_filename, "Unable to read frame"));
+
+					if (atoms.empty()) {
+						std::vector<GCoord> crds = coords();
+						T* p = buffer + static_cast<size_t>(k) * crds.size() * 3;
+						for (std::vector<GCoord>::const_iterator c = crds.begin(); c != crds.end(); ++c) {
+							*p++ = (*c)[0];
+							*p++ = (*c)[1];
+							*p++ = (*c)[2];
+						}
+					} else {
+						updateGroupCoords(scratch);
+						T* p = buffer + static_cast<size_t>(k) * atoms.size() * 3;
+						const CoordinateStore& store = *(scratch.coordinateStore());
+						for (CoordinateStore::const_iterator c = store.begin(); c != store.end(); ++c) {
+							*p++ = (*c)[0];
+							*p++ = (*c)[1];
+							*p++ = (*c)[2];
+						}
+					}
+				}
+			}
+			catch (...) {
+				restoreFrame(saved_frame, saved_cached, saved_subset);
+				throw;
+			}
+
+			restoreFrame(saved_frame, saved_cached, saved_subset);
+		}
+
+
+		// Groups sorted, unique atom indices into contiguous runs.  Runs
+		// separated by no more than max_gap atoms are merged, since it
+		// is usually cheaper to read a few extra atoms than to seek
+		// over them.
+		static std::vector<AtomRange> atomRanges(const std::vector<uint>& indices, const uint max_gap) {
+			std::vector<AtomRange> ranges;
+			for (std::vector<uint>::const_iterator i = indices.begin(); i != indices.end(); ++i) {
+				if (!ranges.empty() && *i - (ranges.back().first + ranges.back().second) <= max_gap)
+					ranges.back().second = *i - ranges.back().first + 1;
+				else
+					ranges.push_back(AtomRange(*i, 1));
+			}
+			return(ranges);
+		}
+
+		std::vector<AtomRange> atomSubsetRanges(const uint max_gap) const {
+			return(atomRanges(_atom_subset, max_gap));
+		}
+
 	private:
 
 		//! NVI implementation for seeking next frame
@@ -322,6 +528,33 @@ namespace loos {
 
 		virtual std::vector<GCoord> velocitiesImpl() const { return(std::vector<GCoord>()); }
 
+		//! NVI implementation for setAtomSubset().  Formats that can skip atoms override this.
+		virtual void setAtomSubsetImpl() { }
+
+		//! NVI implementation of readFrames().  Formats with a faster way to read a block override these.
+		virtual void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer) {
+			readFramesByFrame(frames, atoms, buffer);
+		}
+
+		virtual void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer) {
+			readFramesByFrame(frames, atoms, buffer);
+		}
+
+		// Puts the trajectory back the way it was before readFramesByFrame()
+		void restoreFrame(const uint frame, const bool cached, const std::vector<uint>& subset) {
+			if (subset.empty())
+				clearAtomSubset();
+			else
+				setAtomSubset(subset);
+
+			if (frame < nframes()) {
+				seekFrame(frame);
+				parseFrame();
+			}
+			_current_frame = frame;
+			cached_first = cached;
+		}
+
 	};
 
 }
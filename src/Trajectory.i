@@ -27,6 +27,14 @@
 %}
 
 
+// The raw-pointer readFrames() are replaced below by versions that
+// fill a numpy array in place
+%ignore loos::Trajectory::readFrames(const std::vector<uint>&, const std::vector<uint>&, double*);
+%ignore loos::Trajectory::readFrames(const std::vector<uint>&, const std::vector<uint>&, float*);
+
+%apply (double* INPLACE_ARRAY3, int DIM1, int DIM2, int DIM3) {(double* block, int nf, int na, int nd)};
+%apply (float* INPLACE_ARRAY3, int DIM1, int DIM2, int DIM3) {(float* block, int nf, int na, int nd)};
+
 %include "Trajectory.hpp"
 
 namespace loos {
@@ -40,6 +48,25 @@ namespace loos {
     }
 
 
+    // Fills a frames x atoms x 3 numpy array (float64 or float32)
+    // without copying, e.g.
+    //   block = numpy.empty((len(frames), len(atoms), 3))
+    //   traj.readFrames(frames, atoms, block)
+    void readFrames(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* block, int nf, int na, int nd) {
+      if (nd != 3 || static_cast<uint>(nf) != frames.size()
+          || static_cast<uint>(na) != (atoms.empty() ? $self->natoms() : atoms.size()))
+        throw(loos::LOOSError("Invalid dimensions in Trajectory::readFrames()"));
+      $self->readFrames(frames, atoms, block);
+    }
+
+    void readFrames(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* block, int nf, int na, int nd) {
+      if (nd != 3 || static_cast<uint>(nf) != frames.size()
+          || static_cast<uint>(na) != (atoms.empty() ? $self->natoms() : atoms.size()))
+        throw(loos::LOOSError("Invalid dimensions in Trajectory::readFrames()"));
+      $self->readFrames(frames, atoms, block);
+    }
+
+
   };
 
 
@@ -0,0 +1,261 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+#include <TrajectoryIndex.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // On-disk layout (native byte order, which is checked on read):
+    //
+    //   char[8]   magic
+    //   uint32    byte-order mark
+    //   uint32    version
+    //   char[8]   format tag
+    //   uint64    trajectory size
+    //   int64     trajectory modification time
+    //   uint64    hash of the trajectory's first and last blocks
+    //   uint64    number of metadata values
+    //   uint64    number of frames
+    //   double[]  metadata
+    //   uint64[]  frame offsets
+
+    const char index_magic[8] = { 'L', 'O', 'O', 'S', 'I', 'D', 'X', '\0' };
+    const boost::uint32_t index_bom = 0x01020304;
+    const boost::uint32_t index_version = 1;
+
+    // Amount of data at each end of the trajectory that is hashed
+    const std::streamsize hash_block_size = 4096;
+
+
+    // 64-bit FNV-1a
+    boost::uint64_t hashBytes(const char* p, const std::streamsize n, boost::uint64_t h) {
+      for (std::streamsize i=0; i<n; ++i) {
+        h ^= static_cast<unsigned char>(p[i]);
+        h *= 0x100000001b3ULL;
+      }
+      return(h);
+    }
+
+
+    template<typename T>
+    void writeValue(std::ostream& os, const T& t) {
+      os.write(reinterpret_cast<const char*>(&t), sizeof(T));
+    }
+
+    template<typename T>
+    bool readValue(std::istream& is, T& t) {
+      is.read(reinterpret_cast<char*>(&t), sizeof(T));
+      return(is.good());
+    }
+
+
+    void formatTag(const std::string& format, char* tag) {
+      std::memset(tag, 0, 8);
+      std::memcpy(tag, format.data(), std::min(format.size(), static_cast<std::string::size_type>(8)));
+    }
+
+  }
+
+
+  const std::string TrajectoryIndex::suffix(".loosidx");
+  bool TrajectoryIndex::_enabled = true;
+
+
+  TrajectoryIndex::TrajectoryIndex(const std::string& trajname, const std::string& format)
+    : _trajname(trajname), _indexname(trajname + suffix), _format(format)
+  { }
+
+
+
+  namespace internal {
+
+    bool stampFile(const std::string& fname, FileStamp& s, const bool whole) {
+      boost::system::error_code ec;
+      boost::filesystem::path p(fname);
+
+      if (!boost::filesystem::is_regular_file(p, ec))
+        return(false);
+      s.size = boost::filesystem::file_size(p, ec);
+      if (ec)
+        return(false);
+      s.mtime = boost::filesystem::last_write_time(p, ec);
+      if (ec)
+        return(false);
+
+      std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+      if (!ifs)
+        return(false);
+
+      char buf[hash_block_size];
+      boost::uint64_t h = 0xcbf29ce484222325ULL;
+
+      ifs.read(buf, hash_block_size);
+      h = hashBytes(buf, ifs.gcount(), h);
+
+      if (whole) {
+        while (ifs) {
+          ifs.read(buf, hash_block_size);
+          h = hashBytes(buf, ifs.gcount(), h);
+        }
+      } else if (s.size > static_cast<boost::uint64_t>(2 * hash_block_size)) {
+        ifs.clear();
+        ifs.seekg(-hash_block_size, std::ios_base::end);
+        ifs.read(buf, hash_block_size);
+        h = hashBytes(buf, ifs.gcount(), h);
+      }
+
+      s.hash = h;
+      return(true);
+    }
+
+  }
+
+
+
+  bool TrajectoryIndex::read(std::vector<size_t>& offsets, std::vector<double>& metadata) const {
+    if (!_enabled)
+      return(false);
+
+    std::ifstream ifs(_indexname.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!ifs)
+      return(false);
+
+    internal::FileStamp current;
+    if (!internal::stampFile(_trajname, current))
+      return(false);
+
+    char magic[8], tag[8], expected_tag[8];
+    boost::uint32_t bom, version;
+    boost::uint64_t size, hash, nmeta, nframes;
+    boost::int64_t mtime;
+
+    ifs.read(magic, 8);
+    if (!ifs || std::memcmp(magic, index_magic, 8) != 0)
+      return(false);
+    if (!readValue(ifs, bom) || bom != index_bom)
+      return(false);
+    if (!readValue(ifs, version) || version != index_version)
+      return(false);
+
+    formatTag(_format, expected_tag);
+    ifs.read(tag, 8);
+    if (!ifs || std::memcmp(tag, expected_tag, 8) != 0)
+      return(false);
+
+    if (!(readValue(ifs, size) && readValue(ifs, mtime) && readValue(ifs, hash)))
+      return(false);
+    if (size != current.size || mtime != current.mtime || hash != current.hash)
+      return(false);
+
+    if (!(readValue(ifs, nmeta) && readValue(ifs, nframes)))
+      return(false);
+
+    // Guard against a truncated or corrupted index
+    if ((nmeta * sizeof(double) + nframes * sizeof(boost::uint64_t)) > size)
+      return(false);
+
+    std::vector<double> meta(nmeta);
+    std::vector<boost::uint64_t> offs(nframes);
+    if (nmeta)
+      ifs.read(reinterpret_cast<char*>(&meta[0]), nmeta * sizeof(double));
+    if (nframes)
+      ifs.read(reinterpret_cast<char*>(&offs[0]), nframes * sizeof(boost::uint64_t));
+    if (!ifs)
+      return(false);
+
+    for (boost::uint64_t i=0; i<nframes; ++i)
+      if (offs[i] >= size)
+        return(false);
+
+    metadata.swap(meta);
+    offsets.assign(offs.begin(), offs.end());
+    return(true);
+  }
+
+
+
+  // The index is written to a temporary file that is then renamed, so
+  // concurrent readers never see a partially written index.
+  bool TrajectoryIndex::write(const std::vector<size_t>& offsets, const std::vector<double>& metadata) const {
+    if (!_enabled)
+      return(false);
+
+    internal::FileStamp current;
+    if (!internal::stampFile(_trajname, current))
+      return(false);
+
+    boost::system::error_code ec;
+    boost::filesystem::path tmpname = boost::filesystem::unique_path(_indexname + ".%%%%%%%%", ec);
+    if (ec)
+      return(false);
+
+    {
+      std::ofstream ofs(tmpname.string().c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+      if (!ofs)
+        return(false);
+
+      char tag[8];
+      formatTag(_format, tag);
+
+      ofs.write(index_magic, 8);
+      writeValue(ofs, index_bom);
+      writeValue(ofs, index_version);
+      ofs.write(tag, 8);
+      writeValue(ofs, current.size);
+      writeValue(ofs, current.mtime);
+      writeValue(ofs, current.hash);
+      writeValue(ofs, static_cast<boost::uint64_t>(metadata.size()));
+      writeValue(ofs, static_cast<boost::uint64_t>(offsets.size()));
+
+      if (!metadata.empty())
+        ofs.write(reinterpret_cast<const char*>(&metadata[0]), metadata.size() * sizeof(double));
+
+      std::vector<boost::uint64_t> offs(offsets.begin(), offsets.end());
+      if (!offs.empty())
+        ofs.write(reinterpret_cast<const char*>(&offs[0]), offs.size() * sizeof(boost::uint64_t));
+
+      ofs.close();
+      if (ofs.fail()) {
+        boost::filesystem::remove(tmpname, ec);
+        return(false);
+      }
+    }
+
+    boost::filesystem::rename(tmpname, _indexname, ec);
+    if (ec) {
+      boost::filesystem::remove(tmpname, ec);
+      return(false);
+    }
+
+    return(true);
+  }
+
+}
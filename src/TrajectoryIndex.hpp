@@ -0,0 +1,120 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2008, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#if !defined(LOOS_TRAJECTORY_INDEX_HPP)
+#define LOOS_TRAJECTORY_INDEX_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    //! Identifies a version of a file
+    /**
+     * Records the size and modification time of the file along with a
+     * hash of its contents.  Depending on how stampFile() was called,
+     * the hash covers either just the first and last few kilobytes
+     * (cheap, but blind to changes in the middle of the file) or the
+     * whole file.  Used to decide whether data cached alongside a file
+     * is stale.  Stamps are only comparable if made the same way.
+     */
+    struct FileStamp {
+      FileStamp() : size(0), mtime(0), hash(0) { }
+
+      bool operator==(const FileStamp& s) const { return(size == s.size && mtime == s.mtime && hash == s.hash); }
+      bool operator!=(const FileStamp& s) const { return(!operator==(s)); }
+
+      boost::uint64_t size;
+      boost::int64_t mtime;
+      boost::uint64_t hash;
+    };
+
+    //! Stamps a file, returning false if it is not a readable, regular file
+    /**
+     * By default only the ends of the file (its first and last few
+     * kilobytes) are hashed, which is enough to catch a trajectory
+     * that was replaced or appended to.  If \a whole is set, the
+     * entire file is hashed, so an edit anywhere in it changes the
+     * stamp, at the cost of reading the whole file.
+     */
+    bool stampFile(const std::string& fname, FileStamp& s, const bool whole = false);
+
+  }
+
+
+  //! Persistent frame-offset index kept alongside a trajectory file
+  /**
+   * Formats without a fixed frame size (i.e. XTC and TRR) must scan
+   * the entire trajectory when opened to find where each frame
+   * begins.  A TrajectoryIndex saves the result of that scan next to
+   * the trajectory (as "traj.xtc.loosidx") so later opens can skip it.
+   *
+   * The index records the size and modification time of the
+   * trajectory along with a hash of its first and last few kilobytes
+   * (see stampFile()).
+   * If any of these no longer match, the index is considered stale and
+   * is ignored (and will be replaced by the next scan).  Failure to
+   * write the index (e.g. a read-only directory) is silently ignored.
+   *
+   * In addition to the frame offsets, the reader may store a small
+   * number of values that it would otherwise have derived from the
+   * scan (such as the number of atoms).
+   *
+   * Index files can be globally disabled via
+   * TrajectoryIndex::enabled(false).
+   */
+  class TrajectoryIndex {
+  public:
+    //! \a format is a short tag identifying the trajectory reader (e.g. "XTC")
+    TrajectoryIndex(const std::string& trajname, const std::string& format);
+
+    //! Loads the index, returning false if it is missing, stale, or disabled
+    bool read(std::vector<size_t>& offsets, std::vector<double>& metadata) const;
+
+    //! Saves the index, returning false if it could not be written
+    bool write(const std::vector<size_t>& offsets, const std::vector<double>& metadata) const;
+
+    //! Name of the index file
+    std::string indexName() const { return(_indexname); }
+
+    //! Globally enable or disable the use of index files
+    static void enabled(const bool b) { _enabled = b; }
+    static bool enabled() { return(_enabled); }
+
+    //! Suffix appended to the trajectory name to form the index name
+    static const std::string suffix;
+
+  private:
+    std::string _trajname, _indexname, _format;
+    static bool _enabled;
+  };
+
+}
+
+#endif
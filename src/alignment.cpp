@@ -7,6 +7,10 @@
 #include <alignment.hpp>
 
 #include <cmath>
+#include <algorithm>
+#include <exception>
+
+#include <boost/thread/thread.hpp>
 
 
 namespace loos {
@@ -16,10 +20,254 @@ namespace loos {
   namespace alignment {
 
 
+    namespace {
+
+      SuperpositionMethod superposition_method = SVD;
+
+
+      // Accumulates the inner products needed by QCP in a single pass:
+      // A[3*i+j] is the sum over atoms of V_i * U_j, and Gu and Gv are
+      // the sums of squares of U and V.
+
+      void qcpInnerProduct(const double* U, const double* V, const uint natoms, double* A, double& Gu, double& Gv) {
+        double sxx = 0.0, sxy = 0.0, sxz = 0.0;
+        double syx = 0.0, syy = 0.0, syz = 0.0;
+        double szx = 0.0, szy = 0.0, szz = 0.0;
+        double gu = 0.0, gv = 0.0;
+
+        for (uint i=0; i<natoms; ++i, U += 3, V += 3) {
+          double ux = U[0], uy = U[1], uz = U[2];
+          double vx = V[0], vy = V[1], vz = V[2];
+
+          gu += ux*ux + uy*uy + uz*uz;
+          gv += vx*vx + vy*vy + vz*vz;
+
+          sxx += vx * ux;  sxy += vx * uy;  sxz += vx * uz;
+          syx += vy * ux;  syy += vy * uy;  syz += vy * uz;
+          szx += vz * ux;  szy += vz * uy;  szz += vz * uz;
+        }
+
+        A[0] = sxx; A[1] = sxy; A[2] = sxz;
+        A[3] = syx; A[4] = syy; A[5] = syz;
+        A[6] = szx; A[7] = szy; A[8] = szz;
+        Gu = gu;
+        Gv = gv;
+      }
+
+
+      // Finds the largest eigenvalue of the QCP key matrix by
+      // Newton-Raphson on its characteristic polynomial, storing the
+      // RMSD in rms.  If rot is non-null, the optimal rotation is
+      // stored there (row-major).  Returns false if the rotation
+      // cannot be determined because the largest eigenvalue is
+      // degenerate (e.g. for collinear atoms).  Adapted from Theobald
+      // (2005) Acta Cryst A61:478 and Liu et al (2010) J Comput Chem
+      // 31:1561.
+
+      bool qcpSolve(const double* A, const double E0, const uint natoms, double& rms, double* rot) {
+        const double evalprec = 1e-11;
+        const double evecprec = 1e-6;
+
+        double Sxx = A[0], Sxy = A[1], Sxz = A[2];
+        double Syx = A[3], Syy = A[4], Syz = A[5];
+        double Szx = A[6], Szy = A[7], Szz = A[8];
+
+        double Sxx2 = Sxx * Sxx, Syy2 = Syy * Syy, Szz2 = Szz * Szz;
+        double Sxy2 = Sxy * Sxy, Syz2 = Syz * Syz, Sxz2 = Sxz * Sxz;
+        double Syx2 = Syx * Syx, Szy2 = Szy * Szy, Szx2 = Szx * Szx;
+
+        double SyzSzymSyySzz2 = 2.0 * (Syz * Szy - Syy * Szz);
+        double Sxx2Syy2Szz2Syz2Szy2 = Syy2 + Szz2 - Sxx2 + Syz2 + Szy2;
+
+        double C2 = -2.0 * (Sxx2 + Syy2 + Szz2 + Sxy2 + Syx2 + Sxz2 + Szx2 + Syz2 + Szy2);
+        double C1 = 8.0 * (Sxx * Syz * Szy + Syy * Szx * Sxz + Szz * Sxy * Syx
+                           - Sxx * Syy * Szz - Syz * Szx * Sxy - Szy * Syx * Sxz);
+
+        double SxzpSzx = Sxz + Szx, SyzpSzy = Syz + Szy, SxypSyx = Sxy + Syx;
+        double SyzmSzy = Syz - Szy, SxzmSzx = Sxz - Szx, SxymSyx = Sxy - Syx;
+        double SxxpSyy = Sxx + Syy, SxxmSyy = Sxx - Syy;
+        double Sxy2Sxz2Syx2Szx2 = Sxy2 + Sxz2 - Syx2 - Szx2;
+
+        double C0 = Sxy2Sxz2Syx2Szx2 * Sxy2Sxz2Syx2Szx2
+          + (Sxx2Syy2Szz2Syz2Szy2 + SyzSzymSyySzz2) * (Sxx2Syy2Szz2Syz2Szy2 - SyzSzymSyySzz2)
+          + (-SxzpSzx * SyzmSzy + SxymSyx * (SxxmSyy - Szz)) * (-SxzmSzx * SyzpSzy + SxymSyx * (SxxmSyy + Szz))
+          + (-SxzpSzx * SyzpSzy - SxypSyx * (SxxpSyy - Szz)) * (-SxzmSzx * SyzmSzy - SxypSyx * (SxxpSyy + Szz))
+          + (SxypSyx * SyzpSzy + SxzpSzx * (SxxmSyy + Szz)) * (-SxymSyx * SyzmSzy + SxzpSzx * (SxxpSyy + Szz))
+          + (SxypSyx * SyzmSzy + SxzmSzx * (SxxmSyy - Szz)) * (-SxymSyx * SyzpSzy + SxzmSzx * (SxxpSyy - Szz));
+
+        // The largest eigenvalue is no greater than E0, so start there
+        double lambda = E0;
+        for (uint i=0; i<50; ++i) {
+          double old = lambda;
+          double x2 = lambda * lambda;
+          double b = (x2 + C2) * lambda;
+          double a = b + C1;
+          double delta = (a * lambda + C0) / (2.0 * x2 * lambda + b + a);
+          lambda -= delta;
+          if (std::fabs(lambda - old) < std::fabs(evalprec * lambda))
+            break;
+        }
+
+        rms = std::sqrt(std::fabs(2.0 * (E0 - lambda) / natoms));
+        if (rot == 0)
+          return(true);
+
+        // Columns of the adjoint scale as E0^3, so the test for a
+        // usable column is relative to that
+        double evecmin = evecprec * E0 * E0 * E0 * E0 * E0 * E0;
+
+        // The rotation comes from the eigenvector for lambda, which is
+        // any non-zero column of the adjoint of (K - lambda*I)
+        double a11 = SxxpSyy + Szz - lambda, a12 = SyzmSzy, a13 = -SxzmSzx, a14 = SxymSyx;
+        double a21 = SyzmSzy, a22 = SxxmSyy - Szz - lambda, a23 = SxypSyx, a24 = SxzpSzx;
+        double a31 = a13, a32 = a23, a33 = Syy - Sxx - Szz - lambda, a34 = SyzpSzy;
+        double a41 = a14, a42 = a24, a43 = a34, a44 = Szz - SxxpSyy - lambda;
+
+        double a3344_4334 = a33 * a44 - a43 * a34, a3244_4234 = a32 * a44 - a42 * a34;
+        double a3243_4233 = a32 * a43 - a42 * a33, a3143_4133 = a31 * a43 - a41 * a33;
+        double a3144_4134 = a31 * a44 - a41 * a34, a3142_4132 = a31 * a42 - a41 * a32;
+
+        double q1 =  a22 * a3344_4334 - a23 * a3244_4234 + a24 * a3243_4233;
+        double q2 = -a21 * a3344_4334 + a23 * a3144_4134 - a24 * a3143_4133;
+        double q3 =  a21 * a3244_4234 - a22 * a3144_4134 + a24 * a3142_4132;
+        double q4 = -a21 * a3243_4233 + a22 * a3143_4133 - a23 * a3142_4132;
+        double qsqr = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;
+
+        // If a column is too small, try the next one...
+        if (qsqr < evecmin) {
+          q1 =  a12 * a3344_4334 - a13 * a3244_4234 + a14 * a3243_4233;
+          q2 = -a11 * a3344_4334 + a13 * a3144_4134 - a14 * a3143_4133;
+          q3 =  a11 * a3244_4234 - a12 * a3144_4134 + a14 * a3142_4132;
+          q4 = -a11 * a3243_4233 + a12 * a3143_4133 - a13 * a3142_4132;
+          qsqr = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;
+
+          if (qsqr < evecmin) {
+            double a1324_1423 = a13 * a24 - a14 * a23, a1224_1422 = a12 * a24 - a14 * a22;
+            double a1223_1322 = a12 * a23 - a13 * a22, a1124_1421 = a11 * a24 - a14 * a21;
+            double a1123_1321 = a11 * a23 - a13 * a21, a1122_1221 = a11 * a22 - a12 * a21;
+
+            q1 =  a42 * a1324_1423 - a43 * a1224_1422 + a44 * a1223_1322;
+            q2 = -a41 * a1324_1423 + a43 * a1124_1421 - a44 * a1123_1321;
+            q3 =  a41 * a1224_1422 - a42 * a1124_1421 + a44 * a1122_1221;
+            q4 = -a41 * a1223_1322 + a42 * a1123_1321 - a43 * a1122_1221;
+            qsqr = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;
+
+            if (qsqr < evecmin) {
+              q1 =  a32 * a1324_1423 - a33 * a1224_1422 + a34 * a1223_1322;
+              q2 = -a31 * a1324_1423 + a33 * a1124_1421 - a34 * a1123_1321;
+              q3 =  a31 * a1224_1422 - a32 * a1124_1421 + a34 * a1122_1221;
+              q4 = -a31 * a1223_1322 + a32 * a1123_1321 - a33 * a1122_1221;
+              qsqr = q1 * q1 + q2 * q2 + q3 * q3 + q4 * q4;
+
+              if (qsqr < evecmin)
+                return(false);
+            }
+          }
+        }
+
+        double normq = std::sqrt(qsqr);
+        q1 /= normq;
+        q2 /= normq;
+        q3 /= normq;
+        q4 /= normq;
+
+        double a2 = q1 * q1, x2 = q2 * q2, y2 = q3 * q3, z2 = q4 * q4;
+        double xy = q2 * q3, az = q1 * q4, zx = q4 * q2;
+        double ay = q1 * q3, yz = q3 * q4, ax = q1 * q2;
+
+        rot[0] = a2 + x2 - y2 - z2;
+        rot[1] = 2.0 * (xy + az);
+        rot[2] = 2.0 * (zx - ay);
+        rot[3] = 2.0 * (xy - az);
+        rot[4] = a2 - x2 + y2 - z2;
+        rot[5] = 2.0 * (yz + ax);
+        rot[6] = 2.0 * (zx + ay);
+        rot[7] = 2.0 * (yz - ax);
+        rot[8] = a2 - x2 - y2 + z2;
+
+        return(true);
+      }
+
+    }
+
+
+    void superpositionMethod(const SuperpositionMethod m) { superposition_method = m; }
+    SuperpositionMethod superpositionMethod() { return(superposition_method); }
+
+
+    double qcpCenteredRMSD(const double* U, const double* V, const uint natoms) {
+      double A[9], Gu, Gv, rms;
+      qcpInnerProduct(U, V, natoms, A, Gu, Gv);
+      qcpSolve(A, (Gu + Gv) / 2.0, natoms, rms, 0);
+      return(rms);
+    }
+
+
     // Core aligmnent routine.  Assumes input coord vectors are already centered.
     // Returns the SVD results as a tuple
     SVDTupleVec kabschCore(const vecDouble& u, const vecDouble& v) {
-      int n = u.size() / 3;
+      return(kabschCore(u.data(), v.data(), u.size() / 3));
+    }
+
+
+    namespace {
+
+      // SVD of the 3x3 correlation matrix R (column-major), which is
+      // overwritten.  The sign of the smallest singular value (and its
+      // vector) is flipped if needed to avoid a reflection.
+
+      SVDTupleVec correlationSVD(vecDouble& R) {
+        char joba='G';
+        char jobu = 'U', jobv = 'V';
+        int mv = 0;
+        f77int m = 3, lda = 3, ldv = 3, lwork=100, info;
+        double work[lwork];
+        f77int nn = 3;
+        vecDouble S(3);
+        vecDouble V(9);
+
+        dgesvj_(&joba, &jobu, &jobv, &m, &nn, R.data(), &lda, S.data(), &mv, V.data(), &ldv, work, &lwork, &info);
+
+        if (info > 0) {
+          char op = 'E';
+          double eps = dlamch_(&op);
+          std::cerr << boost::format("Warning- SVD in kabschCore() failed to converge with info=%d and TOL=%e\n") %
+            info % (eps * sqrt(3.0));
+          for (uint i=0; i<6; ++i)
+            std::cerr << boost::format("         work[%d] = %f\n") % (i+1) % work[i];
+          std::cerr << "\tThis may happen periodically, causing the output to be 'mostly' orthogonal.\n";
+          std::cerr << "\tThe residual is typically small and should not appreciably affect the resulting\n";
+          std::cerr << "\tsuperposition.  If this warning appears frequently, then please notify the LOOS\n";
+          std::cerr << "\tdevelopers at loos.maintainer@gmail.com\n";
+          //  throw(NumericalError("SVD in alignment::kabschCore returned an error", info));
+        } else if (info < 0)
+          throw(NumericalError("SVD in alignment::kabschCore returned an error", info));
+
+
+        double dR = R[0]*R[4]*R[8] + R[3]*R[7]*R[2] + R[6]*R[1]*R[5] -
+          R[0]*R[7]*R[5] - R[3]*R[1]*R[8] - R[6]*R[4]*R[2];
+
+
+        double dV = V[0]*V[4]*V[8] + V[3]*V[7]*V[2] + V[6]*V[1]*V[5] -
+          V[0]*V[7]*V[5] - V[3]*V[1]*V[8] - V[6]*V[4]*V[2];
+
+
+        if (dR * dV < 0.0) {
+          S[2] = -S[2];
+
+          R[6] = -R[6];
+          R[7] = -R[7];
+          R[8] = -R[8];
+        }
+
+        return SVDTupleVec(R, S, V);
+      }
+
+    }
+
+
+    SVDTupleVec kabschCore(const double* u, const double* v, const uint natoms) {
+      f77int n = natoms;
 
       // Compute correlation matrix...
       vecDouble R(9);
@@ -31,59 +279,16 @@ namespace loos {
       double one = 1.0;
       double zero = 0.0;
 
-      dgemm_(&ta, &tb, &three, &three, &n, &one, u.data(), &three, v.data(), &three, &zero, R.data(), &three);
+      dgemm_(&ta, &tb, &three, &three, &n, &one, u, &three, v, &three, &zero, R.data(), &three);
 
 #else
 
-      cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, 3, 3, n, 1.0, u.data(), 3, v.data(), 3, 0.0, R.data(), 3);
+      cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, 3, 3, n, 1.0, u, 3, v, 3, 0.0, R.data(), 3);
 
 #endif
 
       // Now compute the SVD of R...
-      char joba='G';
-      char jobu = 'U', jobv = 'V';
-      int mv = 0;
-      f77int m = 3, lda = 3, ldv = 3, lwork=100, info;
-      double work[lwork];
-      f77int nn = 3;
-      vecDouble S(3);
-      vecDouble V(9);
-
-      dgesvj_(&joba, &jobu, &jobv, &m, &nn, R.data(), &lda, S.data(), &mv, V.data(), &ldv, work, &lwork, &info);
-
-      if (info > 0) {
-        char op = 'E';
-        double eps = dlamch_(&op);
-        std::cerr << boost::format("Warning- SVD in kabschCore() failed to converge with info=%d and TOL=%e\n") %
-          info % (eps * sqrt(3.0));
-        for (uint i=0; i<6; ++i)
-          std::cerr << boost::format("         work[%d] = %f\n") % (i+1) % work[i];
-        std::cerr << "\tThis may happen periodically, causing the output to be 'mostly' orthogonal.\n";
-        std::cerr << "\tThe residual is typically small and should not appreciably affect the resulting\n";
-        std::cerr << "\tsuperposition.  If this warning appears frequently, then please notify the LOOS\n";
-        std::cerr << "\tdevelopers at loos.maintainer@gmail.com\n";
-        //  throw(NumericalError("SVD in alignment::kabschCore returned an error", info));
-      } else if (info < 0)
-        throw(NumericalError("SVD in alignment::kabschCore returned an error", info));
-
-
-      double dR = R[0]*R[4]*R[8] + R[3]*R[7]*R[2] + R[6]*R[1]*R[5] -
-        R[0]*R[7]*R[5] - R[3]*R[1]*R[8] - R[6]*R[4]*R[2];
-
-
-      double dV = V[0]*V[4]*V[8] + V[3]*V[7]*V[2] + V[6]*V[1]*V[5] -
-        V[0]*V[7]*V[5] - V[3]*V[1]*V[8] - V[6]*V[4]*V[2];
-
-
-      if (dR * dV < 0.0) {
-        S[2] = -S[2];
-
-        R[6] = -R[6];
-        R[7] = -R[7];
-        R[8] = -R[8];
-      }
-
-      return SVDTupleVec(R, S, V);
+      return(correlationSVD(R));
     }
 
 
@@ -113,8 +318,15 @@ namespace loos {
     // Return the RMSD only for a kabsch alignment between U and V assuming
     // both are centered
     double centeredRMSD(const vecDouble& U, const vecDouble& V) {
+      return(centeredRMSD(U.data(), V.data(), U.size() / 3));
+    }
 
-      int n = U.size();
+
+    double centeredRMSD(const double* U, const double* V, const uint natoms) {
+      if (superposition_method == QCP)
+        return(qcpCenteredRMSD(U, V, natoms));
+
+      int n = 3 * natoms;
 
       double ssu[3] = {0.0, 0.0, 0.0};
       double ssv[3] = {0.0, 0.0, 0.0};
@@ -130,7 +342,7 @@ namespace loos {
 
       double E0 = ssu[0] + ssu[1] + ssu[2] + ssv[0] + ssv[1] + ssv[2];
 
-      SVDTupleVec svd = kabschCore(U, V);
+      SVDTupleVec svd = kabschCore(U, V, natoms);
 
       vecDouble S(boost::get<1>(svd));
       double ss = S[0] + S[1] + S[2];
@@ -153,6 +365,9 @@ namespace loos {
       centerAtOrigin(cU);
       centerAtOrigin(cV);
 
+      if (superposition_method == QCP)
+        return(qcpCenteredRMSD(cU.data(), cV.data(), n / 3));
+
       SVDTupleVec svd = kabschCore(cU, cV);
 
       double ssu[3] = {0.0, 0.0, 0.0};
@@ -180,37 +395,73 @@ namespace loos {
 
     // Kabsch alignment between U and V, assuming both are centered.
     // Returns the tranformation matrix to align U onto V.
-    GMatrix kabschCentered(const vecDouble& U, const vecDouble& V) {
-      SVDTupleVec svd = kabschCore(U, V);
+    namespace {
 
-      vecDouble R(boost::get<0>(svd));
-      vecDouble VV(boost::get<2>(svd));
+      // Rotation that superimposes U onto V given the output of kabschCore()
+      GMatrix rotationFromSVD(const SVDTupleVec& svd) {
+        vecDouble R(boost::get<0>(svd));
+        vecDouble VV(boost::get<2>(svd));
 
-      double M[9];
+        double M[9];
 
 #if defined(__linux__) || defined(__CYGWIN__) || defined(__FreeBSD__)
-      char ta = 'N';
-      char tb = 'T';
-      f77int three = 3;
-      double one = 1.0;
-      double zero = 0.0;
+        char ta = 'N';
+        char tb = 'T';
+        f77int three = 3;
+        double one = 1.0;
+        double zero = 0.0;
 
-      dgemm_(&ta, &tb, &three, &three, &three, &one, R.data(), &three, VV.data(), &three, &zero, M, &three);
+        dgemm_(&ta, &tb, &three, &three, &three, &one, R.data(), &three, VV.data(), &three, &zero, M, &three);
 
 #else
 
-      cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, 3, 3, 3, 1.0, R.data(), 3, VV.data(), 3, 0.0, M, 3);
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, 3, 3, 3, 1.0, R.data(), 3, VV.data(), 3, 0.0, M, 3);
 
 #endif
 
-      // Construct the new transformation matrix...  (W = M')
-      GMatrix Z;
-      for (uint i=0; i<3; i++)
-        for (uint j=0; j<3; j++)
-          Z(i,j) = M[i*3+j];
+        // Construct the new transformation matrix...  (W = M')
+        GMatrix Z;
+        for (uint i=0; i<3; i++)
+          for (uint j=0; j<3; j++)
+            Z(i,j) = M[i*3+j];
+
+        return Z;
+      }
+
+
+      GMatrix svdRotation(const vecDouble& U, const vecDouble& V) {
+        return(rotationFromSVD(kabschCore(U, V)));
+      }
+
+    }
+
+
+    GMatrix kabschCentered(const vecDouble& U, const vecDouble& V) {
+      if (superposition_method == QCP)
+        return(qcpRotation(U.data(), V.data(), U.size() / 3));
+
+      return(svdRotation(U, V));
+    }
+
+
+    GMatrix qcpRotation(const double* U, const double* V, const uint natoms) {
+      double A[9], Gu, Gv, rms, rot[9];
+      qcpInnerProduct(U, V, natoms, A, Gu, Gv);
 
-      return Z;
+      // Any rotation in the degenerate eigenspace is optimal, but QCP
+      // cannot reliably pick one, so let the SVD sort it out
+      if (!qcpSolve(A, (Gu + Gv) / 2.0, natoms, rms, rot)) {
+        vecDouble cU(U, U + 3 * natoms);
+        vecDouble cV(V, V + 3 * natoms);
+        return(svdRotation(cU, cV));
+      }
+
+      GMatrix Z;
+      for (uint i=0; i<3; ++i)
+        for (uint j=0; j<3; ++j)
+          Z(i, j) = rot[i*3+j];
 
+      return(Z);
     }
 
 
@@ -278,6 +529,260 @@ namespace loos {
 
 
 
+    namespace {
+
+      // Applies one of ReferenceSuperposition's per-frame methods to a
+      // contiguous block of packed frames (see runFrameBlocks())
+      template<typename T>
+      struct FrameBlockWorker {
+        typedef T (ReferenceSuperposition::*Method)(const double*) const;
+
+        FrameBlockWorker(const ReferenceSuperposition* r, Method m, const double* f, const uint b, const uint e, T* res, std::string* err)
+          : ref(r), method(m), frames(f), begin(b), end(e), results(res), error(err) { }
+
+        void operator()() {
+          try {
+            size_t stride = 3 * static_cast<size_t>(ref->natoms());
+            for (uint i=begin; i<end; ++i)
+              results[i] = (ref->*method)(frames + i * stride);
+          }
+          catch (std::exception& e) {
+            *error = e.what();
+          }
+          catch (...) {
+            *error = "Unknown exception while superimposing frames";
+          }
+        }
+
+        const ReferenceSuperposition* ref;
+        Method method;
+        const double* frames;
+        uint begin, end;
+        T* results;
+        std::string* error;
+      };
+
+
+      template<typename T>
+      void runFrameBlocks(const ReferenceSuperposition* ref, typename FrameBlockWorker<T>::Method method,
+                          const double* frames, const uint nframes, T* results, const uint nthreads) {
+        uint nt = nthreads ? nthreads : boost::thread::hardware_concurrency();
+        if (nt > nframes)
+          nt = nframes;
+        if (nt < 1)
+          nt = 1;
+
+        std::vector<std::string> errors(nt);
+        boost::thread_group threads;
+        for (uint k=0; k<nt-1; ++k)
+          threads.create_thread(FrameBlockWorker<T>(ref, method, frames,
+                                                    (k * nframes) / nt, ((k+1) * nframes) / nt, results, &(errors[k])));
+
+        // The last block is handled by the calling thread...
+        FrameBlockWorker<T>(ref, method, frames, ((nt-1) * nframes) / nt, nframes, results, &(errors[nt-1]))();
+        threads.join_all();
+
+        for (uint k=0; k<nt; ++k)
+          if (!errors[k].empty())
+            throw(LOOSError(errors[k]));
+      }
+
+    }
+
+
+
+    ReferenceSuperposition::ReferenceSuperposition(const vecDouble& reference)
+      : _reference(reference)
+    {
+      initialize();
+    }
+
+
+    ReferenceSuperposition::ReferenceSuperposition(const AtomicGroup& reference)
+      : _reference(reference.coordsAsVector())
+    {
+      initialize();
+    }
+
+
+    void ReferenceSuperposition::initialize() {
+      if (_reference.empty() || _reference.size() % 3 != 0)
+        throw(LOOSError("ReferenceSuperposition requires a non-empty set of xyz coordinates"));
+
+      _natoms = _reference.size() / 3;
+      _center = centerAtOrigin(_reference);
+      _Gv = 0.0;
+      for (uint i=0; i<_reference.size(); ++i)
+        _Gv += _reference[i] * _reference[i];
+    }
+
+
+    namespace {
+
+      // Coordinate accessors for accumulateInnerProducts(), so packed
+      // coordinates and groups share one loop without copying
+
+      struct PackedCoords {
+        PackedCoords(const double* p) : U(p) { }
+        void operator()(const uint i, double& x, double& y, double& z) const {
+          const double* u = U + 3*i;
+          x = u[0];  y = u[1];  z = u[2];
+        }
+        const double* U;
+      };
+
+      struct GroupCoords {
+        GroupCoords(const AtomicGroup& g) : group(g) { }
+        void operator()(const uint i, double& x, double& y, double& z) const {
+          const GCoord& u = group[i]->coords();
+          x = u.x();  y = u.y();  z = u.z();
+        }
+        const AtomicGroup& group;
+      };
+
+
+      // Since the reference V is centered, the correlation matrix does
+      // not depend on where the frame is, so the frame need not be
+      // centered.  Only its sum of squares is corrected for its
+      // centroid c.  A is laid out as for qcpInnerProduct(), which is
+      // also the column-major correlation matrix kabschCore() would
+      // compute.
+
+      template<class Coords>
+      void accumulateInnerProducts(const Coords& frame, const double* V, const uint natoms,
+                                   double* A, double& Gu, GCoord& c) {
+        double sxx = 0.0, sxy = 0.0, sxz = 0.0;
+        double syx = 0.0, syy = 0.0, syz = 0.0;
+        double szx = 0.0, szy = 0.0, szz = 0.0;
+        double cx = 0.0, cy = 0.0, cz = 0.0;
+        double gu = 0.0;
+
+        for (uint i=0; i<natoms; ++i, V += 3) {
+          double ux, uy, uz;
+          frame(i, ux, uy, uz);
+          double vx = V[0], vy = V[1], vz = V[2];
+
+          cx += ux;  cy += uy;  cz += uz;
+          gu += ux*ux + uy*uy + uz*uz;
+
+          sxx += vx * ux;  sxy += vx * uy;  sxz += vx * uz;
+          syx += vy * ux;  syy += vy * uy;  syz += vy * uz;
+          szx += vz * ux;  szy += vz * uy;  szz += vz * uz;
+        }
+
+        A[0] = sxx; A[1] = sxy; A[2] = sxz;
+        A[3] = syx; A[4] = syy; A[5] = syz;
+        A[6] = szx; A[7] = szy; A[8] = szz;
+
+        c = GCoord(cx / natoms, cy / natoms, cz / natoms);
+        Gu = gu - natoms * (c.x() * c.x() + c.y() * c.y() + c.z() * c.z());
+      }
+
+    }
+
+
+    void ReferenceSuperposition::innerProducts(const double* U, double* A, double& Gu, GCoord& c) const {
+      accumulateInnerProducts(PackedCoords(U), &_reference[0], _natoms, A, Gu, c);
+    }
+
+
+    void ReferenceSuperposition::innerProducts(const AtomicGroup& frame, double* A, double& Gu, GCoord& c) const {
+      if (static_cast<uint>(frame.size()) != _natoms)
+        throw(LOOSError("Group and reference have different numbers of atoms in ReferenceSuperposition"));
+
+      accumulateInnerProducts(GroupCoords(frame), &_reference[0], _natoms, A, Gu, c);
+    }
+
+
+    double ReferenceSuperposition::solveRMSD(const double* A, const double Gu) const {
+      if (superposition_method == QCP) {
+        double rms;
+        qcpSolve(A, (Gu + _Gv) / 2.0, _natoms, rms, 0);
+        return(rms);
+      }
+
+      vecDouble R(A, A + 9);
+      vecDouble S(boost::get<1>(correlationSVD(R)));
+      double ss = S[0] + S[1] + S[2];
+      return(std::sqrt(std::abs(Gu + _Gv - 2.0 * ss) / _natoms));
+    }
+
+
+    GMatrix ReferenceSuperposition::solveSuperposition(const double* A, const double Gu, GCoord c) const {
+      GMatrix M;
+      double rms, rot[9];
+
+      if (superposition_method == QCP && qcpSolve(A, (Gu + _Gv) / 2.0, _natoms, rms, rot)) {
+        for (uint i=0; i<3; ++i)
+          for (uint j=0; j<3; ++j)
+            M(i, j) = rot[i*3+j];
+      } else {
+        vecDouble R(A, A + 9);
+        M = rotationFromSVD(correlationSVD(R));
+      }
+
+      XForm W;
+      W.identity();
+      W.translate(_center);
+      W.concat(M);
+      W.translate(-c);
+
+      return(W.current());
+    }
+
+
+    double ReferenceSuperposition::rmsd(const double* frame) const {
+      double A[9], Gu;
+      GCoord c;
+      innerProducts(frame, A, Gu, c);
+      return(solveRMSD(A, Gu));
+    }
+
+
+    double ReferenceSuperposition::rmsd(const AtomicGroup& frame) const {
+      double A[9], Gu;
+      GCoord c;
+      innerProducts(frame, A, Gu, c);
+      return(solveRMSD(A, Gu));
+    }
+
+
+    GMatrix ReferenceSuperposition::superposition(const double* frame) const {
+      double A[9], Gu;
+      GCoord c;
+      innerProducts(frame, A, Gu, c);
+      return(solveSuperposition(A, Gu, c));
+    }
+
+
+    GMatrix ReferenceSuperposition::superposition(const AtomicGroup& frame) const {
+      double A[9], Gu;
+      GCoord c;
+      innerProducts(frame, A, Gu, c);
+      return(solveSuperposition(A, Gu, c));
+    }
+
+
+    void ReferenceSuperposition::rmsds(const double* frames, const uint nframes, double* results, const uint nthreads) const {
+      if (nframes == 0)
+        return;
+
+      double (ReferenceSuperposition::*method)(const double*) const = &ReferenceSuperposition::rmsd;
+      runFrameBlocks(this, method, frames, nframes, results, nthreads);
+    }
+
+
+    void ReferenceSuperposition::superpositions(const double* frames, const uint nframes, std::vector<GMatrix>& results, const uint nthreads) const {
+      results.resize(nframes);
+      if (nframes == 0)
+        return;
+
+      GMatrix (ReferenceSuperposition::*method)(const double*) const = &ReferenceSuperposition::superposition;
+      runFrameBlocks(this, method, frames, nframes, &results[0], nthreads);
+    }
+
+
+
   }
 
 
@@ -352,50 +857,140 @@ namespace loos {
 
 
 
+  namespace {
+
+    // Number of frames read into memory at a time by the streaming
+    // iterativeAlignment()
+    const uint streaming_block_size = 1024;
+
+
+    // Superimposes a range of frames in a packed block onto the
+    // target, storing each frame's transform and adding the
+    // transformed coordinates into this thread's sum
+
+    struct StreamingAlignWorker {
+      StreamingAlignWorker(const alignment::ReferenceSuperposition* t, const double* b, const uint f, const uint e,
+                           XForm* x, double* s, std::string* err)
+        : target(t), block(b), first(f), end(e), xforms(x), sum(s), error(err) { }
+
+      void operator()() {
+        try {
+          uint n = target->natoms();
+          for (uint i=first; i<end; ++i) {
+            const double* frame = block + static_cast<size_t>(i) * 3 * n;
+            GMatrix M = target->superposition(frame);
+            xforms[i].load(M);
+
+            for (uint j=0; j<n; ++j) {
+              GCoord c = M * GCoord(frame[3*j], frame[3*j+1], frame[3*j+2]);
+              sum[3*j] += c.x();
+              sum[3*j+1] += c.y();
+              sum[3*j+2] += c.z();
+            }
+          }
+        }
+        catch (std::exception& e) {
+          *error = e.what();
+        }
+        catch (...) {
+          *error = "Unknown exception while aligning frames";
+        }
+      }
+
+      const alignment::ReferenceSuperposition* target;
+      const double* block;
+      uint first, end;
+      XForm* xforms;
+      double* sum;
+      std::string* error;
+    };
+
+  }
+
+
   boost::tuple<std::vector<XForm>, greal, int> iterativeAlignment(const AtomicGroup& g,
                                                                   pTraj& traj,
                                                                   const std::vector<uint>& frame_indices,
-                                                                  greal threshold, int maxiter) {
+                                                                  greal threshold, int maxiter,
+                                                                  const uint nthreads) {
 
     using namespace alignment;
 
-    // Must first prime the loop...
+    if (frame_indices.empty())
+      throw(LOOSError("Cannot iteratively align an empty set of frames"));
+
     AtomicGroup frame = g.copy();
+    uint n = frame.size();
+    uint nf = frame_indices.size();
+    uint block_size = std::min(streaming_block_size, nf);
+
+    uint nt = nthreads ? nthreads : boost::thread::hardware_concurrency();
+    if (nt > block_size)
+      nt = block_size;
+    if (nt < 1)
+      nt = 1;
+
+    // Must first prime the loop...
     traj->readFrame(frame_indices[0]);
     traj->updateGroupCoords(frame);
+    vecDouble target = frame.coordsAsVector();
+    centerAtOrigin(target);
 
-    int nf = frame_indices.size();
+    std::vector<XForm> xforms(nf);
+    vecDouble block(static_cast<size_t>(block_size) * 3 * n);
+    std::vector<vecDouble> sums(nt, vecDouble(3 * n));
+    std::vector<std::string> errors(nt);
 
     int iter = 0;
     greal rms;
-    std::vector<XForm> xforms(nf);
-    AtomicGroup avg = frame.copy();
-
-    AtomicGroup target = frame.copy();
-    target.centerAtOrigin();
 
     do {
-      // Compute avg internally so we don't have to read traj twice...
-      for (uint j=0; j<avg.size(); ++j)
-        avg[j]->coords() = GCoord(0,0,0);
-
-      for (int i=0; i<nf; ++i) {
-
-        traj->readFrame(frame_indices[i]);
-        traj->updateGroupCoords(frame);
-
-        GMatrix M = frame.alignOnto(target);
-        xforms[i].load(M);
+      ReferenceSuperposition reference(target);
+      for (uint k=0; k<nt; ++k)
+        std::fill(sums[k].begin(), sums[k].end(), 0.0);
+
+      // One pass through the trajectory, a block of frames at a time.
+      // Frames are read serially, then each thread aligns part of the
+      // block and accumulates its own sum for the new average.
+      for (uint b=0; b<nf; b += block_size) {
+        uint m = std::min(block_size, nf - b);
+
+        for (uint i=0; i<m; ++i) {
+          if (!traj->readFrame(frame_indices[b+i]))
+            throw(LOOSError("Unable to read frame while iteratively aligning a trajectory"));
+          traj->updateGroupCoords(frame);
+
+          double* p = &block[static_cast<size_t>(i) * 3 * n];
+          for (uint j=0; j<n; ++j) {
+            const GCoord& c = frame[j]->coords();
+            p[3*j] = c.x();
+            p[3*j+1] = c.y();
+            p[3*j+2] = c.z();
+          }
+        }
 
-        for (uint j=0; j<avg.size(); ++j)
-          avg[j]->coords() += frame[j]->coords();
+        uint bt = std::min(nt, m);
+        boost::thread_group threads;
+        for (uint k=0; k<bt-1; ++k)
+          threads.create_thread(StreamingAlignWorker(&reference, &block[0], (k * m) / bt, ((k+1) * m) / bt,
+                                                     &xforms[b], &(sums[k][0]), &(errors[k])));
+        StreamingAlignWorker(&reference, &block[0], ((bt-1) * m) / bt, m, &xforms[b], &(sums[bt-1][0]), &(errors[bt-1]))();
+        threads.join_all();
+
+        for (uint k=0; k<bt; ++k)
+          if (!errors[k].empty())
+            throw(LOOSError(errors[k]));
       }
 
+      vecDouble avg(sums[0]);
+      for (uint k=1; k<nt; ++k)
+        for (uint j=0; j<avg.size(); ++j)
+          avg[j] += sums[k][j];
       for (uint j=0; j<avg.size(); ++j)
-        avg[j]->coords() /= nf;
+        avg[j] /= nf;
 
-      rms = avg.rmsd(target);
-      target = avg.copy();
+      rms = rmsd(target, avg);
+      target = avg;
       ++iter;
     } while (rms > threshold && iter <= maxiter);
 
@@ -406,13 +1001,14 @@ namespace loos {
 
   boost::tuple<std::vector<XForm>, greal, int> iterativeAlignment(const AtomicGroup& g,
                                                                   pTraj& traj,
-                                                                  greal threshold, int maxiter) {
+                                                                  greal threshold, int maxiter,
+                                                                  const uint nthreads) {
 
     std::vector<uint> framelist(traj->nframes());
     for (uint i=0; i<traj->nframes(); ++i)
       framelist[i] = i;
 
-    return(iterativeAlignment(g, traj, framelist, threshold, maxiter));
+    return(iterativeAlignment(g, traj, framelist, threshold, maxiter, nthreads));
 
 
   }
@@ -42,18 +42,109 @@ namespace loos {
                 typedef std::vector<double>    vecDouble;
                 typedef std::vector<vecDouble> vecMatrix;
                 typedef boost::tuple<vecDouble, vecDouble, vecDouble>   SVDTupleVec;
-        
+
+
+                //! How the optimal superposition is found
+                /**
+                 * SVD uses LAPACK to decompose the 3x3 correlation
+                 * matrix (the original method).  QCP uses Theobald's
+                 * quaternion characteristic polynomial, which finds
+                 * the RMSD (and rotation) in closed form without any
+                 * LAPACK calls or allocation and is much faster for
+                 * small selections.  Both give the same results to
+                 * within numerical precision, although QCP's RMSD is
+                 * less precise (~1e-4 A) for collinear selections.
+                 */
+                enum SuperpositionMethod { SVD, QCP };
+
+                //! Select the method used by centeredRMSD(), alignedRMSD(), and kabsch() (the default is SVD)
+                void superpositionMethod(const SuperpositionMethod m);
+                SuperpositionMethod superpositionMethod();
+
         
                 SVDTupleVec kabschCore(const vecDouble& u, const vecDouble& v);
                 GCoord centerAtOrigin(vecDouble& v);
                 double alignedRMSD(const vecDouble& U, const vecDouble& V);
                 double centeredRMSD(const vecDouble& U, const vecDouble& V);
+
+#if !defined(SWIG)
+                // Versions that take packed xyz arrays of natoms atoms
+                // each (e.g. frames stored in a memory-mapped file)
+                SVDTupleVec kabschCore(const double* u, const double* v, const uint natoms);
+                double centeredRMSD(const double* U, const double* V, const uint natoms);
+
+                //! RMSD between centered U and V using QCP, regardless of superpositionMethod()
+                double qcpCenteredRMSD(const double* U, const double* V, const uint natoms);
+
+                //! Rotation that superimposes centered U onto V using QCP, regardless of superpositionMethod()
+                GMatrix qcpRotation(const double* U, const double* V, const uint natoms);
+#endif
+
                 GMatrix kabsch(const vecDouble& U, const vecDouble& V);
                 void applyTransform(const GMatrix& M, vecDouble& v);
                 vecDouble averageCoords(const vecMatrix& ensemble);
                 double rmsd(const vecDouble& u, const vecDouble& v);
 
 
+#if !defined(SWIG)
+                //! Superimposes many structures onto one fixed reference
+                /**
+                 * The reference is centered (and its sum of squares
+                 * computed) once, when the object is created.  Each
+                 * structure is then handled in a single pass over its
+                 * coordinates, without copying or centering it, and
+                 * without any allocation when using QCP (see
+                 * superpositionMethod()).  Structures may be given as
+                 * an AtomicGroup or as packed xyz coordinates, and
+                 * blocks of frames stored contiguously may be handled
+                 * in one call using multiple threads.
+                 *
+                 * All methods are const, so one object may be shared
+                 * by several threads.
+                 */
+                class ReferenceSuperposition {
+                public:
+                        explicit ReferenceSuperposition(const vecDouble& reference);
+                        explicit ReferenceSuperposition(const AtomicGroup& reference);
+
+                        uint natoms() const { return(_natoms); }
+
+                        //! Centroid of the reference
+                        GCoord center() const { return(_center); }
+
+                        //! RMSD between the reference and \a frame after optimal superposition
+                        double rmsd(const double* frame) const;
+                        double rmsd(const AtomicGroup& frame) const;
+
+                        //! Transform that superimposes \a frame onto the reference (same as AtomicGroup::superposition())
+                        GMatrix superposition(const double* frame) const;
+                        GMatrix superposition(const AtomicGroup& frame) const;
+
+                        //! RMSDs for \a nframes packed frames stored one after the other in \a frames
+                        /**
+                         * Frames are split into contiguous blocks, one
+                         * per thread (0 = all available).
+                         */
+                        void rmsds(const double* frames, const uint nframes, double* results, const uint nthreads = 1) const;
+
+                        //! Transforms for \a nframes packed frames stored one after the other in \a frames
+                        void superpositions(const double* frames, const uint nframes, std::vector<GMatrix>& results, const uint nthreads = 1) const;
+
+                private:
+                        void initialize();
+                        void innerProducts(const double* frame, double* A, double& Gu, GCoord& c) const;
+                        void innerProducts(const AtomicGroup& frame, double* A, double& Gu, GCoord& c) const;
+                        double solveRMSD(const double* A, const double Gu) const;
+                        GMatrix solveSuperposition(const double* A, const double Gu, GCoord c) const;
+
+                        vecDouble _reference;
+                        uint _natoms;
+                        GCoord _center;
+                        double _Gv;
+                };
+#endif
+
+
         }
 
 #if !defined(SWIG)
@@ -74,18 +165,26 @@ namespace loos {
          * in decent performance.  If speed is essential, then consider
          * using the iterativeAlignment() version that takes a
          * \p std::vector<AtomicGroup>& as argument instead.
+         *
+         * Only a block of frames is held in memory at any time, so
+         * this works for trajectories of any length.  Each pass reads
+         * a block of frames, then superimposes them onto the current
+         * average using \a nthreads threads (0 = all available), with
+         * each thread summing its frames for the next average.
          */
         boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(const AtomicGroup& model,
                                                                       pTraj& traj,
                                                                       const std::vector<uint>& frame_indices,
                                                                       greal threshold=1e-6,
-                                                                      int maxiter=1000);
+                                                                      int maxiter=1000,
+                                                                      const uint nthreads=1);
 
 
         boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(const AtomicGroup& model,
                                                                       pTraj& traj,
                                                                       greal threshold=1e-6,
-                                                                      int maxiter=1000);
+                                                                      int maxiter=1000,
+                                                                      const uint nthreads=1);
 
         
 #endif // !defined(SWIG)
@@ -1,5 +1,7 @@
 // (c) 2012 Tod D. Romo, Grossfield Lab, URMC
 
+#include <algorithm>
+
 #include <amber_netcdf.hpp>
 #include <AtomicGroup.hpp>
 
@@ -102,42 +104,145 @@ namespace loos {
 	}
 
 
+	// Reads the atom triplets for a frame from the given variable,
+	// either all at once or only the runs in the atom subset
+	void AmberNetcdf::readAtoms(const int varid, const uint frameno, GCoord::element_type* data, const std::string& what) {
+		size_t start[3] = {frameno, 0, 0};
+		size_t count[3] = {1, _natoms, 3};
+
+		if (_subset_ranges.empty()) {
+			int retval = VarTypeDecider<GCoord::element_type>::read(_ncid, varid, start, count, data);
+			if (retval)
+				throw(FileReadError(_filename, "Cannot read Amber netcdf frame (" + what + ")", retval));
+			return;
+		}
+
+		for (std::vector<AtomRange>::const_iterator r = _subset_ranges.begin(); r != _subset_ranges.end(); ++r) {
+			start[1] = r->first;
+			count[1] = r->second;
+			int retval = VarTypeDecider<GCoord::element_type>::read(_ncid, varid, start, count, data + 3 * r->first);
+			if (retval)
+				throw(FileReadError(_filename, "Cannot read Amber netcdf frame (" + what + ")", retval));
+		}
+	}
+
+
 	// Given a frame number, read the coord data into the internal array
 	// and retrieve the corresponding periodic box (if present)
 	void AmberNetcdf::readRawFrame(const uint frameno)  {
-		size_t start[3] = {0, 0, 0};
-		size_t count[3] = {1, 1, 3};
-
 
 		// Read coordinates first...
-		start[0] = frameno;
-		count[1] = _natoms;
-
-
-		int retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _coord_id, start, count, _coord_data);
-		if (retval)
-			throw(FileReadError(_filename, "Cannot read Amber netcdf frame (coords)", retval));
+		readAtoms(_coord_id, frameno, _coord_data, "coords");
 
 		if (_velocities)
-		{
-			retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _velocities_id, start, count, _velocity_data);
-			if (retval)
-				throw(FileReadError(_filename, "Cannot read Amber netcdf frame (velocities)", retval));
-		}
+			readAtoms(_velocities_id, frameno, _velocity_data, "velocities");
 
 
 		// Now get box if present...
 		if (_periodic) {
-			start[1] = 0;
-			count[1] = 3;
+			size_t start[2] = {frameno, 0};
+			size_t count[2] = {1, 3};
 
-			retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _cell_lengths_id, start, count, _box_data);
+			int retval = VarTypeDecider<GCoord::element_type>::read(_ncid, _cell_lengths_id, start, count, _box_data);
 			if (retval)
 				throw(FileReadError(_filename, "Cannot read Amber netcdf periodic box", retval));
 		}
 
 	}
 
+	void AmberNetcdf::setAtomSubsetImpl() {
+		// Each hyperslab is a separate request, so merge runs that are
+		// close together
+		_subset_ranges = atomSubsetRanges(256);
+	}
+
+
+	template<typename T>
+	void AmberNetcdf::readFrameBlock(const std::vector<uint>& frames, const std::vector<uint>& atoms, T* buffer) {
+		size_t na = atoms.empty() ? _natoms : atoms.size();
+
+		// Runs of atoms to read, and where each requested atom is in them
+		std::vector<AtomRange> ranges;
+		std::vector<uint> which(atoms.size()), offset(atoms.size());
+		size_t span = 0;
+		if (atoms.empty()) {
+			ranges.push_back(AtomRange(0, _natoms));
+			span = _natoms;
+		} else {
+			std::vector<uint> sorted(atoms);
+			std::sort(sorted.begin(), sorted.end());
+			sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+			ranges = atomRanges(sorted, 256);
+
+			std::vector<uint> starts;
+			for (uint r=0; r<ranges.size(); ++r) {
+				starts.push_back(ranges[r].first);
+				span += ranges[r].second;
+			}
+			for (uint j=0; j<atoms.size(); ++j) {
+				which[j] = std::upper_bound(starts.begin(), starts.end(), atoms[j]) - starts.begin() - 1;
+				offset[j] = atoms[j] - ranges[which[j]].first;
+			}
+		}
+
+		// Consecutive frames are read together, up to about 64 MB at a time
+		size_t max_frames = std::max(static_cast<size_t>(1), 64 * static_cast<size_t>(megabytes) / (span * 3 * sizeof(T)));
+		std::vector<T> slab;
+		std::vector<size_t> slab_start(ranges.size());
+
+		uint k = 0;
+		while (k < frames.size()) {
+			uint m = 1;
+			while (k + m < frames.size() && m < max_frames && frames[k+m] == frames[k+m-1] + 1)
+				++m;
+
+			size_t start[3] = {frames[k], 0, 0};
+			size_t count[3] = {m, 0, 3};
+
+			if (atoms.empty()) {
+				count[1] = _natoms;
+				int retval = VarTypeDecider<T>::read(_ncid, _coord_id, start, count, buffer + k * na * 3);
+				if (retval)
+					throw(FileReadError(_filename, "Cannot read Amber netcdf frames (coords)", retval));
+				k += m;
+				continue;
+			}
+
+			slab.resize(m * span * 3);
+			size_t pos = 0;
+			for (uint r=0; r<ranges.size(); ++r) {
+				slab_start[r] = pos;
+				start[1] = ranges[r].first;
+				count[1] = ranges[r].second;
+				int retval = VarTypeDecider<T>::read(_ncid, _coord_id, start, count, &slab[pos]);
+				if (retval)
+					throw(FileReadError(_filename, "Cannot read Amber netcdf frames (coords)", retval));
+				pos += m * ranges[r].second * 3;
+			}
+
+			for (uint i=0; i<m; ++i) {
+				T* p = buffer + (k + i) * na * 3;
+				for (uint j=0; j<na; ++j) {
+					const T* q = &slab[slab_start[which[j]] + (i * ranges[which[j]].second + offset[j]) * 3];
+					*p++ = q[0];
+					*p++ = q[1];
+					*p++ = q[2];
+				}
+			}
+			k += m;
+		}
+	}
+
+
+	void AmberNetcdf::readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer) {
+		readFrameBlock(frames, atoms, buffer);
+	}
+
+	void AmberNetcdf::readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer) {
+		readFrameBlock(frames, atoms, buffer);
+	}
+
+
 	bool AmberNetcdf::parseFrame() {
 		if (_current_frame >= _nframes)
 			return(false);
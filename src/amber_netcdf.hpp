@@ -64,6 +64,14 @@ namespace loos {
 
 
 	//! Class for reading Amber Trajectories in NetCDF format
+	/**
+	 * With an atom subset (see Trajectory::setAtomSubset()), each run
+	 * of atoms in the subset is read as a separate hyperslab, so only
+	 * those coordinates (and velocities) are read from the file.
+	 * Trajectory::readFrames() reads runs of consecutive frames as one
+	 * hyperslab, directly into the caller's buffer when all atoms are
+	 * requested.
+	 */
 	class AmberNetcdf : public Trajectory {
 	public:
 
@@ -130,6 +138,7 @@ namespace loos {
 		void readGlobalAttributes();
 		std::string readGlobalAttribute(const std::string& name);
 		void readRawFrame(const uint frameno);
+		void readAtoms(const int varid, const uint frameno, GCoord::element_type* data, const std::string& what);
 
 		void updateGroupCoordsImpl(AtomicGroup& g);
 		void updateGroupVelocitiesImpl(AtomicGroup& g);
@@ -139,6 +148,10 @@ namespace loos {
 		void rewindImpl() { }
 
 		std::vector<GCoord> velocitiesImpl() const;
+		void setAtomSubsetImpl();
+		void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer);
+		void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer);
+		template<typename T> void readFrameBlock(const std::vector<uint>& frames, const std::vector<uint>& atoms, T* buffer);
 
 
 	private:
@@ -155,6 +168,7 @@ namespace loos {
 		size_t _coord_size;
 		int _cell_lengths_id;
 		int _velocities_id;
+		std::vector<AtomRange> _subset_ranges;
 		std::string _title, _application, _program, _programVersion, _conventions, _conventionVersion;
 	};
 
@@ -110,12 +110,15 @@ namespace loos {
     pAtom pa;
 
 
-    for (gi = g.begin(); gi != g.end(); ++gi) {
-      uint i = (*gi)->index();
-      if (i >= _natoms)
-        throw(LOOSError(**gi, "Atom index into trajectory is out of bounds"));
-      (*gi)->coords(frame[i]);
-    }
+    if (g.isPacked())
+      g.copyCoordinatesWithIndex(frame);
+    else
+      for (gi = g.begin(); gi != g.end(); ++gi) {
+        uint i = (*gi)->index();
+        if (i >= _natoms)
+          throw(LOOSError(**gi, "Atom index into trajectory is out of bounds"));
+        (*gi)->coords(frame[i]);
+      }
 
     if (periodic)
       g.periodicBox(box);
@@ -133,12 +133,15 @@ namespace loos {
 
   void AmberTraj::updateGroupCoordsImpl(AtomicGroup& g) {
 
-    for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
-      uint idx = (*i)->index();
-      if (idx >= _natoms)
-        throw(LOOSError(**i, "Atom index into trajectory is out of bounds"));
-      (*i)->coords(frame[idx]);
-    }
+    if (g.isPacked())
+      g.copyCoordinatesWithIndex(frame);
+    else
+      for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+        uint idx = (*i)->index();
+        if (idx >= _natoms)
+          throw(LOOSError(**i, "Atom index into trajectory is out of bounds"));
+        (*i)->coords(frame[idx]);
+      }
     
     if (periodic)
       g.periodicBox(box);
@@ -205,6 +205,18 @@ Trajectory::parseFrame;
 %catches(loos::FileError, std::range_error) Trajectory::seekFrame;
 %catches(loos::FileError) Trajectory::rewind;
 %catches(loos::LOOSError, std::range_error) Trajectory::updateGroupCoords;
+%catches(loos::LOOSError) Trajectory::setAtomSubset;
+
+%catches(loos::ParseError,\
+	 loos::FileOpenError,	    \
+	 loos::FileReadErrorWithLine,\
+	 loos::FileReadError,\
+	 loos::FileError,\
+	 loos::XDRDataSizeError,\
+	 loos::LOOSError,\
+	 std::logic_error,\
+	 std::runtime_error) \
+Trajectory::readFrames;
 
 
 
@@ -28,6 +28,7 @@
 #include <exception>
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
 
 #include <stdio.h>
 #include <string.h>
@@ -45,6 +46,7 @@ namespace loos {
 
 
   bool DCD::suppress_warnings = false;
+  bool DCD::use_mmap = true;
   
   
   std::vector<std::string> DCD::titles(void) const { return(_titles); }
@@ -59,9 +61,9 @@ namespace loos {
   float DCD::timestep(void) const { return(_delta); }
   uint DCD::nframes(void) const { return(_nframes); }
 
-  std::vector<dcd_real> DCD::xcoords(void) const { return(xcrds); }
-  std::vector<dcd_real> DCD::ycoords(void) const { return(ycrds); }
-  std::vector<dcd_real> DCD::zcoords(void) const { return(zcrds); }
+  std::vector<dcd_real> DCD::xcoords(void) const { return(std::vector<dcd_real>(xdata(), xdata() + _natoms)); }
+  std::vector<dcd_real> DCD::ycoords(void) const { return(std::vector<dcd_real>(ydata(), ydata() + _natoms)); }
+  std::vector<dcd_real> DCD::zcoords(void) const { return(std::vector<dcd_real>(zdata(), zdata() + _natoms)); }
 
   // The following track CHARMm names (more or less...)
   unsigned int DCD::nsteps(void) const { return(_icntrl[3]); }
@@ -326,6 +328,44 @@ namespace loos {
   }
 
 
+  // Reads only the runs of atoms in subset_ranges from the next
+  // line of coordinates, seeking over the rest of the record
+
+  bool DCD::readCoordRanges(std::vector<dcd_real>& v) {
+    std::streamoff start = ifs->tellg();
+    unsigned int n = _natoms * sizeof(dcd_real);
+
+    unsigned int len = readRecordLen();
+    if (len == 0)
+      return(false);
+    if (len != n)
+      throw(FileReadError(_filename, "Size of coords stored in frame does not match model size"));
+
+    for (std::vector<AtomRange>::const_iterator r = subset_ranges.begin(); r != subset_ranges.end(); ++r) {
+      ifs->seekg(start + 4 + static_cast<std::streamoff>(r->first) * sizeof(dcd_real));
+      ifs->read(reinterpret_cast<char*>(&v[r->first]), r->second * sizeof(dcd_real));
+      if (ifs->fail())
+        throw(FileReadError(_filename, "Error reading data record from DCD"));
+      if (swabbing)
+        for (uint i=r->first; i<r->first + r->second; ++i)
+          v[i] = swab(v[i]);
+    }
+
+    ifs->seekg(start + 4 + n);
+    if (readRecordLen() != n)
+      throw(FileReadError(_filename, "Mismatch in record length while reading from DCD"));
+
+    return(true);
+  }
+
+
+  void DCD::setAtomSubsetImpl(void) {
+    // Seeking costs about as much as reading a page, so don't bother
+    // skipping fewer atoms than that...
+    subset_ranges = atomSubsetRanges(4096 / sizeof(dcd_real));
+  }
+
+
   void DCD::seekFrameImpl(const uint i) {
   
     if (first_frame_pos == 0)
@@ -334,6 +374,11 @@ namespace loos {
     if (i >= nframes())
       throw(FileError(_filename, "Requested DCD frame is out of range"));
 
+    if (mapped) {
+      mapped_pos = first_frame_pos + static_cast<std::streamoff>(i) * frame_size;
+      return;
+    }
+
     ifs->clear();
     ifs->seekg(first_frame_pos + i * frame_size);
     if (ifs->fail() || ifs->bad())
@@ -351,6 +396,9 @@ namespace loos {
     if (first_frame_pos == 0)
       throw(FileReadError(_filename, "Trying to read a DCD frame without first having read the header."));
 
+    if (mapped)
+      return(parseMappedFrame());
+
     // This will not catch most cases of reading to the end of the file...
     if (ifs->eof())
       return(false);
@@ -359,6 +407,16 @@ namespace loos {
       if (!readCrystalParams())
 	return(false);
 
+    if (!subset_ranges.empty()) {
+      if (!readCoordRanges(xcrds))
+        return(false);
+      if (!readCoordRanges(ycrds))
+        throw(FileReadError(_filename, "Unexpected EOF reading Y-coordinates from DCD"));
+      if (!readCoordRanges(zcrds))
+        throw(FileReadError(_filename, "Unexepcted EOF reading Z-coordinates from DCD"));
+      return(true);
+    }
+
     if (!readCoordLine(xcrds))
       return(false);
     
@@ -372,6 +430,11 @@ namespace loos {
 
 
   void DCD::rewindImpl(void) {
+    if (mapped) {
+      mapped_pos = first_frame_pos;
+      return;
+    }
+
     ifs->clear();
     ifs->seekg(first_frame_pos);
     if (ifs->fail() || ifs->bad())
@@ -379,17 +442,209 @@ namespace loos {
   }
 
 
+  // ----------------------------------------------------------
+  // Memory-mapped frames...
+
+  // Maps the file into memory once the header has been read.  If the
+  // file cannot be mapped (or the frames would not be aligned), the
+  // stream is used instead.
+
+  void DCD::mapFile() {
+    if (first_frame_pos % sizeof(dcd_real) != 0 || sizeof(dcd_real) != sizeof(float))
+      return;
+
+    try {
+      mapped = boost::shared_ptr<internal::MappedFile>(new internal::MappedFile(_filename));
+    }
+    catch (FileError&) {
+      mapped.reset();
+      return;
+    }
+
+    if (mapped->size() < static_cast<boost::uint64_t>(first_frame_pos)) {
+      mapped.reset();
+      return;
+    }
+    mapped_pos = first_frame_pos;
+  }
+
+
+  // Reads a F77 record length from the map
+  unsigned int DCD::mappedRecordLen(const std::streamoff pos) const {
+    unsigned int n;
+    memcpy(&n, mapped->data() + pos, sizeof(n));
+    if (swabbing)
+      n = swab(n);
+    return(n);
+  }
+
+
+  // Returns a pointer to the coordinates in the line that starts at
+  // pos.  If the file is not in native order, the coordinates are
+  // swabbed into v instead and a null pointer is returned.
+
+  const dcd_real* DCD::mappedCoordLine(const std::streamoff pos, std::vector<dcd_real>& v) {
+    unsigned int n = _natoms * sizeof(dcd_real);
+    if (mappedRecordLen(pos) != n || mappedRecordLen(pos + 4 + n) != n)
+      throw(FileReadError(_filename, "Size of coords stored in frame does not match model size"));
+
+    const dcd_real* p = reinterpret_cast<const dcd_real*>(mapped->data() + pos + 4);
+    if (!swabbing)
+      return(p);
+
+    if (_atom_subset.empty())
+      for (uint i=0; i<_natoms; ++i)
+        v[i] = swab(p[i]);
+    else
+      for (std::vector<uint>::const_iterator i = _atom_subset.begin(); i != _atom_subset.end(); ++i)
+        v[*i] = swab(p[*i]);
+    return(0);
+  }
+
+
+  bool DCD::parseMappedFrame(void) {
+    std::streamoff pos = mapped_pos;
+    std::streamoff size = mapped->size();
+
+    xmapped = ymapped = zmapped = 0;
+    if (pos >= size)
+      return(false);
+    if (pos + frame_size > size)
+      throw(FileReadError(_filename, "Unexpected EOF reading frame from DCD"));
+
+    if (hasCrystalParams()) {
+      if (mappedRecordLen(pos) != 48 || mappedRecordLen(pos + 52) != 48)
+        throw(FileReadError(_filename, "Cannot read crystal parameters"));
+
+      double dp[6];
+      memcpy(dp, mapped->data() + pos + 4, sizeof(dp));
+
+      qcrys[0] = dp[0];
+      qcrys[1] = dp[2];
+      qcrys[2] = dp[5];
+      qcrys[3] = dp[1];
+      qcrys[4] = dp[3];
+      qcrys[5] = dp[4];
+
+      if (swabbing)
+        for (int i=0; i<6; ++i)
+          qcrys[i] = swab(qcrys[i]);
+
+      pos += 56;
+    }
+
+    std::streamoff line_size = 8 + _natoms * sizeof(dcd_real);
+    const dcd_real* xp = mappedCoordLine(pos, xcrds);
+    const dcd_real* yp = mappedCoordLine(pos + line_size, ycrds);
+    const dcd_real* zp = mappedCoordLine(pos + 2 * line_size, zcrds);
+
+    xmapped = xp;
+    ymapped = yp;
+    zmapped = zp;
+    mapped_pos = pos + 3 * line_size;
+
+    return(true);
+  }
+
+
+  // ----------------------------------------------------------
+  // Batches of frames...
+
+  // Copies the requested atoms out of a complete frame in memory
+  // (starting with the crystal parameters, if present) as x,y,z
+  // triplets
+
+  template<typename T>
+  void DCD::extractFrame(const char* frame, const std::vector<uint>& atoms, T* out) const {
+    unsigned int n = _natoms * sizeof(dcd_real);
+    const char* lines[3];
+
+    const char* p = frame + (hasCrystalParams() ? 56 : 0);
+    for (uint d=0; d<3; ++d, p += 8 + n) {
+      unsigned int head, tail;
+      memcpy(&head, p, sizeof(head));
+      memcpy(&tail, p + 4 + n, sizeof(tail));
+      if (swabbing) {
+        head = swab(head);
+        tail = swab(tail);
+      }
+      if (head != n || tail != n)
+        throw(FileReadError(_filename, "Size of coords stored in frame does not match model size"));
+      lines[d] = p + 4;
+    }
+
+    uint na = atoms.empty() ? _natoms : atoms.size();
+    for (uint j=0; j<na; ++j) {
+      size_t offset = static_cast<size_t>(atoms.empty() ? j : atoms[j]) * sizeof(dcd_real);
+      for (uint d=0; d<3; ++d) {
+        dcd_real v;
+        memcpy(&v, lines[d] + offset, sizeof(v));
+        if (swabbing)
+          v = swab(v);
+        *out++ = v;
+      }
+    }
+  }
+
+
+  template<typename T>
+  void DCD::readFrameBlock(const std::vector<uint>& frames, const std::vector<uint>& atoms, T* buffer) {
+    size_t stride = static_cast<size_t>(atoms.empty() ? _natoms : atoms.size()) * 3;
+
+    if (mapped) {
+      for (uint k=0; k<frames.size(); ++k) {
+        boost::uint64_t pos = first_frame_pos + static_cast<std::streamoff>(frames[k]) * frame_size;
+        if (pos + frame_size > mapped->size())
+          throw(FileReadError(_filename, "Unexpected EOF reading frame from DCD"));
+        extractFrame(mapped->data() + pos, atoms, buffer + k * stride);
+      }
+      return;
+    }
+
+    // Consecutive frames are read in blocks of up to 64 MB
+    std::streamoff max_block = std::max(static_cast<std::streamoff>(64) * megabytes, frame_size);
+    std::vector<char> block;
+    uint k = 0;
+    while (k < frames.size()) {
+      uint m = 1;
+      while (k + m < frames.size() && frames[k+m] == frames[k+m-1] + 1 && (m+1) * frame_size <= max_block)
+        ++m;
+
+      block.resize(m * frame_size);
+      ifs->clear();
+      ifs->seekg(first_frame_pos + static_cast<std::streamoff>(frames[k]) * frame_size);
+      ifs->read(&block[0], block.size());
+      if (ifs->fail())
+        throw(FileReadError(_filename, "Unexpected EOF reading frame from DCD"));
+
+      for (uint i=0; i<m; ++i)
+        extractFrame(&block[0] + i * frame_size, atoms, buffer + (k + i) * stride);
+      k += m;
+    }
+    ifs->clear();
+  }
+
+
+  void DCD::readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer) {
+    readFrameBlock(frames, atoms, buffer);
+  }
+
+  void DCD::readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer) {
+    readFrameBlock(frames, atoms, buffer);
+  }
+
+
   // ----------------------------------------------------------
 
 
   std::vector<GCoord> DCD::coords(void) const {
     std::vector<GCoord> crds(_natoms);
+    const dcd_real* xp = xdata();
+    const dcd_real* yp = ydata();
+    const dcd_real* zp = zdata();
 
-    for (uint i=0; i<_natoms; i++) {
-      crds[i].x(xcrds[i]);
-      crds[i].y(ycrds[i]);
-      crds[i].z(zcrds[i]);
-    }
+    for (uint i=0; i<_natoms; i++)
+      crds[i].set(xp[i], yp[i], zp[i]);
 
     return(crds);
   }
@@ -397,13 +652,14 @@ namespace loos {
   std::vector<GCoord> DCD::mappedCoords(const std::vector<int>& indices) {
     std::vector<int>::const_iterator iter;
     std::vector<GCoord> crds(indices.size());
+    const dcd_real* xp = xdata();
+    const dcd_real* yp = ydata();
+    const dcd_real* zp = zdata();
 
     int j = 0;
     for (iter = indices.begin(); iter != indices.end(); iter++, j++) {
       int index = *iter;
-      crds[j].x(xcrds[index]);
-      crds[j].y(ycrds[index]);
-      crds[j].z(zcrds[index]);
+      crds[j].set(xp[index], yp[index], zp[index]);
     }
 
     return(crds);
@@ -411,12 +667,19 @@ namespace loos {
 
 
   void DCD::updateGroupCoordsImpl(AtomicGroup& g) {
-    for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
-      uint idx = (*i)->index();
-      if (idx >= _natoms)
-        throw(LOOSError(**i, "Atom index into the trajectory frame is out of bounds"));
-      (*i)->coords(GCoord(xcrds[idx], ycrds[idx], zcrds[idx]));
-    }
+    const dcd_real* xp = xdata();
+    const dcd_real* yp = ydata();
+    const dcd_real* zp = zdata();
+
+    if (g.isPacked())
+      g.copyCoordinatesWithIndex(xp, yp, zp, _natoms);
+    else
+      for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+        uint idx = (*i)->index();
+        if (idx >= _natoms)
+          throw(LOOSError(**i, "Atom index into the trajectory frame is out of bounds"));
+        (*i)->coords(GCoord(xp[idx], yp[idx], zp[idx]));
+      }
 
     // Handle periodic boundary conditions (if present)
     if (hasPeriodicBox()) {
@@ -426,8 +689,10 @@ namespace loos {
 
 
 
-  void DCD::initTrajectory() {
+  void DCD::initTrajectory(const bool map) {
         readHeader();
+        if (map)
+          mapFile();
         bool b = parseFrame();
         if (!b)
             throw(LOOSError("Cannot read first frame of DCD during initialization"));
@@ -30,9 +30,12 @@
 #include <stdexcept>
 #include <exception>
 
+#include <boost/shared_ptr.hpp>
+
 #include <loos_defs.hpp>
 
 #include <Trajectory.hpp>
+#include <MappedFile.hpp>
 
 
 namespace loos {
@@ -59,9 +62,25 @@ namespace loos {
      *  - [Almost] everything returned is a copy
      *
      *  - Endian detection is based on the expected size of the header
+     *
+     *  - When opened by filename, the file is mapped into memory and
+     *    frames are located by their offset.  If the DCD is in native
+     *    byte order, coordinates are taken directly from the mapped
+     *    pages without being copied, so random access and strided
+     *    reads cost little more than the coordinates actually used.
+     *    This can be disabled with setMemoryMapping(false).
+     *
+     *  - With an atom subset (see Trajectory::setAtomSubset()), only
+     *    the runs of the x, y and z records that hold those atoms are
+     *    read from a stream, and only those atoms are swabbed.
+     *
+     *  - readFrames() takes frames straight from the mapped file, or
+     *    reads runs of consecutive frames from a stream in one block,
+     *    without going through parseFrame().
      */
     class DCD : public Trajectory {
         static bool suppress_warnings;
+        static bool use_mmap;
 
 
         // Use a union to convert data to appropriate type...
@@ -77,17 +96,20 @@ namespace loos {
         explicit DCD(const std::string s) :  Trajectory(s), _natoms(0), _nframes(0),
                                              qcrys(std::vector<double>(6)),
                                              frame_size(0), first_frame_pos(0),
-                                             swabbing(false) { initTrajectory(); }
+                                             swabbing(false), mapped_pos(0),
+                                             xmapped(0), ymapped(0), zmapped(0) { initTrajectory(use_mmap); }
 
         //! Begin reading from the file named s
         explicit DCD(const char* s) :  Trajectory(s), _natoms(0), _nframes(0),
                                        qcrys(std::vector<double>(6)), frame_size(0),
-                                       first_frame_pos(0), swabbing(false) { initTrajectory(); }
+                                       first_frame_pos(0), swabbing(false), mapped_pos(0),
+                                       xmapped(0), ymapped(0), zmapped(0) { initTrajectory(use_mmap); }
 
         //! Begin reading from the stream ifs
         explicit DCD(std::istream& fs) : Trajectory(fs), _natoms(0), _nframes(0),
                                          qcrys(std::vector<double>(6)), frame_size(0), first_frame_pos(0),
-                                         swabbing(false) { initTrajectory(); };
+                                         swabbing(false), mapped_pos(0),
+                                         xmapped(0), ymapped(0), zmapped(0) { initTrajectory(false); };
 
         std::string description() const { return("CHARMM/NAMD DCD"); }
 
@@ -135,6 +157,9 @@ namespace loos {
         //! Returns true if the DCD file being read is in the native endian format
         bool nativeFormat(void) const;
 
+        //! Returns true if frames are being read from a memory-mapped file
+        bool isMapped(void) const { return(mapped.get() != 0); }
+
         //! Auto-interleave the coords into a vector of GCoord()'s.
         /*!  This can be a pretty slow operation, so be careful. */
 		virtual std::vector<GCoord> coords(void) const;
@@ -147,6 +172,9 @@ namespace loos {
 
         static void setSuppression(const bool b) { suppress_warnings = b; }
 
+        //! Controls whether DCDs opened by filename are memory-mapped (the default)
+        static void setMemoryMapping(const bool b) { use_mmap = b; }
+
         //! Parse a frame of the DCD
         virtual bool parseFrame(void);
 
@@ -155,7 +183,8 @@ namespace loos {
         //! Read in the header from the stored stream
         void readHeader(void);
 
-        void initTrajectory();
+        void initTrajectory(const bool map);
+        void mapFile();
 
         uint calculateNumberOfFrames();
 
@@ -175,6 +204,22 @@ namespace loos {
         void allocateSpace(const int n);
         bool readCrystalParams(void);
         bool readCoordLine(std::vector<float>& v);
+        bool readCoordRanges(std::vector<dcd_real>& v);
+        virtual void setAtomSubsetImpl(void);
+
+        virtual void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer);
+        virtual void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer);
+        template<typename T> void readFrameBlock(const std::vector<uint>& frames, const std::vector<uint>& atoms, T* buffer);
+        template<typename T> void extractFrame(const char* frame, const std::vector<uint>& atoms, T* out) const;
+
+        bool parseMappedFrame(void);
+        unsigned int mappedRecordLen(const std::streamoff pos) const;
+        const dcd_real* mappedCoordLine(const std::streamoff pos, std::vector<dcd_real>& v);
+
+        // Current coordinates, which may point into the mapped file
+        const dcd_real* xdata(void) const { return(xmapped ? xmapped : (xcrds.empty() ? 0 : &xcrds[0])); }
+        const dcd_real* ydata(void) const { return(ymapped ? ymapped : (ycrds.empty() ? 0 : &ycrds[0])); }
+        const dcd_real* zdata(void) const { return(zmapped ? zmapped : (zcrds.empty() ? 0 : &zcrds[0])); }
 
         void endianMatch(pStream& fsw);
 
@@ -199,6 +244,12 @@ namespace loos {
 
         std::vector<dcd_real> xcrds, ycrds, zcrds;
 
+        boost::shared_ptr<internal::MappedFile> mapped;
+        std::streamoff mapped_pos;          // Offset of the next frame to read from the map
+        const dcd_real *xmapped, *ymapped, *zmapped;   // Non-null when coords are read directly from the map
+
+        std::vector<AtomRange> subset_ranges;   // Runs of atoms to read (empty means all)
+
     };
 
 }
@@ -267,22 +267,30 @@ namespace loos {
       slayer.start();
     }
   
-    for (uint j=0; j<l; ++j) {
-      traj->readFrame(indices[j]);
-      traj->updateGroupCoords(model);
-      if (updates)
-        slayer.update();
-      for (uint i=0; i<n; ++i) {
-        GCoord c = model[i]->coords();
-        M[j + offset][i*3] = c.x();
-        M[j + offset][i*3+1] = c.y();
-        M[j + offset][i*3+2] = c.z();
+    // Frames are read in batches so the trajectory can read just the
+    // model's atoms in blocks (see Trajectory::readFrames())
+    const uint batch = 64;
+    std::vector<double> block;
+    for (uint j=0; n > 0 && j<l; j += batch) {
+      std::vector<uint> frames(indices.begin() + j, indices.begin() + std::min(l, j + batch));
+      traj->readFrames(frames, model, block);
+      for (uint k=0; k<frames.size(); ++k) {
+        std::copy(block.begin() + k * 3 * n, block.begin() + (k + 1) * 3 * n, M[j + k + offset].begin());
+        if (updates)
+          slayer.update();
       }
     }
     
     if (updates)
       slayer.finish();
 
+    // Leave the model and trajectory at the last frame, as reading the
+    // frames one at a time did
+    if (l > 0) {
+      traj->readFrame(indices[l-1]);
+      traj->updateGroupCoords(model);
+    }
+
   }
 
   
@@ -56,6 +56,7 @@
 #include <utils_structural.hpp>
 
 #include <Kernel.hpp>
+#include <KernelPredicate.hpp>
 #include <Parser.hpp>
 #include <Selectors.hpp>
 
@@ -66,6 +67,10 @@
 
 #include <AtomicNumberDeducer.hpp>
 #include <Atom.hpp>
+#include <CoordinateStore.hpp>
+#include <CellList.hpp>
+#include <TrajectoryIndex.hpp>
+#include <SystemCache.hpp>
 #include <AtomicGroup.hpp>
 #include <pdb.hpp>
 #include <psf.hpp>
@@ -76,6 +81,10 @@
 #include <dcd.hpp>
 #include <dcd_utils.hpp>
 #include <MultiTraj.hpp>
+#include <PrefetchTraj.hpp>
+#include <ParallelFrameDriver.hpp>
+#include <PairwiseRMSD.hpp>
+#include <Correlation.hpp>
 
 #include <trajwriter.hpp>
 #include <dcdwriter.hpp>
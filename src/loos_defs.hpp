@@ -121,6 +121,9 @@ namespace loos {
   typedef Coord<double> GCoord;
   typedef boost::shared_ptr<GCoord> pGCoord;
 
+  class CoordinateStore;
+  typedef boost::shared_ptr<CoordinateStore> pCoordinateStore;
+
   // Writers
   class TrajectoryWriter;
   class DCDWriter;
@@ -23,8 +23,12 @@
 #include <pdb.hpp>
 #include <utils.hpp>
 #include <Fmt.hpp>
+#include <MappedFile.hpp>
+#include <NumberParser.hpp>
 
+#include <cstring>
 #include <iomanip>
+#include <boost/thread/thread.hpp>
 #include <boost/unordered_set.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
@@ -59,94 +63,189 @@ namespace loos {
   }
 
 
-  // Parse an ATOM or HETATM record...
-  // Note: ParseErrors can come from parseStringAs
+  namespace {
 
-  void PDB::parseAtomRecord(const std::string& s) {
-    greal r;
-    gint i;
-    std::string t;
-    GCoord c;
-    pAtom pa(new Atom);
+    bool hasPrefix(const char* s, const uint n, const char* tag, const uint m) {
+      return(n >= m && std::memcmp(s, tag, m) == 0);
+    }
+
+    bool isAtomRecord(const char* s, const uint n) {
+      return(hasPrefix(s, n, "ATOM", 4) || hasPrefix(s, n, "HETATM", 6));
+    }
 
-    pa->index(_max_index++);
 
-    t = parseStringAs<std::string>(s, 0, 6);
-    pa->recordName(t);
+    // Parses ATOM and HETATM records in place, i.e. without building
+    // a substring and a stringstream for every field.  Fields that are
+    // not plain numbers (or are malformed) are handed off to
+    // parseStringAs(), so the results and any ParseErrors are the same
+    // as before.  Note that the parsed atoms are not indexed.
 
-    i = parseStringAsHybrid36(s, 6, 5);
-    pa->id(i);
+    class AtomRecordParser {
+    public:
+      explicit AtomRecordParser(const bool strict)
+        : missing_q(false), missing_b(false), missing_segid(false), _strict(strict) { }
 
-    t = parseStringAs<std::string>(s, 12, 4);
-    pa->name(t);
+      pAtom operator()(const char* s, const uint n);
 
-    t = parseStringAs<std::string>(s, 16, 1);
-    pa->altLoc(t);
+      bool missing_q, missing_b, missing_segid;
 
-    t = parseStringAs<std::string>(s, 17, 4);
-    pa->resname(t);
+    private:
 
-    t = parseStringAs<std::string>(s, 21, 1);
-    pa->chainId(t);
+      // Same as parseStringAs<std::string>(), i.e. all spaces are removed
+      const std::string& stringField(const char* s, const uint n, const uint pos, const uint width) {
+        _field.clear();
+        if (pos + width <= n)
+          for (uint i=pos; i<pos+width; ++i)
+            if (s[i] != ' ')
+              _field += s[i];
+        return(_field);
+      }
+
+      float floatField(const char* s, const uint n, const uint pos, const uint width) {
+        if (pos < n) {
+          const char* p = s + pos;
+          float val;
+          if (internal::parseNumber(p, s + std::min(n, pos + width), val))
+            return(val);
+        }
+        return(parseStringAs<float>(std::string(s, n), pos, width));
+      }
 
-    i = parseStringAsHybrid36(s, 22, 4);
-    pa->resid(i);
+      int intField(const char* s, const uint n, const uint pos, const uint width) {
+        if (pos < n) {
+          const char* p = s + pos;
+          int val;
+          if (internal::parseInteger(p, s + std::min(n, pos + width), val))
+            return(val);
+        }
+        return(parseStringAs<int>(std::string(s, n), pos, width));
+      }
 
-    t = parseStringAs<std::string>(s, 26, 1);
+      int hybrid36Field(const char* s, const uint n, const uint pos, const uint width) {
+        if (pos + width > n)
+          return(0);
+        return(parseHybrid36(s + pos, width));
+      }
 
-    // Special handling of resid field since it may be frame-shifted by
-    // 1 col in some cases...
-    if (strictness_policy) {
-      char c = t[0];
+      bool _strict;
+      std::string _field;
+    };
 
-      if (c != ' ' && !isalpha(c))
-        throw(ParseError("Non-alpha character in iCode column of PDB"));
-    } else {
-      char c = t[0];
 
-      // Assume that if we see this variant, then we're not using hybrid-36
-      if (c != ' ' && isdigit(c)) {
-        i = parseStringAs<int>(s, 22, 5);
-        pa->resid(i);
-        t = " ";
+    pAtom AtomRecordParser::operator()(const char* s, const uint n) {
+      GCoord c;
+      pAtom pa(new Atom);
+
+      pa->recordName(stringField(s, n, 0, 6));
+      pa->id(hybrid36Field(s, n, 6, 5));
+      pa->name(stringField(s, n, 12, 4));
+      pa->altLoc(stringField(s, n, 16, 1));
+      pa->resname(stringField(s, n, 17, 4));
+      pa->chainId(stringField(s, n, 21, 1));
+      pa->resid(hybrid36Field(s, n, 22, 4));
+
+      stringField(s, n, 26, 1);
+      char ic = _field.empty() ? '\0' : _field[0];
+
+      // Special handling of resid field since it may be frame-shifted by
+      // 1 col in some cases...
+      if (_strict) {
+        if (ic != ' ' && !isalpha(ic))
+          throw(ParseError("Non-alpha character in iCode column of PDB"));
+      } else {
+        // Assume that if we see this variant, then we're not using hybrid-36
+        if (ic != ' ' && isdigit(ic)) {
+          pa->resid(intField(s, n, 22, 5));
+          _field = " ";
+        }
       }
+      pa->iCode(_field);
 
-    }
-    pa->iCode(t);
-
-    c[0] = parseStringAs<float>(s, 30, 8);
-    c[1] = parseStringAs<float>(s, 38, 8);
-    c[2] = parseStringAs<float>(s, 46, 8);
-    pa->coords(c);
-
-    if (s.size() > 54) {
-      r = parseStringAs<float>(s, 54, 6);
-      pa->occupancy(r);
-
-      if (s.size() > 60) {
-	r = parseStringAs<float>(s, 60, 6);
-	pa->bfactor(r);
-
-	if (s.size() > 72) {
-	  t = parseStringAs<std::string>(s, 72, 4);
-	  pa->segid(t);
-
-	  if (s.size() > 76) {
-	    t = parseStringAs<std::string>(s, 76, 2);
-	    pa->PDBelement(t);
-
-	    // Charge is not currently handled...
-	    // t = parseStringAs<std::string>(s, 78, 2);
-	  }
-	} else { // segid
-	  _missing_segid = true;
-	}
-      } else { // b-factor
-	_missing_b = _missing_segid = true;
+      c[0] = floatField(s, n, 30, 8);
+      c[1] = floatField(s, n, 38, 8);
+      c[2] = floatField(s, n, 46, 8);
+      pa->coords(c);
+
+      if (n > 54) {
+        pa->occupancy(floatField(s, n, 54, 6));
+
+        if (n > 60) {
+          pa->bfactor(floatField(s, n, 60, 6));
+
+          if (n > 72) {
+            pa->segid(stringField(s, n, 72, 4));
+
+            if (n > 76) {
+              pa->PDBelement(stringField(s, n, 76, 2));
+
+              // Charge is not currently handled...
+            }
+          } else { // segid
+            missing_segid = true;
+          }
+        } else { // b-factor
+          missing_b = missing_segid = true;
+        }
+      } else { // occupancies
+        missing_q = missing_b = missing_segid = true;
       }
-    } else { // occupancies
-      _missing_q = _missing_b = _missing_segid = true;
+
+      return(pa);
     }
+
+
+
+    // Parses the ATOM and HETATM records in a block of lines (with
+    // nulls for other records).  Parsing stops at the first error,
+    // which is left for the reader to throw when it reaches that
+    // line.
+
+    struct AtomBlockWorker {
+      AtomBlockWorker(const std::vector< std::pair<const char*, uint> >* l, std::vector<pAtom>* a,
+                      const uint f, const uint la, AtomRecordParser* p, std::string* e)
+        : lines(l), atoms(a), first(f), last(la), parser(p), error(e) { }
+
+      void operator()() {
+        try {
+          for (uint i=first; i<last; ++i) {
+            const std::pair<const char*, uint>& line = (*lines)[i];
+            if (isAtomRecord(line.first, line.second))
+              (*atoms)[i] = (*parser)(line.first, line.second);
+          }
+        }
+        catch (LOOSError& e) {
+          *error = e.what();
+        }
+        catch (...) {
+          *error = "Unknown exception";
+        }
+      }
+
+      const std::vector< std::pair<const char*, uint> >* lines;
+      std::vector<pAtom>* atoms;
+      uint first, last;
+      AtomRecordParser* parser;
+      std::string* error;
+    };
+
+  }
+
+
+  uint PDB::_parse_threads = 1;
+
+
+  struct PDB::ReadState {
+    explicit ReadState(const bool strict) : parser(strict), has_cryst(false), has_bonds(false) { }
+
+    AtomRecordParser parser;
+    bool has_cryst;
+    bool has_bonds;
+    boost::unordered_set<std::string> seen;
+  };
+
+
+  void PDB::appendParsedAtom(const pAtom& pa) {
+    pa->index(_max_index++);
     append(pa);
 
     // Record which pAtom belongs to this atomid.
@@ -155,6 +254,14 @@ namespace loos {
   }
 
 
+  // Parse an ATOM or HETATM record...
+  // Note: ParseErrors can come from parseStringAs
+
+  void PDB::parseAtomRecord(const std::string& s, ReadState& state) {
+    appendParsedAtom(state.parser(s.data(), s.size()));
+  }
+
+
 
   // Convert an Atom to a string with a PDB format...
 
@@ -324,6 +431,40 @@ namespace loos {
   }
 
 
+  // Dispatches a single line of a PDB.  Returns false if the line
+  // marks the end of the PDB.
+
+  bool PDB::parseRecord(const std::string& input, ReadState& state) {
+    const char* s = input.data();
+    uint n = input.size();
+
+    if (isAtomRecord(s, n))
+      parseAtomRecord(input, state);
+    else if (hasPrefix(s, n, "REMARK", 6))
+      parseRemark(input);
+    else if (hasPrefix(s, n, "CONECT", 6)) {
+      state.has_bonds = true;
+      parseConectRecord(input);
+    } else if (hasPrefix(s, n, "CRYST1", 6)) {
+      parseCryst1Record(input);
+      state.has_cryst = true;
+    } else if (hasPrefix(s, n, "TER", 3))
+      ;
+    else if (hasPrefix(s, n, "END", 3))
+      return(false);
+    else {
+      int space = input.find_first_of(' ');
+      std::string record = input.substr(0, space);
+      if (state.seen.find(record) == state.seen.end()) {
+        std::cerr << "Warning - unknown PDB record '" << record << "'" << std::endl;
+        state.seen.insert(record);
+      }
+    }
+
+    return(true);
+  }
+
+
   //! Top level parser...
   //! Reads a PDB from an input stream
   /*
@@ -331,34 +472,12 @@ namespace loos {
    */
   void PDB::read(std::istream& is) {
     std::string input;
-    bool has_cryst = false;
-    bool has_bonds = false;
-    boost::unordered_set<std::string> seen;
+    ReadState state(strictness_policy);
 
     while (getline(is, input)) {
       try {
-	if (input.substr(0, 4) == "ATOM" || input.substr(0,6) == "HETATM")
-	  parseAtomRecord(input);
-	else if (input.substr(0, 6) == "REMARK")
-	  parseRemark(input);
-	else if (input.substr(0,6) == "CONECT") {
-	  has_bonds = true;
-	  parseConectRecord(input);
-	} else if (input.substr(0, 6) == "CRYST1") {
-	  parseCryst1Record(input);
-	  has_cryst = true;
-	} else if (input.substr(0,3) == "TER")
-	  ;
-	else if (input.substr(0,3) == "END")
-	  break;
-	else {
-	  int space = input.find_first_of(' ');
-	  std::string record = input.substr(0, space);
-	  if (seen.find(record) == seen.end()) {
-	    std::cerr << "Warning - unknown PDB record '" << record << "'" << std::endl;
-	    seen.insert(record);
-	  }
-	}
+        if (!parseRecord(input, state))
+          break;
       }
       catch(LOOSError& e) {
 	throw(FileReadError(_fname, e.what()));
@@ -367,6 +486,105 @@ namespace loos {
 	throw(FileReadError(_fname, "Unknown exception"));
       }
     }
+
+    finishRead(state);
+  }
+
+
+  void PDB::readFile(const std::string& fname) {
+    uint nthreads = _parse_threads ? _parse_threads : boost::thread::hardware_concurrency();
+    if (nthreads > 1 && readMapped(fname, nthreads))
+      return;
+
+    std::ifstream ifs(fname.c_str());
+    if (!ifs)
+      throw(FileOpenError(fname));
+    read(ifs);
+  }
+
+
+  // Reads a PDB file by mapping it into memory and parsing the atoms
+  // in parallel, then processes the records serially in the order
+  // they appear in the file, as read() does.  Returns false if the
+  // file could not be mapped (e.g. it is a pipe).
+
+  bool PDB::readMapped(const std::string& fname, const uint nthreads) {
+    internal::MappedFile file(fname);
+    if (!file.size())
+      return(false);
+
+    // Split into lines (as getline() would) up to the END record
+    typedef std::pair<const char*, uint>    Line;
+    std::vector<Line> lines;
+    const char* p = file.data();
+    const char* e = p + file.size();
+    while (p != e) {
+      const char* q = static_cast<const char*>(std::memchr(p, '\n', e - p));
+      if (!q)
+        q = e;
+      Line line(p, q - p);
+      if (hasPrefix(line.first, line.second, "END", 3))
+        break;
+      lines.push_back(line);
+      p = (q == e) ? e : q + 1;
+    }
+
+    // Don't bother with threads for small files...
+    uint nt = std::max(1u, std::min(nthreads, static_cast<uint>(lines.size() / 1000)));
+    uint block = (lines.size() + nt - 1) / nt;
+    std::vector<pAtom> atoms(lines.size());
+    std::vector<std::string> errors(nt);
+    std::vector<AtomRecordParser> parsers(nt, AtomRecordParser(strictness_policy));
+
+    boost::thread_group threads;
+    for (uint t=1; t<nt; ++t)
+      threads.create_thread(AtomBlockWorker(&lines, &atoms, t * block, std::min(static_cast<uint>(lines.size()), (t+1) * block),
+                                            &(parsers[t]), &(errors[t])));
+    AtomBlockWorker(&lines, &atoms, 0, std::min(static_cast<uint>(lines.size()), block),
+                    &(parsers[0]), &(errors[0]))();
+    threads.join_all();
+
+    ReadState state(strictness_policy);
+    for (uint t=0; t<nt; ++t) {
+      state.parser.missing_q |= parsers[t].missing_q;
+      state.parser.missing_b |= parsers[t].missing_b;
+      state.parser.missing_segid |= parsers[t].missing_segid;
+    }
+
+    std::string input;
+    for (uint i=0; i<lines.size(); ++i) {
+      if (atoms[i]) {
+        appendParsedAtom(atoms[i]);
+        continue;
+      }
+
+      // An atom that could not be parsed is the first error in its block
+      if (isAtomRecord(lines[i].first, lines[i].second))
+        throw(FileReadError(_fname, errors[i / block]));
+
+      input.assign(lines[i].first, lines[i].second);
+      try {
+        if (!parseRecord(input, state))
+          break;
+      }
+      catch(LOOSError& e) {
+        throw(FileReadError(_fname, e.what()));
+      }
+      catch(...) {
+        throw(FileReadError(_fname, "Unknown exception"));
+      }
+    }
+
+    finishRead(state);
+    return(true);
+  }
+
+
+  void PDB::finishRead(const ReadState& state) {
+    _missing_q |= state.parser.missing_q;
+    _missing_b |= state.parser.missing_b;
+    _missing_segid |= state.parser.missing_segid;
+
     if (isMissingFields())
       std::cerr << "Warning- PDB is missing fields.  Default values will be used.\n";
 
@@ -383,7 +601,7 @@ namespace loos {
 	throw(FileReadError(_fname, e.what()));
       }
       periodicBox(c);
-    } else if (has_cryst) {
+    } else if (state.has_cryst) {
       GCoord c(cell.a(), cell.b(), cell.c());
       periodicBox(c);
     }
@@ -393,7 +611,7 @@ namespace loos {
       renumber();
 
     // Set bonds state...
-    if (has_bonds) {
+    if (state.has_bonds) {
       setGroupConnectivity();
       uniqueBonds();
     }
@@ -80,10 +80,7 @@ namespace loos {
               _missing_q(false), _missing_b(false), _missing_segid(false),
               _fname(fname)
         {
-            std::ifstream ifs(fname.c_str());
-            if (!ifs)
-                throw(FileOpenError(fname));
-            read(ifs);
+            readFile(fname);
         }
       
         //! Read in a PDB from an ifstream
@@ -146,6 +143,18 @@ namespace loos {
         //! Read in PDB from an ifstream
         void read(std::istream& is);
 
+        //! Number of threads used to parse atoms when a PDB is read by filename
+        /**
+         * Large PDB files are mapped into memory and their ATOM and
+         * HETATM records are divided among this many threads (0 means
+         * use all available).  The resulting PDB is identical to one
+         * read serially.  The default is 1, which reads the file as a
+         * stream.  Reading from a stream (e.g. for CCPDB or PDBTraj)
+         * is always serial.
+         */
+        static void parseThreads(const uint n) { _parse_threads = n; }
+        static uint parseThreads() { return(_parse_threads); }
+
     private:
         class ComparePatoms {
             bool operator()(const pAtom& a, const pAtom& b) { return(a->id() < b->id()); }
@@ -163,9 +172,20 @@ namespace loos {
     bool isMissingFields() const { return(_missing_q || _missing_b || _missing_segid); }
 
 
+        // Parsing state for a single read (see pdb.cpp)
+        struct ReadState;
+
+        void readFile(const std::string& fname);
+        bool readMapped(const std::string& fname, const uint nthreads);
+
+        // Returns false at the end of the PDB
+        bool parseRecord(const std::string&, ReadState&);
+        void finishRead(const ReadState&);
+        void appendParsedAtom(const pAtom& pa);
+
         // These will modify the PDB upon a successful parse...
         void parseRemark(const std::string&);
-        void parseAtomRecord(const std::string&);
+        void parseAtomRecord(const std::string&, ReadState&);
         void parseConectRecord(const std::string&);
         void parseCryst1Record(const std::string&);
 
@@ -190,6 +210,8 @@ namespace loos {
         Remarks _remarks;
         UnitCell cell;
         std::map<int, pAtom> _atomid_to_patom;
+
+        static uint _parse_threads;
     };
 
 }
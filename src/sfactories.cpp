@@ -29,6 +29,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include <AtomicGroup.hpp>
+#include <SystemCache.hpp>
 #include <pdb.hpp>
 #include <psf.hpp>
 #include <amber.hpp>
@@ -92,8 +93,15 @@ namespace loos {
   pAtomicGroup createSystemPtr(const std::string& filename, const std::string& filetype) {
 
     for (internal::SystemNameBindingType* p = internal::system_name_bindings; p->creator != 0; ++p)
-      if (p->suffix == filetype)
-        return(*(p->creator))(filename);
+      if (p->suffix == filetype) {
+        SystemCache cache(filename, filetype);
+        pAtomicGroup grp = cache.read();
+        if (!grp) {
+          grp = (*(p->creator))(filename);
+          cache.write(*grp);
+        }
+        return(grp);
+      }
 
     throw(std::runtime_error("Error- unknown system file type '" + filetype + "' for file '" + filename + "'.  Try --help to see available types."));
   }
@@ -54,6 +54,9 @@ namespace loos {
    * group.  Otherwise, the prmtop will be loaded without coords and
    * returned.
    *
+   * Large system files are cached in a binary form alongside the
+   * original the first time they are read, and later reads use the
+   * cache instead (see SystemCache).
    */
   AtomicGroup createSystem(const std::string& filename);
   AtomicGroup createSystem(const std::string& filename, const std::string& filetype);
@@ -29,6 +29,7 @@
 
 
 #include <trr.hpp>
+#include <TrajectoryIndex.hpp>
 
 
 namespace loos {
@@ -115,7 +116,9 @@ namespace loos {
 
 
 	// Initialize the object, along with scanning file for frames to
-	// build the frame index, and finally caches the first frame.
+	// build the frame index, and finally caches the first frame.  The
+	// frame index is saved alongside the trajectory (see
+	// TrajectoryIndex) so subsequent opens can skip the scan.
 	void TRR::init(void) {
 		Header h;
 		h.natoms = 0;
@@ -127,8 +130,31 @@ namespace loos {
 		rewindImpl();
 		frame_indices.clear();
 
+		bool use_index = (_filename != "istream");
+		bool indexed = false;
+		if (use_index) {
+			std::vector<double> meta;
+			if (TrajectoryIndex(_filename, "TRR").read(frame_indices, meta) && meta.size() == 1 && !frame_indices.empty()) {
+				maxatoms = static_cast<int>(meta[0]);
+
+				// The scan leaves the header of the last frame in h...
+				try {
+					ifs->seekg(frame_indices.back(), std::ios_base::beg);
+					indexed = readHeader(h);
+				}
+				catch (FileReadError& e) {
+					indexed = false;
+				}
+			}
+			if (!indexed) {
+				frame_indices.clear();
+				maxatoms = 0;
+				rewindImpl();
+			}
+		}
+
 		size_t frame_start = (xdr_file.get())->tellg();
-		while (readHeader(h)) {
+		while (!indexed && readHeader(h)) {
 			frame_indices.push_back(frame_start);
 			if (h.natoms > maxatoms)
 				maxatoms = h.natoms;
@@ -146,6 +172,9 @@ namespace loos {
 			frame_start = (xdr_file.get())->tellg();
 		}
 
+		if (use_index && !indexed && !frame_indices.empty())
+			TrajectoryIndex(_filename, "TRR").write(frame_indices, std::vector<double>(1, maxatoms));
+
 		coords_.reserve(maxatoms);
 		velo_.reserve(maxatoms);
 		forc_.reserve(maxatoms);
@@ -160,12 +189,15 @@ namespace loos {
 
 	void TRR::updateGroupCoordsImpl(AtomicGroup& g) {
 
-		for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
-			uint idx = (*i)->index();
-			if (static_cast<uint>(idx) >= natoms())
-				throw(LOOSError(**i, "atom index into trajectory frame is out of range"));
-			(*i)->coords(coords_[idx]);
-		}
+		if (g.isPacked())
+			g.copyCoordinatesWithIndex(coords_);
+		else
+			for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+				uint idx = (*i)->index();
+				if (static_cast<uint>(idx) >= natoms())
+					throw(LOOSError(**i, "atom index into trajectory frame is out of range"));
+				(*i)->coords(coords_[idx]);
+			}
 
 		if (hdr_.box_size)
 			g.periodicBox(box);
@@ -186,6 +218,12 @@ namespace loos {
 
 
 
+	void TRR::setAtomSubsetImpl(void) {
+		// Seeking over fewer atoms than this costs more than reading them...
+		subset_ranges = atomSubsetRanges(256);
+	}
+
+
 	void TRR::seekFrameImpl(uint i) {
 		if (i >= frame_indices.size())
 			throw(FileError(_filename, "Requested TRR frame is out of range"));
@@ -70,6 +70,10 @@ namespace loos {
 	 * trajectory will be quickly scanned to build up an index of where
 	 * the frames begin (see the loos::XTC class for more information).
 	 *
+	 * With an atom subset (see Trajectory::setAtomSubset()), only the
+	 * runs of coordinates, velocities and forces that hold those atoms
+	 * are read, and the rest of each block is skipped.
+	 *
 	 * Finally, note that GROMACS stores data in nm whereas LOOS uses
 	 * angstroms, so coordinate/box data will be automatically scaled by
 	 * LOOS.
@@ -203,17 +207,48 @@ namespace loos {
 		}
 
 
+		// Reads only the atoms in subset_ranges from a block of
+		// triplets for n atoms, seeking over the rest.  Other atoms in
+		// v are left as they were.
+		template<typename T>
+		void readSubsetBlock(std::vector<GCoord>& v, const uint n, const std::string& msg) {
+			std::istream* is = xdr_file.get();
+			std::streamoff start = is->tellg();
+
+			if (_atom_subset.back() >= n)
+				throw(FileReadError(_filename, "TRR frame has fewer atoms than the atom subset requires"));
+			v.resize(n);
+
+			std::vector<T> buf;
+			for (std::vector<AtomRange>::const_iterator r = subset_ranges.begin(); r != subset_ranges.end(); ++r) {
+				uint m = r->second * DIM;
+				buf.resize(m);
+				is->seekg(start + static_cast<std::streamoff>(r->first) * DIM * sizeof(T));
+				if (xdr_file.read(&buf[0], m) != m)
+					throw(FileReadError(_filename, "Unable to read " + msg));
+				for (uint i=0; i<r->second; ++i)
+					v[r->first + i] = GCoord(buf[i*DIM], buf[i*DIM+1], buf[i*DIM+2]) * 10.0;
+			}
+
+			is->seekg(start + static_cast<std::streamoff>(n) * DIM * sizeof(T));
+		}
+
+
 		// Note: Assumes that the object Header has already been read...
 		template<typename T>
 		bool readRawFrame() {
 
-			// Clear data first...
+			// Clear data first...  With a subset, the per-atom data
+			// are kept so only the subset has to be overwritten.
 			box_.clear();
 			vir_.clear();
 			pres_.clear();
-			velo_.clear();
-			forc_.clear();
-			coords_.clear();
+			if (subset_ranges.empty() || !hdr_.v_size)
+				velo_.clear();
+			if (subset_ranges.empty() || !hdr_.f_size)
+				forc_.clear();
+			if (subset_ranges.empty() || !hdr_.x_size)
+				coords_.clear();
 
 			if (hdr_.box_size) {
 				readBlock<T>(box_, DIM*DIM, "box");
@@ -226,6 +261,17 @@ namespace loos {
 			if (hdr_.pres_size)
 				readBlock<T>(pres_, DIM*DIM, "pressure");
 
+			if (!subset_ranges.empty()) {
+				if (hdr_.x_size)
+					readSubsetBlock<T>(coords_, hdr_.natoms, "Coordinates");
+				if (hdr_.v_size)
+					readSubsetBlock<T>(velo_, hdr_.natoms, "Velocities");
+				if (hdr_.f_size)
+					readSubsetBlock<T>(forc_, hdr_.natoms, "Forces");
+
+				return(! ((xdr_file.get())->fail() || (xdr_file.get())->eof()) );
+			}
+
 			if (hdr_.x_size)
 				readBlock<T>(coords_, hdr_.natoms * DIM, "Coordinates");
 
@@ -245,6 +291,7 @@ namespace loos {
 		void updateGroupCoordsImpl(AtomicGroup& g);
 		void updateGroupVelocitiesImpl(AtomicGroup& g);
 		std::vector<GCoord> velocitiesImpl() const { return(velo_); }
+		void setAtomSubsetImpl(void);
 
 
 	private:
@@ -260,6 +307,8 @@ namespace loos {
 		std::vector<GCoord> velo_;
 		std::vector<GCoord> forc_;
 
+		std::vector<AtomRange> subset_ranges;   // Runs of atoms to read (empty means all)
+
 		Header hdr_;
 	};
 
@@ -31,6 +31,7 @@
 #include <glob.h>
 
 #include <algorithm>
+#include <map>
 #include <string>
 #include <sstream>
 #include <iomanip>
@@ -209,6 +210,33 @@ namespace loos {
     return(subset);
   }
 
+
+  std::vector< std::vector<uint> > matchGroups(const std::vector<AtomicGroup>& a, const std::vector<AtomicGroup>& b) {
+    typedef std::vector<const Atom*> GroupKey;
+    std::map<GroupKey, std::vector<uint> > index;
+
+    for (uint k=0; k<b.size(); ++k) {
+      GroupKey key;
+      for (AtomicGroup::const_iterator i = b[k].begin(); i != b[k].end(); ++i)
+        key.push_back(i->get());
+      std::sort(key.begin(), key.end());
+      index[key].push_back(k);
+    }
+
+    std::vector< std::vector<uint> > matches(a.size());
+    for (uint j=0; j<a.size(); ++j) {
+      GroupKey key;
+      for (AtomicGroup::const_iterator i = a[j].begin(); i != a[j].end(); ++i)
+        key.push_back(i->get());
+      std::sort(key.begin(), key.end());
+      std::map<GroupKey, std::vector<uint> >::const_iterator m = index.find(key);
+      if (m != index.end())
+        matches[j] = m->second;
+    }
+
+    return(matches);
+  }
+
   std::string timeAsString(const double t, const uint precision) {
     if (t < 90.0) {
       std::stringstream s;
@@ -268,40 +296,46 @@ namespace loos {
     if (pos + n > source.size())
       return(0);
 
-    if (n > 6)
+    return(parseHybrid36(source.data() + pos, n));
+  }
+
+
+  int parseHybrid36(const char* p, const uint nelem) {
+    if (nelem > 6)
       throw(std::logic_error("Requested size exceeds max"));
-    
-    std::string s(source.substr(pos, n));
+
+    const char* si = p;
+    const char* se = p + nelem;
     bool negative(false);
-    std::string::iterator si(s.begin());
-    n = s.size();
+    uint n = nelem;
 
-    if (*si == '-') {
+    if (si != se && *si == '-') {
       negative = true;
       ++si;
       --n;
     }
 
     // Skip leading whitespace
-    for (;si != s.end() && *si == ' '; ++si, --n) ;
+    for (;si != se && *si == ' '; ++si, --n) ;
 
     int offset = 0;   // This adjusts the range of the result
     char cbase = 'a'; // Which set or characters (upper or lower) for the alpha-part
     int ibase = 10;   // Number-base (i.e. 10 or 36)
 
     // Decide which chunk we're in...
-    if (*si >= 'a') {
+    char lead = (si != se) ? *si : '\0';
+    if (lead >= 'a') {
       offset = pow10[n] + 16*pow36[n-1];
       cbase = 'a';
       ibase = 36;
-    } else if (*si >= 'A') {
+    } else if (lead >= 'A') {
       offset = pow10[n] - 10*pow36[n-1];
       cbase = 'A';
       ibase = 36;
     }
 
     int result = 0;
-    while (si != s.end()) {
+    while (si != se) {
       int c = (*si >= cbase) ? *si-cbase+10 : *si-'0';
       result = result * ibase + c;
       ++si;
@@ -50,6 +50,7 @@
 #include <Coord.hpp>
 #include <pdb_remarks.hpp>
 #include <LineReader.hpp>
+#include <TableReader.hpp>
 
 
 
@@ -86,19 +87,33 @@ namespace loos {
     return(data);
   }
 
+  //! Read a list of items using a TableReader object
+  /**
+   * Only the first column of each line is parsed, and a line where it
+   * is not a valid item is an error.
+   */
+  template<typename T>
+  std::vector<T> readVector(TableReader& reader) {
+    reader.selectColumns(std::vector<uint>(1, 0));
+    std::vector<T> data;
+    uint ncols;
+    reader.readRows(data, ncols);
+    return(data);
+  }
+
   //! Read a list of items from a stream with default behavior
   template<typename T>
   std::vector<T> readVector(std::istream& is) {
-    LineReader lr(is);
-    return(readVector<T>(lr));
+    TableReader tr(is);
+    return(readVector<T>(tr));
   }
 
   //! Read a list of items from a file with default behavior
   template<typename T>
   std::vector<T> readVector(const std::string& fname) {
     std::ifstream ifs(fname.c_str());
-    LineReader lr(ifs, fname);
-    return(readVector<T>(lr));
+    TableReader tr(ifs, fname);
+    return(readVector<T>(tr));
   }
 
 
@@ -128,19 +143,30 @@ namespace loos {
     return(table);
   }
 
+  //! Read in a table using a TableReader object (see TableReader::readRow())
+  template<typename T>
+  std::vector< std::vector<T> > readTable(TableReader& reader) {
+    std::vector< std::vector<T> > table;
+    std::vector<T> row;
+
+    while (reader.readRow(row))
+      table.push_back(row);
+    return(table);
+  }
+
   //! Read in a table given a stream
   template<typename T>
   std::vector< std::vector<T> > readTable(std::istream& is) {
-    LineReader lr(is);
-    return(readTable<T>(lr));
+    TableReader tr(is);
+    return(readTable<T>(tr));
   }
 
   //! Read in a table given a filename
   template<typename T>
   std::vector< std::vector<T> > readTable(const std::string& fname) {
     std::ifstream ifs(fname.c_str());
-    LineReader lr(ifs, fname);
-    return(readTable<T>(lr));
+    TableReader tr(ifs, fname);
+    return(readTable<T>(tr));
   }
 
   //! Create an invocation header
@@ -292,6 +318,14 @@ namespace loos {
   //! Applies a string-based selection to an atomic group...
   AtomicGroup selectAtoms(const AtomicGroup&, const std::string);
 
+  //! For each group in \a a, the indices of the groups in \a b made of exactly the same atoms
+  /**
+   * Groups are matched by their atoms (the shared pointers, not their
+   * ids), regardless of order.  Rather than comparing every pair of
+   * groups, the groups in \a b are indexed by their sorted atoms.
+   */
+  std::vector< std::vector<uint> > matchGroups(const std::vector<AtomicGroup>& a, const std::vector<AtomicGroup>& b);
+
 
   //! Returns a byte-swapped copy of an arbitrary type
   /** 
@@ -369,6 +403,9 @@ namespace loos {
   //! Convert a hybrid-36 encoded string into an int
   int parseStringAsHybrid36(const std::string& source, const uint pos =0, const uint nelem =0);
 
+  //! Convert the \a n hybrid-36 encoded characters starting at \a p into an int
+  int parseHybrid36(const char* p, const uint n);
+
   //! Convert an int into a hybrid-36 encoded string
   std::string hybrid36AsString(int value, uint fieldsize);
 
@@ -20,7 +20,9 @@
 */
 
 
+#include <vector>
 #include <boost/random.hpp>
+#include <boost/cstdint.hpp>
 #include <utils_random.hpp>
 
 namespace loos {
@@ -41,4 +43,28 @@ namespace loos {
     rng.seed(seedval);
     return(seedval);
   }
+
+
+  // The state is filled using the SplitMix64 generator (Steele, Lea,
+  // and Flood, OOPSLA 2014), which is a counter-based hash, so nearby
+  // seeds and streams give unrelated states.
+
+  base_generator_type randomStream(const uint seed, const ulong stream) {
+    boost::uint64_t x = (static_cast<boost::uint64_t>(seed) << 32) ^ (static_cast<boost::uint64_t>(stream) * 0xD1B54A32D192ED03ull);
+
+    std::vector<boost::uint32_t> state(base_generator_type::state_size);
+    for (uint i=0; i<state.size(); ++i) {
+      x += 0x9E3779B97F4A7C15ull;
+      boost::uint64_t z = x;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      z ^= z >> 31;
+      state[i] = static_cast<boost::uint32_t>(z >> 32);
+    }
+
+    base_generator_type rng;
+    std::vector<boost::uint32_t>::iterator first = state.begin();
+    rng.seed(first, state.end());
+    return(rng);
+  }
 };
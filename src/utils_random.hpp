@@ -49,6 +49,19 @@ rng_singleton().seed(seed_value);
    */
   uint randomSeedRNG(void);
 
+
+  //! Returns an independent, reproducible random number generator
+  /**
+   * Use this instead of rng_singleton() when replicates of a
+   * calculation run in parallel.  Each replicate (or task) should use
+   * its own stream number.  The generator is seeded by hashing \a seed
+   * and \a stream into its full state, so a given seed and stream
+   * always produce the same sequence, no matter which thread uses it
+   * or in what order the streams are created, and different streams
+   * are effectively uncorrelated.
+   */
+  base_generator_type randomStream(const uint seed, const ulong stream);
+
 };
 
 
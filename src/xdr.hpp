@@ -105,7 +105,7 @@ namespace loos {
       //! Read in an opaque array of n-bytes (same as xdr_opaque)
       uint read(char* p, uint n) {
 	uint rndup;
-	static char buf[sizeof(block_type)];
+	char buf[sizeof(block_type)];   // Not static, so readers may be used in separate threads
 
 	if (n == 0)
 	  return(1);
@@ -236,12 +236,10 @@ namespace loos {
       //! Writes an opaque array of n-bytes
       uint write(const char* p, const uint n) {
 	uint rndup;
-	static char buf[sizeof(block_type)];
-	static bool init(false);
+	char buf[sizeof(block_type)];
 
-	if (!init)
-	  for (uint i=0; i<sizeof(block_type); ++i)
-	    buf[i] = '\0';
+	for (uint i=0; i<sizeof(block_type); ++i)
+	  buf[i] = '\0';
 
 	rndup = n % sizeof(block_type);
 	if (rndup > 0)
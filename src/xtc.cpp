@@ -28,7 +28,13 @@
 */
 
 
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <xtc.hpp>
+#include <TrajectoryIndex.hpp>
 
 
 namespace loos {
@@ -55,6 +61,118 @@ namespace loos {
     
 
 
+  namespace {
+
+    // Reads bits MSB-first from the compressed byte stream.  Bits are
+    // buffered 32 at a time, so most reads are a shift and a mask.
+    class BitReader {
+    public:
+      BitReader(const unsigned char* p, const unsigned char* e) : ptr(p), end(e), cache(0), nbits(0) { }
+
+      // n must be no more than 32
+      uint get(const uint n) {
+        if (nbits < n)
+          refill();
+        nbits -= n;
+        return(static_cast<uint>((cache >> nbits) & ((static_cast<boost::uint64_t>(1) << n) - 1)));
+      }
+
+    private:
+      void refill() {
+        if (end - ptr >= 4) {
+          cache = (cache << 32) | (static_cast<boost::uint64_t>(ptr[0]) << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+          ptr += 4;
+          nbits += 32;
+        } else
+          while (nbits <= 56) {
+            cache = (cache << 8) | (ptr < end ? *ptr++ : 0);   // Pad with zeros past the end
+            nbits += 8;
+          }
+      }
+
+      const unsigned char* ptr;
+      const unsigned char* end;
+      boost::uint64_t cache;
+      uint nbits;
+    };
+
+
+    // Unpacks nints integers that were packed together as one large
+    // integer (in base sizes[i])
+    void decodeInts(BitReader& bits, const int nints, int nbits, const uint* sizes, int* nums) {
+      int bytes[32];
+      int num_of_bytes = 0;
+
+      bytes[1] = bytes[2] = bytes[3] = 0;
+      while (nbits > 8) {
+        bytes[num_of_bytes++] = bits.get(8);
+        nbits -= 8;
+      }
+      if (nbits > 0)
+        bytes[num_of_bytes++] = bits.get(nbits);
+
+      // When the packed integer fits into 64-bits, the unpacking can be
+      // done with native divisions...
+      if (num_of_bytes <= 8) {
+        boost::uint64_t v = 0;
+        for (int j = num_of_bytes-1; j >= 0; --j)
+          v = (v << 8) | static_cast<uint>(bytes[j]);
+        for (int i = nints-1; i > 0; --i) {
+          nums[i] = static_cast<int>(v % sizes[i]);
+          v /= sizes[i];
+        }
+        nums[0] = static_cast<int>(v);
+        return;
+      }
+
+      for (int i = nints-1; i > 0; i--) {
+        int num = 0;
+        for (int j = num_of_bytes-1; j >=0; j--) {
+          num = (num << 8) | bytes[j];
+          int p = num / sizes[i];
+          bytes[j] = p;
+          num = num - p * sizes[i];
+        }
+        nums[i] = num;
+      }
+      nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
+    }
+
+
+    // Reads XDR (big-endian) data from a block of memory
+    class MemoryXDR {
+    public:
+      MemoryXDR(const unsigned char* p, const unsigned char* e) : ptr(p), end(e) { }
+
+      boost::uint32_t getUInt() {
+        if (end - ptr < 4)
+          throw(LOOSError("XTC frame is truncated"));
+        boost::uint32_t u = (static_cast<boost::uint32_t>(ptr[0]) << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+        ptr += 4;
+        return(u);
+      }
+
+      int getInt() { return(static_cast<int>(getUInt())); }
+
+      float getFloat() {
+        boost::uint32_t u = getUInt();
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return(f);
+      }
+
+      const unsigned char* position() const { return(ptr); }
+      long remaining() const { return(end - ptr); }
+
+    private:
+      const unsigned char* ptr;
+      const unsigned char* end;
+    };
+
+  }
+
+
+
   // The following are largely from the xdrlib...
   int XTC::sizeofint(int size) {
     int n = 0;
@@ -97,110 +215,33 @@ namespace loos {
     return(nbits + nbytes*8);
   }
 
-  
-  int XTC::decodebits(int* buf, uint nbits) {
-
-    int mask = (1 << nbits) -1;
-
-    unsigned char *cbuf = reinterpret_cast<unsigned char*>(buf) + 3*sizeof(*buf);
-    int cnt = buf[0];
-    uint lastbits = static_cast<uint>(buf[1]);
-    uint lastbyte = static_cast<uint>(buf[2]);
-    
-    int num = 0;
-    while (nbits >= 8) {
-      lastbyte = ( lastbyte << 8 ) | cbuf[cnt++];
-      num |=  (lastbyte >> lastbits) << (nbits - 8);
-      nbits -=8;
-    }
-    if (nbits > 0) {
-      if (lastbits < nbits) {
-        lastbits += 8;
-        lastbyte = (lastbyte << 8) | cbuf[cnt++];
-      }
-      lastbits -= nbits;
-      num |= (lastbyte >> lastbits) & ((1 << nbits) -1);
-    }
-    num &= mask;
-    buf[0] = cnt;
-    buf[1] = static_cast<int>(lastbits);
-    buf[2] = static_cast<int>(lastbyte);
-
-    return(num);
-  }
 
 
-  void XTC::decodeints(int* buf, const int nints, int nbits,
-                       uint* sizes, int* nums) {
-    int bytes[32];
-    int i, j, num_of_bytes, p, num;
-  
-    bytes[1] = bytes[2] = bytes[3] = 0;
-    num_of_bytes = 0;
-    while (nbits > 8) {
-      bytes[num_of_bytes++] = decodebits(buf, 8);
-      nbits -= 8;
-    }
-    if (nbits > 0) {
-      bytes[num_of_bytes++] = decodebits(buf, nbits);
-    }
-    for (i = nints-1; i > 0; i--) {
-      num = 0;
-      for (j = num_of_bytes-1; j >=0; j--) {
-        num = (num << 8) | bytes[j];
-        p = num / sizes[i];
-        bytes[j] = p;
-        num = num - p * sizes[i];
-      }
-      nums[i] = num;
-    }
-    nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
+  // Converts a decoded integer coordinate into angstroms and stores
+  // it, unless the atom is masked out
+  static inline void storeCoord(GCoord* coords, const char* mask, int& atom, const int* c, const float inv_precision) {
+    if (!mask || mask[atom])
+      coords[atom] = GCoord(c[0] * inv_precision,
+                            c[1] * inv_precision,
+                            c[2] * inv_precision) * 10.0;
+    ++atom;
   }
 
 
-
-  // Coordinates are converted into GCoords and stored in the object's
-  // coords_ vector
-
-  bool XTC::readCompressedCoords(void)
+  // Decodes the compressed coordinates for one frame into coords
+  // (which must have room for lsize atoms).  If mask is given, only
+  // atoms with a non-zero entry are stored.  This does not touch the
+  // object's state, so frames can be decoded in parallel.
+  void XTC::decodeCompressed(const unsigned char* bytes, const uint nbytes, const int lsize,
+                             const int* minint, const int* maxint, int smallidx,
+                             const xtc_t precision, GCoord* coords, const char* mask)
   {
-    int minint[3], maxint[3], *lip;
-    int smallidx;
-    uint sizeint[3], sizesmall[3], bitsizeint[3] = {0,0,0}, size3;
-    int k, *buf1, *buf2, lsize, flag;
-    int smallnum, smaller, i, is_smaller, run;
-    xtc_t precision, inv_precision;
-    int tmp, *thiscoord,  prevcoord[3];
-    unsigned int bitsize;
-  
-     
-    if (!xdr_file.read(lsize))
-      return(false);
-
-    size3 = lsize * 3;
-
-    /* Dont bother with compression for three atoms or less */
-    if(lsize<=9) {
-      float* tmp = new xtc_t[size3];
-      xdr_file.read(tmp, size3);
-      for (uint i=0; i<size3; i += 3)
-        coords_.push_back(GCoord(tmp[i], tmp[i+1], tmp[i+2]) * 10.0);
-      delete[] tmp;
-      return(true);
-    }
+    uint sizeint[3], sizesmall[3], bitsizeint[3] = {0,0,0};
+    int smallnum, smaller, is_smaller, run, tmp;
+    int thiscoord[3], prevcoord[3];
+    uint bitsize;
+    xtc_t inv_precision;
 
-    /* Compression-time if we got here. Read precision first */
-    xdr_file.read(precision);
-    precision_ = precision;
-  
-    int size3padded = static_cast<int>(size3 * 1.2);
-    buf1 = new int[size3padded];
-    buf2 = new int[size3padded];
-    /* buf2[0-2] are special and do not contain actual data */
-    buf2[0] = buf2[1] = buf2[2] = 0;
-    xdr_file.read(minint, 3);
-    xdr_file.read(maxint, 3);
-  
     sizeint[0] = maxint[0] - minint[0]+1;
     sizeint[1] = maxint[1] - minint[1]+1;
     sizeint[2] = maxint[2] - minint[2]+1;
@@ -214,48 +255,29 @@ namespace loos {
     } else {
       bitsize = sizeofints(sizeint, 3);
     }
-	
-    if (!xdr_file.read(smallidx)) {
-      delete[] buf1;
-      delete[] buf2;
-      return(false);
-    }
 
-    tmp=smallidx+8;
+    if (smallidx < firstidx || smallidx >= lastidx)
+      throw(LOOSError("Invalid XTC compression parameters"));
+
     tmp = smallidx-1;
     tmp = (firstidx>tmp) ? firstidx : tmp;
     smaller = magicints[tmp] / 2;
     smallnum = magicints[smallidx] / 2;
     sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx] ;
 
-    /* buf2[0] holds the length in bytes */
-  
-    if (!xdr_file.read(buf2, 1)) {
-      delete[] buf1;
-      delete[] buf2;
-      return(false);
-    }
-
-    if (!xdr_file.read(reinterpret_cast<char*>(&(buf2[3])), static_cast<uint>(buf2[0]))) {
-      delete[] buf1;
-      delete[] buf2;
-      return(false);
-    }
-    buf2[0] = buf2[1] = buf2[2] = 0;
-  
+    BitReader bits(bytes, bytes + nbytes);
     inv_precision = 1.0 / precision;
     run = 0;
-    i = 0;
-    lip = buf1;
+    int i = 0;
+    int atom = 0;
     while ( i < lsize ) {
-      thiscoord = (int *)(lip) + i * 3;
     
       if (bitsize == 0) {
-        thiscoord[0] = decodebits(buf2, bitsizeint[0]);
-        thiscoord[1] = decodebits(buf2, bitsizeint[1]);
-        thiscoord[2] = decodebits(buf2, bitsizeint[2]);
+        thiscoord[0] = bits.get(bitsizeint[0]);
+        thiscoord[1] = bits.get(bitsizeint[1]);
+        thiscoord[2] = bits.get(bitsizeint[2]);
       } else {
-        decodeints(buf2, 3, bitsize, sizeint, thiscoord);
+        decodeInts(bits, 3, bitsize, sizeint, thiscoord);
       }
     
       i++;
@@ -267,18 +289,20 @@ namespace loos {
       prevcoord[1] = thiscoord[1];
       prevcoord[2] = thiscoord[2];
     
-      flag = decodebits(buf2, 1);
+      int flag = bits.get(1);
       is_smaller = 0;
       if (flag == 1) {
-        run = decodebits(buf2, 5);
+        run = bits.get(5);
         is_smaller = run % 3;
         run -= is_smaller;
         is_smaller--;
       }
       if (run > 0) {
-        thiscoord += 3;
-        for (k = 0; k < run; k+=3) {
-          decodeints(buf2, 3, smallidx, sizesmall, thiscoord);
+        if (i + run / 3 > lsize)
+          throw(LOOSError("Corrupted XTC frame (too many atoms)"));
+
+        for (int k = 0; k < run; k+=3) {
+          decodeInts(bits, 3, smallidx, sizesmall, thiscoord);
           i++;
           thiscoord[0] += prevcoord[0] - smallnum;
           thiscoord[1] += prevcoord[1] - smallnum;
@@ -294,24 +318,20 @@ namespace loos {
             tmp = thiscoord[2]; thiscoord[2] = prevcoord[2];
             prevcoord[2] = tmp;
 
-            coords_.push_back(GCoord(prevcoord[0] * inv_precision,
-                                prevcoord[1] * inv_precision,
-                                prevcoord[2] * inv_precision) * 10.0);
+            storeCoord(coords, mask, atom, prevcoord, inv_precision);
           } else {
             prevcoord[0] = thiscoord[0];
             prevcoord[1] = thiscoord[1];
             prevcoord[2] = thiscoord[2];
           }
-          coords_.push_back(GCoord(thiscoord[0] * inv_precision,
-                              thiscoord[1] * inv_precision,
-                              thiscoord[2] * inv_precision) * 10.0);
+          storeCoord(coords, mask, atom, thiscoord, inv_precision);
         }
       } else {
-        coords_.push_back(GCoord(thiscoord[0] * inv_precision,
-                            thiscoord[1] * inv_precision,
-                            thiscoord[2] * inv_precision) * 10.0);
+        storeCoord(coords, mask, atom, thiscoord, inv_precision);
       }
       smallidx += is_smaller;
+      if (smallidx < firstidx || smallidx >= lastidx)
+        throw(LOOSError("Corrupted XTC frame (invalid compression parameters)"));
       if (is_smaller < 0) {
         smallnum = smaller;
         if (smallidx > firstidx) {
@@ -325,14 +345,264 @@ namespace loos {
       }
       sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx] ;
     }
+  }
+
+
+
+  // Coordinates are converted into GCoords and stored in the object's
+  // coords_ vector
+
+  bool XTC::readCompressedCoords(void)
+  {
+    int minint[3], maxint[3];
+    int smallidx, lsize;
+    uint nbytes;
+    xtc_t precision;
+     
+    if (!xdr_file.read(lsize))
+      return(false);
+
+    uint size3 = lsize * 3;
+
+    /* Dont bother with compression for three atoms or less */
+    if(lsize<=9) {
+      float* tmp = new xtc_t[size3];
+      xdr_file.read(tmp, size3);
+      coords_.clear();
+      for (uint i=0; i<size3; i += 3)
+        coords_.push_back(GCoord(tmp[i], tmp[i+1], tmp[i+2]) * 10.0);
+      delete[] tmp;
+      return(true);
+    }
+
+    /* Compression-time if we got here. Read precision first */
+    xdr_file.read(precision);
+    precision_ = precision;
+  
+    xdr_file.read(minint, 3);
+    xdr_file.read(maxint, 3);
+    if (!xdr_file.read(smallidx))
+      return(false);
+
+    /* The length in bytes of the compressed data */
+    if (!xdr_file.read(nbytes))
+      return(false);
+
+    compressed_.resize(nbytes);
+    if (nbytes && !xdr_file.read(reinterpret_cast<char*>(&compressed_[0]), nbytes))
+      return(false);
+
+    coords_.resize(lsize);
+    const char* mask = (!subset_mask_.empty() && subset_mask_.size() == static_cast<uint>(lsize)) ? &subset_mask_[0] : 0;
+    try {
+      decodeCompressed(nbytes ? &compressed_[0] : 0, nbytes, lsize, minint, maxint, smallidx, precision, &coords_[0], mask);
+    }
+    catch (LOOSError& e) {
+      throw(FileReadError(_filename, e.what()));
+    }
 
-    delete[] buf1;
-    delete[] buf2;
     return(true);
   }
 
 
 
+  // Decodes a complete frame (header and all) from a block of memory.
+  // If mask is given, only atoms with a non-zero entry are stored.
+  void XTC::decodeFrame(const unsigned char* p, const unsigned char* end, GCoord* coords, GCoord& frame_box, const char* mask) const {
+    MemoryXDR xdr(p, end);
+
+    if (xdr.getInt() != magic)
+      throw(LOOSError("Invalid XTC magic number"));
+    if (xdr.getUInt() != natoms_)
+      throw(LOOSError("XTC frame has an unexpected number of atoms"));
+    xdr.getUInt();       // step
+    xdr.getFloat();      // time
+
+    float b[9];
+    for (uint i=0; i<9; ++i)
+      b[i] = xdr.getFloat();
+    frame_box = GCoord(b[0], b[4], b[8]) * 10.0;
+
+    int lsize = xdr.getInt();
+    if (static_cast<uint>(lsize) != natoms_)
+      throw(LOOSError("XTC frame has an unexpected number of atoms"));
+
+    if (natoms_ <= min_compressed_system_size) {
+      for (uint i=0; i<natoms_; ++i) {
+        float x = xdr.getFloat();
+        float y = xdr.getFloat();
+        float z = xdr.getFloat();
+        coords[i] = GCoord(x, y, z) * 10.0;
+      }
+      return;
+    }
+
+    xtc_t precision = xdr.getFloat();
+    int minint[3], maxint[3];
+    for (uint i=0; i<3; ++i)
+      minint[i] = xdr.getInt();
+    for (uint i=0; i<3; ++i)
+      maxint[i] = xdr.getInt();
+    int smallidx = xdr.getInt();
+    uint nbytes = xdr.getUInt();
+    if (xdr.remaining() < static_cast<long>(nbytes))
+      throw(LOOSError("XTC frame is truncated"));
+
+    decodeCompressed(xdr.position(), nbytes, lsize, minint, maxint, smallidx, precision, coords, mask);
+  }
+
+
+
+  // Decodes a contiguous block of frames that have already been read
+  // into memory
+  struct XTC::FrameDecoder {
+    FrameDecoder(const XTC* x, const std::vector<unsigned char>* r, const std::vector<size_t>* o,
+                 GCoord* c, GCoord* b, const uint f, const uint l, std::string* e)
+      : xtc(x), raw(r), offsets(o), coords(c), boxes(b), first(f), last(l), error(e) { }
+
+    void operator()() {
+      try {
+        for (uint k=first; k<last; ++k)
+          xtc->decodeFrame(&((*raw)[0]) + (*offsets)[k], &((*raw)[0]) + (*offsets)[k+1],
+                           coords + static_cast<size_t>(k) * xtc->natoms_, boxes[k]);
+      }
+      catch (std::exception& e) {
+        *error = e.what();
+      }
+    }
+
+    const XTC* xtc;
+    const std::vector<unsigned char>* raw;
+    const std::vector<size_t>* offsets;
+    GCoord* coords;
+    GCoord* boxes;
+    uint first, last;
+    std::string* error;
+  };
+
+
+
+  // Reads the raw bytes for n frames starting with first in one block.
+  // Frame k is at offsets[k] through offsets[k+1] in raw.
+  void XTC::readRawFrames(const uint first, const uint n, std::vector<unsigned char>& raw, std::vector<size_t>& offsets) {
+    ifs->clear();
+    size_t begin = frame_indices[first];
+    size_t end;
+    if (first + n < frame_indices.size())
+      end = frame_indices[first + n];
+    else {
+      ifs->seekg(0, std::ios_base::end);
+      end = ifs->tellg();
+    }
+
+    raw.resize(end - begin);
+    ifs->seekg(begin, std::ios_base::beg);
+    ifs->read(reinterpret_cast<char*>(&raw[0]), raw.size());
+    if (ifs->fail())
+      throw(FileReadError(_filename, "Unable to read XTC frames"));
+
+    offsets.resize(n+1);
+    for (uint k=0; k<n; ++k)
+      offsets[k] = frame_indices[first + k] - begin;
+    offsets[n] = raw.size();
+  }
+
+
+  void XTC::readFrames(const uint first, const uint n, std::vector<GCoord>& coords, std::vector<GCoord>& boxes, const uint nthreads) {
+    if (static_cast<unsigned long>(first) + n > frame_indices.size())
+      throw(FileReadError(_filename, "Requested XTC frames are out of range"));
+
+    coords.resize(static_cast<size_t>(n) * natoms_);
+    boxes.resize(n);
+    if (n == 0)
+      return;
+
+    // Read all of the frames in one go...
+    std::vector<unsigned char> raw;
+    std::vector<size_t> offsets;
+    readRawFrames(first, n, raw, offsets);
+
+    // ...then decode them in parallel
+    uint nt = nthreads ? nthreads : boost::thread::hardware_concurrency();
+    if (nt == 0)
+      nt = 1;
+    if (nt > n)
+      nt = n;
+
+    std::vector<std::string> errors(nt);
+    boost::thread_group threads;
+    for (uint t=1; t<nt; ++t)
+      threads.create_thread(FrameDecoder(this, &raw, &offsets, &coords[0], &boxes[0],
+                                         (static_cast<unsigned long>(t) * n) / nt,
+                                         (static_cast<unsigned long>(t+1) * n) / nt,
+                                         &(errors[t])));
+    FrameDecoder(this, &raw, &offsets, &coords[0], &boxes[0], 0, n / nt, &(errors[0]))();
+    threads.join_all();
+
+    for (uint t=0; t<nt; ++t)
+      if (!errors[t].empty())
+        throw(FileReadError(_filename, errors[t]));
+  }
+
+
+
+  // Trajectory::readFrames() reads runs of up to 64 consecutive frames
+  // in one block, then decodes each frame in turn, storing only the
+  // requested atoms
+  template<typename T>
+  void XTC::readFrameBlock(const std::vector<uint>& frames, const std::vector<uint>& atoms, T* buffer) {
+    uint na = atoms.empty() ? natoms_ : atoms.size();
+
+    std::vector<char> mask;
+    if (!atoms.empty()) {
+      mask.resize(natoms_, 0);
+      for (std::vector<uint>::const_iterator i = atoms.begin(); i != atoms.end(); ++i)
+        mask[*i] = 1;
+    }
+
+    std::vector<unsigned char> raw;
+    std::vector<size_t> offsets;
+    std::vector<GCoord> frame(natoms_);
+    GCoord frame_box;
+
+    uint k = 0;
+    while (k < frames.size()) {
+      uint m = 1;
+      while (k + m < frames.size() && m < 64 && frames[k+m] == frames[k+m-1] + 1)
+        ++m;
+
+      readRawFrames(frames[k], m, raw, offsets);
+      for (uint i=0; i<m; ++i) {
+        try {
+          decodeFrame(&raw[0] + offsets[i], &raw[0] + offsets[i+1], &frame[0], frame_box, mask.empty() ? 0 : &mask[0]);
+        }
+        catch (LOOSError& e) {
+          throw(FileReadError(_filename, e.what()));
+        }
+
+        T* p = buffer + static_cast<size_t>(k + i) * na * 3;
+        for (uint j=0; j<na; ++j) {
+          const GCoord& c = frame[atoms.empty() ? j : atoms[j]];
+          *p++ = c[0];
+          *p++ = c[1];
+          *p++ = c[2];
+        }
+      }
+      k += m;
+    }
+  }
+
+
+  void XTC::readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer) {
+    readFrameBlock(frames, atoms, buffer);
+  }
+
+  void XTC::readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer) {
+    readFrameBlock(frames, atoms, buffer);
+  }
+
+
+
   bool XTC::readUncompressedCoords(void) 
   {
       uint lsize;
@@ -359,26 +629,42 @@ namespace loos {
 
   void XTC::updateGroupCoordsImpl(AtomicGroup& g) {
 
-    for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
-      uint idx = (*i)->index();
-      if (idx > natoms_)
-        throw(LOOSError(**i, "atom index into trajectory frame is out of range"));
-      (*i)->coords(coords_[idx]);
-    }
+    if (g.isPacked())
+      g.copyCoordinatesWithIndex(coords_);
+    else
+      for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+        uint idx = (*i)->index();
+        if (idx > natoms_)
+          throw(LOOSError(**i, "atom index into trajectory frame is out of range"));
+        (*i)->coords(coords_[idx]);
+      }
     
     // XTC files *always* have a periodic box...
     g.periodicBox(box);
   }
 
 
+  void XTC::setAtomSubsetImpl(void) {
+    subset_mask_.clear();
+    if (_atom_subset.empty())
+      return;
+
+    subset_mask_.resize(natoms_, 0);
+    for (std::vector<uint>::const_iterator i = _atom_subset.begin(); i != _atom_subset.end(); ++i)
+      subset_mask_[*i] = 1;
+  }
+
+
   bool XTC::parseFrame(void) {
     if (ifs->eof())
       return(false);
 
     // First, clear out existing coords...  A read error after this
-    // point will invalidate the current object's coord state
+    // point will invalidate the current object's coord state.  With a
+    // subset, the coords are kept so only the subset is overwritten.
 
-    coords_.clear();
+    if (subset_mask_.empty() || natoms_ <= min_compressed_system_size)
+      coords_.clear();
     if (!readFrameHeader(current_header_))
       return(false);
     
@@ -418,10 +704,24 @@ namespace loos {
 
   // Scan the trajectory file, skipping each compressed frame.  In the
   // process, we build up an index relating file-pos to frame index.
-  // This permits fast seeking of indivual frames.
+  // This permits fast seeking of indivual frames.  The index is saved
+  // alongside the trajectory (see TrajectoryIndex) so that subsequent
+  // opens can skip the scan.
   void XTC::scanFrames(void) {
     frame_indices.clear();
-    
+
+    bool use_index = (_filename != "istream");
+    if (use_index) {
+      std::vector<double> meta;
+      if (TrajectoryIndex(_filename, "XTC").read(frame_indices, meta) && meta.size() == 2 && !frame_indices.empty()) {
+        natoms_ = static_cast<uint>(meta[0]);
+        timestep_ = meta[1];
+        rewindImpl();
+        return;
+      }
+      frame_indices.clear();
+    }
+
     rewindImpl();
 
     Header h;
@@ -432,7 +732,7 @@ namespace loos {
       bool ok = readFrameHeader(h);
       if (!ok) {
         rewindImpl();
-        return;
+        break;
       }
 
       frame_indices.push_back(pos);
@@ -473,7 +773,13 @@ namespace loos {
     // Catch-all for I/O errors
     if (ifs->fail())
       throw(FileOpenError(_filename, "Problem scanning XTC trajectory to build frame indices"));
-    
+
+    if (use_index && !frame_indices.empty()) {
+      std::vector<double> meta;
+      meta.push_back(natoms_);
+      meta.push_back(timestep_);
+      TrajectoryIndex(_filename, "XTC").write(frame_indices, meta);
+    }
   }
 
 
@@ -56,7 +56,18 @@ namespace loos {
    * frames and to build an index that allows seeking to specific
    * frames.  This is done by reading only enough of each frame header
    * to permit building the index, so it should be a pretty fast
-   * operation.
+   * operation.  The index is also saved next to the trajectory (see
+   * TrajectoryIndex), so only the first open of a given file pays
+   * for the scan.
+   *
+   * Since the coordinates are compressed as a stream, every atom must
+   * still be decoded when an atom subset is set (see
+   * Trajectory::setAtomSubset()), but only those atoms are converted
+   * and stored by parseFrame().
+   *
+   * Trajectory::readFrames() reads runs of consecutive frames from
+   * the file in one block, like readFrames() below, then decodes them
+   * one at a time, converting only the requested atoms.
    */
   class XTC : public Trajectory {
 
@@ -82,11 +93,11 @@ namespace loos {
     typedef float    xtc_t;
 
   public:
-    explicit XTC(const std::string& s) : Trajectory(s), xdr_file(ifs.get()),natoms_(0) {
+    explicit XTC(const std::string& s) : Trajectory(s), xdr_file(ifs.get()), natoms_(0), timestep_(0) {
       init();
     }
 
-    explicit XTC(std::istream& is) : Trajectory(is), xdr_file(ifs.get()), natoms_(0) {
+    explicit XTC(std::istream& is) : Trajectory(is), xdr_file(ifs.get()), natoms_(0), timestep_(0) {
       init();
     }
 
@@ -110,6 +121,21 @@ namespace loos {
     //! Return the stored file's precision
     double precision(void) const { return(precision_); }
 
+    //! Read and decode \a n frames starting with frame \a first
+    /**
+     * All of the frames are read from the file in one block and then
+     * decompressed using \a nthreads threads (0 means use all
+     * available cores).  The coordinates for frame \a first + k are
+     * stored in \a coords starting at k * natoms(), and the
+     * corresponding periodic box is \a boxes[k].
+     *
+     * This does not change the current frame.  The file position is
+     * moved, but readFrame() and friends always seek before reading.
+     */
+    void readFrames(const uint first, const uint n, std::vector<GCoord>& coords, std::vector<GCoord>& boxes, const uint nthreads = 1);
+
+    using Trajectory::readFrames;
+
   private:
 
     void init(void) {
@@ -128,15 +154,22 @@ namespace loos {
     std::vector<GCoord> coords_;
     double timestep_;
     Header current_header_;
+    std::vector<unsigned char> compressed_;
+    std::vector<char> subset_mask_;     // Non-zero for atoms to store (empty means all)
     
     bool parseFrame(void);
 
   private:
 
-    int sizeofint(int);
-    int sizeofints(uint*, const uint);
-    int decodebits(int*, uint);
-    void decodeints(int*, const int, int, uint*, int*);
+    struct FrameDecoder;
+
+    static int sizeofint(int);
+    static int sizeofints(uint*, const uint);
+    static void decodeCompressed(const unsigned char* bytes, const uint nbytes, const int lsize,
+                                 const int* minint, const int* maxint, int smallidx,
+                                 const xtc_t precision, GCoord* coords, const char* mask = 0);
+    void decodeFrame(const unsigned char* p, const unsigned char* end, GCoord* coords, GCoord& frame_box, const char* mask = 0) const;
+    void readRawFrames(const uint first, const uint n, std::vector<unsigned char>& raw, std::vector<size_t>& offsets);
     bool readFrameHeader(Header&);
     void scanFrames(void);
     
@@ -144,6 +177,10 @@ namespace loos {
     void seekFrameImpl(uint);
     void rewindImpl(void) { ifs->clear(); ifs->seekg(0); }
     void updateGroupCoordsImpl(AtomicGroup& g);
+    void setAtomSubsetImpl(void);
+    virtual void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, double* buffer);
+    virtual void readFramesImpl(const std::vector<uint>& frames, const std::vector<uint>& atoms, float* buffer);
+    template<typename T> void readFrameBlock(const std::vector<uint>& frames, const std::vector<uint>& atoms, T* buffer);
     bool readCompressedCoords(void);
     bool readUncompressedCoords(void);
   };